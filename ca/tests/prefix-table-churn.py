@@ -0,0 +1,82 @@
+#!/usr/bin/env python
+# $Id$
+#
+# Copyright (C) 2026  Dragon Research Labs ("DRL")
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND DRL DISCLAIMS ALL WARRANTIES WITH
+# REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+# AND FITNESS.  IN NO EVENT SHALL DRL BE LIABLE FOR ANY SPECIAL, DIRECT,
+# INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+# LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE
+# OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+# PERFORMANCE OF THIS SOFTWARE.
+
+"""
+Announce/withdraw churn test for rpki.POW.PrefixTable.  Each round
+announces a fresh batch of random VRPs, withdraws them again, and
+checks that validation results are right along the way and that the
+table shrinks back to its empty size once everything is withdrawn.
+"""
+
+import sys
+import random
+import struct
+import argparse
+import rpki.POW
+
+parser = argparse.ArgumentParser(description = __doc__)
+parser.add_argument("--rounds", type = int, default = 50)
+parser.add_argument("--size", type = int, default = 2000)
+parser.add_argument("--seed", type = int, default = 1)
+args = parser.parse_args()
+
+def prefix_pdu(v6, announce, prefix, prefixlen, asn):
+    """
+    Build one RPKI-RTR version 1 prefix PDU.
+    """
+
+    if v6:
+        return struct.pack("!BBHLBBBx16sL", 1, 6, 0, 32, announce, prefixlen, prefixlen, prefix, asn)
+    else:
+        return struct.pack("!BBHLBBBx4sL",  1, 4, 0, 20, announce, prefixlen, prefixlen, prefix, asn)
+
+def random_prefix(v6):
+    """
+    Pick a random prefix, returned as (bytes, prefixlen).
+    """
+
+    nbits = 128 if v6 else 32
+    prefixlen = random.randint(0, nbits)
+    n = random.getrandbits(nbits) >> (nbits - prefixlen) << (nbits - prefixlen) if prefixlen else 0
+    return rpki.POW.IPAddress(n, 6 if v6 else 4).toBytes(), prefixlen
+
+random.seed(args.seed)
+
+table = rpki.POW.PrefixTable()
+empty = sys.getsizeof(table)
+
+for r in xrange(args.rounds):
+    v6 = r % 2 == 1
+    vrps = [random_prefix(v6) + (r * args.size + i,) for i in xrange(args.size)]
+    routes = [(rpki.POW.IPAddress.fromBytes(p), l, a) for p, l, a in vrps]
+
+    table.load("".join(prefix_pdu(v6, 1, p, l, a) for p, l, a in vrps))
+    assert len(table) == args.size
+    assert all(s == rpki.POW.ORIGIN_VALID for s in table.validate(routes))
+
+    table.load("".join(prefix_pdu(v6, 0, p, l, a) for p, l, a in vrps[1::2]))
+    assert len(table) == args.size - len(vrps[1::2])
+    assert all(s == rpki.POW.ORIGIN_VALID for s in table.validate(routes[0::2]))
+    assert all(s != rpki.POW.ORIGIN_VALID for s in table.validate(routes[1::2]))
+
+    table.load("".join(prefix_pdu(v6, 0, p, l, a) for p, l, a in vrps[0::2]))
+    assert len(table) == 0
+    assert all(s == rpki.POW.ORIGIN_NOT_FOUND for s in table.validate(routes))
+    assert sys.getsizeof(table) == empty, \
+        "Round %d left %d bytes of trie behind" % (r, sys.getsizeof(table) - empty)
+
+print "%d rounds of %d VRPs, table back to %d bytes" % (args.rounds, args.size, empty)
@@ -71,6 +71,11 @@
 #define	PY_SSIZE_T_CLEAN 1
 #include <Python.h>
 #include <datetime.h>
+#include <pythread.h>
+
+#ifdef WITH_THREAD
+#include <pthread.h>
+#endif
 
 #include <openssl/opensslconf.h>
 #include <openssl/crypto.h>
@@ -89,8 +94,25 @@
 
 #include <time.h>
 #include <string.h>
+#include <stdint.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/inotify.h>
+#endif
+
+#if defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__) || defined(__APPLE__)
+#include <sys/event.h>
+#define HAVE_KQUEUE 1
+#endif
 
 /*
  * GCC attribute to let us tell GCC not to whine about unused formal
@@ -131,15 +153,24 @@ define	GCC_UNUSED
 /* AsymmetricParam EC curves */
 #define EC_P256_CURVE         NID_X9_62_prime256v1
 
+/* Don't bother releasing the GIL to hash less than this much data */
+#define DIGEST_GIL_MINSIZE    2048
+
+/* Limits for verifyBatch() */
+#define BATCH_MAX_ERRORS      8
+#define BATCH_MAX_THREADS     64
+
 /* Object check functions */
 #define POW_X509_Check(op)              PyObject_TypeCheck(op, &POW_X509_Type)
 #define POW_X509StoreCTX_Check(op)      PyObject_TypeCheck(op, &POW_X509StoreCTX_Type)
+#define POW_X509Store_Check(op)         PyObject_TypeCheck(op, &POW_X509Store_Type)
 #define POW_CRL_Check(op)               PyObject_TypeCheck(op, &POW_CRL_Type)
 #define POW_Asymmetric_Check(op)        PyObject_TypeCheck(op, &POW_Asymmetric_Type)
 #define POW_AsymmetricParams_Check(op)	PyObject_TypeCheck(op, &POW_AsymmetricParams_Type)
 #define POW_Digest_Check(op)            PyObject_TypeCheck(op, &POW_Digest_Type)
 #define POW_CMS_Check(op)               PyObject_TypeCheck(op, &POW_CMS_Type)
 #define POW_IPAddress_Check(op)         PyObject_TypeCheck(op, &POW_IPAddress_Type)
+#define POW_ResourceSet_Check(op)       PyObject_TypeCheck(op, &POW_ResourceSet_Type)
 #define POW_ROA_Check(op)               PyObject_TypeCheck(op, &POW_ROA_Type)
 #define POW_Manifest_Check(op)          PyObject_TypeCheck(op, &POW_Manifest_Type)
 #define POW_ROA_Check(op)               PyObject_TypeCheck(op, &POW_ROA_Type)
@@ -322,16 +353,20 @@ static const ASN1_INTEGER *asn1_zero, *asn1_four_octets, *asn1_twenty_octets;
 static PyTypeObject
   POW_X509_Type,
   POW_X509StoreCTX_Type,
+  POW_X509Store_Type,
   POW_CRL_Type,
   POW_Asymmetric_Type,
   POW_AsymmetricParams_Type,
   POW_Digest_Type,
   POW_CMS_Type,
   POW_IPAddress_Type,
+  POW_ResourceSet_Type,
   POW_ROA_Type,
   POW_Manifest_Type,
   POW_ROA_Type,
-  POW_PKCS10_Type;
+  POW_PKCS10_Type,
+  POW_PrefixTable_Type,
+  POW_OriginValidator_Type;
 
 /*
  * Object internals.
@@ -343,6 +378,21 @@ typedef struct {
   const struct ipaddress_version *type;
 } ipaddress_object;
 
+typedef struct {
+  uint64_t hi, lo;
+} resource_u128;
+
+typedef struct {
+  resource_u128 min, max;
+} resource_interval;
+
+typedef struct {
+  PyObject_HEAD
+  resource_interval *v;         /* Canonical: sorted, merged */
+  Py_ssize_t n;
+  int version;                  /* 0 for ASNs, otherwise IP version */
+} resource_set_object;
+
 typedef struct {
   PyObject_HEAD
   X509 *x509;
@@ -354,6 +404,12 @@ typedef struct {
   X509_STORE *store;
 } x509_store_ctx_object;
 
+typedef struct {
+  PyObject_HEAD
+  PyObject *certs;              /* List of X509 objects, top of stack last */
+  STACK_OF(X509) *stack;        /* Same certificates, borrowed from certs */
+} x509_store_object;
+
 typedef struct {
   PyObject_HEAD
   X509_CRL *crl;
@@ -378,6 +434,8 @@ typedef struct {
 typedef struct {
   PyObject_HEAD
   CMS_ContentInfo *cms;
+  unsigned char *der;           /* Not yet decoded, see cms_object_get_cms() */
+  long der_len;
 } cms_object;
 
 typedef struct {
@@ -510,6 +568,72 @@ evp_digest_factory(int digest_type)
   }
 }
 
+/*
+ * OpenSSL thread support.
+ *
+ * OpenSSL 1.0.x is only thread-safe if the application supplies a set
+ * of locks and a way to identify the current thread.  We use Python's
+ * portable thread API for both, like Python's own _ssl module, but we
+ * have to set this up ourselves because we link our own copy of
+ * OpenSSL.  Once this is in place, we can release the interpreter
+ * lock around OpenSSL calls that do real work (public key operations,
+ * signature verification, hashing large buffers), so that threaded
+ * callers can use more than one CPU.
+ *
+ * Releasing the interpreter lock only makes OpenSSL itself safe.  The
+ * Python objects whose OpenSSL guts we're using stay alive because
+ * self and the arguments are referenced by our caller, but nothing
+ * stops another thread from modifying the same POW object at the same
+ * time, so don't do that.
+ */
+
+#ifdef WITH_THREAD
+
+static PyThread_type_lock *openssl_locks = NULL;
+
+static void
+openssl_locking_callback(int mode, int n, GCC_UNUSED const char *file, GCC_UNUSED int line)
+{
+  if (mode & CRYPTO_LOCK)
+    PyThread_acquire_lock(openssl_locks[n], WAIT_LOCK);
+  else
+    PyThread_release_lock(openssl_locks[n]);
+}
+
+static void
+openssl_threadid_callback(CRYPTO_THREADID *id)
+{
+  CRYPTO_THREADID_set_numeric(id, PyThread_get_thread_ident());
+}
+
+static int
+openssl_setup_threads(void)
+{
+  int i, n = CRYPTO_num_locks();
+
+  if (openssl_locks != NULL)
+    return 1;
+
+  if ((openssl_locks = PyMem_Malloc(n * sizeof(*openssl_locks))) == NULL)
+    return 0;
+
+  for (i = 0; i < n; i++) {
+    if ((openssl_locks[i] = PyThread_allocate_lock()) == NULL) {
+      while (--i >= 0)
+        PyThread_free_lock(openssl_locks[i]);
+      PyMem_Free(openssl_locks);
+      openssl_locks = NULL;
+      return 0;
+    }
+  }
+
+  CRYPTO_THREADID_set_callback(openssl_threadid_callback);
+  CRYPTO_set_locking_callback(openssl_locking_callback);
+  return 1;
+}
+
+#endif /* WITH_THREAD */
+
 /*
  * Raise an exception with data pulled from the OpenSSL error stack.
  * Exception value is a tuple with some internal structure.
@@ -739,6 +863,12 @@ x509_helper_iterable_to_stack(PyObject *iterable)
   PyObject *iterator = NULL;
   PyObject *item = NULL;
 
+  if (POW_X509Store_Check(iterable)) {
+    if ((stack = sk_X509_dup(((x509_store_object *) iterable)->stack)) == NULL)
+      lose_no_memory();
+    return stack;
+  }
+
   if ((stack = sk_X509_new_null()) == NULL)
     lose_no_memory();
 
@@ -933,29 +1063,66 @@ BIO_to_PyString_helper(BIO *bio)
   return NULL;
 }
 
+/*
+ * If a BIO is a memory BIO with something in it, return a pointer to
+ * its contents, so that DER read helpers can run d2i_*() directly on
+ * the caller's buffer instead of letting d2i_*_bio() copy the whole
+ * object into a temporary buffer first.  Returns NULL otherwise, in
+ * which case the caller should fall back to d2i_*_bio().
+ */
+static const unsigned char *
+mem_bio_der(BIO *bio, long *len)
+{
+  char *ptr = NULL;
+
+  if (BIO_method_type(bio) != BIO_TYPE_MEM)
+    return NULL;
+
+  if ((*len = BIO_get_mem_data(bio, &ptr)) <= 0)
+    return NULL;
+
+  return (const unsigned char *) ptr;
+}
+
+/*
+ * Read an object from anything that supports the buffer protocol
+ * (str, bytearray, memoryview, mmap, ...).  The memory BIO we wrap
+ * around the buffer is read-only and doesn't copy anything.
+ */
 static PyObject *
 read_from_string_helper(PyObject *(*object_read_helper)(PyTypeObject *, BIO *),
                         PyTypeObject *type,
                         PyObject *args)
 {
   PyObject *result = NULL;
-  char *src = NULL;
+  Py_buffer src;
   BIO *bio = NULL;
-  Py_ssize_t len = 0;
 
-  if (!PyArg_ParseTuple(args, "s#", &src, &len))
+  src.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*", &src))
     goto error;
 
-  if ((bio = BIO_new_mem_buf(src, len)) == NULL)
+  if ((bio = BIO_new_mem_buf(src.buf, src.len)) == NULL)
     lose_no_memory();
 
   result = object_read_helper(type, bio);
 
  error:
   BIO_free(bio);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
   return result;
 }
 
+/*
+ * Read an object from a file.  Where we can, we map the file and
+ * hand the object read helper a memory BIO over the mapping, which
+ * saves both the stdio buffering and the extra copy d2i_*_bio()
+ * would otherwise make.  Anything we can't map (empty files, pipes,
+ * and so forth) goes through a file BIO as before, which also keeps
+ * error reporting for missing files unchanged.
+ */
 static PyObject *
 read_from_file_helper(PyObject *(*object_read_helper)(PyTypeObject *, BIO *),
                       PyTypeObject *type,
@@ -963,18 +1130,37 @@ read_from_file_helper(PyObject *(*object_read_helper)(PyTypeObject *, BIO *),
 {
   const char *filename = NULL;
   PyObject *result = NULL;
+  void *map = MAP_FAILED;
+  size_t maplen = 0;
   BIO *bio = NULL;
+  struct stat sb;
+  int fd = -1;
 
   if (!PyArg_ParseTuple(args, "s", &filename))
     goto error;
 
-  if ((bio = BIO_new_file(filename, "rb")) == NULL)
-    lose_openssl_error("Could not open file");
+  if ((fd = open(filename, O_RDONLY)) >= 0 &&
+      fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0 &&
+      (map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    maplen = (size_t) sb.st_size;
+
+  if (fd >= 0)
+    (void) close(fd);
+
+  if (map != MAP_FAILED) {
+    if ((bio = BIO_new_mem_buf(map, (int) maplen)) == NULL)
+      lose_no_memory();
+  } else {
+    if ((bio = BIO_new_file(filename, "rb")) == NULL)
+      lose_openssl_error("Could not open file");
+  }
 
   result = object_read_helper(type, bio);
 
  error:
   BIO_free(bio);
+  if (map != MAP_FAILED)
+    (void) munmap(map, maplen);
   return result;
 }
 
@@ -1305,7 +1491,9 @@ static int check_crl(X509_CRL *crl,
         record_validation_status(status, DISALLOWED_X509V3_EXTENSION);
 
   if ((pkey = X509_get_pubkey(issuer)) != NULL) {
+    Py_BEGIN_ALLOW_THREADS
     ret = X509_CRL_verify(crl, pkey) > 0;
+    Py_END_ALLOW_THREADS
     EVP_PKEY_free(pkey);
   }
 
@@ -2322,6 +2510,143 @@ extension_set_aki(PyObject *args)
 
 
 
+/*
+ * 128-bit unsigned arithmetic, using a pair of 64-bit limbs.  Used by
+ * IPAddress and ResourceSet objects, so that common operations on
+ * addresses don't have to go through Python longs.
+ */
+
+#define U128_LT(_a_, _b_)  ((_a_).hi < (_b_).hi || ((_a_).hi == (_b_).hi && (_a_).lo < (_b_).lo))
+#define U128_LE(_a_, _b_)  (!U128_LT(_b_, _a_))
+#define U128_EQ(_a_, _b_)  ((_a_).hi == (_b_).hi && (_a_).lo == (_b_).lo)
+
+static resource_u128
+u128_inc(resource_u128 a)
+{
+  if (++a.lo == 0)
+    a.hi++;
+  return a;
+}
+
+static resource_u128
+u128_dec(resource_u128 a)
+{
+  if (a.lo-- == 0)
+    a.hi--;
+  return a;
+}
+
+/*
+ * Number of trailing zero bits, capped at the given width.
+ */
+static unsigned
+u128_ctz(const resource_u128 a, const unsigned bits)
+{
+  unsigned n = bits;
+
+  if (a.lo != 0)
+    n = __builtin_ctzll(a.lo);
+  else if (a.hi != 0)
+    n = 64 + __builtin_ctzll(a.hi);
+
+  return n < bits ? n : bits;
+}
+
+static resource_u128
+u128_mask(const unsigned nbits)
+{
+  resource_u128 m;
+
+  m.lo = nbits >= 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << nbits) - 1);
+  m.hi = nbits >= 128 ? ~(uint64_t) 0 : nbits <= 64 ? 0 : (((uint64_t) 1 << (nbits - 64)) - 1);
+
+  return m;
+}
+
+static resource_u128
+u128_shl(const resource_u128 a, const unsigned n)
+{
+  resource_u128 r;
+
+  if (n == 0)
+    return a;
+
+  if (n >= 64) {
+    r.hi = a.lo << (n - 64);
+    r.lo = 0;
+  } else {
+    r.hi = (a.hi << n) | (a.lo >> (64 - n));
+    r.lo = a.lo << n;
+  }
+
+  return r;
+}
+
+static resource_u128
+u128_shr(const resource_u128 a, const unsigned n)
+{
+  resource_u128 r;
+
+  if (n == 0)
+    return a;
+
+  if (n >= 64) {
+    r.lo = a.hi >> (n - 64);
+    r.hi = 0;
+  } else {
+    r.lo = (a.lo >> n) | (a.hi << (64 - n));
+    r.hi = a.hi >> n;
+  }
+
+  return r;
+}
+
+static int
+u128_cmp(const resource_u128 a, const resource_u128 b)
+{
+  return U128_LT(a, b) ? -1 : U128_LT(b, a) ? 1 : 0;
+}
+
+/*
+ * Convert between IPAddress objects and 128-bit integers.
+ */
+
+static void
+ipaddress_get_u128(const ipaddress_object *addr, resource_u128 *u)
+{
+  unsigned i;
+
+  u->hi = u->lo = 0;
+
+  for (i = 0; i < addr->type->length; i++) {
+    u->hi = (u->hi << 8) | (u->lo >> 56);
+    u->lo = (u->lo << 8) | addr->address[i];
+  }
+}
+
+static void
+ipaddress_set_u128(ipaddress_object *addr, const resource_u128 value)
+{
+  resource_u128 u = value;
+  int i;
+
+  memset(addr->address, 0, sizeof(addr->address));
+
+  for (i = addr->type->length - 1; i >= 0; i--) {
+    addr->address[i] = u.lo & 0xFF;
+    u.lo = (u.lo >> 8) | (u.hi << 56);
+    u.hi >>= 8;
+  }
+}
+
+static int
+ipaddress_u128_fits(const ipaddress_version *type, const resource_u128 u)
+{
+  return type->length == 16 || (u.hi == 0 && u.lo <= 0xFFFFFFFFUL);
+}
+
+
+
 /*
  * IPAddress object.
  */
@@ -2418,15 +2743,68 @@ ipaddress_object_repr(ipaddress_object *self)
   return NULL;
 }
 
+/*
+ * Convert an operand for arithmetic or comparison to a 128-bit
+ * integer.  If type is not NULL, IPAddress operands must be of that
+ * type.  Returns zero for anything we can't handle natively (negative
+ * numbers, huge numbers, other types), in which case the caller falls
+ * back to doing the operation with Python longs.
+ */
+static int
+ipaddress_object_operand(PyObject *o, const ipaddress_version *type, resource_u128 *u)
+{
+  unsigned char buf[16];
+  long v;
+  int i;
+
+  if (POW_IPAddress_Check(o)) {
+    if (type != NULL && ((ipaddress_object *) o)->type != type)
+      return 0;
+    ipaddress_get_u128((ipaddress_object *) o, u);
+    return 1;
+  }
+
+  if (PyInt_Check(o)) {
+    if ((v = PyInt_AS_LONG(o)) < 0)
+      return 0;
+    u->hi = 0;
+    u->lo = (unsigned long) v;
+    return 1;
+  }
+
+  if (PyLong_Check(o)) {
+    if (_PyLong_AsByteArray((PyLongObject *) o, buf, sizeof(buf), 0, 0) < 0) {
+      PyErr_Clear();
+      return 0;
+    }
+    u->hi = u->lo = 0;
+    for (i = 0; i < 8; i++) {
+      u->hi = (u->hi << 8) | buf[i];
+      u->lo = (u->lo << 8) | buf[i + 8];
+    }
+    return 1;
+  }
+
+  return 0;
+}
+
 static int
 ipaddress_object_compare(PyObject *arg1, PyObject *arg2)
 {
-  PyObject *obj1 = PyNumber_Long(arg1);
-  PyObject *obj2 = PyNumber_Long(arg2);
+  PyObject *obj1 = NULL;
+  PyObject *obj2 = NULL;
+  resource_u128 u1, u2;
   int cmp = -1;
 
   ENTERING(ipaddress_object_compare);
 
+  if (ipaddress_object_operand(arg1, NULL, &u1) &&
+      ipaddress_object_operand(arg2, NULL, &u2))
+    return u128_cmp(u1, u2);
+
+  obj1 = PyNumber_Long(arg1);
+  obj2 = PyNumber_Long(arg2);
+
   if (obj1 != NULL && obj2 != NULL)
     cmp = PyObject_Compare(obj1, obj2);
 
@@ -2438,12 +2816,33 @@ ipaddress_object_compare(PyObject *arg1, PyObject *arg2)
 static PyObject *
 ipaddress_object_richcompare(PyObject *arg1, PyObject *arg2, int op)
 {
-  PyObject *obj1 = PyNumber_Long(arg1);
-  PyObject *obj2 = PyNumber_Long(arg2);
+  PyObject *obj1 = NULL;
+  PyObject *obj2 = NULL;
   PyObject *result = NULL;
+  resource_u128 u1, u2;
+  int cmp;
 
   ENTERING(ipaddress_object_richcompare);
 
+  if (ipaddress_object_operand(arg1, NULL, &u1) &&
+      ipaddress_object_operand(arg2, NULL, &u2)) {
+    cmp = u128_cmp(u1, u2);
+    switch (op) {
+    case Py_LT: result = cmp <  0 ? Py_True : Py_False; break;
+    case Py_LE: result = cmp <= 0 ? Py_True : Py_False; break;
+    case Py_EQ: result = cmp == 0 ? Py_True : Py_False; break;
+    case Py_NE: result = cmp != 0 ? Py_True : Py_False; break;
+    case Py_GT: result = cmp >  0 ? Py_True : Py_False; break;
+    case Py_GE: result = cmp >= 0 ? Py_True : Py_False; break;
+    default:    result = Py_NotImplemented;
+    }
+    Py_INCREF(result);
+    return result;
+  }
+
+  obj1 = PyNumber_Long(arg1);
+  obj2 = PyNumber_Long(arg2);
+
   if (obj1 != NULL && obj2 != NULL)
     result = PyObject_RichCompare(obj1, obj2, op);
 
@@ -2452,18 +2851,26 @@ ipaddress_object_richcompare(PyObject *arg1, PyObject *arg2, int op)
   return result;
 }
 
+/*
+ * Where the value fits in a long, hash the same way Python hashes the
+ * equivalent integer, since we compare equal to it.
+ */
 static long
 ipaddress_object_hash(ipaddress_object *self)
 {
-  unsigned long h = 0;
-  int i;
+  unsigned long h;
+  resource_u128 u;
 
   ENTERING(ipaddress_object_hash);
 
-  for (i = 0; (unsigned) i < self->type->length; i++)
-    h ^= self->address[i] << ((i & 3) << 3);
+  ipaddress_get_u128(self, &u);
+
+  if (u.hi == 0 && u.lo <= (uint64_t) LONG_MAX)
+    h = (unsigned long) u.lo;
+  else
+    h = (unsigned long) (u.hi ^ (u.hi >> 32) ^ u.lo ^ (u.lo >> 32));
 
-  return (long) h == -1 ? 0 : (long) h;
+  return (long) h == -1 ? -2 : (long) h;
 }
 
 static char ipaddress_object_from_bytes__doc__[] =
@@ -2505,6 +2912,65 @@ ipaddress_object_from_bytes(PyTypeObject *type, PyObject *args)
   return NULL;
 }
 
+static char ipaddress_object_from_packed_bytes__doc__[] =
+  "Construct a tuple of IPAddress objects from a packed buffer.\n"
+  "\n"
+  "The first argument is any object supporting the buffer protocol,\n"
+  "containing concatenated 4-byte or 16-byte addresses.  The second\n"
+  "argument is the IP version (4 or 6).\n"
+  ;
+
+static PyObject *
+ipaddress_object_from_packed_bytes(PyTypeObject *type, PyObject *args)
+{
+  const ipaddress_version *ip_type = NULL;
+  ipaddress_object *addr = NULL;
+  PyObject *result = NULL;
+  const unsigned char *p;
+  Py_ssize_t i, n;
+  Py_buffer src;
+  int version, v;
+
+  ENTERING(ipaddress_object_from_packed_bytes);
+
+  src.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*i", &src, &version))
+    goto error;
+
+  for (v = 0; v < (int) (sizeof(ipaddress_versions)/sizeof(*ipaddress_versions)); v++)
+    if ((unsigned) version == ipaddress_versions[v]->version)
+      ip_type = ipaddress_versions[v];
+
+  if (ip_type == NULL)
+    lose("Unknown IP version number");
+
+  if (src.len % ip_type->length != 0)
+    lose_value_error("Buffer length is not a multiple of the address length");
+
+  n = src.len / ip_type->length;
+
+  if ((result = PyTuple_New(n)) == NULL)
+    goto error;
+
+  for (i = 0, p = src.buf; i < n; i++, p += ip_type->length) {
+    if ((addr = (ipaddress_object *) type->tp_alloc(type, 0)) == NULL)
+      goto error;
+    addr->type = ip_type;
+    memcpy(addr->address, p, ip_type->length);
+    PyTuple_SET_ITEM(result, i, (PyObject *) addr);
+  }
+
+  PyBuffer_Release(&src);
+  return result;
+
+ error:
+  Py_XDECREF(result);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return NULL;
+}
+
 static char ipaddress_object_to_bytes__doc__[] =
   "Return the binary value of this IPAddress as a Python string\n"
   "of exactly 4 or 16 bytes.\n"
@@ -2531,6 +2997,72 @@ ipaddress_object_get_version(ipaddress_object *self, GCC_UNUSED void *closure)
   return PyInt_FromLong(self->type->version);
 }
 
+/*
+ * Do a binary operation natively.  Returns zero if the result would
+ * be negative or wouldn't fit, so that the caller can fall back to
+ * Python longs, which raise the appropriate exceptions.
+ */
+static int
+ipaddress_u128_binary(binaryfunc function, const ipaddress_version *type,
+                      const resource_u128 a, const resource_u128 b, resource_u128 *r)
+{
+  const unsigned bits = type->length * 8;
+  uint64_t t;
+
+  if (function == PyNumber_Add) {
+    r->lo = a.lo + b.lo;
+    t = a.hi + b.hi;
+    if (t < a.hi)
+      return 0;
+    r->hi = t + (r->lo < a.lo);
+    if (r->hi < t)
+      return 0;
+  }
+
+  else if (function == PyNumber_Subtract) {
+    if (U128_LT(a, b))
+      return 0;
+    r->lo = a.lo - b.lo;
+    r->hi = a.hi - b.hi - (a.lo < b.lo);
+  }
+
+  else if (function == PyNumber_Lshift) {
+    if (b.hi != 0 || b.lo >= bits)
+      return 0;
+    *r = u128_shl(a, b.lo);
+    if (!U128_EQ(u128_shr(*r, b.lo), a))
+      return 0;
+  }
+
+  else if (function == PyNumber_Rshift) {
+    if (b.hi != 0 || b.lo >= 128)
+      r->hi = r->lo = 0;
+    else
+      *r = u128_shr(a, b.lo);
+  }
+
+  else if (function == PyNumber_And) {
+    r->hi = a.hi & b.hi;
+    r->lo = a.lo & b.lo;
+  }
+
+  else if (function == PyNumber_Xor) {
+    r->hi = a.hi ^ b.hi;
+    r->lo = a.lo ^ b.lo;
+  }
+
+  else if (function == PyNumber_Or) {
+    r->hi = a.hi | b.hi;
+    r->lo = a.lo | b.lo;
+  }
+
+  else {
+    return 0;
+  }
+
+  return ipaddress_u128_fits(type, *r);
+}
+
 static PyObject *
 ipaddress_object_number_binary_helper(binaryfunc function, PyObject *arg1, PyObject *arg2)
 {
@@ -2542,6 +3074,7 @@ ipaddress_object_number_binary_helper(binaryfunc function, PyObject *arg1, PyObj
   PyObject *obj2 = NULL;
   PyObject *obj3 = NULL;
   PyObject *obj4 = NULL;
+  resource_u128 u1, u2, u3;
 
   if (POW_IPAddress_Check(arg1))
     addr1 = (ipaddress_object *) arg1;
@@ -2549,6 +3082,19 @@ ipaddress_object_number_binary_helper(binaryfunc function, PyObject *arg1, PyObj
   if (POW_IPAddress_Check(arg2))
     addr2 = (ipaddress_object *) arg2;
 
+  addr = addr1 != NULL ? addr1 : addr2;
+
+  if (addr != NULL &&
+      ipaddress_object_operand(arg1, addr->type, &u1) &&
+      ipaddress_object_operand(arg2, addr->type, &u2) &&
+      ipaddress_u128_binary(function, addr->type, u1, u2, &u3)) {
+    if ((result = (ipaddress_object *) addr->ob_type->tp_alloc(addr->ob_type, 0)) != NULL) {
+      result->type = addr->type;
+      ipaddress_set_u128(result, u3);
+    }
+    return (PyObject *) result;
+  }
+
   if ((addr1 == NULL && addr2 == NULL) ||
       (addr1 != NULL && addr2 != NULL && addr1->type != addr2->type) ||
       (obj1 = PyNumber_Long(arg1)) == NULL ||
@@ -2564,8 +3110,6 @@ ipaddress_object_number_binary_helper(binaryfunc function, PyObject *arg1, PyObj
   if ((obj4 = PyNumber_Long(obj3)) == NULL)
     lose("Couldn't convert result");
 
-  addr = addr1 != NULL ? addr1 : addr2;
-
   if ((result = (ipaddress_object *) addr->ob_type->tp_alloc(addr->ob_type, 0)) == NULL)
     goto error;
 
@@ -2713,6 +3257,7 @@ static struct PyMethodDef ipaddress_object_methods[] = {
   Define_Method(__deepcopy__,		ipaddress_object_copy,		METH_VARARGS),
   Define_Method(toBytes,                ipaddress_object_to_bytes,      METH_NOARGS),
   Define_Class_Method(fromBytes,        ipaddress_object_from_bytes,    METH_VARARGS),
+  Define_Class_Method(fromPackedBytes,  ipaddress_object_from_packed_bytes, METH_VARARGS),
   {NULL}
 };
 
@@ -2806,3202 +3351,3602 @@ static PyTypeObject POW_IPAddress_Type = {
   ipaddress_object_new,                     /* tp_new */
 };
 
-
+
 
 /*
- * X509 object.
+ * ResourceSet object.
+ *
+ * This is the engine underneath rpki.resource_set: a canonical
+ * (sorted, non-overlapping, non-adjacent) array of intervals, with
+ * endpoints packed into 128-bit integers so that ASNs, IPv4, and IPv6
+ * all use the same code.  Set operations are linear merges over the
+ * two arrays, rather than the pop-and-split loops the Python code
+ * used, and nothing allocates per range until results are converted
+ * back to Python.
  */
 
-static x509_object *
-x509_object_new_helper(PyTypeObject *type, X509 *x)
+/*
+ * Append an interval to a canonical array, merging it with the last
+ * interval if they overlap or touch.  Intervals must be appended in
+ * order of their minimum values, and the caller must have allocated
+ * enough space.
+ */
+static void
+resource_interval_append(resource_interval *v, Py_ssize_t *n,
+                         const resource_u128 min, const resource_u128 max)
+{
+  resource_interval *last = *n > 0 ? &v[*n - 1] : NULL;
+
+  if (last != NULL && (U128_LE(min, last->max) || U128_EQ(min, u128_inc(last->max)))) {
+    if (U128_LT(last->max, max))
+      last->max = max;
+  } else {
+    v[*n].min = min;
+    v[*n].max = max;
+    (*n)++;
+  }
+}
+
+static void
+resource_interval_union(const resource_interval *a, const Py_ssize_t na,
+                        const resource_interval *b, const Py_ssize_t nb,
+                        resource_interval *out, Py_ssize_t *nout)
 {
-  x509_object *self;
+  Py_ssize_t i = 0, j = 0;
 
-  if (type == NULL)
-    type = &POW_X509_Type;
+  *nout = 0;
 
-  if ((self = (x509_object *) type->tp_alloc(type, 0)) == NULL)
-    return NULL;
+  while (i < na || j < nb) {
+    if (j >= nb || (i < na && U128_LT(a[i].min, b[j].min))) {
+      resource_interval_append(out, nout, a[i].min, a[i].max);
+      i++;
+    } else {
+      resource_interval_append(out, nout, b[j].min, b[j].max);
+      j++;
+    }
+  }
+}
 
-  self->x509 = x;
-  return self;
+static void
+resource_interval_intersection(const resource_interval *a, const Py_ssize_t na,
+                               const resource_interval *b, const Py_ssize_t nb,
+                               resource_interval *out, Py_ssize_t *nout)
+{
+  Py_ssize_t i = 0, j = 0;
+
+  *nout = 0;
+
+  while (i < na && j < nb) {
+    const resource_u128 min = U128_LT(a[i].min, b[j].min) ? b[j].min : a[i].min;
+    const resource_u128 max = U128_LT(a[i].max, b[j].max) ? a[i].max : b[j].max;
+
+    if (U128_LE(min, max))
+      resource_interval_append(out, nout, min, max);
+
+    if (U128_LT(a[i].max, b[j].max))
+      i++;
+    else
+      j++;
+  }
 }
 
-static PyObject *
-x509_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+static void
+resource_interval_difference(const resource_interval *a, const Py_ssize_t na,
+                             const resource_interval *b, const Py_ssize_t nb,
+                             resource_interval *out, Py_ssize_t *nout)
 {
-  x509_object *self = NULL;
-  X509 *x = NULL;
+  Py_ssize_t i, j = 0, k;
 
-  ENTERING(x509_object_new);
+  *nout = 0;
 
-  if ((x = X509_new()) == NULL)
-    lose_no_memory();
+  for (i = 0; i < na; i++) {
+    resource_u128 min = a[i].min;
+    int done = 0;
 
-  if ((self = x509_object_new_helper(type, x)) == NULL)
+    while (j < nb && U128_LT(b[j].max, min))
+      j++;
+
+    for (k = j; !done && k < nb && U128_LE(b[k].min, a[i].max); k++) {
+      if (U128_LT(min, b[k].min))
+        resource_interval_append(out, nout, min, u128_dec(b[k].min));
+      if (U128_LE(a[i].max, b[k].max))
+        done = 1;
+      else
+        min = u128_inc(b[k].max);
+    }
+
+    if (!done)
+      resource_interval_append(out, nout, min, a[i].max);
+  }
+}
+
+static int
+resource_interval_issubset(const resource_interval *a, const Py_ssize_t na,
+                           const resource_interval *b, const Py_ssize_t nb)
+{
+  Py_ssize_t i, j = 0;
+
+  for (i = 0; i < na; i++) {
+    while (j < nb && U128_LT(b[j].max, a[i].min))
+      j++;
+    if (j >= nb || U128_LT(a[i].min, b[j].min) || U128_LT(b[j].max, a[i].max))
+      return 0;
+  }
+
+  return 1;
+}
+
+static int
+resource_interval_cmp(const void *a, const void *b)
+{
+  const resource_interval *x = a, *y = b;
+
+  if (U128_LT(x->min, y->min))
+    return -1;
+  if (U128_LT(y->min, x->min))
+    return 1;
+  if (U128_LT(x->max, y->max))
+    return -1;
+  if (U128_LT(y->max, x->max))
+    return 1;
+  return 0;
+}
+
+static unsigned
+resource_set_bits(const resource_set_object *self)
+{
+  switch (self->version) {
+  case 4:  return 32;
+  case 6:  return 128;
+  default: return 0;
+  }
+}
+
+static resource_set_object *
+resource_set_object_alloc(PyTypeObject *type, const int version, const Py_ssize_t cap)
+{
+  resource_set_object *self = NULL;
+
+  if ((self = (resource_set_object *) type->tp_alloc(type, 0)) == NULL)
     goto error;
 
-  return (PyObject *) self;
+  self->version = version;
+
+  if (cap > 0 && (self->v = PyMem_New(resource_interval, cap)) == NULL)
+    lose_no_memory();
+
+  return self;
 
  error:
-  X509_free(x);
+  Py_XDECREF(self);
   return NULL;
 }
 
+static PyObject *
+resource_set_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+{
+  ENTERING(resource_set_object_new);
+  return (PyObject *) resource_set_object_alloc(type, 0, 0);
+}
+
 static void
-x509_object_dealloc(x509_object *self)
+resource_set_object_dealloc(resource_set_object *self)
 {
-  ENTERING(x509_object_dealloc);
-  X509_free(self->x509);
+  ENTERING(resource_set_object_dealloc);
+  PyMem_Free(self->v);
   self->ob_type->tp_free((PyObject*) self);
 }
 
+/*
+ * Convert one endpoint from Python.  ASNs are integers, addresses
+ * are IPAddress objects of the right version.
+ */
+static int
+resource_set_value_from_python(const int version, PyObject *o, resource_u128 *result)
+{
+  unsigned PY_LONG_LONG asn;
+
+  result->hi = result->lo = 0;
+
+  if (version == 0) {
+    if ((o = PyNumber_Long(o)) == NULL)
+      goto error;
+    asn = PyLong_AsUnsignedLongLong(o);
+    Py_XDECREF(o);
+    if (PyErr_Occurred())
+      goto error;
+    result->lo = asn;
+    return 1;
+  }
+
+  if (!POW_IPAddress_Check(o) || ((ipaddress_object *) o)->type->version != (unsigned) version)
+    lose_type_error("Expected an IPAddress of the same version as the ResourceSet");
+
+  ipaddress_get_u128((ipaddress_object *) o, result);
+  return 1;
+
+ error:
+  return 0;
+}
+
 static PyObject *
-x509_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+resource_set_value_to_python(const int version, const resource_u128 value)
 {
-  x509_object *self = NULL;
+  ipaddress_object *addr = NULL;
 
-  ENTERING(x509_object_pem_read_helper);
+  if (version == 0)
+    return PyLong_FromUnsignedLongLong(value.lo);
 
-  if ((self = (x509_object *) x509_object_new(type, NULL, NULL)) == NULL)
+  if ((addr = (ipaddress_object *) POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL)
+    return NULL;
+
+  addr->type = version == 4 ? &ipaddress_version_4 : &ipaddress_version_6;
+  ipaddress_set_u128(addr, value);
+  return (PyObject *) addr;
+}
+
+/*
+ * Whack the first n intervals of self->v into canonical form.
+ * Appending in place is safe because the write index never passes
+ * the read index.
+ */
+static void
+resource_set_canonize(resource_set_object *self, const Py_ssize_t n, const int sorted)
+{
+  Py_ssize_t i;
+
+  if (!sorted)
+    qsort(self->v, n, sizeof(*self->v), resource_interval_cmp);
+
+  self->n = 0;
+
+  for (i = 0; i < n; i++)
+    resource_interval_append(self->v, &self->n, self->v[i].min, self->v[i].max);
+}
+
+/*
+ * Width in bytes of one endpoint in the packed representation used by
+ * ResourceSet.fromPacked() and X509.getRFC3779Packed().
+ */
+static unsigned
+resource_set_packed_width(const int version)
+{
+  return version == 6 ? 16 : 4;
+}
+
+static resource_u128
+resource_u128_from_bytes(const unsigned char *p, const unsigned width)
+{
+  resource_u128 u;
+  unsigned i;
+
+  u.hi = u.lo = 0;
+
+  for (i = 0; i < width; i++) {
+    u.hi = (u.hi << 8) | (u.lo >> 56);
+    u.lo = (u.lo << 8) | p[i];
+  }
+
+  return u;
+}
+
+static int
+resource_set_object_init(resource_set_object *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"ranges", "version", NULL};
+  PyObject *iterable = NULL;
+  PyObject *iterator = NULL;
+  PyObject *item = NULL;
+  PyObject *min = NULL;
+  PyObject *max = NULL;
+  Py_ssize_t n, cap;
+  int version = 0;
+  int sorted = 1;
+
+  ENTERING(resource_set_object_init);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oi", kwlist, &iterable, &version))
     goto error;
 
-  if (!PEM_read_bio_X509(bio, &self->x509, NULL, NULL))
-    lose_openssl_error("Couldn't load PEM encoded certificate");
+  if (version != 0 && version != 4 && version != 6)
+    lose_value_error("ResourceSet version must be 0 (ASN), 4, or 6");
 
-  return (PyObject *) self;
+  if ((cap = PyObject_Size(iterable)) <= 0) {
+    PyErr_Clear();
+    cap = 16;
+  }
 
- error:
+  PyMem_Free(self->v);
+  self->v = NULL;
+  self->n = 0;
+  self->version = version;
 
-  Py_XDECREF(self);
-  return NULL;
+  if ((self->v = PyMem_New(resource_interval, cap)) == NULL)
+    lose_no_memory();
+
+  if ((iterator = PyObject_GetIter(iterable)) == NULL)
+    goto error;
+
+  for (n = 0; (item = PyIter_Next(iterator)) != NULL; n++) {
+
+    if (n >= cap) {
+      resource_interval *v = PyMem_Realloc(self->v, 2 * cap * sizeof(*v));
+      if (v == NULL)
+        lose_no_memory();
+      self->v = v;
+      cap *= 2;
+    }
+
+    if (PyTuple_Check(item)) {
+      if (!PyArg_ParseTuple(item, "OO", &min, &max))
+        goto error;
+      Py_INCREF(min);
+      Py_INCREF(max);
+    } else if ((min = PyObject_GetAttrString(item, "min")) == NULL ||
+               (max = PyObject_GetAttrString(item, "max")) == NULL) {
+      goto error;
+    }
+
+    if (!resource_set_value_from_python(version, min, &self->v[n].min) ||
+        !resource_set_value_from_python(version, max, &self->v[n].max))
+      goto error;
+
+    if (U128_LT(self->v[n].max, self->v[n].min))
+      lose_value_error("Range with maximum less than minimum");
+
+    if (n > 0 && resource_interval_cmp(&self->v[n - 1], &self->v[n]) > 0)
+      sorted = 0;
+
+    Py_XDECREF(min);
+    Py_XDECREF(max);
+    Py_XDECREF(item);
+    min = max = item = NULL;
+  }
+
+  if (PyErr_Occurred())
+    goto error;
+
+  resource_set_canonize(self, n, sorted);
+
+  Py_XDECREF(iterator);
+  return 0;
+
+ error:
+  Py_XDECREF(iterator);
+  Py_XDECREF(item);
+  Py_XDECREF(min);
+  Py_XDECREF(max);
+  return -1;
 }
 
+/*
+ * Common code for the binary set operations.
+ */
 static PyObject *
-x509_object_der_read_helper(PyTypeObject *type, BIO *bio)
+resource_set_object_binop(resource_set_object *self, PyObject *args,
+                          void (*op)(const resource_interval *, const Py_ssize_t,
+                                     const resource_interval *, const Py_ssize_t,
+                                     resource_interval *, Py_ssize_t *))
 {
-  x509_object *self;
+  resource_set_object *other = NULL;
+  resource_set_object *result = NULL;
 
-  ENTERING(x509_object_der_read_helper);
+  if (!PyArg_ParseTuple(args, "O!", &POW_ResourceSet_Type, &other))
+    goto error;
 
-  if ((self = (x509_object *) x509_object_new(type, NULL, NULL)) == NULL)
+  if (self->version != other->version)
+    lose_type_error("ResourceSet version mismatch");
+
+  if ((result = resource_set_object_alloc(self->ob_type, self->version, self->n + other->n)) == NULL)
     goto error;
 
-  if (!d2i_X509_bio(bio, &self->x509))
-    lose_openssl_error("Couldn't load DER encoded certificate");
+  op(self->v, self->n, other->v, other->n, result->v, &result->n);
 
-  return (PyObject *) self;
+  return (PyObject *) result;
 
  error:
-  Py_XDECREF(self);
+  Py_XDECREF(result);
   return NULL;
 }
 
-static char x509_object_pem_read__doc__[] =
-  "Read a PEM-encoded X.509 object from a string.\n"
+static char resource_set_object_union__doc__[] =
+  "Return the union of this ResourceSet and another.\n"
   ;
 
 static PyObject *
-x509_object_pem_read(PyTypeObject *type, PyObject *args)
+resource_set_object_union(resource_set_object *self, PyObject *args)
 {
-  ENTERING(x509_object_pem_read);
-  return read_from_string_helper(x509_object_pem_read_helper, type, args);
+  ENTERING(resource_set_object_union);
+  return resource_set_object_binop(self, args, resource_interval_union);
 }
 
-static char x509_object_pem_read_file__doc__[] =
-  "Read a PEM-encoded X.509 object from a file.\n"
+static char resource_set_object_intersection__doc__[] =
+  "Return the intersection of this ResourceSet and another.\n"
   ;
 
 static PyObject *
-x509_object_pem_read_file(PyTypeObject *type, PyObject *args)
+resource_set_object_intersection(resource_set_object *self, PyObject *args)
 {
-  ENTERING(x509_object_pem_read_file);
-  return read_from_file_helper(x509_object_pem_read_helper, type, args);
+  ENTERING(resource_set_object_intersection);
+  return resource_set_object_binop(self, args, resource_interval_intersection);
 }
 
-static char x509_object_der_read__doc__[] =
-  "Read a DER-encoded X.509 object from a string.\n"
+static char resource_set_object_difference__doc__[] =
+  "Return the resources in this ResourceSet which are not in another.\n"
   ;
 
 static PyObject *
-x509_object_der_read(PyTypeObject *type, PyObject *args)
+resource_set_object_difference(resource_set_object *self, PyObject *args)
 {
-  ENTERING(x509_object_der_read);
-  return read_from_string_helper(x509_object_der_read_helper, type, args);
+  ENTERING(resource_set_object_difference);
+  return resource_set_object_binop(self, args, resource_interval_difference);
 }
 
-static char x509_object_der_read_file__doc__[] =
-  "Read a DER-encoded X.509 object from a file.\n"
+static char resource_set_object_symmetric_difference__doc__[] =
+  "Return the resources in exactly one of this ResourceSet and another.\n"
   ;
 
 static PyObject *
-x509_object_der_read_file(PyTypeObject *type, PyObject *args)
+resource_set_object_symmetric_difference(resource_set_object *self, PyObject *args)
 {
-  ENTERING(x509_object_der_read_file);
-  return read_from_file_helper(x509_object_der_read_helper, type, args);
+  resource_set_object *other = NULL;
+  resource_set_object *result = NULL;
+  resource_interval *d1 = NULL, *d2 = NULL;
+  Py_ssize_t n1 = 0, n2 = 0;
+
+  ENTERING(resource_set_object_symmetric_difference);
+
+  if (!PyArg_ParseTuple(args, "O!", &POW_ResourceSet_Type, &other))
+    goto error;
+
+  if (self->version != other->version)
+    lose_type_error("ResourceSet version mismatch");
+
+  if ((d1 = PyMem_New(resource_interval, self->n + other->n + 1)) == NULL ||
+      (d2 = PyMem_New(resource_interval, self->n + other->n + 1)) == NULL)
+    lose_no_memory();
+
+  resource_interval_difference(self->v, self->n, other->v, other->n, d1, &n1);
+  resource_interval_difference(other->v, other->n, self->v, self->n, d2, &n2);
+
+  if ((result = resource_set_object_alloc(self->ob_type, self->version, n1 + n2)) == NULL)
+    goto error;
+
+  resource_interval_union(d1, n1, d2, n2, result->v, &result->n);
+
+ error:                          /* Fall through */
+  PyMem_Free(d1);
+  PyMem_Free(d2);
+  return (PyObject *) result;
 }
 
-static char x509_object_pem_write__doc__[] =
-  "Return the PEM encoding of this certificate, as a string.\n"
+static char resource_set_object_issubset__doc__[] =
+  "Return True if this ResourceSet is a (possibly improper) subset of another.\n"
   ;
 
 static PyObject *
-x509_object_pem_write(x509_object *self)
+resource_set_object_issubset(resource_set_object *self, PyObject *args)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+  resource_set_object *other = NULL;
 
-  ENTERING(x509_object_pem_write);
+  ENTERING(resource_set_object_issubset);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  if (!PyArg_ParseTuple(args, "O!", &POW_ResourceSet_Type, &other))
+    goto error;
 
-  if (!PEM_write_bio_X509(bio, self->x509))
-    lose_openssl_error("Unable to write certificate");
+  if (self->version != other->version)
+    lose_type_error("ResourceSet version mismatch");
 
-  result = BIO_to_PyString_helper(bio);
+  return PyBool_FromLong(resource_interval_issubset(self->v, self->n, other->v, other->n));
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+ error:
+  return NULL;
 }
 
-static char x509_object_der_write__doc__[] =
-  "Return the DER encoding of this certificate, as a string.\n"
+static char resource_set_object_ranges__doc__[] =
+  "Return the ranges in this ResourceSet as a list of (min, max) tuples.\n"
+  "\n"
+  "Endpoints are integers for ASNs, IPAddress objects otherwise.\n"
   ;
 
 static PyObject *
-x509_object_der_write(x509_object *self)
+resource_set_object_ranges(resource_set_object *self)
 {
   PyObject *result = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(x509_object_der_write);
+  PyObject *item = NULL;
+  Py_ssize_t i;
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  ENTERING(resource_set_object_ranges);
 
-  if (!i2d_X509_bio(bio, self->x509))
-    lose_openssl_error("Unable to write certificate");
+  if ((result = PyList_New(self->n)) == NULL)
+    goto error;
 
-  result = BIO_to_PyString_helper(bio);
+  for (i = 0; i < self->n; i++) {
+    if ((item = Py_BuildValue("(NN)",
+                              resource_set_value_to_python(self->version, self->v[i].min),
+                              resource_set_value_to_python(self->version, self->v[i].max))) == NULL)
+      goto error;
+    PyList_SET_ITEM(result, i, item);
+  }
 
- error:                         /* Fall through */
-  BIO_free(bio);
   return result;
-}
 
-static X509_EXTENSION *
-x509_object_extension_get_helper(x509_object *self, int nid)
-{
-  if (self != NULL && self->x509 != NULL)
-    return X509_get_ext(self->x509, X509_get_ext_by_NID(self->x509, nid, -1));
-  else
-    return NULL;
+ error:
+  Py_XDECREF(result);
+  return NULL;
 }
 
+static char resource_set_object_prefixes__doc__[] =
+  "Chop the address ranges in this ResourceSet into prefixes, and return\n"
+  "them as a list of (IPAddress, prefixlen) tuples, in order.\n"
+  ;
+
 static PyObject *
-x509_object_extension_set_helper(x509_object *self, extension_wrapper ext)
+resource_set_object_prefixes(resource_set_object *self)
 {
-  int ok = 0;
+  const unsigned bits = resource_set_bits(self);
+  PyObject *result = NULL;
+  PyObject *item = NULL;
+  resource_u128 min, top, mask;
+  Py_ssize_t i;
+  unsigned k;
 
-  if (ext.value == NULL)
-    goto error;
+  ENTERING(resource_set_object_prefixes);
 
-  if (!X509_add1_ext_i2d(self->x509, ext.nid, ext.value, ext.critical, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add extension to certificate");
+  if (bits == 0)
+    lose_type_error("Can't chop ASNs into prefixes");
 
-  ok = 1;
+  if ((result = PyList_New(0)) == NULL)
+    goto error;
 
- error:
-  ext.destructor(ext.value);
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
-}
+  for (i = 0; i < self->n; i++) {
+    min = self->v[i].min;
 
-static char x509_object_get_public_key__doc__[] =
-  "Return the public key from this certificate object,\n"
-  "as an Asymmetric object.\n"
-  ;
+    for (;;) {
 
-static PyObject *
-x509_object_get_public_key(x509_object *self)
-{
-  PyTypeObject *type = &POW_Asymmetric_Type;
-  asymmetric_object *asym = NULL;
+      /*
+       * Largest aligned block starting at min which fits in the range.
+       */
 
-  ENTERING(x509_object_get_public_key);
+      k = u128_ctz(min, bits);
+      for (;;) {
+        mask = u128_mask(k);
+        top.hi = min.hi | mask.hi;
+        top.lo = min.lo | mask.lo;
+        if (U128_LE(top, self->v[i].max))
+          break;
+        k--;
+      }
 
-  if ((asym = (asymmetric_object *) type->tp_alloc(type, 0)) == NULL)
-    goto error;
+      if ((item = Py_BuildValue("(NI)", resource_set_value_to_python(self->version, min), bits - k)) == NULL ||
+          PyList_Append(result, item) < 0)
+        goto error;
 
-  if ((asym->pkey = X509_get_pubkey(self->x509)) == NULL)
-    lose_openssl_error("Couldn't extract public key from certificate");
+      Py_XDECREF(item);
+      item = NULL;
 
-  whack_ec_key_to_namedCurve(asym->pkey);
+      if (U128_EQ(top, self->v[i].max))
+        break;
 
-  return (PyObject *) asym;
+      min = u128_inc(top);
+    }
+  }
+
+  return result;
 
  error:
-  Py_XDECREF(asym);
+  Py_XDECREF(item);
+  Py_XDECREF(result);
   return NULL;
 }
 
-static char x509_object_set_public_key__doc__[] =
-  "Set the public key of this certificate object.\n"
+static char resource_set_object_from_packed__doc__[] =
+  "Construct a ResourceSet from packed binary ranges.\n"
   "\n"
-  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
-  "containing a public key.\n"
+  "The first argument is any object supporting the buffer protocol,\n"
+  "containing concatenated (min, max) pairs of big-endian integers,\n"
+  "four bytes each for ASNs and IPv4, sixteen bytes each for IPv6.\n"
+  "The second argument is the version, as for the constructor.\n"
+  "\n"
+  "This is the format returned by X509.getRFC3779Packed().\n"
   ;
 
 static PyObject *
-x509_object_set_public_key(x509_object *self, PyObject *args)
+resource_set_object_from_packed(PyTypeObject *type, PyObject *args)
 {
-  asymmetric_object *asym;
+  resource_set_object *self = NULL;
+  const unsigned char *p;
+  unsigned width;
+  Py_ssize_t i, n;
+  Py_buffer src;
+  int version = 0;
+  int sorted = 1;
 
-  ENTERING(x509_object_set_public_key);
+  ENTERING(resource_set_object_from_packed);
 
-  if (!PyArg_ParseTuple(args, "O!", &POW_Asymmetric_Type, &asym))
+  src.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*i", &src, &version))
     goto error;
 
-  if (!X509_set_pubkey(self->x509, asym->pkey))
-    lose_openssl_error("Couldn't set certificate's public key");
+  if (version != 0 && version != 4 && version != 6)
+    lose_value_error("ResourceSet version must be 0 (ASN), 4, or 6");
 
-  Py_RETURN_NONE;
+  width = resource_set_packed_width(version);
 
- error:
-  return NULL;
-}
+  if (src.len % (2 * width) != 0)
+    lose_value_error("Buffer length is not a multiple of the range length");
 
-static char x509_object_sign__doc__[] =
-  "Sign a certificate with a private key.\n"
-  "\n"
-  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
-  "containing a private key.\n"
-  "\n"
-  "The optional \"digest\" parameter indicates which digest to compute and\n"
-  "sign, and should be one of the following:\n"
-  "\n"
-  "* SHA1_DIGEST\n"
-  "* SHA256_DIGEST\n"
-  "* SHA384_DIGEST\n"
-  "* SHA512_DIGEST\n"
-  "\n"
-  "The default digest algorithm is SHA-256.\n"
-  ;
+  n = src.len / (2 * width);
 
-static PyObject *
-x509_object_sign(x509_object *self, PyObject *args)
-{
-  asymmetric_object *asym;
-  int digest_type = SHA256_DIGEST;
-  const EVP_MD *digest_method = NULL;
+  if ((self = resource_set_object_alloc(type, version, n)) == NULL)
+    goto error;
 
-  ENTERING(x509_object_sign);
+  for (i = 0, p = src.buf; i < n; i++, p += 2 * width) {
+    self->v[i].min = resource_u128_from_bytes(p, width);
+    self->v[i].max = resource_u128_from_bytes(p + width, width);
 
-  if (!PyArg_ParseTuple(args, "O!|i", &POW_Asymmetric_Type, &asym, &digest_type))
-    goto error;
+    if (U128_LT(self->v[i].max, self->v[i].min))
+      lose_value_error("Range with maximum less than minimum");
 
-  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
-    lose("Unsupported digest algorithm");
+    if (i > 0 && resource_interval_cmp(&self->v[i - 1], &self->v[i]) > 0)
+      sorted = 0;
+  }
 
-  if (!X509_sign(self->x509, asym->pkey, digest_method))
-    lose_openssl_error("Couldn't sign certificate");
+  resource_set_canonize(self, n, sorted);
 
-  Py_RETURN_NONE;
+  PyBuffer_Release(&src);
+  return (PyObject *) self;
 
  error:
+  Py_XDECREF(self);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
   return NULL;
 }
 
-static int x509_store_ctx_object_verify_cb(int ok, X509_STORE_CTX *ctx);
+static Py_ssize_t
+resource_set_object_length(resource_set_object *self)
+{
+  return self->n;
+}
 
-static char x509_object_verify__doc__[] =
-  "Verify a certificate.\n"
+static PySequenceMethods resource_set_object_as_sequence = {
+  (lenfunc) resource_set_object_length,         /* sq_length */
+};
+
+static struct PyMethodDef resource_set_object_methods[] = {
+  Define_Method(union,                  resource_set_object_union,                      METH_VARARGS),
+  Define_Method(intersection,           resource_set_object_intersection,               METH_VARARGS),
+  Define_Method(difference,             resource_set_object_difference,                 METH_VARARGS),
+  Define_Method(symmetric_difference,   resource_set_object_symmetric_difference,       METH_VARARGS),
+  Define_Method(issubset,               resource_set_object_issubset,                   METH_VARARGS),
+  Define_Method(ranges,                 resource_set_object_ranges,                     METH_NOARGS),
+  Define_Method(prefixes,               resource_set_object_prefixes,                   METH_NOARGS),
+  Define_Class_Method(fromPacked,       resource_set_object_from_packed,                METH_VARARGS),
+  {NULL}
+};
+
+static char POW_ResourceSet_Type__doc__[] =
+  "Canonical set of ASNs or IP addresses, for fast set arithmetic.\n"
+  "\n"
+  "The constructor takes an iterable of ranges and a version, which is 0\n"
+  "for ASNs, or 4 or 6 for IP addresses.  Each range is either a (min, max)\n"
+  "tuple or an object with \"min\" and \"max\" attributes (such as the\n"
+  "range classes in rpki.resource_set).  Endpoints are integers for ASNs,\n"
+  "IPAddress objects of the right version otherwise.  Overlapping and\n"
+  "adjacent ranges are merged.\n"
+  "\n"
+  "This class is the engine underneath rpki.resource_set, which you\n"
+  "probably want to use instead.\n"
   ;
 
-#warning Write real x509_object_verify__doc__[] once API is stable.
+static PyTypeObject POW_ResourceSet_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                        /* ob_size */
+  "rpki.POW.ResourceSet",                   /* tp_name */
+  sizeof(resource_set_object),              /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)resource_set_object_dealloc,  /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  &resource_set_object_as_sequence,         /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_ResourceSet_Type__doc__,              /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  resource_set_object_methods,              /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  (initproc) resource_set_object_init,      /* tp_init */
+  0,                                        /* tp_alloc */
+  resource_set_object_new,                  /* tp_new */
+};
 
-static PyObject *
-x509_object_verify(x509_object *self, PyObject *args, PyObject *kwds)
+
+
+/*
+ * X509 object.
+ */
+
+static x509_object *
+x509_object_new_helper(PyTypeObject *type, X509 *x)
 {
-  static char *kwlist[] = {"trusted", "untrusted", "crl", "policy", "context_class", NULL};
-  PyObject *ctxclass = (PyObject *) &POW_X509StoreCTX_Type;
-  STACK_OF(X509)   *trusted_stack = NULL;
-  STACK_OF(X509) *untrusted_stack = NULL;
-  STACK_OF(X509_CRL)   *crl_stack = NULL;
-  x509_store_ctx_object *ctx = NULL;
-  PyObject *trusted   = Py_None;
-  PyObject *untrusted = Py_None;
-  PyObject *crl       = Py_None;
-  PyObject *policy    = Py_None;
-  int ok = 0;
+  x509_object *self;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOOOO", kwlist, &trusted, &untrusted, &crl, &policy, &ctxclass))
-    goto error;
+  if (type == NULL)
+    type = &POW_X509_Type;
 
-  if ((trusted_stack = x509_helper_iterable_to_stack(trusted)) == NULL)
-    goto error;
+  if ((self = (x509_object *) type->tp_alloc(type, 0)) == NULL)
+    return NULL;
 
-  if ((untrusted_stack = x509_helper_iterable_to_stack(untrusted)) == NULL)
-    goto error;
+  self->x509 = x;
+  return self;
+}
 
-  if (crl != Py_None && !POW_CRL_Check(crl))
-    lose_type_error("Not a CRL");
+static PyObject *
+x509_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+{
+  x509_object *self = NULL;
+  X509 *x = NULL;
 
-  if (crl != Py_None && ((crl_stack = sk_X509_CRL_new_null()) == NULL ||
-                         !sk_X509_CRL_push(crl_stack, ((crl_object *) crl)->crl)))
-    lose_no_memory();
+  ENTERING(x509_object_new);
 
-  if (!PyCallable_Check(ctxclass))
-    lose_type_error("Context class must be callable");
+  if ((x = X509_new()) == NULL)
+    lose_no_memory();
 
-  if ((ctx = (x509_store_ctx_object *) PyObject_CallFunctionObjArgs(ctxclass, NULL)) == NULL)
+  if ((self = x509_object_new_helper(type, x)) == NULL)
     goto error;
 
-  if (!POW_X509StoreCTX_Check(ctx))
-    lose_type_error("Returned context is not a X509StoreCTX");
+  return (PyObject *) self;
 
-  if (ctx->ctx == NULL)
-    lose("Uninitialized X509StoreCTX");
+ error:
+  X509_free(x);
+  return NULL;
+}
 
-  if (crl != Py_None)
-    X509_VERIFY_PARAM_set_flags(ctx->ctx->param, X509_V_FLAG_CRL_CHECK);
+static void
+x509_object_dealloc(x509_object *self)
+{
+  ENTERING(x509_object_dealloc);
+  X509_free(self->x509);
+  self->ob_type->tp_free((PyObject*) self);
+}
 
-  if (policy != Py_None) {
-    const char  *oid_txt = NULL;
-    ASN1_OBJECT *oid_obj = NULL;
+static PyObject *
+x509_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+{
+  x509_object *self = NULL;
 
-    if ((oid_txt = PyString_AsString(policy)) == NULL)
-      goto error;
+  ENTERING(x509_object_pem_read_helper);
 
-    if ((oid_obj = OBJ_txt2obj(oid_txt, 1)) == NULL)
-      lose("Couldn't parse policy OID");
+  if ((self = (x509_object *) x509_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-    X509_VERIFY_PARAM_set_flags(ctx->ctx->param, X509_V_FLAG_POLICY_CHECK | X509_V_FLAG_EXPLICIT_POLICY);
-    X509_VERIFY_PARAM_add0_policy(ctx->ctx->param, oid_obj);
-  }
+  if (!PEM_read_bio_X509(bio, &self->x509, NULL, NULL))
+    lose_openssl_error("Couldn't load PEM encoded certificate");
 
-  Py_XINCREF(trusted);
-  Py_XINCREF(untrusted);
-  Py_XINCREF(crl);
-  X509_STORE_CTX_set_cert(ctx->ctx, self->x509);
-  X509_STORE_CTX_trusted_stack(ctx->ctx, trusted_stack);
-  X509_STORE_CTX_set_chain(ctx->ctx, untrusted_stack);
-  X509_STORE_CTX_set0_crls(ctx->ctx, crl_stack);
+  return (PyObject *) self;
 
-  X509_STORE_CTX_set_verify_cb(ctx->ctx, x509_store_ctx_object_verify_cb);
-  X509_VERIFY_PARAM_set_flags(ctx->ctx->param, X509_V_FLAG_X509_STRICT);
+ error:
 
-  ok = X509_verify_cert(ctx->ctx) >= 0;
+  Py_XDECREF(self);
+  return NULL;
+}
 
-  X509_STORE_CTX_set0_crls(ctx->ctx, NULL);
-  X509_STORE_CTX_set_chain(ctx->ctx, NULL);
-  X509_STORE_CTX_trusted_stack(ctx->ctx, NULL);
-  X509_STORE_CTX_set_cert(ctx->ctx, NULL);
-  Py_XDECREF(crl);
-  Py_XDECREF(untrusted);
-  Py_XDECREF(trusted);
+static PyObject *
+x509_object_der_read_helper(PyTypeObject *type, BIO *bio)
+{
+  x509_object *self;
+  const unsigned char *der;
+  long len = 0;
 
-  if (PyErr_Occurred())
-    goto error;
+  ENTERING(x509_object_der_read_helper);
 
-  if (!ok)
-    lose_validation_error("X509_verify_cert() raised an exception");
+  if ((self = (x509_object *) x509_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
- error:
-  sk_X509_free(trusted_stack);
-  sk_X509_free(untrusted_stack);
-  sk_X509_CRL_free(crl_stack);
+  if ((der = mem_bio_der(bio, &len)) != NULL
+      ? !d2i_X509(&self->x509, &der, len)
+      : !d2i_X509_bio(bio, &self->x509))
+    lose_openssl_error("Couldn't load DER encoded certificate");
 
-  if (ok)
-    return (PyObject *) ctx;
+  return (PyObject *) self;
 
-  Py_XDECREF(ctx);
+ error:
+  Py_XDECREF(self);
   return NULL;
 }
 
-
-static char x509_object_check_rpki_conformance__doc__[] =
-  "Check a certificate for conformance to the RPKI profile.\n"
+static char x509_object_pem_read__doc__[] =
+  "Read a PEM-encoded X.509 object from a string.\n"
   ;
 
-#warning Write real x509_object_check_rpki_conformance__doc__[] once API is stable.
+static PyObject *
+x509_object_pem_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(x509_object_pem_read);
+  return read_from_string_helper(x509_object_pem_read_helper, type, args);
+}
+
+static char x509_object_pem_read_file__doc__[] =
+  "Read a PEM-encoded X.509 object from a file.\n"
+  ;
 
 static PyObject *
-x509_object_check_rpki_conformance(x509_object *self, PyObject *args, PyObject *kwds)
+x509_object_pem_read_file(PyTypeObject *type, PyObject *args)
 {
-  static char *kwlist[] = {"status", "eku", NULL};
-  PyObject *status = Py_None;
-  PyObject *ekuarg = Py_None;
-  EVP_PKEY *issuer_pkey = NULL, *subject_pkey = NULL;
-  AUTHORITY_INFO_ACCESS *sia = NULL, *aia = NULL;
-  STACK_OF(POLICYINFO) *policies = NULL;
-  ASN1_BIT_STRING *ski_pubkey = NULL;
-  STACK_OF(DIST_POINT) *crldp = NULL;
-  EXTENDED_KEY_USAGE *eku = NULL;
-  BASIC_CONSTRAINTS *bc = NULL;
-  ASN1_OCTET_STRING *ski = NULL;
-  AUTHORITY_KEYID *aki = NULL;
-  ASIdentifiers *asid = NULL;
-  IPAddrBlocks *addr = NULL;
-  unsigned char ski_hashbuf[EVP_MAX_MD_SIZE];
-  unsigned ski_hashlen, afi;
-  int i, ok, crit, ex_count, is_ca = 0, ekunid = NID_undef, ret = 0;
+  ENTERING(x509_object_pem_read_file);
+  return read_from_file_helper(x509_object_pem_read_helper, type, args);
+}
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O", kwlist, &PySet_Type, &status, &ekuarg))
-    goto error;
+static char x509_object_der_read__doc__[] =
+  "Read a DER-encoded X.509 object from a string.\n"
+  ;
 
-  if (ekuarg != Py_None) {
-    const char *ekutxt = PyString_AsString(ekuarg);
-    if (ekutxt == NULL)
-      goto error;
-    ekunid = OBJ_txt2nid(ekutxt);
-  }
+static PyObject *
+x509_object_der_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(x509_object_der_read);
+  return read_from_string_helper(x509_object_der_read_helper, type, args);
+}
 
-  /*
-   * We don't use X509_check_ca() to check whether the certificate is
-   * a CA, because it's not paranoid enough to enforce the RPKI
-   * certificate profile, but we still call it because we need it (or
-   * something) to invoke x509v3_cache_extensions() for us.
-   */
+static char x509_object_der_read_file__doc__[] =
+  "Read a DER-encoded X.509 object from a file.\n"
+  ;
 
-  (void) X509_check_ca(self->x509);
+static PyObject *
+x509_object_der_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(x509_object_der_read_file);
+  return read_from_file_helper(x509_object_der_read_helper, type, args);
+}
 
-  if (!check_allowed_time_encoding(X509_get_notBefore(self->x509)) ||
-      !check_allowed_time_encoding(X509_get_notAfter(self->x509)))
-    record_validation_status(status, NONCONFORMANT_ASN1_TIME_VALUE);
+static char x509_object_pem_write__doc__[] =
+  "Return the PEM encoding of this certificate, as a string.\n"
+  ;
 
-  if (X509_get_signature_nid(self->x509) != NID_sha256WithRSAEncryption)
-    record_validation_status(status, NONCONFORMANT_SIGNATURE_ALGORITHM);
+static PyObject *
+x509_object_pem_write(x509_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  if (!check_allowed_dn(X509_get_subject_name(self->x509)))
-    record_validation_status(status, NONCONFORMANT_SUBJECT_NAME);
+  ENTERING(x509_object_pem_write);
 
-  if (!check_allowed_dn(X509_get_issuer_name(self->x509)))
-    record_validation_status(status, NONCONFORMANT_ISSUER_NAME);
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  /*
-   * Apparently nothing ever looks at these fields.  We wouldn't
-   * bother either if they weren't forbidden by the RPKI certificate
-   * profile.
-   */
+  if (!PEM_write_bio_X509(bio, self->x509))
+    lose_openssl_error("Unable to write certificate");
 
-  if (!self->x509->cert_info || self->x509->cert_info->issuerUID || self->x509->cert_info->subjectUID)
-    record_validation_status(status, NONCONFORMANT_CERTIFICATE_UID);
+  result = BIO_to_PyString_helper(bio);
 
-  /*
-   * Public key checks postponed until we've checked extensions (in
-   * particular, until we've checked Basic Constraints and know
-   * whether to apply the CA or EE rules).
-   */
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
 
-  /*
-   * Keep track of allowed extensions we've seen.  Once we've
-   * processed all the ones we expect, anything left is an error.
-   */
+static char x509_object_der_write__doc__[] =
+  "Return the DER encoding of this certificate, as a string.\n"
+  ;
 
-  ex_count = X509_get_ext_count(self->x509);
+static PyObject *
+x509_object_der_write(x509_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  /* Critical */
-  if ((bc = X509_get_ext_d2i(self->x509, NID_basic_constraints, &crit, NULL)) != NULL) {
-    ex_count--;
-    if (!crit || bc->ca <= 0 || bc->pathlen != NULL)
-      record_validation_status(status, MALFORMED_BASIC_CONSTRAINTS);
-  }
+  ENTERING(x509_object_der_write);
 
-  is_ca = bc != NULL;
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  /*
-   * Check for presence of AIA, SIA, and CRLDP, and make sure that
-   * they're in the correct format, but leave checking of the URIs
-   * themselves for Python code to handle.
-   */
+  if (!i2d_X509_bio(bio, self->x509))
+    lose_openssl_error("Unable to write certificate");
 
-  /* Non-criticial */
-  if ((aia = X509_get_ext_d2i(self->x509, NID_info_access, &crit, NULL)) != NULL) {
-    ex_count--;
-    if (crit)
-      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
-    ok = sk_ACCESS_DESCRIPTION_num(aia) > 0;
-    for (i = 0; ok && i < sk_ACCESS_DESCRIPTION_num(aia); i++) {
-      ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(aia, i);
-      ok = (a != NULL && a->location->type == GEN_URI &&
-            OBJ_obj2nid(a->method) == NID_ad_ca_issuers);
-    }
-    if (!ok)
-      record_validation_status(status, MALFORMED_AIA_EXTENSION);
-  }
+  result = BIO_to_PyString_helper(bio);
 
-  /* Non-criticial */
-  if ((sia = X509_get_ext_d2i(self->x509, NID_sinfo_access, &crit, NULL)) != NULL) {
-    ex_count--;
-    if (crit)
-      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
-    ok = sk_ACCESS_DESCRIPTION_num(sia) > 0;
-    for (i = 0; ok && i < sk_ACCESS_DESCRIPTION_num(sia); i++) {
-      ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(sia, i);
-      int nid = a == NULL ? NID_undef : OBJ_obj2nid(a->method);
-      ok = (a != NULL && a->location->type == GEN_URI &&
-            (nid == NID_caRepository    || nid == NID_ad_rpkiManifest ||
-             nid == NID_ad_signedObject || nid == NID_ad_rpkiNotify));
-    }
-    if (!ok)
-      record_validation_status(status, MALFORMED_SIA_EXTENSION);
-  }
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
 
-  /* Non-critical */
-  if ((crldp = X509_get_ext_d2i(self->x509, NID_crl_distribution_points, &crit, NULL)) != NULL) {
-    DIST_POINT *dp = sk_DIST_POINT_value(crldp, 0);
-    ex_count--;
-    if (crit)
-      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
-    ok = (sk_DIST_POINT_num(crldp) == 1 &&
-          dp->reasons == NULL   && dp->CRLissuer == NULL &&
-          dp->distpoint != NULL && dp->distpoint->type == 0);
-    for (i = 0; ok && i < sk_GENERAL_NAME_num(dp->distpoint->name.fullname); i++) {
-      GENERAL_NAME *gn = sk_GENERAL_NAME_value(dp->distpoint->name.fullname, i);
-      ok = gn != NULL && gn->type == GEN_URI;
-    }
-    if (!ok)
-      record_validation_status(status, MALFORMED_CRLDP_EXTENSION);
-  }
+static X509_EXTENSION *
+x509_object_extension_get_helper(x509_object *self, int nid)
+{
+  if (self != NULL && self->x509 != NULL)
+    return X509_get_ext(self->x509, X509_get_ext_by_NID(self->x509, nid, -1));
+  else
+    return NULL;
+}
 
-  /* Non-critical */
-  if ((eku = X509_get_ext_d2i(self->x509, NID_ext_key_usage, &crit, NULL)) != NULL) {
-    ex_count--;
-    ok = 0;
-    if (!crit && !is_ca && sk_ASN1_OBJECT_num(eku) > 0 && ekunid != NID_undef)
-      for (i = 0; !ok && i < sk_ASN1_OBJECT_num(eku); i++)
-        ok = OBJ_obj2nid(sk_ASN1_OBJECT_value(eku, i)) == ekunid;
-    if (!ok)
-      record_validation_status(status, INAPPROPRIATE_EKU_EXTENSION);
-  }
+static PyObject *
+x509_object_extension_set_helper(x509_object *self, extension_wrapper ext)
+{
+  int ok = 0;
 
-  /* Critical */
-  if ((policies = X509_get_ext_d2i(self->x509, NID_certificate_policies, &crit, NULL)) != NULL) {
-    POLICYQUALINFO *qualifier = NULL;
-    POLICYINFO *policy = NULL;
-    ex_count--;
-    if (!crit || sk_POLICYINFO_num(policies) != 1 ||
-	(policy = sk_POLICYINFO_value(policies, 0)) == NULL ||
-	OBJ_obj2nid(policy->policyid) != NID_cp_ipAddr_asNumber ||
-	sk_POLICYQUALINFO_num(policy->qualifiers) > 1 ||
-	(sk_POLICYQUALINFO_num(policy->qualifiers) == 1 &&
-	 ((qualifier = sk_POLICYQUALINFO_value(policy->qualifiers, 0)) == NULL ||
-	  OBJ_obj2nid(qualifier->pqualid) != NID_id_qt_cps)))
-      record_validation_status(status, BAD_CERTIFICATE_POLICY);
-    else if (qualifier != NULL)
-      record_validation_status(status, POLICY_QUALIFIER_CPS);
-  }
+  if (ext.value == NULL)
+    goto error;
 
-  /* Critical */
-  if ((self->x509->ex_flags & EXFLAG_KUSAGE) == 0) 
-    record_validation_status(status, KEY_USAGE_MISSING);
-  else {
-    ex_count--;    
-    if (!X509_EXTENSION_get_critical(X509_get_ext(self->x509, X509_get_ext_by_NID(self->x509, NID_key_usage, -1))) ||
-        self->x509->ex_kusage != (is_ca ? KU_KEY_CERT_SIGN | KU_CRL_SIGN : KU_DIGITAL_SIGNATURE))
-      record_validation_status(status, BAD_KEY_USAGE);
-  }
+  if (!X509_add1_ext_i2d(self->x509, ext.nid, ext.value, ext.critical, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add extension to certificate");
 
-  /* Critical */
-  if ((addr = X509_get_ext_d2i(self->x509, NID_sbgp_ipAddrBlock, &crit, NULL)) != NULL) {
-    ex_count--;
-    if (!crit || ekunid == NID_id_kp_bgpsec_router ||
-	!v3_addr_is_canonical(addr) || sk_IPAddressFamily_num(addr) == 0)
-      record_validation_status(status, BAD_IPADDRBLOCKS);
-    else
-      for (i = 0; i < sk_IPAddressFamily_num(addr); i++) {
-        IPAddressFamily *f = sk_IPAddressFamily_value(addr, i);
-        afi = v3_addr_get_afi(f);
-        if (afi != IANA_AFI_IPV4 && afi != IANA_AFI_IPV6)
-          record_validation_status(status, UNKNOWN_AFI);
-        else if (f->addressFamily->length != 2)
-          record_validation_status(status, SAFI_NOT_ALLOWED);
-      }
-  }
-
-  /* Critical */
-  if ((asid = X509_get_ext_d2i(self->x509, NID_sbgp_autonomousSysNum, &crit, NULL)) != NULL) {
-    ex_count--;
-    if (!crit || asid->asnum == NULL || asid->rdi != NULL || !v3_asid_is_canonical(asid) ||
-	(ekunid == NID_id_kp_bgpsec_router && asid->asnum->type == ASIdentifierChoice_inherit))
-      record_validation_status(status, BAD_ASIDENTIFIERS);
-  }
-
-  if (addr == NULL && asid == NULL)
-    record_validation_status(status, MISSING_RESOURCES);
-
-  /* Non-critical */
-  if ((ski = X509_get_ext_d2i(self->x509, NID_subject_key_identifier, &crit, NULL)) == NULL)
-    record_validation_status(status, SKI_EXTENSION_MISSING);
-  else {
-    ex_count--;
-    if (crit)
-      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
-    if ((ski_pubkey = X509_get0_pubkey_bitstr(self->x509)) == NULL ||
-        !EVP_Digest(ski_pubkey->data, ski_pubkey->length,
-                    ski_hashbuf, &ski_hashlen, EVP_sha1(), NULL) ||
-        ski_hashlen != 20 ||
-        ski_hashlen != ASN1_STRING_length(ski) ||
-        memcmp(ski_hashbuf, ASN1_STRING_data(ski), ski_hashlen))
-      record_validation_status(status, SKI_PUBLIC_KEY_MISMATCH);
-  }
-
-  /* Non-critical */
-  if ((aki = X509_get_ext_d2i(self->x509, NID_authority_key_identifier, &crit, NULL)) != NULL) {
-    ex_count--;
-    if (crit)
-      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
-    if (aki->keyid == NULL || aki->serial != NULL || aki->issuer != NULL)
-      record_validation_status(status, AKI_EXTENSION_WRONG_FORMAT);
-  }
-
-  if (ex_count > 0)
-    record_validation_status(status, DISALLOWED_X509V3_EXTENSION);
-
-  /*
-   * Public key checks.
-   */
-
-  subject_pkey = X509_get_pubkey(self->x509);
-  ok = subject_pkey != NULL;
-  if (ok) {
-    ASN1_OBJECT *algorithm;
-
-    (void) X509_PUBKEY_get0_param(&algorithm, NULL, NULL, NULL, X509_get_X509_PUBKEY(self->x509));
-
-    switch (OBJ_obj2nid(algorithm)) {
-
-    case NID_rsaEncryption:
-      ok = (EVP_PKEY_base_id(subject_pkey) == EVP_PKEY_RSA &&
-            EVP_PKEY_bits(subject_pkey) == 2048 &&
-            BN_get_word(subject_pkey->pkey.rsa->e) == 65537);
-      break;
-
-    case NID_X9_62_id_ecPublicKey:
-      ok = (EVP_PKEY_base_id(subject_pkey) == EVP_PKEY_EC &&
-            ekunid == NID_id_kp_bgpsec_router &&
-            EC_GROUP_get_curve_name(EC_KEY_get0_group(subject_pkey->pkey.ec)) == NID_X9_62_prime256v1);
-      break;
-
-    default:
-      ok = 0;
-    }
-  }
-  if (!ok)
-    record_validation_status(status, BAD_PUBLIC_KEY);
-
-  ret = 1;
+  ok = 1;
 
  error:
-  EVP_PKEY_free(issuer_pkey);
-  EVP_PKEY_free(subject_pkey);
-  BASIC_CONSTRAINTS_free(bc);
-  sk_ACCESS_DESCRIPTION_pop_free(sia, ACCESS_DESCRIPTION_free);
-  sk_ACCESS_DESCRIPTION_pop_free(aia, ACCESS_DESCRIPTION_free);
-  sk_DIST_POINT_pop_free(crldp, DIST_POINT_free);
-  sk_POLICYINFO_pop_free(policies, POLICYINFO_free);
-  sk_ASN1_OBJECT_pop_free(eku, ASN1_OBJECT_free);
-  ASN1_OCTET_STRING_free(ski);
-  AUTHORITY_KEYID_free(aki);
-  ASIdentifiers_free(asid);
-  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
-
-  if (ret)
+  ext.destructor(ext.value);
+  if (ok)
     Py_RETURN_NONE;
   else
     return NULL;
 }
 
-static char x509_object_get_version__doc__[] =
-  "Return version number of this certificate.\n"
-  ;
-
-static PyObject *
-x509_object_get_version(x509_object *self)
-{
-  ENTERING(x509_object_get_version);
-  return Py_BuildValue("l", X509_get_version(self->x509));
-}
-
-static char x509_object_set_version__doc__[] =
-  "Set version number of this certificate.\n"
-  "\n"
-  "The \"version\" parameter should be an integer.\n"
+static char x509_object_get_public_key__doc__[] =
+  "Return the public key from this certificate object,\n"
+  "as an Asymmetric object.\n"
   ;
 
 static PyObject *
-x509_object_set_version(x509_object *self, PyObject *args)
+x509_object_get_public_key(x509_object *self)
 {
-  long version = 0;
+  PyTypeObject *type = &POW_Asymmetric_Type;
+  asymmetric_object *asym = NULL;
 
-  ENTERING(x509_object_set_version);
+  ENTERING(x509_object_get_public_key);
 
-  if (!PyArg_ParseTuple(args, "l", &version))
+  if ((asym = (asymmetric_object *) type->tp_alloc(type, 0)) == NULL)
     goto error;
 
-  if (!X509_set_version(self->x509, version))
-    lose("Couldn't set certificate version");
+  if ((asym->pkey = X509_get_pubkey(self->x509)) == NULL)
+    lose_openssl_error("Couldn't extract public key from certificate");
 
-  Py_RETURN_NONE;
+  whack_ec_key_to_namedCurve(asym->pkey);
 
- error:
+  return (PyObject *) asym;
 
+ error:
+  Py_XDECREF(asym);
   return NULL;
 }
 
-static char x509_object_get_serial__doc__[] =
-  "Return the serial number of this certificate.\n"
-  ;
-
-static PyObject *
-x509_object_get_serial(x509_object *self)
-{
-  ENTERING(x509_object_get_serial);
-  return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(X509_get_serialNumber(self->x509)));
-}
-
-static char x509_object_set_serial__doc__[] =
-  "Set the serial number of this certificate.\n"
+static char x509_object_set_public_key__doc__[] =
+  "Set the public key of this certificate object.\n"
   "\n"
-  "The \"serial\" parameter should ba an integer.\n"
+  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
+  "containing a public key.\n"
   ;
 
 static PyObject *
-x509_object_set_serial(x509_object *self, PyObject *args)
+x509_object_set_public_key(x509_object *self, PyObject *args)
 {
-  ASN1_INTEGER *a_serial = NULL;
-  PyObject *p_serial = NULL;
-  int ok = 0;
+  asymmetric_object *asym;
 
-  ENTERING(x509_object_set_serial);
+  ENTERING(x509_object_set_public_key);
 
-  if (!PyArg_ParseTuple(args, "O", &p_serial) ||
-      (a_serial = PyLong_to_ASN1_INTEGER(p_serial)) == NULL)
+  if (!PyArg_ParseTuple(args, "O!", &POW_Asymmetric_Type, &asym))
     goto error;
 
-  if (!X509_set_serialNumber(self->x509, a_serial))
-    lose_no_memory();
+  if (!X509_set_pubkey(self->x509, asym->pkey))
+    lose_openssl_error("Couldn't set certificate's public key");
 
-  ok = 1;
+  Py_RETURN_NONE;
 
  error:
-  ASN1_INTEGER_free(a_serial);
-
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+  return NULL;
 }
 
-static char x509_object_get_issuer__doc__[] =
-  "Return this certificate's issuer name, represented as a tuple.\n"
-  "\n"
-  "Each element of this tuple is another tuple representing one\n"
-  "\"Relative Distinguished Name\" (RDN), each element of which in turn\n"
-  "is yet another tuple representing one AttributeTypeAndValue pair.\n"
-  "\n"
-  "In practice, RDNs containing multiple attributes are rare, thus the RDN\n"
-  "tuples will usually be exactly one element long, but using the\n"
-  "tuple-of-tuples-of-tuples format lets us represent the general case.\n"
-  "\n"
-  "The AttributeTypeANdValue pairs are two-element tuples, the first\n"
-  "element of which is a string representing an Object Identifier (OID),\n"
-  "the second of which contains the attribute value.\n"
+static char x509_object_sign__doc__[] =
+  "Sign a certificate with a private key.\n"
   "\n"
-  "This method takes an optional \"format\" parameter which controls\n"
-  "the format in which OIDs are returned.  Allowed values are:\n"
+  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
+  "containing a private key.\n"
   "\n"
-  "  * SHORTNAME_FORMAT (the OpenSSL \"short name\" for this OID)\n"
-  "  * LONGNAME_FORMAT  (the OpenSSL \"long name\" for this OID)\n"
-  "  * OIDNAME_FORMAT   (the OID in dotted decimal numeric format)\n"
+  "The optional \"digest\" parameter indicates which digest to compute and\n"
+  "sign, and should be one of the following:\n"
   "\n"
-  "The default is OIDNAME_FORMAT.\n"
+  "* SHA1_DIGEST\n"
+  "* SHA256_DIGEST\n"
+  "* SHA384_DIGEST\n"
+  "* SHA512_DIGEST\n"
   "\n"
-  "See RFC 5280 section 4.1.2.4 for details of the ASN.1 structure.\n"
+  "The default digest algorithm is SHA-256.\n"
   ;
 
 static PyObject *
-x509_object_get_issuer(x509_object *self, PyObject *args)
+x509_object_sign(x509_object *self, PyObject *args)
 {
-  PyObject *result = NULL;
-  int format = OIDNAME_FORMAT;
+  asymmetric_object *asym;
+  int digest_type = SHA256_DIGEST;
+  const EVP_MD *digest_method = NULL;
+  int ok;
 
-  ENTERING(x509_object_get_issuer);
+  ENTERING(x509_object_sign);
 
-  if (!PyArg_ParseTuple(args, "|i", &format))
+  if (!PyArg_ParseTuple(args, "O!|i", &POW_Asymmetric_Type, &asym, &digest_type))
     goto error;
 
-  result = x509_object_helper_get_name(X509_get_issuer_name(self->x509),
-                                       format);
+  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
+    lose("Unsupported digest algorithm");
 
- error:                         /* Fall through */
-  return result;
-}
+  Py_BEGIN_ALLOW_THREADS
+  ok = X509_sign(self->x509, asym->pkey, digest_method);
+  Py_END_ALLOW_THREADS
 
-static char x509_object_get_subject__doc__[] =
-  "Return this certificate's subject name, as a tuple.\n"
-  "\n"
-  "See the documentation for the \"getIssuer\" method for details on the\n"
-  "structure of the return value and use of the optional \"format\"\n"
-  "parameter.\n"
-  ;
+  if (!ok)
+    lose_openssl_error("Couldn't sign certificate");
 
-static PyObject *
-x509_object_get_subject(x509_object *self, PyObject *args)
-{
-  PyObject *result = NULL;
-  int format = OIDNAME_FORMAT;
+  Py_RETURN_NONE;
 
-  ENTERING(x509_object_get_subject);
+ error:
+  return NULL;
+}
 
-  if (!PyArg_ParseTuple(args, "|i", &format))
-    goto error;
+static int x509_store_ctx_object_verify_cb(int ok, X509_STORE_CTX *ctx);
 
-  result = x509_object_helper_get_name(X509_get_subject_name(self->x509),
-                                       format);
+static char x509_object_verify__doc__[] =
+  "Verify a certificate.\n"
+  ;
 
- error:                         /* Fall through */
-  return result;
-}
-
-static char x509_object_set_subject__doc__[] =
-  "Set this certificate's subject name.\n"
-  "\n"
-  "The \"name\" parameter should be in the same format as the return\n"
-  "value from the \"getIssuer\" method.\n"
-  ;
+#warning Write real x509_object_verify__doc__[] once API is stable.
 
 static PyObject *
-x509_object_set_subject(x509_object *self, PyObject *args)
+x509_object_verify(x509_object *self, PyObject *args, PyObject *kwds)
 {
-  PyObject *name_sequence = NULL;
-  X509_NAME *name = NULL;
-
-  ENTERING(x509_object_set_subject);
+  static char *kwlist[] = {"trusted", "untrusted", "crl", "policy", "context_class", NULL};
+  PyObject *ctxclass = (PyObject *) &POW_X509StoreCTX_Type;
+  STACK_OF(X509)   *trusted_stack = NULL;
+  STACK_OF(X509) *untrusted_stack = NULL;
+  STACK_OF(X509_CRL)   *crl_stack = NULL;
+  x509_store_ctx_object *ctx = NULL;
+  PyObject *trusted   = Py_None;
+  PyObject *untrusted = Py_None;
+  PyObject *crl       = Py_None;
+  PyObject *policy    = Py_None;
+  int ok = 0;
 
-  if (!PyArg_ParseTuple(args, "O", &name_sequence))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOOOO", kwlist, &trusted, &untrusted, &crl, &policy, &ctxclass))
     goto error;
 
-  if (!PySequence_Check(name_sequence))
-    lose_type_error("Expected a sequence object");
+  if ((trusted_stack = x509_helper_iterable_to_stack(trusted)) == NULL)
+    goto error;
 
-  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
+  if ((untrusted_stack = x509_helper_iterable_to_stack(untrusted)) == NULL)
     goto error;
 
-  if (!X509_set_subject_name(self->x509, name))
-    lose("Unable to set subject name");
+  if (crl != Py_None && !POW_CRL_Check(crl))
+    lose_type_error("Not a CRL");
 
-  X509_NAME_free(name);
+  if (crl != Py_None && ((crl_stack = sk_X509_CRL_new_null()) == NULL ||
+                         !sk_X509_CRL_push(crl_stack, ((crl_object *) crl)->crl)))
+    lose_no_memory();
 
-  Py_RETURN_NONE;
+  if (!PyCallable_Check(ctxclass))
+    lose_type_error("Context class must be callable");
 
- error:
-  X509_NAME_free(name);
-  return NULL;
-}
+  if ((ctx = (x509_store_ctx_object *) PyObject_CallFunctionObjArgs(ctxclass, NULL)) == NULL)
+    goto error;
 
-static char x509_object_set_issuer__doc__[] =
-  "Set this certificate's issuer name.\n"
-  "\n"
-  "The \"name\" parameter should be in the same format as the return\n"
-  "value from the \"getIssuer\" method.\n"
-  ;
+  if (!POW_X509StoreCTX_Check(ctx))
+    lose_type_error("Returned context is not a X509StoreCTX");
 
-static PyObject *
-x509_object_set_issuer(x509_object *self, PyObject *args)
-{
-  PyObject *name_sequence = NULL;
-  X509_NAME *name = NULL;
+  if (ctx->ctx == NULL)
+    lose("Uninitialized X509StoreCTX");
 
-  ENTERING(x509_object_set_issuer);
+  if (crl != Py_None)
+    X509_VERIFY_PARAM_set_flags(ctx->ctx->param, X509_V_FLAG_CRL_CHECK);
 
-  if (!PyArg_ParseTuple(args, "O", &name_sequence))
-    goto error;
+  if (policy != Py_None) {
+    const char  *oid_txt = NULL;
+    ASN1_OBJECT *oid_obj = NULL;
 
-  if (!PySequence_Check(name_sequence))
-    lose_type_error("Expected a sequence object");
+    if ((oid_txt = PyString_AsString(policy)) == NULL)
+      goto error;
 
-  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
-    goto error;
+    if ((oid_obj = OBJ_txt2obj(oid_txt, 1)) == NULL)
+      lose("Couldn't parse policy OID");
 
-  if (!X509_set_issuer_name(self->x509, name))
-    lose("Unable to set issuer name");
+    X509_VERIFY_PARAM_set_flags(ctx->ctx->param, X509_V_FLAG_POLICY_CHECK | X509_V_FLAG_EXPLICIT_POLICY);
+    X509_VERIFY_PARAM_add0_policy(ctx->ctx->param, oid_obj);
+  }
 
-  X509_NAME_free(name);
+  Py_XINCREF(trusted);
+  Py_XINCREF(untrusted);
+  Py_XINCREF(crl);
+  X509_STORE_CTX_set_cert(ctx->ctx, self->x509);
+  X509_STORE_CTX_trusted_stack(ctx->ctx, trusted_stack);
+  X509_STORE_CTX_set_chain(ctx->ctx, untrusted_stack);
+  X509_STORE_CTX_set0_crls(ctx->ctx, crl_stack);
 
-  Py_RETURN_NONE;
+  X509_STORE_CTX_set_verify_cb(ctx->ctx, x509_store_ctx_object_verify_cb);
+  X509_VERIFY_PARAM_set_flags(ctx->ctx->param, X509_V_FLAG_X509_STRICT);
 
- error:
-  X509_NAME_free(name);
-  return  NULL;
-}
+  /*
+   * x509_store_ctx_object_verify_cb() reacquires the interpreter lock
+   * if it needs to call back into Python.
+   */
+  Py_BEGIN_ALLOW_THREADS
+  ok = X509_verify_cert(ctx->ctx) >= 0;
+  Py_END_ALLOW_THREADS
 
-static char x509_object_get_issuer_hash__doc__[] =
-  "Return the OpenSSL \"name hash\" for this certificate's issuer name.\n"
-  ;
+  X509_STORE_CTX_set0_crls(ctx->ctx, NULL);
+  X509_STORE_CTX_set_chain(ctx->ctx, NULL);
+  X509_STORE_CTX_trusted_stack(ctx->ctx, NULL);
+  X509_STORE_CTX_set_cert(ctx->ctx, NULL);
+  Py_XDECREF(crl);
+  Py_XDECREF(untrusted);
+  Py_XDECREF(trusted);
 
-static PyObject *
-x509_object_get_issuer_hash(x509_object *self)
-{
-  ENTERING(x509_object_get_issuer_hash);
-  return Py_BuildValue("k", X509_NAME_hash(X509_get_issuer_name(self->x509)));
-}
+  if (PyErr_Occurred())
+    goto error;
 
-static char x509_object_get_subject_hash__doc__[] =
-  "Return the OpenSSL \"name hash\" for this certificate's subject name.\n"
-  ;
+  if (!ok)
+    lose_validation_error("X509_verify_cert() raised an exception");
 
-static PyObject *
-x509_object_get_subject_hash(x509_object *self)
-{
-  ENTERING(x509_object_get_subject_hash);
-  return Py_BuildValue("k", X509_NAME_hash(X509_get_subject_name(self->x509)));
-}
+ error:
+  sk_X509_free(trusted_stack);
+  sk_X509_free(untrusted_stack);
+  sk_X509_CRL_free(crl_stack);
 
-static char x509_object_get_not_before__doc__[] =
-  "Return this certificate's \"notBefore\" value as a datetime.\n"
-  ;
+  if (ok)
+    return (PyObject *) ctx;
 
-static PyObject *
-x509_object_get_not_before (x509_object *self)
-{
-  ENTERING(x509_object_get_not_before);
-  return ASN1_TIME_to_Python(X509_get_notBefore(self->x509));
+  Py_XDECREF(ctx);
+  return NULL;
 }
 
-static char x509_object_get_not_after__doc__[] =
-  "Return this certificate's \"notAfter\" value as a datetime.\n"
-  ;
-
-static PyObject *
-x509_object_get_not_after (x509_object *self)
-{
-  ENTERING(x509_object_get_not_after);
-  return ASN1_TIME_to_Python(X509_get_notAfter(self->x509));
-}
 
-static char x509_object_set_not_after__doc__[] =
-  "Set this certificate's \"notAfter\" value.\n"
-  "\n"
-  "The \"time\" parameter should be a datetime object.\n"
-  ;
+/*
+ * Check a certificate for conformance to the RPKI profile.  This is
+ * the guts of X509.checkRPKIConformance(), broken out so that the
+ * batch verification code can use it too.
+ */
 
-static PyObject *
-x509_object_set_not_after (x509_object *self, PyObject *args)
+static int
+check_x509(X509 *x, const int ekunid, PyObject *status)
 {
-  PyObject *o = NULL;
-  ASN1_TIME *t = NULL;
-
-  ENTERING(x509_object_set_not_after);
+  EVP_PKEY *issuer_pkey = NULL, *subject_pkey = NULL;
+  AUTHORITY_INFO_ACCESS *sia = NULL, *aia = NULL;
+  STACK_OF(POLICYINFO) *policies = NULL;
+  ASN1_BIT_STRING *ski_pubkey = NULL;
+  STACK_OF(DIST_POINT) *crldp = NULL;
+  EXTENDED_KEY_USAGE *eku = NULL;
+  BASIC_CONSTRAINTS *bc = NULL;
+  ASN1_OCTET_STRING *ski = NULL;
+  AUTHORITY_KEYID *aki = NULL;
+  ASIdentifiers *asid = NULL;
+  IPAddrBlocks *addr = NULL;
+  unsigned char ski_hashbuf[EVP_MAX_MD_SIZE];
+  unsigned ski_hashlen, afi;
+  int i, ok, crit, ex_count, is_ca = 0, ret = 0;
 
-  if (!PyArg_ParseTuple(args, "O", &o))
-    goto error;
+  /*
+   * We don't use X509_check_ca() to check whether the certificate is
+   * a CA, because it's not paranoid enough to enforce the RPKI
+   * certificate profile, but we still call it because we need it (or
+   * something) to invoke x509v3_cache_extensions() for us.
+   */
 
-  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
-    lose("Couldn't convert notAfter string");
+  (void) X509_check_ca(x);
 
-  if (!X509_set_notAfter(self->x509, t))
-    lose("Couldn't set notAfter");
+  if (!check_allowed_time_encoding(X509_get_notBefore(x)) ||
+      !check_allowed_time_encoding(X509_get_notAfter(x)))
+    record_validation_status(status, NONCONFORMANT_ASN1_TIME_VALUE);
 
-  ASN1_TIME_free(t);
-  Py_RETURN_NONE;
+  if (X509_get_signature_nid(x) != NID_sha256WithRSAEncryption)
+    record_validation_status(status, NONCONFORMANT_SIGNATURE_ALGORITHM);
 
- error:
-  ASN1_TIME_free(t);
-  return NULL;
-}
+  if (!check_allowed_dn(X509_get_subject_name(x)))
+    record_validation_status(status, NONCONFORMANT_SUBJECT_NAME);
 
-static char x509_object_set_not_before__doc__[] =
-  "Set this certificate's \"notBefore\" value.\n"
-  "\n"
-  "The \"time\" parameter should be a datetime object.\n"
-  ;
+  if (!check_allowed_dn(X509_get_issuer_name(x)))
+    record_validation_status(status, NONCONFORMANT_ISSUER_NAME);
 
-static PyObject *
-x509_object_set_not_before (x509_object *self, PyObject *args)
-{
-  PyObject *o = NULL;
-  ASN1_TIME *t = NULL;
+  /*
+   * Apparently nothing ever looks at these fields.  We wouldn't
+   * bother either if they weren't forbidden by the RPKI certificate
+   * profile.
+   */
 
-  ENTERING(x509_object_set_not_before);
+  if (!x->cert_info || x->cert_info->issuerUID || x->cert_info->subjectUID)
+    record_validation_status(status, NONCONFORMANT_CERTIFICATE_UID);
 
-  if (!PyArg_ParseTuple(args, "O", &o))
-    goto error;
+  /*
+   * Public key checks postponed until we've checked extensions (in
+   * particular, until we've checked Basic Constraints and know
+   * whether to apply the CA or EE rules).
+   */
 
-  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
-    lose("Couldn't convert notBefore string");
+  /*
+   * Keep track of allowed extensions we've seen.  Once we've
+   * processed all the ones we expect, anything left is an error.
+   */
 
-  if (!X509_set_notBefore(self->x509, t))
-    lose("Couldn't set notBefore");
+  ex_count = X509_get_ext_count(x);
 
-  ASN1_TIME_free(t);
-  Py_RETURN_NONE;
+  /* Critical */
+  if ((bc = X509_get_ext_d2i(x, NID_basic_constraints, &crit, NULL)) != NULL) {
+    ex_count--;
+    if (!crit || bc->ca <= 0 || bc->pathlen != NULL)
+      record_validation_status(status, MALFORMED_BASIC_CONSTRAINTS);
+  }
 
- error:
-  ASN1_TIME_free(t);
-  return NULL;
-}
+  is_ca = bc != NULL;
 
-static char x509_object_clear_extensions__doc__[] =
-  "Clear all extensions attached to this certificate.\n"
-  ;
+  /*
+   * Check for presence of AIA, SIA, and CRLDP, and make sure that
+   * they're in the correct format, but leave checking of the URIs
+   * themselves for Python code to handle.
+   */
 
-static PyObject *
-x509_object_clear_extensions(x509_object *self)
-{
-  X509_EXTENSION *ext;
+  /* Non-criticial */
+  if ((aia = X509_get_ext_d2i(x, NID_info_access, &crit, NULL)) != NULL) {
+    ex_count--;
+    if (crit)
+      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
+    ok = sk_ACCESS_DESCRIPTION_num(aia) > 0;
+    for (i = 0; ok && i < sk_ACCESS_DESCRIPTION_num(aia); i++) {
+      ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(aia, i);
+      ok = (a != NULL && a->location->type == GEN_URI &&
+            OBJ_obj2nid(a->method) == NID_ad_ca_issuers);
+    }
+    if (!ok)
+      record_validation_status(status, MALFORMED_AIA_EXTENSION);
+  }
 
-  ENTERING(x509_object_clear_extensions);
+  /* Non-criticial */
+  if ((sia = X509_get_ext_d2i(x, NID_sinfo_access, &crit, NULL)) != NULL) {
+    ex_count--;
+    if (crit)
+      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
+    ok = sk_ACCESS_DESCRIPTION_num(sia) > 0;
+    for (i = 0; ok && i < sk_ACCESS_DESCRIPTION_num(sia); i++) {
+      ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(sia, i);
+      int nid = a == NULL ? NID_undef : OBJ_obj2nid(a->method);
+      ok = (a != NULL && a->location->type == GEN_URI &&
+            (nid == NID_caRepository    || nid == NID_ad_rpkiManifest ||
+             nid == NID_ad_signedObject || nid == NID_ad_rpkiNotify));
+    }
+    if (!ok)
+      record_validation_status(status, MALFORMED_SIA_EXTENSION);
+  }
 
-  while ((ext = X509_delete_ext(self->x509, 0)) != NULL)
-    X509_EXTENSION_free(ext);
+  /* Non-critical */
+  if ((crldp = X509_get_ext_d2i(x, NID_crl_distribution_points, &crit, NULL)) != NULL) {
+    DIST_POINT *dp = sk_DIST_POINT_value(crldp, 0);
+    ex_count--;
+    if (crit)
+      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
+    ok = (sk_DIST_POINT_num(crldp) == 1 &&
+          dp->reasons == NULL   && dp->CRLissuer == NULL &&
+          dp->distpoint != NULL && dp->distpoint->type == 0);
+    for (i = 0; ok && i < sk_GENERAL_NAME_num(dp->distpoint->name.fullname); i++) {
+      GENERAL_NAME *gn = sk_GENERAL_NAME_value(dp->distpoint->name.fullname, i);
+      ok = gn != NULL && gn->type == GEN_URI;
+    }
+    if (!ok)
+      record_validation_status(status, MALFORMED_CRLDP_EXTENSION);
+  }
 
-  Py_RETURN_NONE;
-}
+  /* Non-critical */
+  if ((eku = X509_get_ext_d2i(x, NID_ext_key_usage, &crit, NULL)) != NULL) {
+    ex_count--;
+    ok = 0;
+    if (!crit && !is_ca && sk_ASN1_OBJECT_num(eku) > 0 && ekunid != NID_undef)
+      for (i = 0; !ok && i < sk_ASN1_OBJECT_num(eku); i++)
+        ok = OBJ_obj2nid(sk_ASN1_OBJECT_value(eku, i)) == ekunid;
+    if (!ok)
+      record_validation_status(status, INAPPROPRIATE_EKU_EXTENSION);
+  }
 
-static char x509_object_get_ski__doc__[] =
-  EXTENSION_GET_SKI__DOC__
-  ;
+  /* Critical */
+  if ((policies = X509_get_ext_d2i(x, NID_certificate_policies, &crit, NULL)) != NULL) {
+    POLICYQUALINFO *qualifier = NULL;
+    POLICYINFO *policy = NULL;
+    ex_count--;
+    if (!crit || sk_POLICYINFO_num(policies) != 1 ||
+	(policy = sk_POLICYINFO_value(policies, 0)) == NULL ||
+	OBJ_obj2nid(policy->policyid) != NID_cp_ipAddr_asNumber ||
+	sk_POLICYQUALINFO_num(policy->qualifiers) > 1 ||
+	(sk_POLICYQUALINFO_num(policy->qualifiers) == 1 &&
+	 ((qualifier = sk_POLICYQUALINFO_value(policy->qualifiers, 0)) == NULL ||
+	  OBJ_obj2nid(qualifier->pqualid) != NID_id_qt_cps)))
+      record_validation_status(status, BAD_CERTIFICATE_POLICY);
+    else if (qualifier != NULL)
+      record_validation_status(status, POLICY_QUALIFIER_CPS);
+  }
 
-static PyObject *
-x509_object_get_ski(x509_object *self)
-{
-  return extension_get_ski(x509_object_extension_get_helper(self, NID_subject_key_identifier));
-}
+  /* Critical */
+  if ((x->ex_flags & EXFLAG_KUSAGE) == 0) 
+    record_validation_status(status, KEY_USAGE_MISSING);
+  else {
+    ex_count--;    
+    if (!X509_EXTENSION_get_critical(X509_get_ext(x, X509_get_ext_by_NID(x, NID_key_usage, -1))) ||
+        x->ex_kusage != (is_ca ? KU_KEY_CERT_SIGN | KU_CRL_SIGN : KU_DIGITAL_SIGNATURE))
+      record_validation_status(status, BAD_KEY_USAGE);
+  }
 
-static char x509_object_set_ski__doc__[] =
-  EXTENSION_SET_SKI__DOC__
-  ;
+  /* Critical */
+  if ((addr = X509_get_ext_d2i(x, NID_sbgp_ipAddrBlock, &crit, NULL)) != NULL) {
+    ex_count--;
+    if (!crit || ekunid == NID_id_kp_bgpsec_router ||
+	!v3_addr_is_canonical(addr) || sk_IPAddressFamily_num(addr) == 0)
+      record_validation_status(status, BAD_IPADDRBLOCKS);
+    else
+      for (i = 0; i < sk_IPAddressFamily_num(addr); i++) {
+        IPAddressFamily *f = sk_IPAddressFamily_value(addr, i);
+        afi = v3_addr_get_afi(f);
+        if (afi != IANA_AFI_IPV4 && afi != IANA_AFI_IPV6)
+          record_validation_status(status, UNKNOWN_AFI);
+        else if (f->addressFamily->length != 2)
+          record_validation_status(status, SAFI_NOT_ALLOWED);
+      }
+  }
 
-static PyObject *
-x509_object_set_ski(x509_object *self, PyObject *args)
-{
-  return x509_object_extension_set_helper(self, extension_set_ski(args));
-}
+  /* Critical */
+  if ((asid = X509_get_ext_d2i(x, NID_sbgp_autonomousSysNum, &crit, NULL)) != NULL) {
+    ex_count--;
+    if (!crit || asid->asnum == NULL || asid->rdi != NULL || !v3_asid_is_canonical(asid) ||
+	(ekunid == NID_id_kp_bgpsec_router && asid->asnum->type == ASIdentifierChoice_inherit))
+      record_validation_status(status, BAD_ASIDENTIFIERS);
+  }
 
-static char x509_object_get_aki__doc__[] =
-  EXTENSION_GET_AKI__DOC__
-  ;
+  if (addr == NULL && asid == NULL)
+    record_validation_status(status, MISSING_RESOURCES);
 
-static PyObject *
-x509_object_get_aki(x509_object *self)
-{
-  return extension_get_aki(x509_object_extension_get_helper(self, NID_authority_key_identifier));
+  /* Non-critical */
+  if ((ski = X509_get_ext_d2i(x, NID_subject_key_identifier, &crit, NULL)) == NULL)
+    record_validation_status(status, SKI_EXTENSION_MISSING);
+  else {
+    ex_count--;
+    if (crit)
+      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
+    if ((ski_pubkey = X509_get0_pubkey_bitstr(x)) == NULL ||
+        !EVP_Digest(ski_pubkey->data, ski_pubkey->length,
+                    ski_hashbuf, &ski_hashlen, EVP_sha1(), NULL) ||
+        ski_hashlen != 20 ||
+        ski_hashlen != ASN1_STRING_length(ski) ||
+        memcmp(ski_hashbuf, ASN1_STRING_data(ski), ski_hashlen))
+      record_validation_status(status, SKI_PUBLIC_KEY_MISMATCH);
+  }
+
+  /* Non-critical */
+  if ((aki = X509_get_ext_d2i(x, NID_authority_key_identifier, &crit, NULL)) != NULL) {
+    ex_count--;
+    if (crit)
+      record_validation_status(status, GRATUITOUSLY_CRITICAL_EXTENSION);
+    if (aki->keyid == NULL || aki->serial != NULL || aki->issuer != NULL)
+      record_validation_status(status, AKI_EXTENSION_WRONG_FORMAT);
+  }
+
+  if (ex_count > 0)
+    record_validation_status(status, DISALLOWED_X509V3_EXTENSION);
+
+  /*
+   * Public key checks.
+   */
+
+  subject_pkey = X509_get_pubkey(x);
+  ok = subject_pkey != NULL;
+  if (ok) {
+    ASN1_OBJECT *algorithm;
+
+    (void) X509_PUBKEY_get0_param(&algorithm, NULL, NULL, NULL, X509_get_X509_PUBKEY(x));
+
+    switch (OBJ_obj2nid(algorithm)) {
+
+    case NID_rsaEncryption:
+      ok = (EVP_PKEY_base_id(subject_pkey) == EVP_PKEY_RSA &&
+            EVP_PKEY_bits(subject_pkey) == 2048 &&
+            BN_get_word(subject_pkey->pkey.rsa->e) == 65537);
+      break;
+
+    case NID_X9_62_id_ecPublicKey:
+      ok = (EVP_PKEY_base_id(subject_pkey) == EVP_PKEY_EC &&
+            ekunid == NID_id_kp_bgpsec_router &&
+            EC_GROUP_get_curve_name(EC_KEY_get0_group(subject_pkey->pkey.ec)) == NID_X9_62_prime256v1);
+      break;
+
+    default:
+      ok = 0;
+    }
+  }
+  if (!ok)
+    record_validation_status(status, BAD_PUBLIC_KEY);
+
+  ret = 1;
+
+ error:
+  EVP_PKEY_free(issuer_pkey);
+  EVP_PKEY_free(subject_pkey);
+  BASIC_CONSTRAINTS_free(bc);
+  sk_ACCESS_DESCRIPTION_pop_free(sia, ACCESS_DESCRIPTION_free);
+  sk_ACCESS_DESCRIPTION_pop_free(aia, ACCESS_DESCRIPTION_free);
+  sk_DIST_POINT_pop_free(crldp, DIST_POINT_free);
+  sk_POLICYINFO_pop_free(policies, POLICYINFO_free);
+  sk_ASN1_OBJECT_pop_free(eku, ASN1_OBJECT_free);
+  ASN1_OCTET_STRING_free(ski);
+  AUTHORITY_KEYID_free(aki);
+  ASIdentifiers_free(asid);
+  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
+
+  return ret;
 }
 
-static char x509_object_set_aki__doc__[] =
-  EXTENSION_SET_AKI__DOC__
+static char x509_object_check_rpki_conformance__doc__[] =
+  "Check a certificate for conformance to the RPKI profile.\n"
   ;
 
+#warning Write real x509_object_check_rpki_conformance__doc__[] once API is stable.
+
 static PyObject *
-x509_object_set_aki(x509_object *self, PyObject *args)
+x509_object_check_rpki_conformance(x509_object *self, PyObject *args, PyObject *kwds)
 {
-  return x509_object_extension_set_helper(self, extension_set_aki(args));
+  static char *kwlist[] = {"status", "eku", NULL};
+  PyObject *status = Py_None;
+  PyObject *ekuarg = Py_None;
+  int ekunid = NID_undef;
+
+  ENTERING(x509_object_check_rpki_conformance);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O", kwlist, &PySet_Type, &status, &ekuarg))
+    goto error;
+
+  if (ekuarg != Py_None) {
+    const char *ekutxt = PyString_AsString(ekuarg);
+    if (ekutxt == NULL)
+      goto error;
+    ekunid = OBJ_txt2nid(ekutxt);
+  }
+
+  if (!check_x509(self->x509, ekunid, status))
+    goto error;
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
 }
 
-static char x509_object_get_key_usage__doc__[] =
-  EXTENSION_GET_KEY_USAGE__DOC__
+static char x509_object_get_version__doc__[] =
+  "Return version number of this certificate.\n"
   ;
 
 static PyObject *
-x509_object_get_key_usage(x509_object *self)
+x509_object_get_version(x509_object *self)
 {
-  return extension_get_key_usage(x509_object_extension_get_helper(self, NID_key_usage));
+  ENTERING(x509_object_get_version);
+  return Py_BuildValue("l", X509_get_version(self->x509));
 }
 
-static char x509_object_set_key_usage__doc__[] =
-  "Set the KeyUsage extension for this certificate.\n"
+static char x509_object_set_version__doc__[] =
+  "Set version number of this certificate.\n"
   "\n"
-  EXTENSION_SET_KEY_USAGE__DOC__
+  "The \"version\" parameter should be an integer.\n"
   ;
 
 static PyObject *
-x509_object_set_key_usage(x509_object *self, PyObject *args)
+x509_object_set_version(x509_object *self, PyObject *args)
 {
-  return x509_object_extension_set_helper(self, extension_set_key_usage(args));
-}
+  long version = 0;
 
-static char x509_object_get_eku__doc__[] =
-  EXTENSION_GET_EKU__DOC__
+  ENTERING(x509_object_set_version);
+
+  if (!PyArg_ParseTuple(args, "l", &version))
+    goto error;
+
+  if (!X509_set_version(self->x509, version))
+    lose("Couldn't set certificate version");
+
+  Py_RETURN_NONE;
+
+ error:
+
+  return NULL;
+}
+
+static char x509_object_get_serial__doc__[] =
+  "Return the serial number of this certificate.\n"
   ;
 
 static PyObject *
-x509_object_get_eku(x509_object *self)
+x509_object_get_serial(x509_object *self)
 {
-  return extension_get_eku(x509_object_extension_get_helper(self, NID_ext_key_usage));
+  ENTERING(x509_object_get_serial);
+  return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(X509_get_serialNumber(self->x509)));
 }
 
-static char x509_object_set_eku__doc__[] =
-  "Set the ExtendedKeyUsage extension for this certificate.\n"
+static char x509_object_set_serial__doc__[] =
+  "Set the serial number of this certificate.\n"
   "\n"
-  EXTENSION_SET_EKU__DOC__
+  "The \"serial\" parameter should ba an integer.\n"
   ;
 
 static PyObject *
-x509_object_set_eku(x509_object *self, PyObject *args)
+x509_object_set_serial(x509_object *self, PyObject *args)
 {
-  return x509_object_extension_set_helper(self, extension_set_eku(args));
+  ASN1_INTEGER *a_serial = NULL;
+  PyObject *p_serial = NULL;
+  int ok = 0;
+
+  ENTERING(x509_object_set_serial);
+
+  if (!PyArg_ParseTuple(args, "O", &p_serial) ||
+      (a_serial = PyLong_to_ASN1_INTEGER(p_serial)) == NULL)
+    goto error;
+
+  if (!X509_set_serialNumber(self->x509, a_serial))
+    lose_no_memory();
+
+  ok = 1;
+
+ error:
+  ASN1_INTEGER_free(a_serial);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
 }
 
-static char x509_object_get_rfc3779__doc__[] =
-  "Return this certificate's RFC 3779 resources.\n"
+static char x509_object_get_issuer__doc__[] =
+  "Return this certificate's issuer name, represented as a tuple.\n"
   "\n"
-  "Return value is a three-element tuple: the first element is the ASN\n"
-  "resources, the second is the IPv4 resources, the third is the IPv6\n"
-  "resources.  Each of these elements in turn can be:\n"
+  "Each element of this tuple is another tuple representing one\n"
+  "\"Relative Distinguished Name\" (RDN), each element of which in turn\n"
+  "is yet another tuple representing one AttributeTypeAndValue pair.\n"
   "\n"
-  "* None, if this certificate contains no resources of this kind;\n"
+  "In practice, RDNs containing multiple attributes are rare, thus the RDN\n"
+  "tuples will usually be exactly one element long, but using the\n"
+  "tuple-of-tuples-of-tuples format lets us represent the general case.\n"
   "\n"
-  "* the string \"inherit\", if this certificate inherits this kind\n"
-  "  of resources from its  issuer; or\n"
+  "The AttributeTypeANdValue pairs are two-element tuples, the first\n"
+  "element of which is a string representing an Object Identifier (OID),\n"
+  "the second of which contains the attribute value.\n"
   "\n"
-  "* a tuple representing a set of ranges of ASNs or IP addresses.\n"
+  "This method takes an optional \"format\" parameter which controls\n"
+  "the format in which OIDs are returned.  Allowed values are:\n"
   "\n"
-  "Each range is a two-element tuple, respectively representing the low\n"
-  "and high ends of the range, inclusive.  ASN ranges are represented by\n"
-  "pairs of integers, IP address ranges are represented by pairs of\n"
-  "IPAddress objects.\n"
+  "  * SHORTNAME_FORMAT (the OpenSSL \"short name\" for this OID)\n"
+  "  * LONGNAME_FORMAT  (the OpenSSL \"long name\" for this OID)\n"
+  "  * OIDNAME_FORMAT   (the OID in dotted decimal numeric format)\n"
+  "\n"
+  "The default is OIDNAME_FORMAT.\n"
+  "\n"
+  "See RFC 5280 section 4.1.2.4 for details of the ASN.1 structure.\n"
   ;
 
 static PyObject *
-x509_object_get_rfc3779(x509_object *self)
+x509_object_get_issuer(x509_object *self, PyObject *args)
 {
   PyObject *result = NULL;
-  PyObject *asn_result = NULL;
-  PyObject *ipv4_result = NULL;
-  PyObject *ipv6_result = NULL;
-  PyObject *range = NULL;
-  PyObject *range_b = NULL;
-  PyObject *range_e = NULL;
-  ASIdentifiers *asid = NULL;
-  IPAddrBlocks *addr = NULL;
-  int i, j;
+  int format = OIDNAME_FORMAT;
 
-  ENTERING(x509_object_get_rfc3779);
+  ENTERING(x509_object_get_issuer);
 
-  if ((asid = X509_get_ext_d2i(self->x509, NID_sbgp_autonomousSysNum, NULL, NULL)) != NULL &&
-      asid->asnum != NULL) {
-    switch (asid->asnum->type) {
+  if (!PyArg_ParseTuple(args, "|i", &format))
+    goto error;
 
-    case ASIdentifierChoice_inherit:
-      if ((asn_result = PyString_FromString("inherit")) == NULL)
-        goto error;
-      break;
+  result = x509_object_helper_get_name(X509_get_issuer_name(self->x509),
+                                       format);
 
-    case ASIdentifierChoice_asIdsOrRanges:
+ error:                         /* Fall through */
+  return result;
+}
 
-      if ((asn_result = PyTuple_New(sk_ASIdOrRange_num(asid->asnum->u.asIdsOrRanges))) == NULL)
-        goto error;
+static char x509_object_get_subject__doc__[] =
+  "Return this certificate's subject name, as a tuple.\n"
+  "\n"
+  "See the documentation for the \"getIssuer\" method for details on the\n"
+  "structure of the return value and use of the optional \"format\"\n"
+  "parameter.\n"
+  ;
 
-      for (i = 0; i < sk_ASIdOrRange_num(asid->asnum->u.asIdsOrRanges); i++) {
-        ASIdOrRange *aor = sk_ASIdOrRange_value(asid->asnum->u.asIdsOrRanges, i);
-        ASN1_INTEGER *b = NULL;
-        ASN1_INTEGER *e = NULL;
+static PyObject *
+x509_object_get_subject(x509_object *self, PyObject *args)
+{
+  PyObject *result = NULL;
+  int format = OIDNAME_FORMAT;
 
-        switch (aor->type) {
+  ENTERING(x509_object_get_subject);
 
-        case ASIdOrRange_id:
-          b = e = aor->u.id;
-          break;
+  if (!PyArg_ParseTuple(args, "|i", &format))
+    goto error;
 
-        case ASIdOrRange_range:
-          b = aor->u.range->min;
-          e = aor->u.range->max;
-          break;
+  result = x509_object_helper_get_name(X509_get_subject_name(self->x509),
+                                       format);
 
-        default:
-          lose_value_error("Unexpected asIdsOrRanges type");
-        }
+ error:                         /* Fall through */
+  return result;
+}
 
-        if (ASN1_STRING_type(b) == V_ASN1_NEG_INTEGER ||
-            ASN1_STRING_type(e) == V_ASN1_NEG_INTEGER)
-          lose_value_error("I don't believe in negative ASNs");
+static char x509_object_set_subject__doc__[] =
+  "Set this certificate's subject name.\n"
+  "\n"
+  "The \"name\" parameter should be in the same format as the return\n"
+  "value from the \"getIssuer\" method.\n"
+  ;
 
-        if ((range_b = ASN1_INTEGER_to_PyLong(b)) == NULL ||
-            (range_e = ASN1_INTEGER_to_PyLong(e)) == NULL ||
-            (range = Py_BuildValue("(NN)", range_b, range_e)) == NULL)
-          goto error;
+static PyObject *
+x509_object_set_subject(x509_object *self, PyObject *args)
+{
+  PyObject *name_sequence = NULL;
+  X509_NAME *name = NULL;
 
-        PyTuple_SET_ITEM(asn_result, i, range);
-        range = range_b = range_e = NULL;
-      }
+  ENTERING(x509_object_set_subject);
 
-      break;
+  if (!PyArg_ParseTuple(args, "O", &name_sequence))
+    goto error;
 
-    default:
-      lose_value_error("Unexpected ASIdentifierChoice type");
-    }
-  }
+  if (!PySequence_Check(name_sequence))
+    lose_type_error("Expected a sequence object");
 
-  if ((addr = X509_get_ext_d2i(self->x509, NID_sbgp_ipAddrBlock, NULL, NULL)) != NULL) {
-    for (i = 0; i < sk_IPAddressFamily_num(addr); i++) {
-      IPAddressFamily *f = sk_IPAddressFamily_value(addr, i);
-      const struct ipaddress_version *ip_type = NULL;
-      const unsigned int afi = v3_addr_get_afi(f);
-      PyObject **result_obj = NULL;
-      int addr_len = 0;
+  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
+    goto error;
 
-      switch (afi) {
-      case IANA_AFI_IPV4: result_obj = &ipv4_result; ip_type = &ipaddress_version_4; break;
-      case IANA_AFI_IPV6: result_obj = &ipv6_result; ip_type = &ipaddress_version_6; break;
-      default:            lose_value_error("Unknown AFI");
-      }
+  if (!X509_set_subject_name(self->x509, name))
+    lose("Unable to set subject name");
 
-      if (*result_obj != NULL)
-        lose_value_error("Duplicate IPAddressFamily");
+  X509_NAME_free(name);
 
-      if (f->addressFamily->length > 2)
-        lose_value_error("Unsupported SAFI");
+  Py_RETURN_NONE;
 
-      switch (f->ipAddressChoice->type) {
+ error:
+  X509_NAME_free(name);
+  return NULL;
+}
 
-      case IPAddressChoice_inherit:
-        if ((*result_obj = PyString_FromString("inherit")) == NULL)
-          goto error;
-        continue;
+static char x509_object_set_issuer__doc__[] =
+  "Set this certificate's issuer name.\n"
+  "\n"
+  "The \"name\" parameter should be in the same format as the return\n"
+  "value from the \"getIssuer\" method.\n"
+  ;
 
-      case IPAddressChoice_addressesOrRanges:
-        break;
+static PyObject *
+x509_object_set_issuer(x509_object *self, PyObject *args)
+{
+  PyObject *name_sequence = NULL;
+  X509_NAME *name = NULL;
 
-      default:
-        lose_value_error("Unexpected IPAddressChoice type");
-      }
+  ENTERING(x509_object_set_issuer);
 
-      if ((*result_obj = PyTuple_New(sk_IPAddressOrRange_num(f->ipAddressChoice->u.addressesOrRanges))) == NULL)
-        goto error;
+  if (!PyArg_ParseTuple(args, "O", &name_sequence))
+    goto error;
 
-      for (j = 0; j < sk_IPAddressOrRange_num(f->ipAddressChoice->u.addressesOrRanges); j++) {
-        IPAddressOrRange *aor = sk_IPAddressOrRange_value(f->ipAddressChoice->u.addressesOrRanges, j);
-        ipaddress_object *addr_b = NULL;
-        ipaddress_object *addr_e = NULL;
+  if (!PySequence_Check(name_sequence))
+    lose_type_error("Expected a sequence object");
 
-        if ((range_b = POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL ||
-            (range_e = POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL)
-          goto error;
+  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
+    goto error;
 
-        addr_b = (ipaddress_object *) range_b;
-        addr_e = (ipaddress_object *) range_e;
+  if (!X509_set_issuer_name(self->x509, name))
+    lose("Unable to set issuer name");
 
-        if ((addr_len = v3_addr_get_range(aor, afi, addr_b->address, addr_e->address,
-                                          sizeof(addr_b->address))) == 0)
-          lose_value_error("Couldn't unpack IP addresses from BIT STRINGs");
+  X509_NAME_free(name);
 
-        addr_b->type = addr_e->type = ip_type;
+  Py_RETURN_NONE;
 
-        if ((range = Py_BuildValue("(NN)", range_b, range_e)) == NULL)
-          goto error;
+ error:
+  X509_NAME_free(name);
+  return  NULL;
+}
 
-        PyTuple_SET_ITEM(*result_obj, j, range);
-        range = range_b = range_e = NULL;
-      }
-    }
-  }
+static char x509_object_get_issuer_hash__doc__[] =
+  "Return the OpenSSL \"name hash\" for this certificate's issuer name.\n"
+  ;
 
-  result = Py_BuildValue("(OOO)",
-                         (asn_result  == NULL ? Py_None : asn_result),
-                         (ipv4_result == NULL ? Py_None : ipv4_result),
-                         (ipv6_result == NULL ? Py_None : ipv6_result));
+static PyObject *
+x509_object_get_issuer_hash(x509_object *self)
+{
+  ENTERING(x509_object_get_issuer_hash);
+  return Py_BuildValue("k", X509_NAME_hash(X509_get_issuer_name(self->x509)));
+}
 
- error:                         /* Fall through */
-  ASIdentifiers_free(asid);
-  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
-  Py_XDECREF(range_b);
-  Py_XDECREF(range_e);
-  Py_XDECREF(range);
-  Py_XDECREF(asn_result);
-  Py_XDECREF(ipv4_result);
-  Py_XDECREF(ipv6_result);
+static char x509_object_get_subject_hash__doc__[] =
+  "Return the OpenSSL \"name hash\" for this certificate's subject name.\n"
+  ;
 
-  return result;
+static PyObject *
+x509_object_get_subject_hash(x509_object *self)
+{
+  ENTERING(x509_object_get_subject_hash);
+  return Py_BuildValue("k", X509_NAME_hash(X509_get_subject_name(self->x509)));
 }
 
-static char x509_object_set_rfc3779__doc__[] =
-  "Set this certificate's RFC 3779 resources.\n"
-  "\n"
-  "This method takes three arguments: \"asn\", \"ipv4\", and \"ipv6\".\n"
-  "\n"
-  "Each of these arguments can be:\n"
-  "\n"
-  "* None, to omit this kind of resource;\n"
-  "\n"
-  "* The string \"inherit\", to specify RFC 3779 resource inheritance; or\n"
-  "\n"
-  "* An iterable object which returns range pairs of the appropriate type.\n"
-  "\n"
-  "Range pairs are as returned by the .getRFC3779() method.\n"
+static char x509_object_get_not_before__doc__[] =
+  "Return this certificate's \"notBefore\" value as a datetime.\n"
   ;
 
 static PyObject *
-x509_object_set_rfc3779(x509_object *self, PyObject *args, PyObject *kwds)
+x509_object_get_not_before (x509_object *self)
 {
-  static char *kwlist[] = {"asn", "ipv4", "ipv6", NULL};
-  PyObject *asn_arg  = Py_None;
-  PyObject *ipv4_arg = Py_None;
-  PyObject *ipv6_arg = Py_None;
-  PyObject *iterator = NULL;
-  PyObject *item = NULL;
-  PyObject *fast = NULL;
-  ASIdentifiers *asid = NULL;
-  IPAddrBlocks *addr = NULL;
-  ASN1_INTEGER *asid_b = NULL;
-  ASN1_INTEGER *asid_e = NULL;
-  ipaddress_object *addr_b = NULL;
-  ipaddress_object *addr_e = NULL;
-  int empty = 0;
+  ENTERING(x509_object_get_not_before);
+  return ASN1_TIME_to_Python(X509_get_notBefore(self->x509));
+}
 
-  ENTERING(x509_object_set_rfc3779);
+static char x509_object_get_not_after__doc__[] =
+  "Return this certificate's \"notAfter\" value as a datetime.\n"
+  ;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOO", kwlist, &asn_arg, &ipv4_arg, &ipv6_arg))
-    goto error;
+static PyObject *
+x509_object_get_not_after (x509_object *self)
+{
+  ENTERING(x509_object_get_not_after);
+  return ASN1_TIME_to_Python(X509_get_notAfter(self->x509));
+}
 
-  if (asn_arg != Py_None) {
+static char x509_object_set_not_after__doc__[] =
+  "Set this certificate's \"notAfter\" value.\n"
+  "\n"
+  "The \"time\" parameter should be a datetime object.\n"
+  ;
 
-    empty = 1;
+static PyObject *
+x509_object_set_not_after (x509_object *self, PyObject *args)
+{
+  PyObject *o = NULL;
+  ASN1_TIME *t = NULL;
 
-    if ((asid = ASIdentifiers_new()) == NULL)
-      lose_no_memory();
+  ENTERING(x509_object_set_not_after);
 
-    if (PyString_Check(asn_arg)) {
+  if (!PyArg_ParseTuple(args, "O", &o))
+    goto error;
 
-      if (strcmp(PyString_AsString(asn_arg), "inherit"))
-        lose_type_error("ASID must be an iterable that returns range pairs, or the string \"inherit\"");
+  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
+    lose("Couldn't convert notAfter string");
 
-      if (!v3_asid_add_inherit(asid, V3_ASID_ASNUM))
-        lose_no_memory();
+  if (!X509_set_notAfter(self->x509, t))
+    lose("Couldn't set notAfter");
 
-      empty = 0;
+  ASN1_TIME_free(t);
+  Py_RETURN_NONE;
 
-    } else {
+ error:
+  ASN1_TIME_free(t);
+  return NULL;
+}
 
-      if ((iterator = PyObject_GetIter(asn_arg)) == NULL)
-        goto error;
+static char x509_object_set_not_before__doc__[] =
+  "Set this certificate's \"notBefore\" value.\n"
+  "\n"
+  "The \"time\" parameter should be a datetime object.\n"
+  ;
 
-      while ((item = PyIter_Next(iterator)) != NULL) {
+static PyObject *
+x509_object_set_not_before (x509_object *self, PyObject *args)
+{
+  PyObject *o = NULL;
+  ASN1_TIME *t = NULL;
 
-        if ((fast = PySequence_Fast(item, "ASN range must be a sequence")) == NULL)
-          goto error;
+  ENTERING(x509_object_set_not_before);
 
-        if (PySequence_Fast_GET_SIZE(fast) != 2)
-          lose_type_error("ASN range must be two-element sequence");
+  if (!PyArg_ParseTuple(args, "O", &o))
+    goto error;
 
-        if ((asid_b = PyLong_to_ASN1_INTEGER(PySequence_Fast_GET_ITEM(fast, 0))) == NULL)
-          goto error;
+  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
+    lose("Couldn't convert notBefore string");
 
-        switch (PyObject_RichCompareBool(PySequence_Fast_GET_ITEM(fast, 0),
-                                         PySequence_Fast_GET_ITEM(fast, 1), Py_EQ)) {
-        case 0:
-          if ((asid_e = PyLong_to_ASN1_INTEGER(PySequence_Fast_GET_ITEM(fast, 1))) == NULL)
-            goto error;
-          break;
-        case 1:
-          break;
-        default:
-          goto error;
-        }
+  if (!X509_set_notBefore(self->x509, t))
+    lose("Couldn't set notBefore");
 
-        if (!v3_asid_add_id_or_range(asid, V3_ASID_ASNUM, asid_b, asid_e))
-          lose_openssl_error("Couldn't add range to ASID");
+  ASN1_TIME_free(t);
+  Py_RETURN_NONE;
 
-        asid_b = asid_e = NULL;
-        Py_XDECREF(item);
-        Py_XDECREF(fast);
-        item = fast = NULL;
-        empty = 0;
-      }
+ error:
+  ASN1_TIME_free(t);
+  return NULL;
+}
 
-      Py_XDECREF(iterator);
-      iterator = NULL;
-    }
+static char x509_object_clear_extensions__doc__[] =
+  "Clear all extensions attached to this certificate.\n"
+  ;
 
-    if (!empty && (!v3_asid_canonize(asid) ||
-                   !X509_add1_ext_i2d(self->x509, NID_sbgp_autonomousSysNum,
-                                      asid, 1, X509V3_ADD_REPLACE)))
-      lose_openssl_error("Couldn't add ASID extension to certificate");
-  }
+static PyObject *
+x509_object_clear_extensions(x509_object *self)
+{
+  X509_EXTENSION *ext;
 
-  if (ipv4_arg != Py_None || ipv6_arg != Py_None) {
-    int v;
- 
-    empty = 1;
+  ENTERING(x509_object_clear_extensions);
 
-    if ((addr = sk_IPAddressFamily_new_null()) == NULL)
-      lose_no_memory();
+  while ((ext = X509_delete_ext(self->x509, 0)) != NULL)
+    X509_EXTENSION_free(ext);
 
-    /*
-     * Cheap trick to let us inline all of this instead of being
-     * forced to use a separate function.  Refactor, some day.
-     */
+  Py_RETURN_NONE;
+}
 
-    for (v = 0; v < (int) (sizeof(ipaddress_versions)/sizeof(*ipaddress_versions)); v++) {
-      const struct ipaddress_version *ip_type = ipaddress_versions[v];
-      PyObject **argp;
+static char x509_object_get_ski__doc__[] =
+  EXTENSION_GET_SKI__DOC__
+  ;
 
-      switch (ip_type->version) {
-      case 4: argp = &ipv4_arg; break;
-      case 6: argp = &ipv6_arg; break;
-      default: continue;        /* Never happens */
-      }
+static PyObject *
+x509_object_get_ski(x509_object *self)
+{
+  return extension_get_ski(x509_object_extension_get_helper(self, NID_subject_key_identifier));
+}
 
-      if (PyString_Check(*argp)) {
+static char x509_object_set_ski__doc__[] =
+  EXTENSION_SET_SKI__DOC__
+  ;
 
-        if (strcmp(PyString_AsString(*argp), "inherit"))
-          lose_type_error("Argument must be an iterable that returns range pairs, or the string \"inherit\"");
+static PyObject *
+x509_object_set_ski(x509_object *self, PyObject *args)
+{
+  return x509_object_extension_set_helper(self, extension_set_ski(args));
+}
 
-        if (!v3_addr_add_inherit(addr, ip_type->afi, NULL))
-          lose_no_memory();
+static char x509_object_get_aki__doc__[] =
+  EXTENSION_GET_AKI__DOC__
+  ;
 
-        empty = 0;
+static PyObject *
+x509_object_get_aki(x509_object *self)
+{
+  return extension_get_aki(x509_object_extension_get_helper(self, NID_authority_key_identifier));
+}
 
-      } else {
+static char x509_object_set_aki__doc__[] =
+  EXTENSION_SET_AKI__DOC__
+  ;
 
-        if ((iterator = PyObject_GetIter(*argp)) == NULL)
-          goto error;
+static PyObject *
+x509_object_set_aki(x509_object *self, PyObject *args)
+{
+  return x509_object_extension_set_helper(self, extension_set_aki(args));
+}
 
-        while ((item = PyIter_Next(iterator)) != NULL) {
-
-          if ((fast = PySequence_Fast(item, "Address range must be a sequence")) == NULL)
-            goto error;
-
-          if (PySequence_Fast_GET_SIZE(fast) != 2 ||
-              !POW_IPAddress_Check(PySequence_Fast_GET_ITEM(fast, 0)) ||
-              !POW_IPAddress_Check(PySequence_Fast_GET_ITEM(fast, 1)))
-            lose_type_error("Address range must be two-element sequence of IPAddress objects");
-
-          addr_b = (ipaddress_object *) PySequence_Fast_GET_ITEM(fast, 0);
-          addr_e = (ipaddress_object *) PySequence_Fast_GET_ITEM(fast, 1);
-
-          if (addr_b->type != ip_type ||
-              addr_e->type != ip_type ||
-              memcmp(addr_b->address, addr_e->address, ip_type->length) > 0)
-            lose("Address range must be two-element sequence of IPAddress objects in ascending order");
-
-          if (!v3_addr_add_range(addr, ip_type->afi, NULL, addr_b->address, addr_e->address))
-            lose_openssl_error("Couldn't add range to IPAddrBlock");
-
-          Py_XDECREF(item);
-          Py_XDECREF(fast);
-          item = fast = NULL;
-          addr_b = addr_e = NULL;
-          empty = 0;
-        }
-
-        Py_XDECREF(iterator);
-        iterator = NULL;
-      }
-    }
-
-    if (!empty && (!v3_addr_canonize(addr) ||
-                   !X509_add1_ext_i2d(self->x509, NID_sbgp_ipAddrBlock,
-                                      addr, 1, X509V3_ADD_REPLACE)))
-      lose_openssl_error("Couldn't add IPAddrBlock extension to certificate");
-  }
-
-  Py_RETURN_NONE;
-
- error:
-  ASN1_INTEGER_free(asid_b);
-  ASN1_INTEGER_free(asid_e);
-  ASIdentifiers_free(asid);
-  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
-  Py_XDECREF(iterator);
-  Py_XDECREF(item);
-  Py_XDECREF(fast);
-  return NULL;
-}
-
-static char x509_object_get_basic_constraints__doc__[] =
-  "Return BasicConstraints for this certificate.\n"
-  "\n"
-  EXTENSION_GET_BASIC_CONSTRAINTS__DOC__
+static char x509_object_get_key_usage__doc__[] =
+  EXTENSION_GET_KEY_USAGE__DOC__
   ;
 
 static PyObject *
-x509_object_get_basic_constraints(x509_object *self)
+x509_object_get_key_usage(x509_object *self)
 {
-  return extension_get_basic_constraints(x509_object_extension_get_helper(self, NID_basic_constraints));
+  return extension_get_key_usage(x509_object_extension_get_helper(self, NID_key_usage));
 }
 
-static char x509_object_set_basic_constraints__doc__[] =
-  "Set BasicConstraints for this certificate.\n"
+static char x509_object_set_key_usage__doc__[] =
+  "Set the KeyUsage extension for this certificate.\n"
   "\n"
-  EXTENSION_SET_BASIC_CONSTRAINTS__DOC__
+  EXTENSION_SET_KEY_USAGE__DOC__
   ;
 
 static PyObject *
-x509_object_set_basic_constraints(x509_object *self, PyObject *args)
+x509_object_set_key_usage(x509_object *self, PyObject *args)
 {
-  return x509_object_extension_set_helper(self, extension_set_basic_constraints(args));
+  return x509_object_extension_set_helper(self, extension_set_key_usage(args));
 }
 
-static char x509_object_get_sia__doc__[] =
-  "Get SIA values for this certificate.\n"
-  "\n"
-  EXTENSION_GET_SIA__DOC__
+static char x509_object_get_eku__doc__[] =
+  EXTENSION_GET_EKU__DOC__
   ;
 
 static PyObject *
-x509_object_get_sia(x509_object *self)
+x509_object_get_eku(x509_object *self)
 {
-  return extension_get_sia(x509_object_extension_get_helper(self, NID_sinfo_access));
+  return extension_get_eku(x509_object_extension_get_helper(self, NID_ext_key_usage));
 }
 
-static char x509_object_set_sia__doc__[] =
-  "Set SIA values for this certificate.\n"
+static char x509_object_set_eku__doc__[] =
+  "Set the ExtendedKeyUsage extension for this certificate.\n"
   "\n"
-  EXTENSION_SET_SIA__DOC__
+  EXTENSION_SET_EKU__DOC__
   ;
 
 static PyObject *
-x509_object_set_sia(x509_object *self, PyObject *args, PyObject *kwds)
+x509_object_set_eku(x509_object *self, PyObject *args)
 {
-  return x509_object_extension_set_helper(self, extension_set_sia(args, kwds));
+  return x509_object_extension_set_helper(self, extension_set_eku(args));
 }
 
-static char x509_object_get_aia__doc__[] =
-  "Get this certificate's AIA values.\n"
+static char x509_object_get_rfc3779__doc__[] =
+  "Return this certificate's RFC 3779 resources.\n"
   "\n"
-  "If the certificate has no AIA extension, this method returns None.\n"
-  "\n"  
-  "Otherwise, this returns a sequence of caIssuers URIs.\n"
+  "Return value is a three-element tuple: the first element is the ASN\n"
+  "resources, the second is the IPv4 resources, the third is the IPv6\n"
+  "resources.  Each of these elements in turn can be:\n"
   "\n"
-  "Any other accessMethods are ignored, as are any non-URI accessLocations.\n"
+  "* None, if this certificate contains no resources of this kind;\n"
+  "\n"
+  "* the string \"inherit\", if this certificate inherits this kind\n"
+  "  of resources from its  issuer; or\n"
+  "\n"
+  "* a tuple representing a set of ranges of ASNs or IP addresses.\n"
+  "\n"
+  "Each range is a two-element tuple, respectively representing the low\n"
+  "and high ends of the range, inclusive.  ASN ranges are represented by\n"
+  "pairs of integers, IP address ranges are represented by pairs of\n"
+  "IPAddress objects.\n"
   ;
 
 static PyObject *
-x509_object_get_aia(x509_object *self)
+x509_object_get_rfc3779(x509_object *self)
 {
-  AUTHORITY_INFO_ACCESS *ext = NULL;
   PyObject *result = NULL;
-  const char *uri;
-  PyObject *obj;
-  int i, n = 0;
-
-  ENTERING(x509_object_get_aia);
+  PyObject *asn_result = NULL;
+  PyObject *ipv4_result = NULL;
+  PyObject *ipv6_result = NULL;
+  PyObject *range = NULL;
+  PyObject *range_b = NULL;
+  PyObject *range_e = NULL;
+  ASIdentifiers *asid = NULL;
+  IPAddrBlocks *addr = NULL;
+  int i, j;
 
-  if ((ext = X509_get_ext_d2i(self->x509, NID_info_access, NULL, NULL)) == NULL)
-    Py_RETURN_NONE;
+  ENTERING(x509_object_get_rfc3779);
 
-  for (i = 0; i < sk_ACCESS_DESCRIPTION_num(ext); i++) {
-    ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(ext, i);
-    if (a->location->type == GEN_URI &&
-        OBJ_obj2nid(a->method) == NID_ad_ca_issuers)
-      n++;
-  }
+  if ((asid = X509_get_ext_d2i(self->x509, NID_sbgp_autonomousSysNum, NULL, NULL)) != NULL &&
+      asid->asnum != NULL) {
+    switch (asid->asnum->type) {
 
-  if (((result = PyTuple_New(n)) == NULL))
-    goto error;
+    case ASIdentifierChoice_inherit:
+      if ((asn_result = PyString_FromString("inherit")) == NULL)
+        goto error;
+      break;
 
-  n = 0;
+    case ASIdentifierChoice_asIdsOrRanges:
 
-  for (i = 0; i < sk_ACCESS_DESCRIPTION_num(ext); i++) {
-    ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(ext, i);
-    if (a->location->type == GEN_URI && OBJ_obj2nid(a->method) == NID_ad_ca_issuers) {
-      uri = (char *) ASN1_STRING_data(a->location->d.uniformResourceIdentifier);
-      if ((obj = PyString_FromString(uri)) == NULL)
+      if ((asn_result = PyTuple_New(sk_ASIdOrRange_num(asid->asnum->u.asIdsOrRanges))) == NULL)
         goto error;
-      PyTuple_SET_ITEM(result, n++, obj);
-    }
-  }
 
-  AUTHORITY_INFO_ACCESS_free(ext);
-  return result;
+      for (i = 0; i < sk_ASIdOrRange_num(asid->asnum->u.asIdsOrRanges); i++) {
+        ASIdOrRange *aor = sk_ASIdOrRange_value(asid->asnum->u.asIdsOrRanges, i);
+        ASN1_INTEGER *b = NULL;
+        ASN1_INTEGER *e = NULL;
 
- error:
-  AUTHORITY_INFO_ACCESS_free(ext);
-  Py_XDECREF(result);
-  return NULL;
-}
+        switch (aor->type) {
 
-static char x509_object_set_aia__doc__[] =
-  "Set AIA URIs for this certificate.\n"
-  "\n"
-  "Argument is a iterable which returns caIssuers URIs.\n"
-  ;
+        case ASIdOrRange_id:
+          b = e = aor->u.id;
+          break;
 
-static PyObject *
-x509_object_set_aia(x509_object *self, PyObject *args)
-{
-  AUTHORITY_INFO_ACCESS *ext = NULL;
-  PyObject *caIssuers = NULL;
-  PyObject *iterator = NULL;
-  ASN1_OBJECT *oid = NULL;
-  PyObject *item = NULL;
-  ACCESS_DESCRIPTION *a = NULL;
-  int ok = 0;
-  Py_ssize_t urilen;
-  char *uri;
+        case ASIdOrRange_range:
+          b = aor->u.range->min;
+          e = aor->u.range->max;
+          break;
 
-  ENTERING(x509_object_set_aia);
+        default:
+          lose_value_error("Unexpected asIdsOrRanges type");
+        }
 
-  if (!PyArg_ParseTuple(args, "O", &caIssuers))
-    goto error;
+        if (ASN1_STRING_type(b) == V_ASN1_NEG_INTEGER ||
+            ASN1_STRING_type(e) == V_ASN1_NEG_INTEGER)
+          lose_value_error("I don't believe in negative ASNs");
 
-  if ((ext = AUTHORITY_INFO_ACCESS_new()) == NULL)
-    lose_no_memory();
+        if ((range_b = ASN1_INTEGER_to_PyLong(b)) == NULL ||
+            (range_e = ASN1_INTEGER_to_PyLong(e)) == NULL ||
+            (range = Py_BuildValue("(NN)", range_b, range_e)) == NULL)
+          goto error;
 
-  if ((oid = OBJ_nid2obj(NID_ad_ca_issuers)) == NULL)
-    lose_openssl_error("Couldn't find AIA accessMethod OID");
+        PyTuple_SET_ITEM(asn_result, i, range);
+        range = range_b = range_e = NULL;
+      }
 
-  if ((iterator = PyObject_GetIter(caIssuers)) == NULL)
-    goto error;
+      break;
 
-  while ((item = PyIter_Next(iterator)) != NULL) {
+    default:
+      lose_value_error("Unexpected ASIdentifierChoice type");
+    }
+  }
 
-    if (PyString_AsStringAndSize(item, &uri, &urilen) < 0)
-      goto error;
+  if ((addr = X509_get_ext_d2i(self->x509, NID_sbgp_ipAddrBlock, NULL, NULL)) != NULL) {
+    for (i = 0; i < sk_IPAddressFamily_num(addr); i++) {
+      IPAddressFamily *f = sk_IPAddressFamily_value(addr, i);
+      const struct ipaddress_version *ip_type = NULL;
+      const unsigned int afi = v3_addr_get_afi(f);
+      PyObject **result_obj = NULL;
+      int addr_len = 0;
 
-    if ((a = ACCESS_DESCRIPTION_new()) == NULL ||
-        (a->method = OBJ_dup(oid)) == NULL ||
-        (a->location->d.uniformResourceIdentifier = ASN1_IA5STRING_new()) == NULL ||
-        !ASN1_OCTET_STRING_set(a->location->d.uniformResourceIdentifier, (unsigned char *) uri, urilen))
-      lose_no_memory();
+      switch (afi) {
+      case IANA_AFI_IPV4: result_obj = &ipv4_result; ip_type = &ipaddress_version_4; break;
+      case IANA_AFI_IPV6: result_obj = &ipv6_result; ip_type = &ipaddress_version_6; break;
+      default:            lose_value_error("Unknown AFI");
+      }
 
-    a->location->type = GEN_URI;
+      if (*result_obj != NULL)
+        lose_value_error("Duplicate IPAddressFamily");
 
-    if (!sk_ACCESS_DESCRIPTION_push(ext, a))
-      lose_no_memory();
+      if (f->addressFamily->length > 2)
+        lose_value_error("Unsupported SAFI");
 
-    a = NULL;
-    Py_XDECREF(item);
-    item = NULL;
-  }
+      switch (f->ipAddressChoice->type) {
 
-  Py_XDECREF(iterator);
-  iterator = NULL;
-
-  if (!X509_add1_ext_i2d(self->x509, NID_info_access, ext, 0, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add AIA extension to certificate");
-
-  ok = 1;
+      case IPAddressChoice_inherit:
+        if ((*result_obj = PyString_FromString("inherit")) == NULL)
+          goto error;
+        continue;
 
- error:
-  AUTHORITY_INFO_ACCESS_free(ext);
-  ACCESS_DESCRIPTION_free(a);
-  Py_XDECREF(item);
-  Py_XDECREF(iterator);
+      case IPAddressChoice_addressesOrRanges:
+        break;
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
-}
+      default:
+        lose_value_error("Unexpected IPAddressChoice type");
+      }
 
-static char x509_object_get_crldp__doc__[] =
-  "Get CRL Distribution Point (CRLDP) values for this certificate.\n"
-  "\n"
-  "If the certificate has no CRLDP extension, this method returns None.\n"
-  "\n"
-  "Otherwise, it returns a sequence of URIs representing distributionPoint\n"
-  "fullName values found in the first Distribution Point.  Other CRLDP\n"
-  "fields are ignored, as are subsequent Distribution Points and any non-URI\n"
-  "fullName values.\n"
-  ;
+      if ((*result_obj = PyTuple_New(sk_IPAddressOrRange_num(f->ipAddressChoice->u.addressesOrRanges))) == NULL)
+        goto error;
 
-static PyObject *
-x509_object_get_crldp(x509_object *self)
-{
-  CRL_DIST_POINTS *ext = NULL;
-  DIST_POINT *dp = NULL;
-  PyObject *result = NULL;
-  const char *uri;
-  PyObject *obj;
-  int i, n = 0;
+      for (j = 0; j < sk_IPAddressOrRange_num(f->ipAddressChoice->u.addressesOrRanges); j++) {
+        IPAddressOrRange *aor = sk_IPAddressOrRange_value(f->ipAddressChoice->u.addressesOrRanges, j);
+        ipaddress_object *addr_b = NULL;
+        ipaddress_object *addr_e = NULL;
 
-  ENTERING(x509_object_get_crldp);
+        if ((range_b = POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL ||
+            (range_e = POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL)
+          goto error;
 
-  if ((ext = X509_get_ext_d2i(self->x509, NID_crl_distribution_points, NULL, NULL)) == NULL ||
-      (dp = sk_DIST_POINT_value(ext, 0)) == NULL ||
-      dp->distpoint == NULL ||
-      dp->distpoint->type != 0)
-    Py_RETURN_NONE;
+        addr_b = (ipaddress_object *) range_b;
+        addr_e = (ipaddress_object *) range_e;
 
-  for (i = 0; i < sk_GENERAL_NAME_num(dp->distpoint->name.fullname); i++) {
-    GENERAL_NAME *gn = sk_GENERAL_NAME_value(dp->distpoint->name.fullname, i);
-    if (gn->type == GEN_URI)
-      n++;
-  }
+        if ((addr_len = v3_addr_get_range(aor, afi, addr_b->address, addr_e->address,
+                                          sizeof(addr_b->address))) == 0)
+          lose_value_error("Couldn't unpack IP addresses from BIT STRINGs");
 
-  if (((result = PyTuple_New(n)) == NULL))
-    goto error;
+        addr_b->type = addr_e->type = ip_type;
 
-  n = 0;
+        if ((range = Py_BuildValue("(NN)", range_b, range_e)) == NULL)
+          goto error;
 
-  for (i = 0; i < sk_GENERAL_NAME_num(dp->distpoint->name.fullname); i++) {
-    GENERAL_NAME *gn = sk_GENERAL_NAME_value(dp->distpoint->name.fullname, i);
-    if (gn->type == GEN_URI) {
-      uri = (char *) ASN1_STRING_data(gn->d.uniformResourceIdentifier);
-      if ((obj = PyString_FromString(uri)) == NULL)
-        goto error;
-      PyTuple_SET_ITEM(result, n++, obj);
+        PyTuple_SET_ITEM(*result_obj, j, range);
+        range = range_b = range_e = NULL;
+      }
     }
   }
 
-  sk_DIST_POINT_pop_free(ext, DIST_POINT_free);
-  return result;
+  result = Py_BuildValue("(OOO)",
+                         (asn_result  == NULL ? Py_None : asn_result),
+                         (ipv4_result == NULL ? Py_None : ipv4_result),
+                         (ipv6_result == NULL ? Py_None : ipv6_result));
 
- error:
-  sk_DIST_POINT_pop_free(ext, DIST_POINT_free);
-  Py_XDECREF(result);
-  return NULL;
+ error:                         /* Fall through */
+  ASIdentifiers_free(asid);
+  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
+  Py_XDECREF(range_b);
+  Py_XDECREF(range_e);
+  Py_XDECREF(range);
+  Py_XDECREF(asn_result);
+  Py_XDECREF(ipv4_result);
+  Py_XDECREF(ipv6_result);
+
+  return result;
 }
 
-static char x509_object_set_crldp__doc__[] =
-  "Set CRLDP values for this certificate.\n"
+static char x509_object_get_rfc3779_packed__doc__[] =
+  "Return this certificate's RFC 3779 resources as packed binary ranges.\n"
   "\n"
-  "Argument is a iterable which returns distributionPoint fullName URIs.\n"
+  "Return value is a three-element tuple, as with .getRFC3779(), except\n"
+  "that each set of ranges is a string of concatenated (min, max) pairs\n"
+  "of big-endian integers: four bytes each for ASNs and IPv4, sixteen\n"
+  "bytes each for IPv6.  This is the format ResourceSet.fromPacked()\n"
+  "takes, and avoids creating Python objects for every range.\n"
   ;
 
-static PyObject *
-x509_object_set_crldp(x509_object *self, PyObject *args)
+/*
+ * Write an ASN1_INTEGER as a four-byte big-endian unsigned integer.
+ */
+static int
+x509_object_pack_asn(ASN1_INTEGER *a, unsigned char *p)
 {
-  CRL_DIST_POINTS *ext = NULL;
-  PyObject *fullNames = NULL;
-  PyObject *iterator = NULL;
-  PyObject *item = NULL;
-  DIST_POINT *dp = NULL;
-  GENERAL_NAME *gn = NULL;
-  Py_ssize_t urilen;
-  char *uri;
+  BIGNUM *bn = NULL;
   int ok = 0;
 
-  ENTERING(x509_object_set_crldp);
+  if (ASN1_STRING_type(a) == V_ASN1_NEG_INTEGER)
+    lose_value_error("I don't believe in negative ASNs");
 
-  if (!PyArg_ParseTuple(args, "O", &fullNames))
-    goto error;
+  if ((bn = ASN1_INTEGER_to_BN(a, NULL)) == NULL)
+    lose_openssl_error("Couldn't convert ASN to BIGNUM");
 
-  if ((ext = sk_DIST_POINT_new_null()) == NULL ||
-      (dp = DIST_POINT_new()) == NULL ||
-      (dp->distpoint = DIST_POINT_NAME_new()) == NULL ||
-      (dp->distpoint->name.fullname = sk_GENERAL_NAME_new_null()) == NULL)
-    lose_no_memory();
+  if (BN_num_bytes(bn) > 4)
+    lose_value_error("ASN out of range");
 
-  dp->distpoint->type = 0;
+  memset(p, 0, 4);
+  BN_bn2bin(bn, p + 4 - BN_num_bytes(bn));
+  ok = 1;
 
-  if ((iterator = PyObject_GetIter(fullNames)) == NULL)
-    goto error;
+ error:
+  BN_free(bn);
+  return ok;
+}
 
-  while ((item = PyIter_Next(iterator)) != NULL) {
+static PyObject *
+x509_object_get_rfc3779_packed(x509_object *self)
+{
+  PyObject *result = NULL;
+  PyObject *asn_result = NULL;
+  PyObject *ipv4_result = NULL;
+  PyObject *ipv6_result = NULL;
+  ASIdentifiers *asid = NULL;
+  IPAddrBlocks *addr = NULL;
+  unsigned char *p;
+  int i, j, n;
 
-    if (PyString_AsStringAndSize(item, &uri, &urilen) < 0)
-      goto error;
+  ENTERING(x509_object_get_rfc3779_packed);
 
-    if ((gn = GENERAL_NAME_new()) == NULL ||
-        (gn->d.uniformResourceIdentifier = ASN1_IA5STRING_new()) == NULL ||
-        !ASN1_OCTET_STRING_set(gn->d.uniformResourceIdentifier, (unsigned char *) uri, urilen))
-      lose_no_memory();
+  if ((asid = X509_get_ext_d2i(self->x509, NID_sbgp_autonomousSysNum, NULL, NULL)) != NULL &&
+      asid->asnum != NULL) {
+    switch (asid->asnum->type) {
 
-    gn->type = GEN_URI;
+    case ASIdentifierChoice_inherit:
+      if ((asn_result = PyString_FromString("inherit")) == NULL)
+        goto error;
+      break;
 
-    if (!sk_GENERAL_NAME_push(dp->distpoint->name.fullname, gn))
-      lose_no_memory();
+    case ASIdentifierChoice_asIdsOrRanges:
 
-    gn = NULL;
-    Py_XDECREF(item);
-    item = NULL;
-  }
+      n = sk_ASIdOrRange_num(asid->asnum->u.asIdsOrRanges);
 
-  Py_XDECREF(iterator);
-  iterator = NULL;
+      if ((asn_result = PyString_FromStringAndSize(NULL, n * 8)) == NULL)
+        goto error;
 
-  if (!sk_DIST_POINT_push(ext, dp))
-    lose_no_memory();
+      p = (unsigned char *) PyString_AS_STRING(asn_result);
 
-  dp = NULL;
+      for (i = 0; i < n; i++, p += 8) {
+        ASIdOrRange *aor = sk_ASIdOrRange_value(asid->asnum->u.asIdsOrRanges, i);
+        ASN1_INTEGER *b = NULL;
+        ASN1_INTEGER *e = NULL;
 
-  if (!X509_add1_ext_i2d(self->x509, NID_crl_distribution_points, ext, 0, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add CRLDP extension to certificate");
+        switch (aor->type) {
 
-  ok = 1;
+        case ASIdOrRange_id:
+          b = e = aor->u.id;
+          break;
 
- error:
-  sk_DIST_POINT_pop_free(ext, DIST_POINT_free);
-  DIST_POINT_free(dp);
-  GENERAL_NAME_free(gn);
-  Py_XDECREF(item);
-  Py_XDECREF(iterator);
+        case ASIdOrRange_range:
+          b = aor->u.range->min;
+          e = aor->u.range->max;
+          break;
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
-}
+        default:
+          lose_value_error("Unexpected asIdsOrRanges type");
+        }
 
-static char x509_object_get_certificate_policies__doc__[] =
-  "Get Certificate Policies values for this certificate.\n"
-  "\n"
-  "If this certificate has no Certificate Policies extension, this method\n"
-  "returns None.\n"
-  "\n"
-  "Otherwise, this method returns a sequence of Object Identifiers.\n"
-  "\n"
-  "Policy qualifiers, if any, are ignored.\n"
-  ;
+        if (!x509_object_pack_asn(b, p) || !x509_object_pack_asn(e, p + 4))
+          goto error;
+      }
 
-static PyObject *
-x509_object_get_certificate_policies(x509_object *self)
-{
-  CERTIFICATEPOLICIES *ext = NULL;
-  PyObject *result = NULL;
-  PyObject *obj;
-  int i;
+      break;
 
-  ENTERING(x509_object_get_certificate_policies);
+    default:
+      lose_value_error("Unexpected ASIdentifierChoice type");
+    }
+  }
 
-  if ((ext = X509_get_ext_d2i(self->x509, NID_certificate_policies, NULL, NULL)) == NULL)
-    Py_RETURN_NONE;
+  if ((addr = X509_get_ext_d2i(self->x509, NID_sbgp_ipAddrBlock, NULL, NULL)) != NULL) {
+    for (i = 0; i < sk_IPAddressFamily_num(addr); i++) {
+      IPAddressFamily *f = sk_IPAddressFamily_value(addr, i);
+      const unsigned int afi = v3_addr_get_afi(f);
+      PyObject **result_obj = NULL;
+      int width = 0;
 
-  if (((result = PyTuple_New(sk_POLICYINFO_num(ext))) == NULL))
-    goto error;
+      switch (afi) {
+      case IANA_AFI_IPV4: result_obj = &ipv4_result; width = 4;  break;
+      case IANA_AFI_IPV6: result_obj = &ipv6_result; width = 16; break;
+      default:            lose_value_error("Unknown AFI");
+      }
 
-  for (i = 0; i < sk_POLICYINFO_num(ext); i++) {
-    POLICYINFO *p = sk_POLICYINFO_value(ext, i);
+      if (*result_obj != NULL)
+        lose_value_error("Duplicate IPAddressFamily");
 
-    if ((obj = ASN1_OBJECT_to_PyString(p->policyid)) == NULL)
-      goto error;
+      if (f->addressFamily->length > 2)
+        lose_value_error("Unsupported SAFI");
 
-    PyTuple_SET_ITEM(result, i, obj);
-  }
+      switch (f->ipAddressChoice->type) {
 
-  sk_POLICYINFO_pop_free(ext, POLICYINFO_free);
-  return result;
+      case IPAddressChoice_inherit:
+        if ((*result_obj = PyString_FromString("inherit")) == NULL)
+          goto error;
+        continue;
 
- error:
-  sk_POLICYINFO_pop_free(ext, POLICYINFO_free);
-  Py_XDECREF(result);
-  return NULL;
+      case IPAddressChoice_addressesOrRanges:
+        break;
+
+      default:
+        lose_value_error("Unexpected IPAddressChoice type");
+      }
+
+      n = sk_IPAddressOrRange_num(f->ipAddressChoice->u.addressesOrRanges);
+
+      if ((*result_obj = PyString_FromStringAndSize(NULL, n * 2 * width)) == NULL)
+        goto error;
+
+      p = (unsigned char *) PyString_AS_STRING(*result_obj);
+
+      for (j = 0; j < n; j++, p += 2 * width) {
+        IPAddressOrRange *aor = sk_IPAddressOrRange_value(f->ipAddressChoice->u.addressesOrRanges, j);
+        if (v3_addr_get_range(aor, afi, p, p + width, width) == 0)
+          lose_value_error("Couldn't unpack IP addresses from BIT STRINGs");
+      }
+    }
+  }
+
+  result = Py_BuildValue("(OOO)",
+                         (asn_result  == NULL ? Py_None : asn_result),
+                         (ipv4_result == NULL ? Py_None : ipv4_result),
+                         (ipv6_result == NULL ? Py_None : ipv6_result));
+
+ error:                         /* Fall through */
+  ASIdentifiers_free(asid);
+  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
+  Py_XDECREF(asn_result);
+  Py_XDECREF(ipv4_result);
+  Py_XDECREF(ipv6_result);
+
+  return result;
 }
 
-static char x509_object_set_certificate_policies__doc__[] =
-  "Set Certificate Policies for this certificate.\n"
+static char x509_object_set_rfc3779__doc__[] =
+  "Set this certificate's RFC 3779 resources.\n"
   "\n"
-  "Argument is a iterable which returns policy OIDs.\n"
-  "\n"  
-  "Policy qualifier are not supported.\n"
+  "This method takes three arguments: \"asn\", \"ipv4\", and \"ipv6\".\n"
   "\n"
-  "The extension will be marked as critical, since there's not much point\n"
-  "in using this extension without making it critical.\n"
+  "Each of these arguments can be:\n"
+  "\n"
+  "* None, to omit this kind of resource;\n"
+  "\n"
+  "* The string \"inherit\", to specify RFC 3779 resource inheritance; or\n"
+  "\n"
+  "* An iterable object which returns range pairs of the appropriate type.\n"
+  "\n"
+  "Range pairs are as returned by the .getRFC3779() method.\n"
   ;
 
 static PyObject *
-x509_object_set_certificate_policies(x509_object *self, PyObject *args)
+x509_object_set_rfc3779(x509_object *self, PyObject *args, PyObject *kwds)
 {
-  CERTIFICATEPOLICIES *ext = NULL;
-  PyObject *policies = NULL;
+  static char *kwlist[] = {"asn", "ipv4", "ipv6", NULL};
+  PyObject *asn_arg  = Py_None;
+  PyObject *ipv4_arg = Py_None;
+  PyObject *ipv6_arg = Py_None;
   PyObject *iterator = NULL;
-  POLICYINFO *pol = NULL;
   PyObject *item = NULL;
-  const char *oid;
-  int ok = 0;
+  PyObject *fast = NULL;
+  ASIdentifiers *asid = NULL;
+  IPAddrBlocks *addr = NULL;
+  ASN1_INTEGER *asid_b = NULL;
+  ASN1_INTEGER *asid_e = NULL;
+  ipaddress_object *addr_b = NULL;
+  ipaddress_object *addr_e = NULL;
+  int empty = 0;
 
-  ENTERING(x509_object_set_certificate_policies);
+  ENTERING(x509_object_set_rfc3779);
 
-  if (!PyArg_ParseTuple(args, "O", &policies))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOO", kwlist, &asn_arg, &ipv4_arg, &ipv6_arg))
     goto error;
 
-  if ((ext = sk_POLICYINFO_new_null()) == NULL)
-    lose_no_memory();
+  if (asn_arg != Py_None) {
 
-  if ((iterator = PyObject_GetIter(policies)) == NULL)
-    goto error;
+    empty = 1;
 
-  while ((item = PyIter_Next(iterator)) != NULL) {
+    if ((asid = ASIdentifiers_new()) == NULL)
+      lose_no_memory();
 
-    if ((oid = PyString_AsString(item)) == NULL)
-      goto error;
+    if (PyString_Check(asn_arg)) {
 
-    if ((pol = POLICYINFO_new()) == NULL)
-      lose_no_memory();
+      if (strcmp(PyString_AsString(asn_arg), "inherit"))
+        lose_type_error("ASID must be an iterable that returns range pairs, or the string \"inherit\"");
 
-    if ((pol->policyid = OBJ_txt2obj(oid, 1)) == NULL)
-      lose("Couldn't parse OID");
+      if (!v3_asid_add_inherit(asid, V3_ASID_ASNUM))
+        lose_no_memory();
 
-    if (!sk_POLICYINFO_push(ext, pol))
-      lose_no_memory();
+      empty = 0;
 
-    pol = NULL;
-    Py_XDECREF(item);
-    item = NULL;
-  }
+    } else {
 
-  Py_XDECREF(iterator);
-  iterator = NULL;
+      if ((iterator = PyObject_GetIter(asn_arg)) == NULL)
+        goto error;
 
-  if (!X509_add1_ext_i2d(self->x509, NID_certificate_policies, ext, 1, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add CERTIFICATE_POLICIES extension to certificate");
+      while ((item = PyIter_Next(iterator)) != NULL) {
 
-  ok = 1;
+        if ((fast = PySequence_Fast(item, "ASN range must be a sequence")) == NULL)
+          goto error;
 
- error:
-  POLICYINFO_free(pol);
-  sk_POLICYINFO_pop_free(ext, POLICYINFO_free);
-  Py_XDECREF(item);
-  Py_XDECREF(iterator);
+        if (PySequence_Fast_GET_SIZE(fast) != 2)
+          lose_type_error("ASN range must be two-element sequence");
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
-}
+        if ((asid_b = PyLong_to_ASN1_INTEGER(PySequence_Fast_GET_ITEM(fast, 0))) == NULL)
+          goto error;
 
-static char x509_object_pprint__doc__[] =
-  "Return a pretty-printed rendition of this certificate.\n"
-  ;
+        switch (PyObject_RichCompareBool(PySequence_Fast_GET_ITEM(fast, 0),
+                                         PySequence_Fast_GET_ITEM(fast, 1), Py_EQ)) {
+        case 0:
+          if ((asid_e = PyLong_to_ASN1_INTEGER(PySequence_Fast_GET_ITEM(fast, 1))) == NULL)
+            goto error;
+          break;
+        case 1:
+          break;
+        default:
+          goto error;
+        }
 
-static PyObject *
-x509_object_pprint(x509_object *self)
-{
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+        if (!v3_asid_add_id_or_range(asid, V3_ASID_ASNUM, asid_b, asid_e))
+          lose_openssl_error("Couldn't add range to ASID");
 
-  ENTERING(x509_object_pprint);
+        asid_b = asid_e = NULL;
+        Py_XDECREF(item);
+        Py_XDECREF(fast);
+        item = fast = NULL;
+        empty = 0;
+      }
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+      Py_XDECREF(iterator);
+      iterator = NULL;
+    }
 
-  if (!X509_print(bio, self->x509))
-    lose_openssl_error("Unable to pretty-print certificate");
+    if (!empty && (!v3_asid_canonize(asid) ||
+                   !X509_add1_ext_i2d(self->x509, NID_sbgp_autonomousSysNum,
+                                      asid, 1, X509V3_ADD_REPLACE)))
+      lose_openssl_error("Couldn't add ASID extension to certificate");
+  }
 
-  result = BIO_to_PyString_helper(bio);
+  if (ipv4_arg != Py_None || ipv6_arg != Py_None) {
+    int v;
+ 
+    empty = 1;
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
-}
+    if ((addr = sk_IPAddressFamily_new_null()) == NULL)
+      lose_no_memory();
 
-static struct PyMethodDef x509_object_methods[] = {
-  Define_Method(pemWrite,               x509_object_pem_write,                  METH_NOARGS),
-  Define_Method(derWrite,               x509_object_der_write,                  METH_NOARGS),
-  Define_Method(sign,                   x509_object_sign,                       METH_VARARGS),
-  Define_Method(verify,                 x509_object_verify,                     METH_KEYWORDS),
-  Define_Method(checkRPKIConformance,   x509_object_check_rpki_conformance,     METH_KEYWORDS),
-  Define_Method(getPublicKey,           x509_object_get_public_key,             METH_NOARGS),
-  Define_Method(setPublicKey,           x509_object_set_public_key,             METH_VARARGS),
-  Define_Method(getVersion,             x509_object_get_version,                METH_NOARGS),
-  Define_Method(setVersion,             x509_object_set_version,                METH_VARARGS),
-  Define_Method(getSerial,              x509_object_get_serial,                 METH_NOARGS),
-  Define_Method(setSerial,              x509_object_set_serial,                 METH_VARARGS),
-  Define_Method(getIssuer,              x509_object_get_issuer,                 METH_VARARGS),
-  Define_Method(setIssuer,              x509_object_set_issuer,                 METH_VARARGS),
-  Define_Method(getSubject,             x509_object_get_subject,                METH_VARARGS),
-  Define_Method(setSubject,             x509_object_set_subject,                METH_VARARGS),
-  Define_Method(getNotBefore,           x509_object_get_not_before,             METH_NOARGS),
-  Define_Method(getNotAfter,            x509_object_get_not_after,              METH_NOARGS),
-  Define_Method(setNotAfter,            x509_object_set_not_after,              METH_VARARGS),
-  Define_Method(setNotBefore,           x509_object_set_not_before,             METH_VARARGS),
-  Define_Method(clearExtensions,        x509_object_clear_extensions,           METH_NOARGS),
-  Define_Method(pprint,                 x509_object_pprint,                     METH_NOARGS),
-  Define_Method(getSKI,                 x509_object_get_ski,                    METH_NOARGS),
-  Define_Method(setSKI,                 x509_object_set_ski,                    METH_VARARGS),
-  Define_Method(getAKI,                 x509_object_get_aki,                    METH_NOARGS),
-  Define_Method(setAKI,                 x509_object_set_aki,                    METH_VARARGS),
-  Define_Method(getKeyUsage,            x509_object_get_key_usage,              METH_NOARGS),
-  Define_Method(setKeyUsage,            x509_object_set_key_usage,              METH_VARARGS),
-  Define_Method(getEKU,                 x509_object_get_eku,                    METH_NOARGS),
-  Define_Method(setEKU,                 x509_object_set_eku,                    METH_VARARGS),
-  Define_Method(getRFC3779,             x509_object_get_rfc3779,                METH_NOARGS),
-  Define_Method(setRFC3779,             x509_object_set_rfc3779,                METH_KEYWORDS),
-  Define_Method(getBasicConstraints,    x509_object_get_basic_constraints,      METH_NOARGS),
-  Define_Method(setBasicConstraints,    x509_object_set_basic_constraints,      METH_VARARGS),
-  Define_Method(getSIA,                 x509_object_get_sia,                    METH_NOARGS),
-  Define_Method(setSIA,                 x509_object_set_sia,                    METH_KEYWORDS),
-  Define_Method(getAIA,                 x509_object_get_aia,                    METH_NOARGS),
-  Define_Method(setAIA,                 x509_object_set_aia,                    METH_VARARGS),
-  Define_Method(getCRLDP,               x509_object_get_crldp,                  METH_NOARGS),
-  Define_Method(setCRLDP,               x509_object_set_crldp,                  METH_VARARGS),
-  Define_Method(getCertificatePolicies, x509_object_get_certificate_policies,   METH_NOARGS),
-  Define_Method(setCertificatePolicies, x509_object_set_certificate_policies,   METH_VARARGS),
-  Define_Method(getIssuerHash,          x509_object_get_issuer_hash,            METH_NOARGS),
-  Define_Method(getSubjectHash,         x509_object_get_subject_hash,           METH_NOARGS),
-  Define_Class_Method(pemRead,          x509_object_pem_read,                   METH_VARARGS),
-  Define_Class_Method(pemReadFile,      x509_object_pem_read_file,              METH_VARARGS),
-  Define_Class_Method(derRead,          x509_object_der_read,                   METH_VARARGS),
-  Define_Class_Method(derReadFile,      x509_object_der_read_file,              METH_VARARGS),
-  {NULL}
-};
+    /*
+     * Cheap trick to let us inline all of this instead of being
+     * forced to use a separate function.  Refactor, some day.
+     */
 
-static char POW_X509_Type__doc__[] =
-  "This class represents an X.509v3 certificate.\n"
-  ;
+    for (v = 0; v < (int) (sizeof(ipaddress_versions)/sizeof(*ipaddress_versions)); v++) {
+      const struct ipaddress_version *ip_type = ipaddress_versions[v];
+      PyObject **argp;
 
-static PyTypeObject POW_X509_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                        /* ob_size */
-  "rpki.POW.X509",                          /* tp_name */
-  sizeof(x509_object),                      /* tp_basicsize */
-  0,                                        /* tp_itemsize */
-  (destructor)x509_object_dealloc,          /* tp_dealloc */
-  0,                                        /* tp_print */
-  0,                                        /* tp_getattr */
-  0,                                        /* tp_setattr */
-  0,                                        /* tp_compare */
-  0,                                        /* tp_repr */
-  0,                                        /* tp_as_number */
-  0,                                        /* tp_as_sequence */
-  0,                                        /* tp_as_mapping */
-  0,                                        /* tp_hash */
-  0,                                        /* tp_call */
-  0,                                        /* tp_str */
-  0,                                        /* tp_getattro */
-  0,                                        /* tp_setattro */
-  0,                                        /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_X509_Type__doc__,                     /* tp_doc */
-  0,                                        /* tp_traverse */
-  0,                                        /* tp_clear */
-  0,                                        /* tp_richcompare */
-  0,                                        /* tp_weaklistoffset */
-  0,                                        /* tp_iter */
-  0,                                        /* tp_iternext */
-  x509_object_methods,                      /* tp_methods */
-  0,                                        /* tp_members */
-  0,                                        /* tp_getset */
-  0,                                        /* tp_base */
-  0,                                        /* tp_dict */
-  0,                                        /* tp_descr_get */
-  0,                                        /* tp_descr_set */
-  0,                                        /* tp_dictoffset */
-  0,                                        /* tp_init */
-  0,                                        /* tp_alloc */
-  x509_object_new,                          /* tp_new */
-};
-
-
+      switch (ip_type->version) {
+      case 4: argp = &ipv4_arg; break;
+      case 6: argp = &ipv6_arg; break;
+      default: continue;        /* Never happens */
+      }
 
-/*
- * X509StoreCTX object.
- */
+      if (PyString_Check(*argp)) {
 
-static int 
-x509_store_ctx_object_verify_cb(int ok, X509_STORE_CTX *ctx)
-{
-  static char method_name[] = "verify_callback";
-  x509_store_ctx_object *self = (x509_store_ctx_object *) X509_STORE_CTX_get_ex_data(ctx, x509_store_ctx_ex_data_idx);
-  PyObject *result = NULL;
+        if (strcmp(PyString_AsString(*argp), "inherit"))
+          lose_type_error("Argument must be an iterable that returns range pairs, or the string \"inherit\"");
 
-  if (self == NULL)
-    return ok;
+        if (!v3_addr_add_inherit(addr, ip_type->afi, NULL))
+          lose_no_memory();
 
-  if (!PyObject_HasAttrString((PyObject *) self, method_name))
-    return ok;
+        empty = 0;
 
-  if ((result = PyObject_CallMethod((PyObject *) self, method_name, "i", ok)) == NULL)
-    return -1;
+      } else {
 
-  ok = PyObject_IsTrue(result);
-  Py_XDECREF(result);
-  return ok;
-}
+        if ((iterator = PyObject_GetIter(*argp)) == NULL)
+          goto error;
 
-static PyObject *
-x509_store_ctx_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
-{
-  x509_store_ctx_object *self = NULL;
+        while ((item = PyIter_Next(iterator)) != NULL) {
 
-  ENTERING(x509_store_ctx_object_new);
+          if ((fast = PySequence_Fast(item, "Address range must be a sequence")) == NULL)
+            goto error;
 
-  if ((self = (x509_store_ctx_object *) type->tp_alloc(type, 0)) == NULL)
-    goto error;
+          if (PySequence_Fast_GET_SIZE(fast) != 2 ||
+              !POW_IPAddress_Check(PySequence_Fast_GET_ITEM(fast, 0)) ||
+              !POW_IPAddress_Check(PySequence_Fast_GET_ITEM(fast, 1)))
+            lose_type_error("Address range must be two-element sequence of IPAddress objects");
 
-  self->ctx = NULL;
-  self->store = NULL;
-  return (PyObject *) self;    
+          addr_b = (ipaddress_object *) PySequence_Fast_GET_ITEM(fast, 0);
+          addr_e = (ipaddress_object *) PySequence_Fast_GET_ITEM(fast, 1);
 
- error:
-  Py_XDECREF(self);
-  return NULL;
-}
+          if (addr_b->type != ip_type ||
+              addr_e->type != ip_type ||
+              memcmp(addr_b->address, addr_e->address, ip_type->length) > 0)
+            lose("Address range must be two-element sequence of IPAddress objects in ascending order");
 
-static int
-x509_store_ctx_object_init(x509_store_ctx_object *self, PyObject *args, GCC_UNUSED PyObject *kwds)
-{
-  ENTERING(x509_store_ctx_object_init);
+          if (!v3_addr_add_range(addr, ip_type->afi, NULL, addr_b->address, addr_e->address))
+            lose_openssl_error("Couldn't add range to IPAddrBlock");
 
-  if ((self->store = X509_STORE_new()) == NULL ||
-      (self->ctx = X509_STORE_CTX_new()) == NULL)
-    lose_no_memory();
+          Py_XDECREF(item);
+          Py_XDECREF(fast);
+          item = fast = NULL;
+          addr_b = addr_e = NULL;
+          empty = 0;
+        }
 
-  if (!X509_STORE_CTX_init(self->ctx, self->store, NULL, NULL))
-    lose_openssl_error("Couldn't initialize X509_STORE_CTX");
+        Py_XDECREF(iterator);
+        iterator = NULL;
+      }
+    }
 
-  if (!X509_STORE_CTX_set_ex_data(self->ctx, x509_store_ctx_ex_data_idx, self))
-    lose_openssl_error("Couldn't set X509_STORE_CTX ex_data");
+    if (!empty && (!v3_addr_canonize(addr) ||
+                   !X509_add1_ext_i2d(self->x509, NID_sbgp_ipAddrBlock,
+                                      addr, 1, X509V3_ADD_REPLACE)))
+      lose_openssl_error("Couldn't add IPAddrBlock extension to certificate");
+  }
 
-  X509_VERIFY_PARAM_set_flags(self->ctx->param, X509_V_FLAG_X509_STRICT);
-  return 0;
+  Py_RETURN_NONE;
 
  error:
-  return -1;
+  ASN1_INTEGER_free(asid_b);
+  ASN1_INTEGER_free(asid_e);
+  ASIdentifiers_free(asid);
+  sk_IPAddressFamily_pop_free(addr, IPAddressFamily_free);
+  Py_XDECREF(iterator);
+  Py_XDECREF(item);
+  Py_XDECREF(fast);
+  return NULL;
 }
 
-static void
-x509_store_ctx_object_dealloc(x509_store_ctx_object *self)
+static char x509_object_get_basic_constraints__doc__[] =
+  "Return BasicConstraints for this certificate.\n"
+  "\n"
+  EXTENSION_GET_BASIC_CONSTRAINTS__DOC__
+  ;
+
+static PyObject *
+x509_object_get_basic_constraints(x509_object *self)
 {
-  ENTERING(x509_store_ctx_object_dealloc);
-  X509_STORE_CTX_free(self->ctx);
-  X509_STORE_free(self->store);
-  self->ob_type->tp_free((PyObject*) self);
+  return extension_get_basic_constraints(x509_object_extension_get_helper(self, NID_basic_constraints));
 }
 
-static char x509_store_ctx_object_get_error__doc__[] =
-  "Extract verification error code from this X509StoreCTX.\n"
+static char x509_object_set_basic_constraints__doc__[] =
+  "Set BasicConstraints for this certificate.\n"
+  "\n"
+  EXTENSION_SET_BASIC_CONSTRAINTS__DOC__
   ;
 
-static PyObject*
-x509_store_ctx_object_get_error (x509_store_ctx_object *self)
+static PyObject *
+x509_object_set_basic_constraints(x509_object *self, PyObject *args)
 {
-  return Py_BuildValue("i", X509_STORE_CTX_get_error(self->ctx));
+  return x509_object_extension_set_helper(self, extension_set_basic_constraints(args));
 }
 
-static char x509_store_ctx_object_get_error_string__doc__[] =
-  "Extract verification error string from this X509StoreCTX.\n"
+static char x509_object_get_sia__doc__[] =
+  "Get SIA values for this certificate.\n"
+  "\n"
+  EXTENSION_GET_SIA__DOC__
   ;
 
-static PyObject*
-x509_store_ctx_object_get_error_string (x509_store_ctx_object *self)
+static PyObject *
+x509_object_get_sia(x509_object *self)
 {
-  return Py_BuildValue("s", X509_verify_cert_error_string(X509_STORE_CTX_get_error(self->ctx)));
+  return extension_get_sia(x509_object_extension_get_helper(self, NID_sinfo_access));
 }
 
-static char x509_store_ctx_object_get_error_depth__doc__[] =
-  "Extract verification error depth from this X509StoreCTX.\n"
+static char x509_object_set_sia__doc__[] =
+  "Set SIA values for this certificate.\n"
+  "\n"
+  EXTENSION_SET_SIA__DOC__
   ;
 
-static PyObject*
-x509_store_ctx_object_get_error_depth (x509_store_ctx_object *self)
+static PyObject *
+x509_object_set_sia(x509_object *self, PyObject *args, PyObject *kwds)
 {
-  return Py_BuildValue("i", X509_STORE_CTX_get_error_depth(self->ctx));
+  return x509_object_extension_set_helper(self, extension_set_sia(args, kwds));
 }
 
-static char x509_store_ctx_object_get_current_certificate__doc__[] =
-  "Extract the certificate which caused the current validation error,\n"
-  "or None if no certificate is relevant.\n"
+static char x509_object_get_aia__doc__[] =
+  "Get this certificate's AIA values.\n"
+  "\n"
+  "If the certificate has no AIA extension, this method returns None.\n"
+  "\n"  
+  "Otherwise, this returns a sequence of caIssuers URIs.\n"
+  "\n"
+  "Any other accessMethods are ignored, as are any non-URI accessLocations.\n"
   ;
 
 static PyObject *
-x509_store_ctx_object_get_current_certificate (x509_store_ctx_object *self)
+x509_object_get_aia(x509_object *self)
 {
-  X509 *x = X509_STORE_CTX_get_current_cert(self->ctx);
-  x509_object *obj = NULL;
+  AUTHORITY_INFO_ACCESS *ext = NULL;
+  PyObject *result = NULL;
+  const char *uri;
+  PyObject *obj;
+  int i, n = 0;
 
-  if (x == NULL)
+  ENTERING(x509_object_get_aia);
+
+  if ((ext = X509_get_ext_d2i(self->x509, NID_info_access, NULL, NULL)) == NULL)
     Py_RETURN_NONE;
 
-  if ((x = X509_dup(x)) == NULL)
-    lose_no_memory();
+  for (i = 0; i < sk_ACCESS_DESCRIPTION_num(ext); i++) {
+    ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(ext, i);
+    if (a->location->type == GEN_URI &&
+        OBJ_obj2nid(a->method) == NID_ad_ca_issuers)
+      n++;
+  }
 
-  if ((obj = x509_object_new_helper(NULL, x)) == NULL)
+  if (((result = PyTuple_New(n)) == NULL))
     goto error;
 
-  return (PyObject *) obj;
+  n = 0;
+
+  for (i = 0; i < sk_ACCESS_DESCRIPTION_num(ext); i++) {
+    ACCESS_DESCRIPTION *a = sk_ACCESS_DESCRIPTION_value(ext, i);
+    if (a->location->type == GEN_URI && OBJ_obj2nid(a->method) == NID_ad_ca_issuers) {
+      uri = (char *) ASN1_STRING_data(a->location->d.uniformResourceIdentifier);
+      if ((obj = PyString_FromString(uri)) == NULL)
+        goto error;
+      PyTuple_SET_ITEM(result, n++, obj);
+    }
+  }
+
+  AUTHORITY_INFO_ACCESS_free(ext);
+  return result;
 
  error:
-  Py_XDECREF(obj);
-  X509_free(x);
+  AUTHORITY_INFO_ACCESS_free(ext);
+  Py_XDECREF(result);
   return NULL;
 }
 
-static char x509_store_ctx_object_get_chain__doc__[] =
-  "Extract certificate chain from X509StoreCTX.  If validation\n"
-  "completed succesfully, this is the complete validation chain;\n"
-  "otherwise, the returned chain may be invalid or incomplete.\n"
+static char x509_object_set_aia__doc__[] =
+  "Set AIA URIs for this certificate.\n"
+  "\n"
+  "Argument is a iterable which returns caIssuers URIs.\n"
   ;
 
 static PyObject *
-x509_store_ctx_object_get_chain (x509_store_ctx_object *self)
+x509_object_set_aia(x509_object *self, PyObject *args)
 {
-  STACK_OF(X509) *chain = NULL;
-  PyObject *result = NULL;
+  AUTHORITY_INFO_ACCESS *ext = NULL;
+  PyObject *caIssuers = NULL;
+  PyObject *iterator = NULL;
+  ASN1_OBJECT *oid = NULL;
+  PyObject *item = NULL;
+  ACCESS_DESCRIPTION *a = NULL;
+  int ok = 0;
+  Py_ssize_t urilen;
+  char *uri;
 
-  if ((chain = X509_STORE_CTX_get1_chain(self->ctx)) == NULL)
-    lose_openssl_error("X509_STORE_CTX_get1_chain() failed");
-  
-  result = stack_to_tuple_helper(CHECKED_PTR_OF(STACK_OF(X509), chain),
-                                 stack_to_tuple_helper_get_x509);
+  ENTERING(x509_object_set_aia);
 
- error:                         /* fall through */
-  sk_X509_pop_free(chain, X509_free);
-  return result;
-}
-
-/*
- * See (omnibus) man page for X509_STORE_CTX_get_error() for other
- * query methods we might want to expose.  Someday we might want to
- * support X509_V_FLAG_USE_CHECK_TIME too.
- */
-
-static struct PyMethodDef x509_store_ctx_object_methods[] = {
-  Define_Method(getError,               x509_store_ctx_object_get_error,                METH_NOARGS),
-  Define_Method(getErrorString,         x509_store_ctx_object_get_error_string,         METH_NOARGS),
-  Define_Method(getErrorDepth,          x509_store_ctx_object_get_error_depth,          METH_NOARGS),
-  Define_Method(getCurrentCertificate,  x509_store_ctx_object_get_current_certificate,  METH_NOARGS),
-  Define_Method(getChain,               x509_store_ctx_object_get_chain,                METH_NOARGS),
- {NULL}
-};
-
-static char POW_X509StoreCTX_Type__doc__[] =
-  "This class holds the state of an OpenSSL certificate verification\n"
-  "operation.  Ordinarily, the user will never have cause to instantiate\n"
-  "this class directly, instead, an object of this class will be returned\n"
-  "by X509.verify().\n"
-  "\n"
-  "If you need to see OpenSSL's verification callbacks, you can do so\n"
-  "by subclassing X509StoreCTX and passing your subclass as an argument\n"
-  "to X509.verify.  Your subclass should provide a .verify_callback()\n"
-  "method, which should expect to receive one argument: the integer \"ok\"\n"
-  "value passed by OpenSSL's verification callbacks.\n"
-  "\n"
-  "The return value from your .verify_callback() method will be is interpreted\n"
-  "as a boolean value: anything which evaluates to True will be result in a\n"
-  "return value of 1 to OpenSSL, while anything which evaluates to False will\n"
-  "result in a return value of 0 to OpenSSL.\n"
-  ;
+  if (!PyArg_ParseTuple(args, "O", &caIssuers))
+    goto error;
 
-static PyTypeObject POW_X509StoreCTX_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                        /* ob_size */
-  "rpki.POW.X509StoreCTX",                  /* tp_name */
-  sizeof(x509_store_ctx_object),            /* tp_basicsize */
-  0,                                        /* tp_itemsize */
-  (destructor)x509_store_ctx_object_dealloc,/* tp_dealloc */
-  0,                                        /* tp_print */
-  0,                                        /* tp_getattr */
-  0,                                        /* tp_setattr */
-  0,                                        /* tp_compare */
-  0,                                        /* tp_repr */
-  0,                                        /* tp_as_number */
-  0,                                        /* tp_as_sequence */
-  0,                                        /* tp_as_mapping */
-  0,                                        /* tp_hash */
-  0,                                        /* tp_call */
-  0,                                        /* tp_str */
-  0,                                        /* tp_getattro */
-  0,                                        /* tp_setattro */
-  0,                                        /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_X509StoreCTX_Type__doc__,             /* tp_doc */
-  0,                                        /* tp_traverse */
-  0,                                        /* tp_clear */
-  0,                                        /* tp_richcompare */
-  0,                                        /* tp_weaklistoffset */
-  0,                                        /* tp_iter */
-  0,                                        /* tp_iternext */
-  x509_store_ctx_object_methods,            /* tp_methods */
-  0,                                        /* tp_members */
-  0,                                        /* tp_getset */
-  0,                                        /* tp_base */
-  0,                                        /* tp_dict */
-  0,                                        /* tp_descr_get */
-  0,                                        /* tp_descr_set */
-  0,                                        /* tp_dictoffset */
-  (initproc) x509_store_ctx_object_init,    /* tp_init */
-  0,                                        /* tp_alloc */
-  x509_store_ctx_object_new,                /* tp_new */
-};
+  if ((ext = AUTHORITY_INFO_ACCESS_new()) == NULL)
+    lose_no_memory();
 
-
+  if ((oid = OBJ_nid2obj(NID_ad_ca_issuers)) == NULL)
+    lose_openssl_error("Couldn't find AIA accessMethod OID");
 
-/*
- * CRL object.
- */
+  if ((iterator = PyObject_GetIter(caIssuers)) == NULL)
+    goto error;
 
-static crl_object *
-crl_object_new_helper(PyTypeObject *type, X509_CRL *crl)
-{
-  crl_object *self = NULL;
+  while ((item = PyIter_Next(iterator)) != NULL) {
 
-  if (type == NULL)
-    type = &POW_CRL_Type;
+    if (PyString_AsStringAndSize(item, &uri, &urilen) < 0)
+      goto error;
 
-  if ((self = (crl_object *) type->tp_alloc(type, 0)) == NULL)
-    return NULL;
+    if ((a = ACCESS_DESCRIPTION_new()) == NULL ||
+        (a->method = OBJ_dup(oid)) == NULL ||
+        (a->location->d.uniformResourceIdentifier = ASN1_IA5STRING_new()) == NULL ||
+        !ASN1_OCTET_STRING_set(a->location->d.uniformResourceIdentifier, (unsigned char *) uri, urilen))
+      lose_no_memory();
 
-  self->crl = crl;
-  return self;
-}
+    a->location->type = GEN_URI;
 
-static PyObject *
-crl_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
-{
-  crl_object *self = NULL;
-  X509_CRL *crl = NULL;
+    if (!sk_ACCESS_DESCRIPTION_push(ext, a))
+      lose_no_memory();
 
-  ENTERING(crl_object_new);
+    a = NULL;
+    Py_XDECREF(item);
+    item = NULL;
+  }
 
-  if ((crl = X509_CRL_new()) == NULL)
-    lose_no_memory();
+  Py_XDECREF(iterator);
+  iterator = NULL;
 
-  if ((self = crl_object_new_helper(type, crl)) == NULL)
-    goto error;
+  if (!X509_add1_ext_i2d(self->x509, NID_info_access, ext, 0, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add AIA extension to certificate");
 
-  return (PyObject *) self;
+  ok = 1;
 
  error:
-  X509_CRL_free(crl);
-  return NULL;
-}
+  AUTHORITY_INFO_ACCESS_free(ext);
+  ACCESS_DESCRIPTION_free(a);
+  Py_XDECREF(item);
+  Py_XDECREF(iterator);
 
-static void
-crl_object_dealloc(crl_object *self)
-{
-  ENTERING(crl_object_dealloc);
-  X509_CRL_free(self->crl);
-  self->ob_type->tp_free((PyObject*) self);
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
 }
 
+static char x509_object_get_crldp__doc__[] =
+  "Get CRL Distribution Point (CRLDP) values for this certificate.\n"
+  "\n"
+  "If the certificate has no CRLDP extension, this method returns None.\n"
+  "\n"
+  "Otherwise, it returns a sequence of URIs representing distributionPoint\n"
+  "fullName values found in the first Distribution Point.  Other CRLDP\n"
+  "fields are ignored, as are subsequent Distribution Points and any non-URI\n"
+  "fullName values.\n"
+  ;
+
 static PyObject *
-crl_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+x509_object_get_crldp(x509_object *self)
 {
-  crl_object *self;
+  CRL_DIST_POINTS *ext = NULL;
+  DIST_POINT *dp = NULL;
+  PyObject *result = NULL;
+  const char *uri;
+  PyObject *obj;
+  int i, n = 0;
 
-  ENTERING(crl_object_pem_read_helper);
+  ENTERING(x509_object_get_crldp);
 
-  if ((self = (crl_object *) crl_object_new(type, NULL, NULL)) == NULL)
+  if ((ext = X509_get_ext_d2i(self->x509, NID_crl_distribution_points, NULL, NULL)) == NULL ||
+      (dp = sk_DIST_POINT_value(ext, 0)) == NULL ||
+      dp->distpoint == NULL ||
+      dp->distpoint->type != 0)
+    Py_RETURN_NONE;
+
+  for (i = 0; i < sk_GENERAL_NAME_num(dp->distpoint->name.fullname); i++) {
+    GENERAL_NAME *gn = sk_GENERAL_NAME_value(dp->distpoint->name.fullname, i);
+    if (gn->type == GEN_URI)
+      n++;
+  }
+
+  if (((result = PyTuple_New(n)) == NULL))
     goto error;
 
-  if (!PEM_read_bio_X509_CRL(bio, &self->crl, NULL, NULL))
-    lose_openssl_error("Couldn't PEM encoded load CRL");
+  n = 0;
 
-  return (PyObject *) self;
+  for (i = 0; i < sk_GENERAL_NAME_num(dp->distpoint->name.fullname); i++) {
+    GENERAL_NAME *gn = sk_GENERAL_NAME_value(dp->distpoint->name.fullname, i);
+    if (gn->type == GEN_URI) {
+      uri = (char *) ASN1_STRING_data(gn->d.uniformResourceIdentifier);
+      if ((obj = PyString_FromString(uri)) == NULL)
+        goto error;
+      PyTuple_SET_ITEM(result, n++, obj);
+    }
+  }
+
+  sk_DIST_POINT_pop_free(ext, DIST_POINT_free);
+  return result;
 
  error:
-  Py_XDECREF(self);
+  sk_DIST_POINT_pop_free(ext, DIST_POINT_free);
+  Py_XDECREF(result);
   return NULL;
 }
 
+static char x509_object_set_crldp__doc__[] =
+  "Set CRLDP values for this certificate.\n"
+  "\n"
+  "Argument is a iterable which returns distributionPoint fullName URIs.\n"
+  ;
+
 static PyObject *
-crl_object_der_read_helper(PyTypeObject *type, BIO *bio)
+x509_object_set_crldp(x509_object *self, PyObject *args)
 {
-  crl_object *self;
+  CRL_DIST_POINTS *ext = NULL;
+  PyObject *fullNames = NULL;
+  PyObject *iterator = NULL;
+  PyObject *item = NULL;
+  DIST_POINT *dp = NULL;
+  GENERAL_NAME *gn = NULL;
+  Py_ssize_t urilen;
+  char *uri;
+  int ok = 0;
 
-  ENTERING(crl_object_der_read_helper);
+  ENTERING(x509_object_set_crldp);
 
-  if ((self = (crl_object *) crl_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "O", &fullNames))
     goto error;
 
-  if (!d2i_X509_CRL_bio(bio, &self->crl))
-    lose_openssl_error("Couldn't load DER encoded CRL");
-
-  return (PyObject *) self;
+  if ((ext = sk_DIST_POINT_new_null()) == NULL ||
+      (dp = DIST_POINT_new()) == NULL ||
+      (dp->distpoint = DIST_POINT_NAME_new()) == NULL ||
+      (dp->distpoint->name.fullname = sk_GENERAL_NAME_new_null()) == NULL)
+    lose_no_memory();
 
- error:
-  Py_XDECREF(self);
-  return NULL;
-}
+  dp->distpoint->type = 0;
 
-static char crl_object_pem_read__doc__[] =
-  "Read a PEM-encoded CRL object from a string.\n"
-  ;
+  if ((iterator = PyObject_GetIter(fullNames)) == NULL)
+    goto error;
 
-static PyObject *
-crl_object_pem_read(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(crl_object_pem_read);
-  return read_from_string_helper(crl_object_pem_read_helper, type, args);
-}
+  while ((item = PyIter_Next(iterator)) != NULL) {
 
-static char crl_object_pem_read_file__doc__[] =
-  "Read a PEM-encoded CRL object from a file.\n"
-  ;
+    if (PyString_AsStringAndSize(item, &uri, &urilen) < 0)
+      goto error;
 
-static PyObject *
-crl_object_pem_read_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(crl_object_pem_read_file);
-  return read_from_file_helper(crl_object_pem_read_helper, type, args);
-}
-
-static char crl_object_der_read__doc__[] =
-  "Read a DER-encoded CRL object from a string.\n"
-  ;
+    if ((gn = GENERAL_NAME_new()) == NULL ||
+        (gn->d.uniformResourceIdentifier = ASN1_IA5STRING_new()) == NULL ||
+        !ASN1_OCTET_STRING_set(gn->d.uniformResourceIdentifier, (unsigned char *) uri, urilen))
+      lose_no_memory();
 
-static PyObject *
-crl_object_der_read(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(crl_object_der_read);
-  return read_from_string_helper(crl_object_der_read_helper, type, args);
-}
+    gn->type = GEN_URI;
 
-static char crl_object_der_read_file__doc__[] =
-  "Read a DER-encoded CRL object from a file.\n"
-  ;
+    if (!sk_GENERAL_NAME_push(dp->distpoint->name.fullname, gn))
+      lose_no_memory();
 
-static PyObject *
-crl_object_der_read_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(crl_object_der_read_file);
-  return read_from_file_helper(crl_object_der_read_helper, type, args);
-}
+    gn = NULL;
+    Py_XDECREF(item);
+    item = NULL;
+  }
 
-static X509_EXTENSION *
-crl_object_extension_get_helper(crl_object *self, int nid)
-{
-  if (self != NULL && self->crl != NULL)
-    return X509_CRL_get_ext(self->crl, X509_CRL_get_ext_by_NID(self->crl, nid, -1));
-  else
-    return NULL;
-}
+  Py_XDECREF(iterator);
+  iterator = NULL;
 
-static PyObject *
-crl_object_extension_set_helper(crl_object *self, extension_wrapper ext)
-{
-  int ok = 0;
+  if (!sk_DIST_POINT_push(ext, dp))
+    lose_no_memory();
 
-  if (ext.value == NULL)
-    goto error;
+  dp = NULL;
 
-  if (!X509_CRL_add1_ext_i2d(self->crl, ext.nid, ext.value, ext.critical, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add extension to CRL");
+  if (!X509_add1_ext_i2d(self->x509, NID_crl_distribution_points, ext, 0, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add CRLDP extension to certificate");
 
   ok = 1;
 
  error:
-  ext.destructor(ext.value);
+  sk_DIST_POINT_pop_free(ext, DIST_POINT_free);
+  DIST_POINT_free(dp);
+  GENERAL_NAME_free(gn);
+  Py_XDECREF(item);
+  Py_XDECREF(iterator);
+
   if (ok)
     Py_RETURN_NONE;
   else
     return NULL;
 }
 
-
-
-static char crl_object_get_version__doc__[] =
-  "Return the version number of this CRL.\n"
-  ;
-
-static PyObject *
-crl_object_get_version(crl_object *self)
-{
-  ENTERING(crl_object_get_version);
-  return Py_BuildValue("l", X509_CRL_get_version(self->crl));
-}
-
-static char crl_object_set_version__doc__[] =
-  "Set the version number of this CRL.\n"
+static char x509_object_get_certificate_policies__doc__[] =
+  "Get Certificate Policies values for this certificate.\n"
   "\n"
-  "The \"version\" parameter should be a positive integer.\n"
+  "If this certificate has no Certificate Policies extension, this method\n"
+  "returns None.\n"
+  "\n"
+  "Otherwise, this method returns a sequence of Object Identifiers.\n"
+  "\n"
+  "Policy qualifiers, if any, are ignored.\n"
   ;
 
 static PyObject *
-crl_object_set_version(crl_object *self, PyObject *args)
+x509_object_get_certificate_policies(x509_object *self)
 {
-  long version = 0;
+  CERTIFICATEPOLICIES *ext = NULL;
+  PyObject *result = NULL;
+  PyObject *obj;
+  int i;
 
-  ENTERING(crl_object_set_version);
+  ENTERING(x509_object_get_certificate_policies);
 
-  if (!PyArg_ParseTuple(args, "i", &version))
+  if ((ext = X509_get_ext_d2i(self->x509, NID_certificate_policies, NULL, NULL)) == NULL)
+    Py_RETURN_NONE;
+
+  if (((result = PyTuple_New(sk_POLICYINFO_num(ext))) == NULL))
     goto error;
 
-  if (!X509_CRL_set_version(self->crl, version))
-    lose_no_memory();
+  for (i = 0; i < sk_POLICYINFO_num(ext); i++) {
+    POLICYINFO *p = sk_POLICYINFO_value(ext, i);
 
-  Py_RETURN_NONE;
+    if ((obj = ASN1_OBJECT_to_PyString(p->policyid)) == NULL)
+      goto error;
+
+    PyTuple_SET_ITEM(result, i, obj);
+  }
+
+  sk_POLICYINFO_pop_free(ext, POLICYINFO_free);
+  return result;
 
  error:
+  sk_POLICYINFO_pop_free(ext, POLICYINFO_free);
+  Py_XDECREF(result);
   return NULL;
 }
 
-static char crl_object_get_issuer__doc__[] =
-  "Return issuer name of this CRL.\n"
+static char x509_object_set_certificate_policies__doc__[] =
+  "Set Certificate Policies for this certificate.\n"
   "\n"
-  "See the \"getIssuer()\" method of the X509 class for more details.\n"
+  "Argument is a iterable which returns policy OIDs.\n"
+  "\n"  
+  "Policy qualifier are not supported.\n"
+  "\n"
+  "The extension will be marked as critical, since there's not much point\n"
+  "in using this extension without making it critical.\n"
   ;
 
 static PyObject *
-crl_object_get_issuer(crl_object *self, PyObject *args)
+x509_object_set_certificate_policies(x509_object *self, PyObject *args)
 {
-  PyObject *result = NULL;
-  int format = OIDNAME_FORMAT;
+  CERTIFICATEPOLICIES *ext = NULL;
+  PyObject *policies = NULL;
+  PyObject *iterator = NULL;
+  POLICYINFO *pol = NULL;
+  PyObject *item = NULL;
+  const char *oid;
+  int ok = 0;
 
-  ENTERING(crl_object_get_issuer);
+  ENTERING(x509_object_set_certificate_policies);
 
-  if (!PyArg_ParseTuple(args, "|i", &format))
+  if (!PyArg_ParseTuple(args, "O", &policies))
     goto error;
 
-  result = x509_object_helper_get_name(X509_CRL_get_issuer(self->crl), format);
+  if ((ext = sk_POLICYINFO_new_null()) == NULL)
+    lose_no_memory();
 
- error:                         /* Fall through */
-  return result;
-}
+  if ((iterator = PyObject_GetIter(policies)) == NULL)
+    goto error;
 
-static char crl_object_set_issuer__doc__[] =
-  "Set this CRL's issuer name.\n"
-  "\n"
-  "See the \"setIssuer()\" method of the X509 class for details.\n"
-  ;
+  while ((item = PyIter_Next(iterator)) != NULL) {
 
-static PyObject *
-crl_object_set_issuer(crl_object *self, PyObject *args)
-{
-  PyObject *name_sequence = NULL;
-  X509_NAME *name = NULL;
+    if ((oid = PyString_AsString(item)) == NULL)
+      goto error;
 
-  ENTERING(crl_object_set_issuer);
+    if ((pol = POLICYINFO_new()) == NULL)
+      lose_no_memory();
 
-  if (!PyArg_ParseTuple(args, "O", &name_sequence))
-    goto error;
+    if ((pol->policyid = OBJ_txt2obj(oid, 1)) == NULL)
+      lose("Couldn't parse OID");
 
-  if (!PySequence_Check(name_sequence))
-    lose_type_error("Expected a sequence object");
+    if (!sk_POLICYINFO_push(ext, pol))
+      lose_no_memory();
 
-  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
-    goto error;
+    pol = NULL;
+    Py_XDECREF(item);
+    item = NULL;
+  }
 
-  if (!X509_CRL_set_issuer_name(self->crl, name))
-    lose_openssl_error("Unable to set issuer name");
+  Py_XDECREF(iterator);
+  iterator = NULL;
 
-  X509_NAME_free(name);
+  if (!X509_add1_ext_i2d(self->x509, NID_certificate_policies, ext, 1, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add CERTIFICATE_POLICIES extension to certificate");
 
-  Py_RETURN_NONE;
+  ok = 1;
 
  error:
-  X509_NAME_free(name);
-  return NULL;
-}
-
-static char crl_object_get_issuer_hash__doc__[] =
-  "Return the OpenSSL \"name hash\" for this CRL's issuer name.\n"
-  ;
+  POLICYINFO_free(pol);
+  sk_POLICYINFO_pop_free(ext, POLICYINFO_free);
+  Py_XDECREF(item);
+  Py_XDECREF(iterator);
 
-static PyObject *
-crl_object_get_issuer_hash(crl_object *self)
-{
-  ENTERING(crl_object_get_issuer_hash);
-  return Py_BuildValue("k", X509_NAME_hash(X509_CRL_get_issuer(self->crl)));
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
 }
 
-/*
- * NB: OpenSSL is confused about the name of this field, probably for
- * backwards compatability with some ancient mistake.  What RFC 5280
- * calls "thisUpdate", OpenSSL calls "lastUpdate".
- */
-
-static char crl_object_set_this_update__doc__[] =
-  "Set this CRL's \"thisUpdate\" value.\n"
-  "\n"
-  "The \"time\" parameter should be a datetime object.\n"
+static char x509_object_pprint__doc__[] =
+  "Return a pretty-printed rendition of this certificate.\n"
   ;
 
 static PyObject *
-crl_object_set_this_update (crl_object *self, PyObject *args)
+x509_object_pprint(x509_object *self)
 {
-  PyObject *o = NULL;
-  ASN1_TIME *t = NULL;
-
-  ENTERING(crl_object_set_this_update);
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  if (!PyArg_ParseTuple(args, "O", &o))
-    goto error;
+  ENTERING(x509_object_pprint);
 
-  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
-    lose("Couldn't convert thisUpdate string");
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  if (!X509_CRL_set_lastUpdate(self->crl, t)) /* sic */
-    lose("Couldn't set thisUpdate");
+  if (!X509_print(bio, self->x509))
+    lose_openssl_error("Unable to pretty-print certificate");
 
-  ASN1_TIME_free(t);
-  Py_RETURN_NONE;
+  result = BIO_to_PyString_helper(bio);
 
- error:
-  ASN1_TIME_free(t);
-  return NULL;
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
 }
 
-static char crl_object_get_this_update__doc__[] =
-  "Return this CRL's \"thisUpdate\" value as a datetime.\n"
-  ;
-
-static PyObject *
-crl_object_get_this_update (crl_object *self)
-{
-  ENTERING(crl_object_get_this_update);
-  return ASN1_TIME_to_Python(X509_CRL_get_lastUpdate(self->crl)); /* sic */
-}
+static struct PyMethodDef x509_object_methods[] = {
+  Define_Method(pemWrite,               x509_object_pem_write,                  METH_NOARGS),
+  Define_Method(derWrite,               x509_object_der_write,                  METH_NOARGS),
+  Define_Method(sign,                   x509_object_sign,                       METH_VARARGS),
+  Define_Method(verify,                 x509_object_verify,                     METH_KEYWORDS),
+  Define_Method(checkRPKIConformance,   x509_object_check_rpki_conformance,     METH_KEYWORDS),
+  Define_Method(getPublicKey,           x509_object_get_public_key,             METH_NOARGS),
+  Define_Method(setPublicKey,           x509_object_set_public_key,             METH_VARARGS),
+  Define_Method(getVersion,             x509_object_get_version,                METH_NOARGS),
+  Define_Method(setVersion,             x509_object_set_version,                METH_VARARGS),
+  Define_Method(getSerial,              x509_object_get_serial,                 METH_NOARGS),
+  Define_Method(setSerial,              x509_object_set_serial,                 METH_VARARGS),
+  Define_Method(getIssuer,              x509_object_get_issuer,                 METH_VARARGS),
+  Define_Method(setIssuer,              x509_object_set_issuer,                 METH_VARARGS),
+  Define_Method(getSubject,             x509_object_get_subject,                METH_VARARGS),
+  Define_Method(setSubject,             x509_object_set_subject,                METH_VARARGS),
+  Define_Method(getNotBefore,           x509_object_get_not_before,             METH_NOARGS),
+  Define_Method(getNotAfter,            x509_object_get_not_after,              METH_NOARGS),
+  Define_Method(setNotAfter,            x509_object_set_not_after,              METH_VARARGS),
+  Define_Method(setNotBefore,           x509_object_set_not_before,             METH_VARARGS),
+  Define_Method(clearExtensions,        x509_object_clear_extensions,           METH_NOARGS),
+  Define_Method(pprint,                 x509_object_pprint,                     METH_NOARGS),
+  Define_Method(getSKI,                 x509_object_get_ski,                    METH_NOARGS),
+  Define_Method(setSKI,                 x509_object_set_ski,                    METH_VARARGS),
+  Define_Method(getAKI,                 x509_object_get_aki,                    METH_NOARGS),
+  Define_Method(setAKI,                 x509_object_set_aki,                    METH_VARARGS),
+  Define_Method(getKeyUsage,            x509_object_get_key_usage,              METH_NOARGS),
+  Define_Method(setKeyUsage,            x509_object_set_key_usage,              METH_VARARGS),
+  Define_Method(getEKU,                 x509_object_get_eku,                    METH_NOARGS),
+  Define_Method(setEKU,                 x509_object_set_eku,                    METH_VARARGS),
+  Define_Method(getRFC3779,             x509_object_get_rfc3779,                METH_NOARGS),
+  Define_Method(getRFC3779Packed,       x509_object_get_rfc3779_packed,         METH_NOARGS),
+  Define_Method(setRFC3779,             x509_object_set_rfc3779,                METH_KEYWORDS),
+  Define_Method(getBasicConstraints,    x509_object_get_basic_constraints,      METH_NOARGS),
+  Define_Method(setBasicConstraints,    x509_object_set_basic_constraints,      METH_VARARGS),
+  Define_Method(getSIA,                 x509_object_get_sia,                    METH_NOARGS),
+  Define_Method(setSIA,                 x509_object_set_sia,                    METH_KEYWORDS),
+  Define_Method(getAIA,                 x509_object_get_aia,                    METH_NOARGS),
+  Define_Method(setAIA,                 x509_object_set_aia,                    METH_VARARGS),
+  Define_Method(getCRLDP,               x509_object_get_crldp,                  METH_NOARGS),
+  Define_Method(setCRLDP,               x509_object_set_crldp,                  METH_VARARGS),
+  Define_Method(getCertificatePolicies, x509_object_get_certificate_policies,   METH_NOARGS),
+  Define_Method(setCertificatePolicies, x509_object_set_certificate_policies,   METH_VARARGS),
+  Define_Method(getIssuerHash,          x509_object_get_issuer_hash,            METH_NOARGS),
+  Define_Method(getSubjectHash,         x509_object_get_subject_hash,           METH_NOARGS),
+  Define_Class_Method(pemRead,          x509_object_pem_read,                   METH_VARARGS),
+  Define_Class_Method(pemReadFile,      x509_object_pem_read_file,              METH_VARARGS),
+  Define_Class_Method(derRead,          x509_object_der_read,                   METH_VARARGS),
+  Define_Class_Method(derReadFile,      x509_object_der_read_file,              METH_VARARGS),
+  {NULL}
+};
 
-static char crl_object_set_next_update__doc__[] =
-  "Set this CRL's \"nextUpdate\" value.\n"
-  "\n"
-  "The \"time\" parameter should be a datetime object.\n"
+static char POW_X509_Type__doc__[] =
+  "This class represents an X.509v3 certificate.\n"
   ;
 
-static PyObject *
-crl_object_set_next_update (crl_object *self, PyObject *args)
-{
-  PyObject *o = NULL;
-  ASN1_TIME *t = NULL;
+static PyTypeObject POW_X509_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                        /* ob_size */
+  "rpki.POW.X509",                          /* tp_name */
+  sizeof(x509_object),                      /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)x509_object_dealloc,          /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  0,                                        /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_X509_Type__doc__,                     /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  x509_object_methods,                      /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  0,                                        /* tp_init */
+  0,                                        /* tp_alloc */
+  x509_object_new,                          /* tp_new */
+};
 
-  ENTERING(crl_object_set_next_update);
+
 
-  if (!PyArg_ParseTuple(args, "O", &o))
-    goto error;
+/*
+ * X509StoreCTX object.
+ */
 
-  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
-    lose("Couldn't parse nextUpdate string");
+static int 
+x509_store_ctx_object_verify_cb(int ok, X509_STORE_CTX *ctx)
+{
+  static char method_name[] = "verify_callback";
+  x509_store_ctx_object *self = (x509_store_ctx_object *) X509_STORE_CTX_get_ex_data(ctx, x509_store_ctx_ex_data_idx);
+  PyObject *result = NULL;
+  PyGILState_STATE gil;
 
-  if (!X509_CRL_set_nextUpdate(self->crl, t))
-    lose("Couldn't set nextUpdate");
+  if (self == NULL)
+    return ok;
 
-  ASN1_TIME_free(t);
-  Py_RETURN_NONE;
+  /*
+   * We're called from X509_verify_cert(), which runs without the
+   * interpreter lock, so grab the lock before touching Python.
+   */
+  gil = PyGILState_Ensure();
 
- error:
-  ASN1_TIME_free(t);
-  return NULL;
-}
+  if (!PyObject_HasAttrString((PyObject *) self, method_name))
+    goto done;
 
-static char crl_object_get_next_update__doc__[] =
-  "Returns this CRL's \"nextUpdate\" value as a datetime.\n"
-  ;
+  if ((result = PyObject_CallMethod((PyObject *) self, method_name, "i", ok)) == NULL) {
+    ok = -1;
+    goto done;
+  }
 
-static PyObject *
-crl_object_get_next_update (crl_object *self)
-{
-  ENTERING(crl_object_get_next_update);
-  return ASN1_TIME_to_Python(X509_CRL_get_nextUpdate(self->crl));
-}
+  ok = PyObject_IsTrue(result);
+  Py_XDECREF(result);
 
-static char crl_object_add_revocations__doc__[] =
-  "This method adds a collection of revocations to this CRL.\n"
-  "\n"
-  "The \"iterable\" parameter should be an iterable object which returns\n"
-  "two-element sequences.  The first element of each pair should be the\n"
-  "revoked serial number (an integer), the second element should be the\n"
-  "revocation date (a datetime object).\n"
-  ;
+ done:
+  PyGILState_Release(gil);
+  return ok;
+}
 
 static PyObject *
-crl_object_add_revocations(crl_object *self, PyObject *args)
+x509_store_ctx_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
 {
-  PyObject *iterable = NULL;
-  PyObject *iterator = NULL;
-  PyObject *item = NULL;
-  PyObject *fast = NULL;
-  X509_REVOKED *revoked = NULL;
-  ASN1_INTEGER *serial = NULL;
-  ASN1_TIME *date = NULL;
-  int ok = 0;
+  x509_store_ctx_object *self = NULL;
 
-  ENTERING(crl_object_add_revocations);
+  ENTERING(x509_store_ctx_object_new);
 
-  if (!PyArg_ParseTuple(args, "O", &iterable) ||
-      (iterator = PyObject_GetIter(iterable)) == NULL)
+  if ((self = (x509_store_ctx_object *) type->tp_alloc(type, 0)) == NULL)
     goto error;
 
-  while ((item = PyIter_Next(iterator)) != NULL) {
-
-    if ((fast = PySequence_Fast(item, "Revocation entry must be a sequence")) == NULL)
-      goto error;
-
-    if (PySequence_Fast_GET_SIZE(fast) != 2)
-      lose_type_error("Revocation entry must be two-element sequence");
-
-    if ((serial = PyLong_to_ASN1_INTEGER(PySequence_Fast_GET_ITEM(fast, 0))) == NULL ||
-        (date = Python_to_ASN1_TIME(PySequence_Fast_GET_ITEM(fast, 1), 1)) == NULL)
-      goto error;
-
-    if ((revoked = X509_REVOKED_new()) == NULL ||
-        !X509_REVOKED_set_serialNumber(revoked, serial) ||
-        !X509_REVOKED_set_revocationDate(revoked, date))
-      lose_no_memory();
+  self->ctx = NULL;
+  self->store = NULL;
+  return (PyObject *) self;    
 
-    ASN1_INTEGER_free(serial);
-    serial = NULL;
+ error:
+  Py_XDECREF(self);
+  return NULL;
+}
 
-    ASN1_TIME_free(date);
-    date = NULL;
+static int
+x509_store_ctx_object_init(x509_store_ctx_object *self, PyObject *args, GCC_UNUSED PyObject *kwds)
+{
+  ENTERING(x509_store_ctx_object_init);
 
-    if (!X509_CRL_add0_revoked(self->crl, revoked))
-      lose_no_memory();
+  if ((self->store = X509_STORE_new()) == NULL ||
+      (self->ctx = X509_STORE_CTX_new()) == NULL)
+    lose_no_memory();
 
-    revoked = NULL;
-    Py_XDECREF(item);
-    Py_XDECREF(fast);
-    item = fast = NULL;
-  }
+  if (!X509_STORE_CTX_init(self->ctx, self->store, NULL, NULL))
+    lose_openssl_error("Couldn't initialize X509_STORE_CTX");
 
-  if (!X509_CRL_sort(self->crl))
-    lose_openssl_error("Couldn't sort CRL");
+  if (!X509_STORE_CTX_set_ex_data(self->ctx, x509_store_ctx_ex_data_idx, self))
+    lose_openssl_error("Couldn't set X509_STORE_CTX ex_data");
 
-  ok = 1;
+  X509_VERIFY_PARAM_set_flags(self->ctx->param, X509_V_FLAG_X509_STRICT);
+  return 0;
 
  error:
-  Py_XDECREF(iterator);
-  Py_XDECREF(item);
-  Py_XDECREF(fast);
-  X509_REVOKED_free(revoked);
-  ASN1_INTEGER_free(serial);
-  ASN1_TIME_free(date);
+  return -1;
+}
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+static void
+x509_store_ctx_object_dealloc(x509_store_ctx_object *self)
+{
+  ENTERING(x509_store_ctx_object_dealloc);
+  X509_STORE_CTX_free(self->ctx);
+  X509_STORE_free(self->store);
+  self->ob_type->tp_free((PyObject*) self);
 }
 
-static char crl_object_get_revoked__doc__[] =
-  "Return a sequence of two-element tuples representing the sequence of\n"
-  "revoked certificates listed in this CRL.\n"
-  "\n"
-  "The first element of each pair is the serialNumber of the revoked\n"
-  "certificate, the second element is the revocationDate.\n"
+static char x509_store_ctx_object_get_error__doc__[] =
+  "Extract verification error code from this X509StoreCTX.\n"
   ;
 
-static PyObject *
-crl_object_get_revoked(crl_object *self)
+static PyObject*
+x509_store_ctx_object_get_error (x509_store_ctx_object *self)
 {
-  STACK_OF(X509_REVOKED) *revoked = NULL;
-  X509_REVOKED *r = NULL;
-  PyObject *result = NULL;
-  PyObject *item = NULL;
-  PyObject *serial = NULL;
-  PyObject *date = NULL;
-  int i;
-
-  ENTERING(crl_object_get_revoked);
-
-  if ((revoked = X509_CRL_get_REVOKED(self->crl)) == NULL)
-    lose("Inexplicable NULL revocation list pointer");
-
-  if ((result = PyTuple_New(sk_X509_REVOKED_num(revoked))) == NULL)
-    goto error;
-
-  for (i = 0; i < sk_X509_REVOKED_num(revoked); i++) {
-    r = sk_X509_REVOKED_value(revoked, i);
+  return Py_BuildValue("i", X509_STORE_CTX_get_error(self->ctx));
+}
 
-    if ((serial = ASN1_INTEGER_to_PyLong(r->serialNumber)) == NULL ||
-        (date = ASN1_TIME_to_Python(r->revocationDate)) == NULL ||
-        (item = Py_BuildValue("(NN)", serial, date)) == NULL)
-      goto error;
+static char x509_store_ctx_object_get_error_string__doc__[] =
+  "Extract verification error string from this X509StoreCTX.\n"
+  ;
 
-    PyTuple_SET_ITEM(result, i, item);
-    item = serial = date = NULL;
-  }
+static PyObject*
+x509_store_ctx_object_get_error_string (x509_store_ctx_object *self)
+{
+  return Py_BuildValue("s", X509_verify_cert_error_string(X509_STORE_CTX_get_error(self->ctx)));
+}
 
-  return result;
+static char x509_store_ctx_object_get_error_depth__doc__[] =
+  "Extract verification error depth from this X509StoreCTX.\n"
+  ;
 
- error:
-  Py_XDECREF(result);
-  Py_XDECREF(item);
-  Py_XDECREF(serial);
-  Py_XDECREF(date);
-  return NULL;
+static PyObject*
+x509_store_ctx_object_get_error_depth (x509_store_ctx_object *self)
+{
+  return Py_BuildValue("i", X509_STORE_CTX_get_error_depth(self->ctx));
 }
 
-static char crl_object_is_revoked__doc__[] =
-  "Check whether a particular certificate has been revoked.\n"
+static char x509_store_ctx_object_get_current_certificate__doc__[] =
+  "Extract the certificate which caused the current validation error,\n"
+  "or None if no certificate is relevant.\n"
   ;
 
 static PyObject *
-crl_object_is_revoked(crl_object *self, PyObject *args)
+x509_store_ctx_object_get_current_certificate (x509_store_ctx_object *self)
 {
-  x509_object *x = NULL;
+  X509 *x = X509_STORE_CTX_get_current_cert(self->ctx);
+  x509_object *obj = NULL;
 
-  if (!PyArg_ParseTuple(args, "O!", &POW_X509_Type, &x))
-    return NULL;
+  if (x == NULL)
+    Py_RETURN_NONE;
 
-  return PyBool_FromLong(X509_CRL_get0_by_cert(self->crl, NULL, x->x509));
+  if ((x = X509_dup(x)) == NULL)
+    lose_no_memory();
+
+  if ((obj = x509_object_new_helper(NULL, x)) == NULL)
+    goto error;
+
+  return (PyObject *) obj;
+
+ error:
+  Py_XDECREF(obj);
+  X509_free(x);
+  return NULL;
 }
 
-static char crl_object_clear_extensions__doc__[] =
-  "Clear all extensions attached to this CRL.\n"
+static char x509_store_ctx_object_get_chain__doc__[] =
+  "Extract certificate chain from X509StoreCTX.  If validation\n"
+  "completed succesfully, this is the complete validation chain;\n"
+  "otherwise, the returned chain may be invalid or incomplete.\n"
   ;
 
 static PyObject *
-crl_object_clear_extensions(crl_object *self)
+x509_store_ctx_object_get_chain (x509_store_ctx_object *self)
 {
-  X509_EXTENSION *ext;
-
-  ENTERING(crl_object_clear_extensions);
+  STACK_OF(X509) *chain = NULL;
+  PyObject *result = NULL;
 
-  while ((ext = X509_CRL_delete_ext(self->crl, 0)) != NULL)
-    X509_EXTENSION_free(ext);
+  if ((chain = X509_STORE_CTX_get1_chain(self->ctx)) == NULL)
+    lose_openssl_error("X509_STORE_CTX_get1_chain() failed");
+  
+  result = stack_to_tuple_helper(CHECKED_PTR_OF(STACK_OF(X509), chain),
+                                 stack_to_tuple_helper_get_x509);
 
-  Py_RETURN_NONE;
+ error:                         /* fall through */
+  sk_X509_pop_free(chain, X509_free);
+  return result;
 }
 
-static char crl_object_sign__doc__[] =
-  "Sign this CRL with a private key.\n"
-  "\n"
-  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
-  "containing a private key.\n"
-  "\n"
-  "The optional \"digest\" parameter indicates which digest to compute and\n"
-  "sign, and should be one of the following:\n"
+/*
+ * See (omnibus) man page for X509_STORE_CTX_get_error() for other
+ * query methods we might want to expose.  Someday we might want to
+ * support X509_V_FLAG_USE_CHECK_TIME too.
+ */
+
+static struct PyMethodDef x509_store_ctx_object_methods[] = {
+  Define_Method(getError,               x509_store_ctx_object_get_error,                METH_NOARGS),
+  Define_Method(getErrorString,         x509_store_ctx_object_get_error_string,         METH_NOARGS),
+  Define_Method(getErrorDepth,          x509_store_ctx_object_get_error_depth,          METH_NOARGS),
+  Define_Method(getCurrentCertificate,  x509_store_ctx_object_get_current_certificate,  METH_NOARGS),
+  Define_Method(getChain,               x509_store_ctx_object_get_chain,                METH_NOARGS),
+ {NULL}
+};
+
+static char POW_X509StoreCTX_Type__doc__[] =
+  "This class holds the state of an OpenSSL certificate verification\n"
+  "operation.  Ordinarily, the user will never have cause to instantiate\n"
+  "this class directly, instead, an object of this class will be returned\n"
+  "by X509.verify().\n"
   "\n"
-  "* SHA1_DIGEST\n"
-  "* SHA256_DIGEST\n"
-  "* SHA384_DIGEST\n"
-  "* SHA512_DIGEST\n"
+  "If you need to see OpenSSL's verification callbacks, you can do so\n"
+  "by subclassing X509StoreCTX and passing your subclass as an argument\n"
+  "to X509.verify.  Your subclass should provide a .verify_callback()\n"
+  "method, which should expect to receive one argument: the integer \"ok\"\n"
+  "value passed by OpenSSL's verification callbacks.\n"
   "\n"
-  "The default digest algorithm is SHA-256.\n"
+  "The return value from your .verify_callback() method will be is interpreted\n"
+  "as a boolean value: anything which evaluates to True will be result in a\n"
+  "return value of 1 to OpenSSL, while anything which evaluates to False will\n"
+  "result in a return value of 0 to OpenSSL.\n"
   ;
 
+static PyTypeObject POW_X509StoreCTX_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                        /* ob_size */
+  "rpki.POW.X509StoreCTX",                  /* tp_name */
+  sizeof(x509_store_ctx_object),            /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)x509_store_ctx_object_dealloc,/* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  0,                                        /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_X509StoreCTX_Type__doc__,             /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  x509_store_ctx_object_methods,            /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  (initproc) x509_store_ctx_object_init,    /* tp_init */
+  0,                                        /* tp_alloc */
+  x509_store_ctx_object_new,                /* tp_new */
+};
+
+
+/*
+ * X509Store object.
+ */
+
 static PyObject *
-crl_object_sign(crl_object *self, PyObject *args)
+x509_store_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
 {
-  asymmetric_object *asym;
-  int digest_type = SHA256_DIGEST;
-  const EVP_MD *digest_method = NULL;
+  x509_store_object *self = NULL;
 
-  ENTERING(crl_object_sign);
+  ENTERING(x509_store_object_new);
 
-  if (!PyArg_ParseTuple(args, "O!|i", &POW_Asymmetric_Type, &asym, &digest_type))
+  if ((self = (x509_store_object *) type->tp_alloc(type, 0)) == NULL)
     goto error;
 
-  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
-    lose("Unsupported digest algorithm");
+  if ((self->certs = PyList_New(0)) == NULL)
+    goto error;
 
-  if (!X509_CRL_sign(self->crl, asym->pkey, digest_method))
-    lose_openssl_error("Couldn't sign CRL");
+  if ((self->stack = sk_X509_new_null()) == NULL)
+    lose_no_memory();
 
-  Py_RETURN_NONE;
+  return (PyObject *) self;
 
  error:
+  Py_XDECREF(self);
   return NULL;
 }
 
-static char crl_object_verify__doc__[] =
-  "Verify this CRL's signature against its issuer.\n"
-  ;
+static void
+x509_store_object_dealloc(x509_store_object *self)
+{
+  ENTERING(x509_store_object_dealloc);
+  sk_X509_free(self->stack);
+  Py_XDECREF(self->certs);
+  self->ob_type->tp_free((PyObject*) self);
+}
 
-static PyObject *
-crl_object_verify(crl_object *self, PyObject *args)
+/*
+ * Push one certificate.  While we have the interpreter lock, we also
+ * get OpenSSL to cache the parsed extensions (including RFC 3779
+ * resources) and public key, so that verifications using this store
+ * don't redo that work, and so that OpenSSL doesn't have to update
+ * shared certificates when verifying in other threads.
+ */
+static int
+x509_store_object_push_helper(x509_store_object *self, PyObject *cert)
 {
-  x509_object *issuer;
+  X509 *x = NULL;
 
-  ENTERING(crl_object_verify);
+  if (!POW_X509_Check(cert))
+    lose_type_error("Expected an X509 object");
 
-  if (!PyArg_ParseTuple(args, "O!", &POW_X509_Type, &issuer))
-    goto error;
+  x = ((x509_object *) cert)->x509;
 
-  if (!X509_CRL_verify(self->crl, X509_get_pubkey(issuer->x509)))
-    lose_validation_error("X509_CRL_verify() raised an exception");
+  (void) X509_check_ca(x);
+  EVP_PKEY_free(X509_get_pubkey(x));
+  ERR_clear_error();
 
-  Py_RETURN_NONE;
+  if (!sk_X509_push(self->stack, x))
+    lose_no_memory();
+
+  if (PyList_Append(self->certs, cert) < 0) {
+    (void) sk_X509_pop(self->stack);
+    goto error;
+  }
+
+  return 1;
 
  error:
-  return NULL;
+  return 0;
 }
 
-static char crl_object_check_rpki_conformance__doc__[] =
-  "Check this CRL for conformance to the RPKI profile.\n"
-  ;
-
-static PyObject *
-crl_object_check_rpki_conformance(crl_object *self, PyObject *args, PyObject *kwds)
+static int
+x509_store_object_init(x509_store_object *self, PyObject *args, PyObject *kwds)
 {
-  static char *kwlist[] = {"issuer", "status", NULL};
-  x509_object *issuer = NULL;
-  PyObject *status = Py_None;
+  static char *kwlist[] = {"certs", NULL};
+  PyObject *iterable = Py_None;
+  PyObject *iterator = NULL;
+  PyObject *item = NULL;
 
-  ENTERING(crl_object_check_rpki_conformance);
+  ENTERING(x509_store_object_init);
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!", kwlist, &POW_X509_Type, &issuer, &PySet_Type, &status))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &iterable))
     goto error;
 
-  if (!check_crl(self->crl, issuer->x509, status))
+  if (iterable == Py_None)
+    return 0;
+
+  if ((iterator = PyObject_GetIter(iterable)) == NULL)
     goto error;
 
-  Py_RETURN_NONE;
+  while ((item = PyIter_Next(iterator)) != NULL) {
+    if (!x509_store_object_push_helper(self, item))
+      goto error;
+    Py_XDECREF(item);
+    item = NULL;
+  }
 
- error:
-  return NULL;
-}
+  Py_XDECREF(iterator);
 
-static char crl_object_pem_write__doc__[] =
-  "Return the PEM encoding of this CRL, as a string.\n"
-  ;
-
-static PyObject *
-crl_object_pem_write(crl_object *self)
-{
-  PyObject *result = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(crl_object_pem_write);
-
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
-  if (!PEM_write_bio_X509_CRL(bio, self->crl))
-    lose_openssl_error("Unable to write CRL");
+  if (PyErr_Occurred())
+    return -1;
 
-  result = BIO_to_PyString_helper(bio);
+  return 0;
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+ error:
+  Py_XDECREF(iterator);
+  Py_XDECREF(item);
+  return -1;
 }
 
-static char crl_object_der_write__doc__[] =
-  "Return the DER encoding of this CRL, as a string.\n"
+static char x509_store_object_push__doc__[] =
+  "Push a CA certificate onto this store, making it the new top of stack.\n"
   ;
 
 static PyObject *
-crl_object_der_write(crl_object *self)
+x509_store_object_push(x509_store_object *self, PyObject *args)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+  PyObject *cert = NULL;
 
-  ENTERING(crl_object_der_write);
+  ENTERING(x509_store_object_push);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  if (!PyArg_ParseTuple(args, "O!", &POW_X509_Type, &cert))
+    goto error;
 
-  if (!i2d_X509_CRL_bio(bio, self->crl))
-    lose_openssl_error("Unable to write CRL");
+  if (!x509_store_object_push_helper(self, cert))
+    goto error;
 
-  result = BIO_to_PyString_helper(bio);
+  Py_RETURN_NONE;
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+ error:
+  return NULL;
 }
 
-static char crl_object_get_aki__doc__[] =
-  EXTENSION_GET_AKI__DOC__
+static char x509_store_object_pop__doc__[] =
+  "Remove the top certificate from this store, and return it.\n"
   ;
 
 static PyObject *
-crl_object_get_aki(crl_object *self)
+x509_store_object_pop(x509_store_object *self)
 {
-  return extension_get_aki(crl_object_extension_get_helper(self, NID_authority_key_identifier));
-}
-
-static char crl_object_set_aki__doc__[] =
-  EXTENSION_SET_AKI__DOC__
-  ;
+  Py_ssize_t n = PyList_GET_SIZE(self->certs);
+  PyObject *result = NULL;
 
-static PyObject *
-crl_object_set_aki(crl_object *self, PyObject *args)
-{
-  return crl_object_extension_set_helper(self, extension_set_aki(args));
-}
+  ENTERING(x509_store_object_pop);
 
-static char crl_object_get_crl_number__doc__[] =
-  "Return the CRL Number extension value from this CRL, an integer.\n"
-  ;
+  if (n == 0) {
+    PyErr_SetString(PyExc_IndexError, "pop from empty X509Store");
+    goto error;
+  }
 
-static PyObject *
-crl_object_get_crl_number(crl_object *self)
-{
-  ASN1_INTEGER *ext = X509_CRL_get_ext_d2i(self->crl, NID_crl_number, NULL, NULL);
-  PyObject *result = NULL;
+  result = PyList_GET_ITEM(self->certs, n - 1);
+  Py_INCREF(result);
 
-  ENTERING(crl_object_get_crl_number);
+  if (PyList_SetSlice(self->certs, n - 1, n, NULL) < 0)
+    goto error;
 
-  if (ext == NULL)
-    Py_RETURN_NONE;
+  (void) sk_X509_pop(self->stack);
 
-  result = Py_BuildValue("N", ASN1_INTEGER_to_PyLong(ext));
-  ASN1_INTEGER_free(ext);
   return result;
+
+ error:
+  Py_XDECREF(result);
+  return NULL;
 }
 
-static char crl_object_set_crl_number__doc__[] =
-  "Set the CRL Number extension value in this CRL.\n"
+static char x509_store_object_copy__doc__[] =
+  "Return a new X509Store containing the same certificates as this one.\n"
   "\n"
-  "The \"number\" parameter should be an integer.\n"
+  "This is cheap, since the certificates themselves are shared.\n"
   ;
 
 static PyObject *
-crl_object_set_crl_number(crl_object *self, PyObject *args)
+x509_store_object_copy(x509_store_object *self)
 {
-  ASN1_INTEGER *ext = NULL;
-  PyObject *crl_number = NULL;
+  x509_store_object *result = NULL;
 
-  ENTERING(crl_object_set_crl_number);
+  ENTERING(x509_store_object_copy);
 
-  if (!PyArg_ParseTuple(args, "O", &crl_number) ||
-      (ext = PyLong_to_ASN1_INTEGER(crl_number)) == NULL)
+  if ((result = (x509_store_object *) x509_store_object_new(self->ob_type, NULL, NULL)) == NULL)
     goto error;
 
-  if (!X509_CRL_add1_ext_i2d(self->crl, NID_crl_number, ext, 0, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add CRL Number extension to CRL");
+  if (PyList_SetSlice(result->certs, 0, 0, self->certs) < 0)
+    goto error;
 
-  ASN1_INTEGER_free(ext);
-  Py_RETURN_NONE;
+  sk_X509_free(result->stack);
+
+  if ((result->stack = sk_X509_dup(self->stack)) == NULL)
+    lose_no_memory();
+
+  return (PyObject *) result;
 
  error:
-  ASN1_INTEGER_free(ext);
+  Py_XDECREF(result);
   return NULL;
 }
 
-static char crl_object_pprint__doc__[] =
-  "Return a pretty-printed rendition of this CRL.\n"
-  ;
+static Py_ssize_t
+x509_store_object_length(x509_store_object *self)
+{
+  return PyList_GET_SIZE(self->certs);
+}
 
+/*
+ * Indexing starts at the top of the stack, so that store[0] is the
+ * issuer of whatever we're about to verify, just like the lists of
+ * trusted certificates this class replaces.
+ */
 static PyObject *
-crl_object_pprint(crl_object *self)
+x509_store_object_item(x509_store_object *self, Py_ssize_t i)
 {
+  Py_ssize_t n = PyList_GET_SIZE(self->certs);
   PyObject *result = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(crl_object_pprint);
-
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
-  if (!X509_CRL_print(bio, self->crl))
-    lose_openssl_error("Unable to pretty-print CRL");
 
-  result = BIO_to_PyString_helper(bio);
+  if (i < 0 || i >= n) {
+    PyErr_SetString(PyExc_IndexError, "X509Store index out of range");
+    return NULL;
+  }
 
- error:                         /* Fall through */
-  BIO_free(bio);
+  result = PyList_GET_ITEM(self->certs, n - 1 - i);
+  Py_INCREF(result);
   return result;
 }
 
-static struct PyMethodDef crl_object_methods[] = {
-  Define_Method(sign,                   crl_object_sign,                        METH_VARARGS),
-  Define_Method(verify,                 crl_object_verify,                      METH_VARARGS),
-  Define_Method(checkRPKIConformance,   crl_object_check_rpki_conformance,      METH_KEYWORDS),
-  Define_Method(getVersion,             crl_object_get_version,                 METH_NOARGS),
-  Define_Method(setVersion,             crl_object_set_version,                 METH_VARARGS),
-  Define_Method(getIssuer,              crl_object_get_issuer,                  METH_VARARGS),
-  Define_Method(setIssuer,              crl_object_set_issuer,                  METH_VARARGS),
-  Define_Method(getThisUpdate,          crl_object_get_this_update,     	METH_NOARGS),
-  Define_Method(setThisUpdate,          crl_object_set_this_update,             METH_VARARGS),
-  Define_Method(getNextUpdate,          crl_object_get_next_update,             METH_NOARGS),
-  Define_Method(setNextUpdate,          crl_object_set_next_update,             METH_VARARGS),
-  Define_Method(getRevoked,             crl_object_get_revoked,                 METH_NOARGS),
-  Define_Method(isRevoked,              crl_object_is_revoked,                  METH_VARARGS),
-  Define_Method(addRevocations,         crl_object_add_revocations,             METH_VARARGS),
-  Define_Method(clearExtensions,        crl_object_clear_extensions,            METH_NOARGS),
-  Define_Method(pemWrite,               crl_object_pem_write,                   METH_NOARGS),
-  Define_Method(derWrite,               crl_object_der_write,                   METH_NOARGS),
-  Define_Method(pprint,                 crl_object_pprint,                      METH_NOARGS),
-  Define_Method(getAKI,                 crl_object_get_aki,                     METH_NOARGS),
-  Define_Method(setAKI,                 crl_object_set_aki,                     METH_VARARGS),
-  Define_Method(getCRLNumber,           crl_object_get_crl_number,              METH_NOARGS),
-  Define_Method(setCRLNumber,           crl_object_set_crl_number,              METH_VARARGS),
-  Define_Method(getIssuerHash,          crl_object_get_issuer_hash,             METH_NOARGS),
-  Define_Class_Method(pemRead,          crl_object_pem_read,                    METH_VARARGS),
-  Define_Class_Method(pemReadFile,      crl_object_pem_read_file,               METH_VARARGS),
-  Define_Class_Method(derRead,          crl_object_der_read,                    METH_VARARGS),
-  Define_Class_Method(derReadFile,      crl_object_der_read_file,               METH_VARARGS),
+static PySequenceMethods x509_store_object_as_sequence = {
+  (lenfunc) x509_store_object_length,           /* sq_length */
+  0,                                            /* sq_concat */
+  0,                                            /* sq_repeat */
+  (ssizeargfunc) x509_store_object_item,        /* sq_item */
+};
+
+static struct PyMethodDef x509_store_object_methods[] = {
+  Define_Method(push,                   x509_store_object_push,                 METH_VARARGS),
+  Define_Method(pop,                    x509_store_object_pop,                  METH_NOARGS),
+  Define_Method(copy,                   x509_store_object_copy,                 METH_NOARGS),
   {NULL}
 };
 
-static char POW_CRL_Type__doc__[] =
-  "Container for OpenSSL's X509 CRL management facilities.\n"
+static char POW_X509Store_Type__doc__[] =
+  "This class holds a chain of trusted CA certificates which can be\n"
+  "reused across many verifications.  Anywhere a sequence of trusted\n"
+  "certificates is accepted (X509.verify(), verifyBatch(), ...), an\n"
+  "X509Store can be used instead, which saves rebuilding the chain from\n"
+  "a Python list for every object verified.\n"
+  "\n"
+  "Certificates are pushed and popped as one walks down and back up the\n"
+  "certificate tree.  The store behaves as a read-only sequence whose\n"
+  "first element is the most recently pushed certificate.\n"
+  "\n"
+  "The optional \"certs\" argument to the constructor is an iterable of\n"
+  "certificates to push, starting from the trust anchor.\n"
   ;
 
-static PyTypeObject POW_CRL_Type = {
+static PyTypeObject POW_X509Store_Type = {
   PyObject_HEAD_INIT(0)
-  0,                                     /* ob_size */
-  "rpki.POW.CRL",                        /* tp_name */
-  sizeof(crl_object),                    /* tp_basicsize */
-  0,                                     /* tp_itemsize */
-  (destructor)crl_object_dealloc,        /* tp_dealloc */
-  0,                                     /* tp_print */
-  0,                                     /* tp_getattr */
-  0,                                     /* tp_setattr */
-  0,                                     /* tp_compare */
-  0,                                     /* tp_repr */
-  0,                                     /* tp_as_number */
-  0,                                     /* tp_as_sequence */
-  0,                                     /* tp_as_mapping */
-  0,                                     /* tp_hash */
-  0,                                     /* tp_call */
-  0,                                     /* tp_str */
-  0,                                     /* tp_getattro */
-  0,                                     /* tp_setattro */
-  0,                                     /* tp_as_buffer */
+  0,                                        /* ob_size */
+  "rpki.POW.X509Store",                     /* tp_name */
+  sizeof(x509_store_object),                /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)x509_store_object_dealloc,    /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  &x509_store_object_as_sequence,           /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
   Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_CRL_Type__doc__,                   /* tp_doc */
-  0,                                     /* tp_traverse */
-  0,                                     /* tp_clear */
-  0,                                     /* tp_richcompare */
-  0,                                     /* tp_weaklistoffset */
-  0,                                     /* tp_iter */
-  0,                                     /* tp_iternext */
-  crl_object_methods,                    /* tp_methods */
-  0,                                     /* tp_members */
-  0,                                     /* tp_getset */
-  0,                                     /* tp_base */
-  0,                                     /* tp_dict */
-  0,                                     /* tp_descr_get */
-  0,                                     /* tp_descr_set */
-  0,                                     /* tp_dictoffset */
-  0,                                     /* tp_init */
-  0,                                     /* tp_alloc */
-  crl_object_new,                        /* tp_new */
+  POW_X509Store_Type__doc__,                /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  x509_store_object_methods,                /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  (initproc) x509_store_object_init,        /* tp_init */
+  0,                                        /* tp_alloc */
+  x509_store_object_new,                    /* tp_new */
 };
 
 
 
 /*
- * Asymmetric object.
+ * CRL object.
  */
 
+static crl_object *
+crl_object_new_helper(PyTypeObject *type, X509_CRL *crl)
+{
+  crl_object *self = NULL;
+
+  if (type == NULL)
+    type = &POW_CRL_Type;
+
+  if ((self = (crl_object *) type->tp_alloc(type, 0)) == NULL)
+    return NULL;
+
+  self->crl = crl;
+  return self;
+}
+
 static PyObject *
-asymmetric_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+crl_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
 {
-  asymmetric_object *self = NULL;
+  crl_object *self = NULL;
+  X509_CRL *crl = NULL;
 
-  ENTERING(asymmetric_object_new);
+  ENTERING(crl_object_new);
 
-  if ((self = (asymmetric_object *) type->tp_alloc(type, 0)) == NULL)
-    goto error;
+  if ((crl = X509_CRL_new()) == NULL)
+    lose_no_memory();
 
-  self->pkey = NULL;
+  if ((self = crl_object_new_helper(type, crl)) == NULL)
+    goto error;
 
   return (PyObject *) self;
 
  error:
-
-  Py_XDECREF(self);
+  X509_CRL_free(crl);
   return NULL;
 }
 
-static int
-asymmetric_object_init(asymmetric_object *self, PyObject *args, PyObject *kwds)
-{
-  static char *kwlist[] = {NULL};
-
-  ENTERING(asymmetric_object_init);
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "", kwlist))
-    goto error;
-
-  /*
-   * We used to take arguments to generate an RSA key, but that's
-   * now in the .generateRSA() class method.
-   */
-
-  return 0;
-
- error:
-  return -1;
-}
-
 static void
-asymmetric_object_dealloc(asymmetric_object *self)
+crl_object_dealloc(crl_object *self)
 {
-  ENTERING(asymmetric_object_dealloc);
-  EVP_PKEY_free(self->pkey);
+  ENTERING(crl_object_dealloc);
+  X509_CRL_free(self->crl);
   self->ob_type->tp_free((PyObject*) self);
 }
 
 static PyObject *
-asymmetric_object_pem_read_private_helper(PyTypeObject *type, BIO *bio, char *pass)
+crl_object_pem_read_helper(PyTypeObject *type, BIO *bio)
 {
-  asymmetric_object *self = NULL;
+  crl_object *self;
 
-  ENTERING(asymmetric_object_pem_read_private_helper);
+  ENTERING(crl_object_pem_read_helper);
 
-  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
+  if ((self = (crl_object *) crl_object_new(type, NULL, NULL)) == NULL)
     goto error;
 
-  if (!PEM_read_bio_PrivateKey(bio, &self->pkey, NULL, pass))
-    lose_openssl_error("Couldn't load private key");
-
-  whack_ec_key_to_namedCurve(self->pkey);
+  if (!PEM_read_bio_X509_CRL(bio, &self->crl, NULL, NULL))
+    lose_openssl_error("Couldn't PEM encoded load CRL");
 
   return (PyObject *) self;
 
@@ -6010,632 +6955,606 @@ asymmetric_object_pem_read_private_helper(PyTypeObject *type, BIO *bio, char *pa
   return NULL;
 }
 
-/*
- * We can't use the generic read_from_*_helper() functions here
- * because of optional the PEM password, so we just code the two PEM
- * read cases for private keys directly.  Other than the passphrase,
- * code is pretty much the same as the generic functions.
- *
- * It turns out that OpenSSL is moving away from its old raw PKCS #1.5
- * private key format in favor of PKCS #8.  This makes sense, but it
- * leaves us with a minor mess to track.  Many OpenSSL functions that
- * originally expected PKCS #1.5 now also accept PKCS #8, so there's
- * no tearing hurry about this, but at some point we might want to
- * switch to writing PKCS #8.  It looks like this would be relatively
- * straightforward: see functions i2d_PKCS8PrivateKey_bio() and
- * PEM_write_bio_PKCS8PrivateKey(), and note that PKCS #8 supports
- * encrypted private keys in DER format, so the DER methods should
- * take a passphrase argument as the PEM methods do.
- */
-
-static char asymmetric_object_pem_read_private__doc__[] =
-  "Read a PEM-encoded private key from a string.\n"
-  "\n"
-  "Optional second argument is a passphrase for the key.\n"
-  ;
-
 static PyObject *
-asymmetric_object_pem_read_private(PyTypeObject *type, PyObject *args)
+crl_object_der_read_helper(PyTypeObject *type, BIO *bio)
 {
-  PyObject *result = NULL;
-  char *pass = NULL;
-  char *src = NULL;
-  BIO *bio = NULL;
-  Py_ssize_t len = 0;
+  crl_object *self;
+  const unsigned char *der;
+  long len = 0;
 
-  ENTERING(asymmetric_object_pem_read_private);
+  ENTERING(crl_object_der_read_helper);
 
-  if (!PyArg_ParseTuple(args, "s#|s", &src, &len, &pass))
+  if ((self = (crl_object *) crl_object_new(type, NULL, NULL)) == NULL)
     goto error;
 
-  if ((bio = BIO_new_mem_buf(src, len)) == NULL)
-    lose_no_memory();
+  if ((der = mem_bio_der(bio, &len)) != NULL
+      ? !d2i_X509_CRL(&self->crl, &der, len)
+      : !d2i_X509_CRL_bio(bio, &self->crl))
+    lose_openssl_error("Couldn't load DER encoded CRL");
 
-  result = asymmetric_object_pem_read_private_helper(type, bio, pass);
+  return (PyObject *) self;
 
  error:
-  BIO_free(bio);
-  return result;
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static char asymmetric_object_pem_read_private_file__doc__[] =
-  "Read a PEM-encoded private key from a file.\n"
-  "\n"
-  "Optional second argument is a passphrase for the key.\n"
+static char crl_object_pem_read__doc__[] =
+  "Read a PEM-encoded CRL object from a string.\n"
   ;
 
 static PyObject *
-asymmetric_object_pem_read_private_file(PyTypeObject *type, PyObject *args)
+crl_object_pem_read(PyTypeObject *type, PyObject *args)
 {
-  const char *filename = NULL;
-  PyObject *result = NULL;
-  char *pass = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(asymmetric_object_pem_read_private_file);
+  ENTERING(crl_object_pem_read);
+  return read_from_string_helper(crl_object_pem_read_helper, type, args);
+}
 
-  if (!PyArg_ParseTuple(args, "s|s", &filename, &pass))
-    goto error;
+static char crl_object_pem_read_file__doc__[] =
+  "Read a PEM-encoded CRL object from a file.\n"
+  ;
 
-  if ((bio = BIO_new_file(filename, "rb")) == NULL)
-    lose_openssl_error("Could not open file");
+static PyObject *
+crl_object_pem_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(crl_object_pem_read_file);
+  return read_from_file_helper(crl_object_pem_read_helper, type, args);
+}
 
-  result = asymmetric_object_pem_read_private_helper(type, bio, pass);
+static char crl_object_der_read__doc__[] =
+  "Read a DER-encoded CRL object from a string.\n"
+  ;
 
- error:
-  BIO_free(bio);
-  return result;
+static PyObject *
+crl_object_der_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(crl_object_der_read);
+  return read_from_string_helper(crl_object_der_read_helper, type, args);
 }
 
-/*
- * Used to be only PEM format private keys had passphrases, but with PKCS #8
- * that's not really true anymore.  We may need to extend the API here to allow
- * passphrases for DER private keys as well.
- */
+static char crl_object_der_read_file__doc__[] =
+  "Read a DER-encoded CRL object from a file.\n"
+  ;
 
 static PyObject *
-asymmetric_object_der_read_private_helper(PyTypeObject *type, BIO *bio)
+crl_object_der_read_file(PyTypeObject *type, PyObject *args)
 {
-  asymmetric_object *self = NULL;
+  ENTERING(crl_object_der_read_file);
+  return read_from_file_helper(crl_object_der_read_helper, type, args);
+}
 
-  ENTERING(asymmetric_object_der_read_private_helper);
+static X509_EXTENSION *
+crl_object_extension_get_helper(crl_object *self, int nid)
+{
+  if (self != NULL && self->crl != NULL)
+    return X509_CRL_get_ext(self->crl, X509_CRL_get_ext_by_NID(self->crl, nid, -1));
+  else
+    return NULL;
+}
 
-  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
-    goto error;
+static PyObject *
+crl_object_extension_set_helper(crl_object *self, extension_wrapper ext)
+{
+  int ok = 0;
 
-  if (!d2i_PrivateKey_bio(bio, &self->pkey))
-    lose_openssl_error("Couldn't load private key");
+  if (ext.value == NULL)
+    goto error;
 
-  whack_ec_key_to_namedCurve(self->pkey);
+  if (!X509_CRL_add1_ext_i2d(self->crl, ext.nid, ext.value, ext.critical, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add extension to CRL");
 
-  return (PyObject *) self;
+  ok = 1;
 
  error:
-
-  Py_XDECREF(self);
-  return NULL;
+  ext.destructor(ext.value);
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
 }
 
-static char asymmetric_object_der_read_private__doc__[] =
-  "Read a DER-encoded private key from a string.\n"
-  ;
 
-static PyObject *
-asymmetric_object_der_read_private(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(asymmetric_object_der_read_private);
-  return read_from_string_helper(asymmetric_object_der_read_private_helper, type, args);
-}
 
-static char asymmetric_object_der_read_private_file__doc__[] =
-  "Read a DER-encoded private key from a file.\n"
+static char crl_object_get_version__doc__[] =
+  "Return the version number of this CRL.\n"
   ;
 
 static PyObject *
-asymmetric_object_der_read_private_file(PyTypeObject *type, PyObject *args)
+crl_object_get_version(crl_object *self)
 {
-  ENTERING(asymmetric_object_der_read_private_file);
-  return read_from_file_helper(asymmetric_object_der_read_private_helper, type, args);
+  ENTERING(crl_object_get_version);
+  return Py_BuildValue("l", X509_CRL_get_version(self->crl));
 }
 
+static char crl_object_set_version__doc__[] =
+  "Set the version number of this CRL.\n"
+  "\n"
+  "The \"version\" parameter should be a positive integer.\n"
+  ;
+
 static PyObject *
-asymmetric_object_pem_read_public_helper(PyTypeObject *type, BIO *bio)
+crl_object_set_version(crl_object *self, PyObject *args)
 {
-  asymmetric_object *self = NULL;
+  long version = 0;
 
-  ENTERING(asymmetric_object_pem_read_public_helper);
+  ENTERING(crl_object_set_version);
 
-  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "i", &version))
     goto error;
 
-  if (!PEM_read_bio_PUBKEY(bio, &self->pkey, NULL, NULL))
-    lose_openssl_error("Couldn't load public key");
-
-  whack_ec_key_to_namedCurve(self->pkey);
+  if (!X509_CRL_set_version(self->crl, version))
+    lose_no_memory();
 
-  return (PyObject *) self;
+  Py_RETURN_NONE;
 
  error:
-  Py_XDECREF(self);
   return NULL;
 }
 
+static char crl_object_get_issuer__doc__[] =
+  "Return issuer name of this CRL.\n"
+  "\n"
+  "See the \"getIssuer()\" method of the X509 class for more details.\n"
+  ;
+
 static PyObject *
-asymmetric_object_der_read_public_helper(PyTypeObject *type, BIO *bio)
+crl_object_get_issuer(crl_object *self, PyObject *args)
 {
-  asymmetric_object *self = NULL;
+  PyObject *result = NULL;
+  int format = OIDNAME_FORMAT;
 
-  ENTERING(asymmetric_object_der_read_public_helper);
+  ENTERING(crl_object_get_issuer);
 
-  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "|i", &format))
     goto error;
 
-  if (!d2i_PUBKEY_bio(bio, &self->pkey))
-    lose_openssl_error("Couldn't load public key");
-
-  whack_ec_key_to_namedCurve(self->pkey);
-
-  return (PyObject *) self;
-
- error:
+  result = x509_object_helper_get_name(X509_CRL_get_issuer(self->crl), format);
 
-  Py_XDECREF(self);
-  return NULL;
+ error:                         /* Fall through */
+  return result;
 }
 
-static char asymmetric_object_pem_read_public__doc__[] =
-  "Read a PEM-encoded public key from a string.\n"
+static char crl_object_set_issuer__doc__[] =
+  "Set this CRL's issuer name.\n"
+  "\n"
+  "See the \"setIssuer()\" method of the X509 class for details.\n"
   ;
 
 static PyObject *
-asymmetric_object_pem_read_public(PyTypeObject *type, PyObject *args)
+crl_object_set_issuer(crl_object *self, PyObject *args)
 {
-  ENTERING(asymmetric_object_pem_read_public);
-  return read_from_string_helper(asymmetric_object_pem_read_public_helper, type, args);
-}
+  PyObject *name_sequence = NULL;
+  X509_NAME *name = NULL;
 
-static char asymmetric_object_pem_read_public_file__doc__[] =
-  "Read a PEM-encoded public key from a file.\n"
-  ;
+  ENTERING(crl_object_set_issuer);
 
-static PyObject *
-asymmetric_object_pem_read_public_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(asymmetric_object_pem_read_public_file);
-  return read_from_file_helper(asymmetric_object_pem_read_public_helper, type, args);
-}
+  if (!PyArg_ParseTuple(args, "O", &name_sequence))
+    goto error;
 
-static char asymmetric_object_der_read_public__doc__[] =
-  "Read a DER-encoded public key from a string.\n"
-  ;
+  if (!PySequence_Check(name_sequence))
+    lose_type_error("Expected a sequence object");
 
-static PyObject *
-asymmetric_object_der_read_public(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(asymmetric_object_der_read_public);
-  return read_from_string_helper(asymmetric_object_der_read_public_helper, type, args);
+  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
+    goto error;
+
+  if (!X509_CRL_set_issuer_name(self->crl, name))
+    lose_openssl_error("Unable to set issuer name");
+
+  X509_NAME_free(name);
+
+  Py_RETURN_NONE;
+
+ error:
+  X509_NAME_free(name);
+  return NULL;
 }
 
-static char asymmetric_object_der_read_public_file__doc__[] =
-  "Read a DER-encoded public key from a file.\n"
+static char crl_object_get_issuer_hash__doc__[] =
+  "Return the OpenSSL \"name hash\" for this CRL's issuer name.\n"
   ;
 
 static PyObject *
-asymmetric_object_der_read_public_file(PyTypeObject *type, PyObject *args)
+crl_object_get_issuer_hash(crl_object *self)
 {
-  ENTERING(asymmetric_object_der_read_public_file);
-  return read_from_file_helper(asymmetric_object_der_read_public_helper, type, args);
+  ENTERING(crl_object_get_issuer_hash);
+  return Py_BuildValue("k", X509_NAME_hash(X509_CRL_get_issuer(self->crl)));
 }
 
-static char asymmetric_object_pem_write_private__doc__[] =
-  "Return the PEM encoding of an \"Asymmetric\" private key.\n"
-  "\n"
-  "This method takes an optional parameter \"passphrase\" which, if\n"
-  "specified, will be used to encrypt the private key with AES-256-CBC.\n"
+/*
+ * NB: OpenSSL is confused about the name of this field, probably for
+ * backwards compatability with some ancient mistake.  What RFC 5280
+ * calls "thisUpdate", OpenSSL calls "lastUpdate".
+ */
+
+static char crl_object_set_this_update__doc__[] =
+  "Set this CRL's \"thisUpdate\" value.\n"
   "\n"
-  "If you don't specify a passphrase, the key will not be encrypted.\n"
+  "The \"time\" parameter should be a datetime object.\n"
   ;
 
 static PyObject *
-asymmetric_object_pem_write_private(asymmetric_object *self, PyObject *args)
+crl_object_set_this_update (crl_object *self, PyObject *args)
 {
-  PyObject *result = NULL;
-  char *passphrase = NULL;
-  const EVP_CIPHER *evp_method = NULL;
-  BIO *bio = NULL;
+  PyObject *o = NULL;
+  ASN1_TIME *t = NULL;
 
-  ENTERING(asymmetric_object_pem_write_private);
+  ENTERING(crl_object_set_this_update);
 
-  if (!PyArg_ParseTuple(args, "|s", &passphrase))
+  if (!PyArg_ParseTuple(args, "O", &o))
     goto error;
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
-  if (passphrase)
-    evp_method = EVP_aes_256_cbc();
+  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
+    lose("Couldn't convert thisUpdate string");
 
-  if (!PEM_write_bio_PrivateKey(bio, self->pkey, evp_method, NULL, 0, NULL, passphrase))
-    lose_openssl_error("Unable to write key");
+  if (!X509_CRL_set_lastUpdate(self->crl, t)) /* sic */
+    lose("Couldn't set thisUpdate");
 
-  result = BIO_to_PyString_helper(bio);
+  ASN1_TIME_free(t);
+  Py_RETURN_NONE;
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+ error:
+  ASN1_TIME_free(t);
+  return NULL;
 }
 
-static char asymmetric_object_pem_write_public__doc__[] =
-  "Return the PEM encoding of an \"Asymmetric\" public key.\n"
+static char crl_object_get_this_update__doc__[] =
+  "Return this CRL's \"thisUpdate\" value as a datetime.\n"
   ;
 
 static PyObject *
-asymmetric_object_pem_write_public(asymmetric_object *self)
+crl_object_get_this_update (crl_object *self)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(asymmetric_object_pem_write_public);
-
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
-  if (!PEM_write_bio_PUBKEY(bio, self->pkey))
-    lose_openssl_error("Unable to write key");
-
-  result = BIO_to_PyString_helper(bio);
-
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+  ENTERING(crl_object_get_this_update);
+  return ASN1_TIME_to_Python(X509_CRL_get_lastUpdate(self->crl)); /* sic */
 }
 
-static char asymmetric_object_der_write_private__doc__[] =
-  "Return the DER encoding of an \"Asymmetric\" private key.\n"
+static char crl_object_set_next_update__doc__[] =
+  "Set this CRL's \"nextUpdate\" value.\n"
+  "\n"
+  "The \"time\" parameter should be a datetime object.\n"
   ;
 
 static PyObject *
-asymmetric_object_der_write_private(asymmetric_object *self)
+crl_object_set_next_update (crl_object *self, PyObject *args)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+  PyObject *o = NULL;
+  ASN1_TIME *t = NULL;
 
-  ENTERING(asymmetric_object_der_write_private);
+  ENTERING(crl_object_set_next_update);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  if (!PyArg_ParseTuple(args, "O", &o))
+    goto error;
 
-  if (!i2d_PrivateKey_bio(bio, self->pkey))
-    lose_openssl_error("Unable to write private key");
+  if ((t = Python_to_ASN1_TIME(o, 1)) == NULL)
+    lose("Couldn't parse nextUpdate string");
 
-  result = BIO_to_PyString_helper(bio);
+  if (!X509_CRL_set_nextUpdate(self->crl, t))
+    lose("Couldn't set nextUpdate");
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+  ASN1_TIME_free(t);
+  Py_RETURN_NONE;
+
+ error:
+  ASN1_TIME_free(t);
+  return NULL;
 }
 
-static char asymmetric_object_der_write_public__doc__[] =
-  "Return the DER encoding of an \"Asymmetric\" public key.\n"
+static char crl_object_get_next_update__doc__[] =
+  "Returns this CRL's \"nextUpdate\" value as a datetime.\n"
   ;
 
 static PyObject *
-asymmetric_object_der_write_public(asymmetric_object *self)
+crl_object_get_next_update (crl_object *self)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(asymmetric_object_der_write_public);
-
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
-  if (!i2d_PUBKEY_bio(bio, self->pkey))
-    lose_openssl_error("Unable to write public key");
-
-  result = BIO_to_PyString_helper(bio);
-
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+  ENTERING(crl_object_get_next_update);
+  return ASN1_TIME_to_Python(X509_CRL_get_nextUpdate(self->crl));
 }
 
-static char asymmetric_object_generate_rsa__doc__[] =
-  "Generate a new RSA keypair.\n"
+static char crl_object_add_revocations__doc__[] =
+  "This method adds a collection of revocations to this CRL.\n"
   "\n"
-  "Optional argument key_size is the desired key size, in bits;\n"
-  "if not specified, the default is 2048."
+  "The \"iterable\" parameter should be an iterable object which returns\n"
+  "two-element sequences.  The first element of each pair should be the\n"
+  "revoked serial number (an integer), the second element should be the\n"
+  "revocation date (a datetime object).\n"
   ;
 
 static PyObject *
-asymmetric_object_generate_rsa(PyTypeObject *type, PyObject *args, PyObject *kwds)
+crl_object_add_revocations(crl_object *self, PyObject *args)
 {
-  static char *kwlist[] = {"key_size", NULL};
-  asymmetric_object *self = NULL;
-  EVP_PKEY_CTX *ctx = NULL;
-  int key_size = 2048;
+  PyObject *iterable = NULL;
+  PyObject *iterator = NULL;
+  PyObject *item = NULL;
+  PyObject *fast = NULL;
+  X509_REVOKED *revoked = NULL;
+  ASN1_INTEGER *serial = NULL;
+  ASN1_TIME *date = NULL;
   int ok = 0;
 
-  ENTERING(asymmetric_object_generate_rsa);
+  ENTERING(crl_object_add_revocations);
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &key_size))
+  if (!PyArg_ParseTuple(args, "O", &iterable) ||
+      (iterator = PyObject_GetIter(iterable)) == NULL)
     goto error;
 
-  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
-    goto error;
+  while ((item = PyIter_Next(iterator)) != NULL) {
 
-  /*
-   * Explictly setting RSA_F4 would be tedious, as it requires messing
-   * about with bignums, and F4 is the default, so we leave it alone.
-   * In case this ever changes, the required sequence would be:
-   * BN_new(), BN_set_word(), EVP_PKEY_CTX_set_rsa_keygen_pubexp(),
-   * BN_free().
-   */
+    if ((fast = PySequence_Fast(item, "Revocation entry must be a sequence")) == NULL)
+      goto error;
 
-  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL)) == NULL ||
-      EVP_PKEY_keygen_init(ctx) <= 0 ||
-      EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, key_size) <= 0 ||
-      EVP_PKEY_keygen(ctx, &self->pkey) <= 0)
-    lose_openssl_error("Couldn't generate new RSA key");
+    if (PySequence_Fast_GET_SIZE(fast) != 2)
+      lose_type_error("Revocation entry must be two-element sequence");
 
-  ok = 1;
+    if ((serial = PyLong_to_ASN1_INTEGER(PySequence_Fast_GET_ITEM(fast, 0))) == NULL ||
+        (date = Python_to_ASN1_TIME(PySequence_Fast_GET_ITEM(fast, 1), 1)) == NULL)
+      goto error;
 
- error:
-  EVP_PKEY_CTX_free(ctx);
+    if ((revoked = X509_REVOKED_new()) == NULL ||
+        !X509_REVOKED_set_serialNumber(revoked, serial) ||
+        !X509_REVOKED_set_revocationDate(revoked, date))
+      lose_no_memory();
 
-  if (ok)
-    return (PyObject *) self;
+    ASN1_INTEGER_free(serial);
+    serial = NULL;
 
-  Py_XDECREF(self);
-  return NULL;
-}
+    ASN1_TIME_free(date);
+    date = NULL;
 
-static char asymmetric_object_generate_from_params__doc__[] =
-  "Generate a new keypair using an AsymmetricParams object.\n"
-  ;
+    if (!X509_CRL_add0_revoked(self->crl, revoked))
+      lose_no_memory();
 
-static PyObject *
-asymmetric_object_generate_from_params(PyTypeObject *type, PyObject *args)
-{
-  asymmetric_params_object *params = NULL;
-  asymmetric_object *self = NULL;
-  EVP_PKEY_CTX *ctx = NULL;
-  int ok = 0;
+    revoked = NULL;
+    Py_XDECREF(item);
+    Py_XDECREF(fast);
+    item = fast = NULL;
+  }
 
-  ENTERING(asymmetric_object_generate_from_params);
-
-  if (!PyArg_ParseTuple(args, "O!", &POW_AsymmetricParams_Type, &params))
-    goto error;
-
-  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
-    goto error;
-
-  if ((ctx = EVP_PKEY_CTX_new(params->pkey, NULL)) == NULL ||
-      EVP_PKEY_keygen_init(ctx) <= 0 ||
-      EVP_PKEY_keygen(ctx, &self->pkey) <= 0)
-    lose_openssl_error("Couldn't generate new key");
-
-  whack_ec_key_to_namedCurve(self->pkey);
+  if (!X509_CRL_sort(self->crl))
+    lose_openssl_error("Couldn't sort CRL");
 
   ok = 1;
 
  error:
-  EVP_PKEY_CTX_free(ctx);
+  Py_XDECREF(iterator);
+  Py_XDECREF(item);
+  Py_XDECREF(fast);
+  X509_REVOKED_free(revoked);
+  ASN1_INTEGER_free(serial);
+  ASN1_TIME_free(date);
 
   if (ok)
-    return (PyObject *) self;
-
-  Py_XDECREF(self);
-  return NULL;
+    Py_RETURN_NONE;
+  else
+    return NULL;
 }
 
-static char asymmetric_object_calculate_ski__doc__[] =
-  "Calculate SKI value for this key.\n"
+static char crl_object_get_revoked__doc__[] =
+  "Return a sequence of two-element tuples representing the sequence of\n"
+  "revoked certificates listed in this CRL.\n"
   "\n"
-  "The SKI is the SHA-1 hash of key's SubjectPublicKey value.\n"
+  "The first element of each pair is the serialNumber of the revoked\n"
+  "certificate, the second element is the revocationDate.\n"
   ;
 
 static PyObject *
-asymmetric_object_calculate_ski(asymmetric_object *self)
+crl_object_get_revoked(crl_object *self)
 {
+  STACK_OF(X509_REVOKED) *revoked = NULL;
+  X509_REVOKED *r = NULL;
   PyObject *result = NULL;
-  X509_PUBKEY *pubkey = NULL;
-  unsigned char digest[EVP_MAX_MD_SIZE];
-  unsigned digest_length;
-  const unsigned char *key_data = NULL;
-  int key_length;
-
-  ENTERING(asymmetric_object_calculate_ski);
+  PyObject *item = NULL;
+  PyObject *serial = NULL;
+  PyObject *date = NULL;
+  int i;
 
-  if (!X509_PUBKEY_set(&pubkey, self->pkey) ||
-      !X509_PUBKEY_get0_param(NULL, &key_data, &key_length, NULL, pubkey))
-    lose_openssl_error("Couldn't extract public key");
+  ENTERING(crl_object_get_revoked);
 
-  if (!EVP_Digest(key_data, key_length, digest, &digest_length, EVP_sha1(), NULL))
-    lose_openssl_error("Couldn't calculate SHA-1 digest of public key");
+  if ((revoked = X509_CRL_get_REVOKED(self->crl)) == NULL)
+    lose("Inexplicable NULL revocation list pointer");
 
-  result = PyString_FromStringAndSize((char *) digest, digest_length);
+  if ((result = PyTuple_New(sk_X509_REVOKED_num(revoked))) == NULL)
+    goto error;
 
- error:
-  X509_PUBKEY_free(pubkey);
-  return result;
-}
+  for (i = 0; i < sk_X509_REVOKED_num(revoked); i++) {
+    r = sk_X509_REVOKED_value(revoked, i);
 
-static struct PyMethodDef asymmetric_object_methods[] = {
-  Define_Method(pemWritePrivate,          asymmetric_object_pem_write_private,          METH_VARARGS),
-  Define_Method(pemWritePublic,           asymmetric_object_pem_write_public,           METH_NOARGS),
-  Define_Method(derWritePrivate,          asymmetric_object_der_write_private,          METH_NOARGS),
-  Define_Method(derWritePublic,           asymmetric_object_der_write_public,           METH_NOARGS),
-  Define_Method(calculateSKI,             asymmetric_object_calculate_ski,              METH_NOARGS),
-  Define_Class_Method(pemReadPublic,      asymmetric_object_pem_read_public,            METH_VARARGS),
-  Define_Class_Method(pemReadPublicFile,  asymmetric_object_pem_read_public_file,       METH_VARARGS),
-  Define_Class_Method(derReadPublic,      asymmetric_object_der_read_public,            METH_VARARGS),
-  Define_Class_Method(derReadPublicFile,  asymmetric_object_der_read_public_file,       METH_VARARGS),
-  Define_Class_Method(pemReadPrivate,     asymmetric_object_pem_read_private,           METH_VARARGS),
-  Define_Class_Method(pemReadPrivateFile, asymmetric_object_pem_read_private_file,      METH_VARARGS),
-  Define_Class_Method(derReadPrivate,     asymmetric_object_der_read_private,           METH_VARARGS),
-  Define_Class_Method(derReadPrivateFile, asymmetric_object_der_read_private_file,      METH_VARARGS),
-  Define_Class_Method(generateRSA,        asymmetric_object_generate_rsa,               METH_KEYWORDS),
-  Define_Class_Method(generateFromParams, asymmetric_object_generate_from_params,       METH_VARARGS),
-  {NULL}
-};
+    if ((serial = ASN1_INTEGER_to_PyLong(r->serialNumber)) == NULL ||
+        (date = ASN1_TIME_to_Python(r->revocationDate)) == NULL ||
+        (item = Py_BuildValue("(NN)", serial, date)) == NULL)
+      goto error;
 
-static char POW_Asymmetric_Type__doc__[] =
-  "Container for OpenSSL's EVP_PKEY asymmetric key classes.\n"
-  ;
+    PyTuple_SET_ITEM(result, i, item);
+    item = serial = date = NULL;
+  }
 
-static PyTypeObject POW_Asymmetric_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                     /* ob_size */
-  "rpki.POW.Asymmetric",                 /* tp_name */
-  sizeof(asymmetric_object),             /* tp_basicsize */
-  0,                                     /* tp_itemsize */
-  (destructor)asymmetric_object_dealloc, /* tp_dealloc */
-  0,                                     /* tp_print */
-  0,                                     /* tp_getattr */
-  0,                                     /* tp_setattr */
-  0,                                     /* tp_compare */
-  0,                                     /* tp_repr */
-  0,                                     /* tp_as_number */
-  0,                                     /* tp_as_sequence */
-  0,                                     /* tp_as_mapping */
-  0,                                     /* tp_hash */
-  0,                                     /* tp_call */
-  0,                                     /* tp_str */
-  0,                                     /* tp_getattro */
-  0,                                     /* tp_setattro */
-  0,                                     /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_Asymmetric_Type__doc__,            /* tp_doc */
-  0,                                     /* tp_traverse */
-  0,                                     /* tp_clear */
-  0,                                     /* tp_richcompare */
-  0,                                     /* tp_weaklistoffset */
-  0,                                     /* tp_iter */
-  0,                                     /* tp_iternext */
-  asymmetric_object_methods,             /* tp_methods */
-  0,                                     /* tp_members */
-  0,                                     /* tp_getset */
-  0,                                     /* tp_base */
-  0,                                     /* tp_dict */
-  0,                                     /* tp_descr_get */
-  0,                                     /* tp_descr_set */
-  0,                                     /* tp_dictoffset */
-  (initproc) asymmetric_object_init,     /* tp_init */
-  0,                                     /* tp_alloc */
-  asymmetric_object_new,                 /* tp_new */
-};
+  return result;
 
-
+ error:
+  Py_XDECREF(result);
+  Py_XDECREF(item);
+  Py_XDECREF(serial);
+  Py_XDECREF(date);
+  return NULL;
+}
 
-/*
- * AsymmetricParams object.
- */
+static char crl_object_is_revoked__doc__[] =
+  "Check whether a particular certificate has been revoked.\n"
+  ;
 
 static PyObject *
-asymmetric_params_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+crl_object_is_revoked(crl_object *self, PyObject *args)
 {
-  asymmetric_params_object *self = NULL;
+  x509_object *x = NULL;
 
-  ENTERING(asymmetric_params_object_new);
+  if (!PyArg_ParseTuple(args, "O!", &POW_X509_Type, &x))
+    return NULL;
 
-  if ((self = (asymmetric_params_object *) type->tp_alloc(type, 0)) == NULL)
-    goto error;
+  return PyBool_FromLong(X509_CRL_get0_by_cert(self->crl, NULL, x->x509));
+}
 
-  self->pkey = NULL;
+static char crl_object_clear_extensions__doc__[] =
+  "Clear all extensions attached to this CRL.\n"
+  ;
 
-  return (PyObject *) self;
+static PyObject *
+crl_object_clear_extensions(crl_object *self)
+{
+  X509_EXTENSION *ext;
 
- error:
+  ENTERING(crl_object_clear_extensions);
 
-  Py_XDECREF(self);
-  return NULL;
+  while ((ext = X509_CRL_delete_ext(self->crl, 0)) != NULL)
+    X509_EXTENSION_free(ext);
+
+  Py_RETURN_NONE;
 }
 
-static int
-asymmetric_params_object_init(asymmetric_params_object *self, PyObject *args, PyObject *kwds)
+static char crl_object_sign__doc__[] =
+  "Sign this CRL with a private key.\n"
+  "\n"
+  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
+  "containing a private key.\n"
+  "\n"
+  "The optional \"digest\" parameter indicates which digest to compute and\n"
+  "sign, and should be one of the following:\n"
+  "\n"
+  "* SHA1_DIGEST\n"
+  "* SHA256_DIGEST\n"
+  "* SHA384_DIGEST\n"
+  "* SHA512_DIGEST\n"
+  "\n"
+  "The default digest algorithm is SHA-256.\n"
+  ;
+
+static PyObject *
+crl_object_sign(crl_object *self, PyObject *args)
 {
-  static char *kwlist[] = {NULL};
+  asymmetric_object *asym;
+  int digest_type = SHA256_DIGEST;
+  const EVP_MD *digest_method = NULL;
+  int ok;
 
-  ENTERING(asymmetric_params_object_init);
+  ENTERING(crl_object_sign);
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "", kwlist))
+  if (!PyArg_ParseTuple(args, "O!|i", &POW_Asymmetric_Type, &asym, &digest_type))
     goto error;
 
-  return 0;
+  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
+    lose("Unsupported digest algorithm");
+
+  Py_BEGIN_ALLOW_THREADS
+  ok = X509_CRL_sign(self->crl, asym->pkey, digest_method);
+  Py_END_ALLOW_THREADS
+
+  if (!ok)
+    lose_openssl_error("Couldn't sign CRL");
+
+  Py_RETURN_NONE;
 
  error:
-  return -1;
+  return NULL;
 }
 
-static void
-asymmetric_params_object_dealloc(asymmetric_params_object *self)
-{
-  ENTERING(asymmetric_params_object_dealloc);
-  EVP_PKEY_free(self->pkey);
-  self->ob_type->tp_free((PyObject*) self);
-}
+static char crl_object_verify__doc__[] =
+  "Verify this CRL's signature against its issuer.\n"
+  ;
 
 static PyObject *
-asymmetric_params_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+crl_object_verify(crl_object *self, PyObject *args)
 {
-  asymmetric_params_object *self = NULL;
+  x509_object *issuer;
+  EVP_PKEY *pkey = NULL;
+  int ok;
 
-  ENTERING(asymmetric_params_object_pem_read_helper);
+  ENTERING(crl_object_verify);
 
-  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "O!", &POW_X509_Type, &issuer))
     goto error;
 
-  if (!PEM_read_bio_Parameters(bio, &self->pkey))
-    lose_openssl_error("Couldn't load PEM encoded key parameters");
+  pkey = X509_get_pubkey(issuer->x509);
 
-  return (PyObject *) self;
+  Py_BEGIN_ALLOW_THREADS
+  ok = X509_CRL_verify(self->crl, pkey);
+  Py_END_ALLOW_THREADS
 
- error:
+  if (!ok)
+    lose_validation_error("X509_CRL_verify() raised an exception");
 
-  Py_XDECREF(self);
+  EVP_PKEY_free(pkey);
+  Py_RETURN_NONE;
+
+ error:
+  EVP_PKEY_free(pkey);
   return NULL;
 }
 
-static char asymmetric_params_object_pem_read__doc__[] =
-  "Read PEM-encoded key parameters from a string.\n"
+static char crl_object_check_rpki_conformance__doc__[] =
+  "Check this CRL for conformance to the RPKI profile.\n"
   ;
 
 static PyObject *
-asymmetric_params_object_pem_read(PyTypeObject *type, PyObject *args)
+crl_object_check_rpki_conformance(crl_object *self, PyObject *args, PyObject *kwds)
 {
-  ENTERING(asymmetric_params_object_pem_read);
-  return read_from_string_helper(asymmetric_params_object_pem_read_helper, type, args);
+  static char *kwlist[] = {"issuer", "status", NULL};
+  x509_object *issuer = NULL;
+  PyObject *status = Py_None;
+
+  ENTERING(crl_object_check_rpki_conformance);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O!", kwlist, &POW_X509_Type, &issuer, &PySet_Type, &status))
+    goto error;
+
+  if (!check_crl(self->crl, issuer->x509, status))
+    goto error;
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
 }
 
-static char asymmetric_params_object_pem_read_file__doc__[] =
-  "Read PEM-encoded key parameters from a file.\n"
+static char crl_object_pem_write__doc__[] =
+  "Return the PEM encoding of this CRL, as a string.\n"
   ;
 
 static PyObject *
-asymmetric_params_object_pem_read_file(PyTypeObject *type, PyObject *args)
+crl_object_pem_write(crl_object *self)
 {
-  ENTERING(asymmetric_params_object_pem_read_file);
-  return read_from_file_helper(asymmetric_params_object_pem_read_helper, type, args);
+  PyObject *result = NULL;
+  BIO *bio = NULL;
+
+  ENTERING(crl_object_pem_write);
+
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
+
+  if (!PEM_write_bio_X509_CRL(bio, self->crl))
+    lose_openssl_error("Unable to write CRL");
+
+  result = BIO_to_PyString_helper(bio);
+
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
 }
 
-static char asymmetric_params_object_pem_write__doc__[] =
-  "Return the PEM encoding of this set of key parameters, as a string.\n"
+static char crl_object_der_write__doc__[] =
+  "Return the DER encoding of this CRL, as a string.\n"
   ;
 
 static PyObject *
-asymmetric_params_object_pem_write(asymmetric_params_object *self)
+crl_object_der_write(crl_object *self)
 {
   PyObject *result = NULL;
   BIO *bio = NULL;
 
-  ENTERING(asymmetric_params_object_pem_write);
+  ENTERING(crl_object_der_write);
 
   if ((bio = BIO_new(BIO_s_mem())) == NULL)
     lose_no_memory();
 
-  if (PEM_write_bio_Parameters(bio, self->pkey) <= 0)
-    lose_openssl_error("Unable to write key parameters");
+  if (!i2d_X509_CRL_bio(bio, self->crl))
+    lose_openssl_error("Unable to write CRL");
 
   result = BIO_to_PyString_helper(bio);
 
@@ -6644,156 +7563,142 @@ asymmetric_params_object_pem_write(asymmetric_params_object *self)
   return result;
 }
 
-static char asymmetric_params_object_generate_ec__doc__[] =
-  "Generate a new set of EC parameters.\n"
-  "\n"
-  "Optional argument curve is a numeric code representing the curve to use;\n"
-  "if not specified, the default is P-256."
+static char crl_object_get_aki__doc__[] =
+  EXTENSION_GET_AKI__DOC__
   ;
 
 static PyObject *
-asymmetric_params_object_generate_ec(PyTypeObject *type, PyObject *args, PyObject *kwds)
+crl_object_get_aki(crl_object *self)
 {
-  static char *kwlist[] = {"curve", NULL};
-  asymmetric_params_object *self = NULL;
-  EVP_PKEY_CTX *ctx = NULL;
-  int curve = NID_X9_62_prime256v1;
-  int ok = 0;
-
-  ENTERING(asymmetric_params_object_generate_ec);
+  return extension_get_aki(crl_object_extension_get_helper(self, NID_authority_key_identifier));
+}
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &curve))
-    goto error;
+static char crl_object_set_aki__doc__[] =
+  EXTENSION_SET_AKI__DOC__
+  ;
 
-  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
-    goto error;
+static PyObject *
+crl_object_set_aki(crl_object *self, PyObject *args)
+{
+  return crl_object_extension_set_helper(self, extension_set_aki(args));
+}
 
-  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL)) == NULL ||
-      EVP_PKEY_paramgen_init(ctx) <= 0 ||
-      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, curve) <= 0 ||
-      EVP_PKEY_paramgen(ctx, &self->pkey) <= 0)
-    lose_openssl_error("Couldn't generate key parameters");
+static char crl_object_get_crl_number__doc__[] =
+  "Return the CRL Number extension value from this CRL, an integer.\n"
+  ;
 
-  ok = 1;
+static PyObject *
+crl_object_get_crl_number(crl_object *self)
+{
+  ASN1_INTEGER *ext = X509_CRL_get_ext_d2i(self->crl, NID_crl_number, NULL, NULL);
+  PyObject *result = NULL;
 
- error:
-  EVP_PKEY_CTX_free(ctx);
+  ENTERING(crl_object_get_crl_number);
 
-  if (ok)
-    return (PyObject *) self;
+  if (ext == NULL)
+    Py_RETURN_NONE;
 
-  Py_XDECREF(self);
-  return NULL;
+  result = Py_BuildValue("N", ASN1_INTEGER_to_PyLong(ext));
+  ASN1_INTEGER_free(ext);
+  return result;
 }
 
-static char asymmetric_params_object_generate_dh__doc__[] =
-  "Generate a new set of DH parameters.\n"
-  "\n"
-  "Optional argument prime_length is length of the DH prime parameter\n"
-  "to use, in bits; if not specified, the default is 2048 bits.\n"
+static char crl_object_set_crl_number__doc__[] =
+  "Set the CRL Number extension value in this CRL.\n"
   "\n"
-  "Be warned that generating DH parameters with a 2048-bit prime may\n"
-  "take a ridiculously long time.\n"
+  "The \"number\" parameter should be an integer.\n"
   ;
 
 static PyObject *
-asymmetric_params_object_generate_dh(PyTypeObject *type, PyObject *args, PyObject *kwds)
+crl_object_set_crl_number(crl_object *self, PyObject *args)
 {
-  static char *kwlist[] = {"prime_length", NULL};
-  asymmetric_params_object *self = NULL;
-  EVP_PKEY_CTX *ctx = NULL;
-  int prime_length = 2048;
-  int ok = 0;
-
-  ENTERING(asymmetric_params_object_generate_dh);
+  ASN1_INTEGER *ext = NULL;
+  PyObject *crl_number = NULL;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &prime_length))
-    goto error;
+  ENTERING(crl_object_set_crl_number);
 
-  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "O", &crl_number) ||
+      (ext = PyLong_to_ASN1_INTEGER(crl_number)) == NULL)
     goto error;
 
-  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_DH, NULL)) == NULL ||
-      EVP_PKEY_paramgen_init(ctx) <= 0 ||
-      EVP_PKEY_CTX_set_dh_paramgen_prime_len(ctx, prime_length) <= 0 ||
-      EVP_PKEY_paramgen(ctx, &self->pkey) <= 0)
-    lose_openssl_error("Couldn't generate key parameters");
+  if (!X509_CRL_add1_ext_i2d(self->crl, NID_crl_number, ext, 0, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add CRL Number extension to CRL");
 
-  ok = 1;
+  ASN1_INTEGER_free(ext);
+  Py_RETURN_NONE;
 
  error:
-  EVP_PKEY_CTX_free(ctx);
-
-  if (ok)
-    return (PyObject *) self;
-
-  Py_XDECREF(self);
+  ASN1_INTEGER_free(ext);
   return NULL;
 }
 
-static char asymmetric_params_object_generate_dsa__doc__[] =
-  "Generate a new set of DSA parameters.\n"
-  "\n"
-  "Optional argument key_length is the length of the key to generate, in bits;\n"
-  "if not specified, the default is 2048 bits."
+static char crl_object_pprint__doc__[] =
+  "Return a pretty-printed rendition of this CRL.\n"
   ;
 
 static PyObject *
-asymmetric_params_object_generate_dsa(PyTypeObject *type, PyObject *args, PyObject *kwds)
+crl_object_pprint(crl_object *self)
 {
-  static char *kwlist[] = {"key_length", NULL};
-  asymmetric_params_object *self = NULL;
-  EVP_PKEY_CTX *ctx = NULL;
-  int key_length = 2048;
-  int ok = 0;
-
-  ENTERING(asymmetric_params_object_generate_dsa);
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &key_length))
-    goto error;
-
-  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
-    goto error;
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_DSA, NULL)) == NULL ||
-      EVP_PKEY_paramgen_init(ctx) <= 0 ||
-      EVP_PKEY_CTX_set_dsa_paramgen_bits(ctx, key_length) <= 0 ||
-      EVP_PKEY_paramgen(ctx, &self->pkey) <= 0)
-    lose_openssl_error("Couldn't generate key parameters");
+  ENTERING(crl_object_pprint);
 
-  ok = 1;
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
- error:
-  EVP_PKEY_CTX_free(ctx);
+  if (!X509_CRL_print(bio, self->crl))
+    lose_openssl_error("Unable to pretty-print CRL");
 
-  if (ok)
-    return (PyObject *) self;
+  result = BIO_to_PyString_helper(bio);
 
-  Py_XDECREF(self);
-  return NULL;
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
 }
 
-static struct PyMethodDef asymmetric_params_object_methods[] = {
-  Define_Method(pemWrite,               asymmetric_params_object_pem_write,             METH_NOARGS),
-  Define_Class_Method(pemRead,          asymmetric_params_object_pem_read,              METH_VARARGS),
-  Define_Class_Method(pemReadFile,      asymmetric_params_object_pem_read_file,         METH_VARARGS),
-  Define_Class_Method(generateEC,       asymmetric_params_object_generate_ec,		METH_KEYWORDS),
-  Define_Class_Method(generateDH,	asymmetric_params_object_generate_dh,           METH_KEYWORDS),
-  Define_Class_Method(generateDSA,	asymmetric_params_object_generate_dsa,          METH_KEYWORDS),
+static struct PyMethodDef crl_object_methods[] = {
+  Define_Method(sign,                   crl_object_sign,                        METH_VARARGS),
+  Define_Method(verify,                 crl_object_verify,                      METH_VARARGS),
+  Define_Method(checkRPKIConformance,   crl_object_check_rpki_conformance,      METH_KEYWORDS),
+  Define_Method(getVersion,             crl_object_get_version,                 METH_NOARGS),
+  Define_Method(setVersion,             crl_object_set_version,                 METH_VARARGS),
+  Define_Method(getIssuer,              crl_object_get_issuer,                  METH_VARARGS),
+  Define_Method(setIssuer,              crl_object_set_issuer,                  METH_VARARGS),
+  Define_Method(getThisUpdate,          crl_object_get_this_update,     	METH_NOARGS),
+  Define_Method(setThisUpdate,          crl_object_set_this_update,             METH_VARARGS),
+  Define_Method(getNextUpdate,          crl_object_get_next_update,             METH_NOARGS),
+  Define_Method(setNextUpdate,          crl_object_set_next_update,             METH_VARARGS),
+  Define_Method(getRevoked,             crl_object_get_revoked,                 METH_NOARGS),
+  Define_Method(isRevoked,              crl_object_is_revoked,                  METH_VARARGS),
+  Define_Method(addRevocations,         crl_object_add_revocations,             METH_VARARGS),
+  Define_Method(clearExtensions,        crl_object_clear_extensions,            METH_NOARGS),
+  Define_Method(pemWrite,               crl_object_pem_write,                   METH_NOARGS),
+  Define_Method(derWrite,               crl_object_der_write,                   METH_NOARGS),
+  Define_Method(pprint,                 crl_object_pprint,                      METH_NOARGS),
+  Define_Method(getAKI,                 crl_object_get_aki,                     METH_NOARGS),
+  Define_Method(setAKI,                 crl_object_set_aki,                     METH_VARARGS),
+  Define_Method(getCRLNumber,           crl_object_get_crl_number,              METH_NOARGS),
+  Define_Method(setCRLNumber,           crl_object_set_crl_number,              METH_VARARGS),
+  Define_Method(getIssuerHash,          crl_object_get_issuer_hash,             METH_NOARGS),
+  Define_Class_Method(pemRead,          crl_object_pem_read,                    METH_VARARGS),
+  Define_Class_Method(pemReadFile,      crl_object_pem_read_file,               METH_VARARGS),
+  Define_Class_Method(derRead,          crl_object_der_read,                    METH_VARARGS),
+  Define_Class_Method(derReadFile,      crl_object_der_read_file,               METH_VARARGS),
   {NULL}
 };
 
-static char POW_AsymmetricParams_Type__doc__[] =
-  "Container for OpenSSL's EVP_PKEY asymmetric key parameter classes.\n"
+static char POW_CRL_Type__doc__[] =
+  "Container for OpenSSL's X509 CRL management facilities.\n"
   ;
 
-static PyTypeObject POW_AsymmetricParams_Type = {
+static PyTypeObject POW_CRL_Type = {
   PyObject_HEAD_INIT(0)
   0,                                     /* ob_size */
-  "rpki.POW.AsymmetricParams",           /* tp_name */
-  sizeof(asymmetric_params_object),      /* tp_basicsize */
+  "rpki.POW.CRL",                        /* tp_name */
+  sizeof(crl_object),                    /* tp_basicsize */
   0,                                     /* tp_itemsize */
-  (destructor)asymmetric_params_object_dealloc, /* tp_dealloc */
+  (destructor)crl_object_dealloc,        /* tp_dealloc */
   0,                                     /* tp_print */
   0,                                     /* tp_getattr */
   0,                                     /* tp_setattr */
@@ -6809,14 +7714,14 @@ static PyTypeObject POW_AsymmetricParams_Type = {
   0,                                     /* tp_setattro */
   0,                                     /* tp_as_buffer */
   Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_AsymmetricParams_Type__doc__,      /* tp_doc */
+  POW_CRL_Type__doc__,                   /* tp_doc */
   0,                                     /* tp_traverse */
   0,                                     /* tp_clear */
   0,                                     /* tp_richcompare */
   0,                                     /* tp_weaklistoffset */
   0,                                     /* tp_iter */
   0,                                     /* tp_iternext */
-  asymmetric_params_object_methods,      /* tp_methods */
+  crl_object_methods,                    /* tp_methods */
   0,                                     /* tp_members */
   0,                                     /* tp_getset */
   0,                                     /* tp_base */
@@ -6824,53 +7729,51 @@ static PyTypeObject POW_AsymmetricParams_Type = {
   0,                                     /* tp_descr_get */
   0,                                     /* tp_descr_set */
   0,                                     /* tp_dictoffset */
-  (initproc) asymmetric_params_object_init, /* tp_init */
+  0,                                     /* tp_init */
   0,                                     /* tp_alloc */
-  asymmetric_params_object_new,          /* tp_new */
+  crl_object_new,                        /* tp_new */
 };
 
 
 
 /*
- * Digest object.
+ * Asymmetric object.
  */
 
 static PyObject *
-digest_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+asymmetric_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
 {
-  digest_object *self = NULL;
+  asymmetric_object *self = NULL;
 
-  ENTERING(digest_object_new);
+  ENTERING(asymmetric_object_new);
 
-  if ((self = (digest_object *) type->tp_alloc(type, 0)) == NULL)
+  if ((self = (asymmetric_object *) type->tp_alloc(type, 0)) == NULL)
     goto error;
 
-  self->digest_type = 0;
+  self->pkey = NULL;
 
   return (PyObject *) self;
 
  error:
+
+  Py_XDECREF(self);
   return NULL;
 }
 
 static int
-digest_object_init(digest_object *self, PyObject *args, PyObject *kwds)
+asymmetric_object_init(asymmetric_object *self, PyObject *args, PyObject *kwds)
 {
-  static char *kwlist[] = {"digest_type", NULL};
-  const EVP_MD *digest_method = NULL;
-  int digest_type = 0;
+  static char *kwlist[] = {NULL};
 
-  ENTERING(digest_object_init);
+  ENTERING(asymmetric_object_init);
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "i", kwlist, &digest_type))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "", kwlist))
     goto error;
 
-  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
-    lose("Unsupported digest algorithm");
-
-  self->digest_type = digest_type;
-  if (!EVP_DigestInit(&self->digest_ctx, digest_method))
-    lose_openssl_error("Couldn't initialize digest");
+  /*
+   * We used to take arguments to generate an RSA key, but that's
+   * now in the .generateRSA() class method.
+   */
 
   return 0;
 
@@ -6879,222 +7782,184 @@ digest_object_init(digest_object *self, PyObject *args, PyObject *kwds)
 }
 
 static void
-digest_object_dealloc(digest_object *self)
+asymmetric_object_dealloc(asymmetric_object *self)
 {
-  ENTERING(digest_object_dealloc);
-  EVP_MD_CTX_cleanup(&self->digest_ctx);
+  ENTERING(asymmetric_object_dealloc);
+  EVP_PKEY_free(self->pkey);
   self->ob_type->tp_free((PyObject*) self);
 }
 
-static char digest_object_update__doc__[] =
-  "Add data to this digest.\n"
-  "\n"
-  "the \"data\" parameter should be a string containing the data to be added.\n"
-  ;
-
 static PyObject *
-digest_object_update(digest_object *self, PyObject *args)
+asymmetric_object_pem_read_private_helper(PyTypeObject *type, BIO *bio, char *pass)
 {
-  char *data = NULL;
-  Py_ssize_t len = 0;
+  asymmetric_object *self = NULL;
 
-  ENTERING(digest_object_update);
+  ENTERING(asymmetric_object_pem_read_private_helper);
 
-  if (!PyArg_ParseTuple(args, "s#", &data, &len))
+  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
     goto error;
 
-  if (!EVP_DigestUpdate(&self->digest_ctx, data, len))
-    lose_openssl_error("EVP_DigestUpdate() failed");
+  if (!PEM_read_bio_PrivateKey(bio, &self->pkey, NULL, pass))
+    lose_openssl_error("Couldn't load private key");
 
-  Py_RETURN_NONE;
+  whack_ec_key_to_namedCurve(self->pkey);
+
+  return (PyObject *) self;
 
  error:
+  Py_XDECREF(self);
   return NULL;
 }
 
-static char digest_object_copy__doc__[] =
-  "Return a copy of this Digest object.\n"
+/*
+ * We can't use the generic read_from_*_helper() functions here
+ * because of optional the PEM password, so we just code the two PEM
+ * read cases for private keys directly.  Other than the passphrase,
+ * code is pretty much the same as the generic functions.
+ *
+ * It turns out that OpenSSL is moving away from its old raw PKCS #1.5
+ * private key format in favor of PKCS #8.  This makes sense, but it
+ * leaves us with a minor mess to track.  Many OpenSSL functions that
+ * originally expected PKCS #1.5 now also accept PKCS #8, so there's
+ * no tearing hurry about this, but at some point we might want to
+ * switch to writing PKCS #8.  It looks like this would be relatively
+ * straightforward: see functions i2d_PKCS8PrivateKey_bio() and
+ * PEM_write_bio_PKCS8PrivateKey(), and note that PKCS #8 supports
+ * encrypted private keys in DER format, so the DER methods should
+ * take a passphrase argument as the PEM methods do.
+ */
+
+static char asymmetric_object_pem_read_private__doc__[] =
+  "Read a PEM-encoded private key from a string.\n"
+  "\n"
+  "Optional second argument is a passphrase for the key.\n"
   ;
 
 static PyObject *
-digest_object_copy(digest_object *self)
+asymmetric_object_pem_read_private(PyTypeObject *type, PyObject *args)
 {
-  digest_object *new = NULL;
+  PyObject *result = NULL;
+  char *pass = NULL;
+  Py_buffer src;
+  BIO *bio = NULL;
 
-  ENTERING(digest_object_copy);
+  ENTERING(asymmetric_object_pem_read_private);
 
-  if ((new = (digest_object *) digest_object_new(&POW_Digest_Type, NULL, NULL)) == NULL)
+  src.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*|s", &src, &pass))
     goto error;
 
-  new->digest_type = self->digest_type;
-  if (!EVP_MD_CTX_copy(&new->digest_ctx, &self->digest_ctx))
-    lose_openssl_error("Couldn't copy digest");
+  if ((bio = BIO_new_mem_buf(src.buf, src.len)) == NULL)
+    lose_no_memory();
 
-  return (PyObject*) new;
+  result = asymmetric_object_pem_read_private_helper(type, bio, pass);
 
  error:
-
-  Py_XDECREF(new);
-  return NULL;
+  BIO_free(bio);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return result;
 }
 
-static char digest_object_digest__doc__[] =
-  "Return the digest of all the data which this Digest object has processed.\n"
+static char asymmetric_object_pem_read_private_file__doc__[] =
+  "Read a PEM-encoded private key from a file.\n"
   "\n"
-  "This method can be called at any time and will not effect the internal\n"
-  "state of the Digest object.\n"
+  "Optional second argument is a passphrase for the key.\n"
   ;
 
-/*
- * Do we really need to do this copy?  Nice general operation, but does
- * anything we're doing for RPKI care?
- */
-
 static PyObject *
-digest_object_digest(digest_object *self)
+asymmetric_object_pem_read_private_file(PyTypeObject *type, PyObject *args)
 {
-  unsigned char digest_text[EVP_MAX_MD_SIZE];
-  unsigned digest_len = 0;
+  const char *filename = NULL;
   PyObject *result = NULL;
-  EVP_MD_CTX ctx;
+  char *pass = NULL;
+  BIO *bio = NULL;
 
-  ENTERING(digest_object_digest);
+  ENTERING(asymmetric_object_pem_read_private_file);
 
-  if (!EVP_MD_CTX_copy(&ctx, &self->digest_ctx))
-    lose_openssl_error("Couldn't copy digest");
+  if (!PyArg_ParseTuple(args, "s|s", &filename, &pass))
+    goto error;
 
-  EVP_DigestFinal(&ctx, digest_text, &digest_len);
+  if ((bio = BIO_new_file(filename, "rb")) == NULL)
+    lose_openssl_error("Could not open file");
 
-  result = Py_BuildValue("s#", digest_text, (Py_ssize_t) digest_len);
+  result = asymmetric_object_pem_read_private_helper(type, bio, pass);
 
  error:
-  EVP_MD_CTX_cleanup(&ctx);
+  BIO_free(bio);
   return result;
 }
 
-static struct PyMethodDef digest_object_methods[] = {
-  Define_Method(update,         digest_object_update,   METH_VARARGS),
-  Define_Method(digest,         digest_object_digest,   METH_NOARGS),
-  Define_Method(copy,           digest_object_copy,     METH_NOARGS),
-  {NULL}
-};
-
-static char POW_Digest_Type__doc__[] =
-  "This class provides access to the digest functionality of OpenSSL.\n"
-  "It emulates the digest modules in the Python Standard Library, but\n"
-  "does not currently support the \"hexdigest\" method.\n"
-  "\n"
-  "The constructor takes one parameter, the kind of Digest object to create.\n"
-  "This should be one of the following:\n"
-  "\n"
-  "  * SHA1_DIGEST\n"
-  "  * SHA256_DIGEST\n"
-  "  * SHA384_DIGEST\n"
-  "  * SHA512_DIGEST\n"
-  ;
-
-static PyTypeObject POW_Digest_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                  /* ob_size */
-  "rpki.POW.Digest",                  /* tp_name */
-  sizeof(digest_object),              /* tp_basicsize */
-  0,                                  /* tp_itemsize */
-  (destructor)digest_object_dealloc,  /* tp_dealloc */
-  0,                                  /* tp_print */
-  0,                                  /* tp_getattr */
-  0,                                  /* tp_setattr */
-  0,                                  /* tp_compare */
-  0,                                  /* tp_repr */
-  0,                                  /* tp_as_number */
-  0,                                  /* tp_as_sequence */
-  0,                                  /* tp_as_mapping */
-  0,                                  /* tp_hash */
-  0,                                  /* tp_call */
-  0,                                  /* tp_str */
-  0,                                  /* tp_getattro */
-  0,                                  /* tp_setattro */
-  0,                                  /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_Digest_Type__doc__,             /* tp_doc */
-  0,                                  /* tp_traverse */
-  0,                                  /* tp_clear */
-  0,                                  /* tp_richcompare */
-  0,                                  /* tp_weaklistoffset */
-  0,                                  /* tp_iter */
-  0,                                  /* tp_iternext */
-  digest_object_methods,              /* tp_methods */
-  0,                                  /* tp_members */
-  0,                                  /* tp_getset */
-  0,                                  /* tp_base */
-  0,                                  /* tp_dict */
-  0,                                  /* tp_descr_get */
-  0,                                  /* tp_descr_set */
-  0,                                  /* tp_dictoffset */
-  (initproc) digest_object_init,      /* tp_init */
-  0,                                  /* tp_alloc */
-  digest_object_new,                  /* tp_new */
-};
-
-
-
 /*
- * CMS object.
+ * Used to be only PEM format private keys had passphrases, but with PKCS #8
+ * that's not really true anymore.  We may need to extend the API here to allow
+ * passphrases for DER private keys as well.
  */
 
 static PyObject *
-cms_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
-{
-  cms_object *self;
-
-  ENTERING(cms_object_new);
-
-  if ((self = (cms_object *) type->tp_alloc(type, 0)) != NULL)
-    return (PyObject *) self;
-
-  Py_XDECREF(self);
-  return NULL;
-}
-
-static void
-cms_object_dealloc(cms_object *self)
-{
-  ENTERING(cms_object_dealloc);
-  CMS_ContentInfo_free(self->cms);
-  self->ob_type->tp_free((PyObject*) self);
-}
-
-static PyObject *
-cms_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+asymmetric_object_der_read_private_helper(PyTypeObject *type, BIO *bio)
 {
-  cms_object *self;
+  asymmetric_object *self = NULL;
+  const unsigned char *der;
+  long len = 0;
 
-  ENTERING(cms_object_pem_read_helper);
+  ENTERING(asymmetric_object_der_read_private_helper);
 
-  if ((self = (cms_object *) type->tp_new(type, NULL, NULL)) == NULL)
+  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
     goto error;
 
-  if (!PEM_read_bio_CMS(bio, &self->cms, NULL, NULL))
-    lose_openssl_error("Couldn't load PEM encoded CMS message");
+  if ((der = mem_bio_der(bio, &len)) != NULL
+      ? !d2i_AutoPrivateKey(&self->pkey, &der, len)
+      : !d2i_PrivateKey_bio(bio, &self->pkey))
+    lose_openssl_error("Couldn't load private key");
+
+  whack_ec_key_to_namedCurve(self->pkey);
 
   return (PyObject *) self;
 
  error:
+
   Py_XDECREF(self);
   return NULL;
 }
 
+static char asymmetric_object_der_read_private__doc__[] =
+  "Read a DER-encoded private key from a string.\n"
+  ;
+
 static PyObject *
-cms_object_der_read_helper(PyTypeObject *type, BIO *bio)
+asymmetric_object_der_read_private(PyTypeObject *type, PyObject *args)
 {
-  cms_object *self;
+  ENTERING(asymmetric_object_der_read_private);
+  return read_from_string_helper(asymmetric_object_der_read_private_helper, type, args);
+}
 
-  ENTERING(cms_object_der_read_helper);
+static char asymmetric_object_der_read_private_file__doc__[] =
+  "Read a DER-encoded private key from a file.\n"
+  ;
 
-  if ((self = (cms_object *) type->tp_new(type, NULL, NULL)) == NULL)
+static PyObject *
+asymmetric_object_der_read_private_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(asymmetric_object_der_read_private_file);
+  return read_from_file_helper(asymmetric_object_der_read_private_helper, type, args);
+}
+
+static PyObject *
+asymmetric_object_pem_read_public_helper(PyTypeObject *type, BIO *bio)
+{
+  asymmetric_object *self = NULL;
+
+  ENTERING(asymmetric_object_pem_read_public_helper);
+
+  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
     goto error;
 
-  if (!d2i_CMS_bio(bio, &self->cms))
-    lose_openssl_error("Couldn't load DER encoded CMS message");
+  if (!PEM_read_bio_PUBKEY(bio, &self->pkey, NULL, NULL))
+    lose_openssl_error("Couldn't load public key");
+
+  whack_ec_key_to_namedCurve(self->pkey);
 
   return (PyObject *) self;
 
@@ -7103,67 +7968,107 @@ cms_object_der_read_helper(PyTypeObject *type, BIO *bio)
   return NULL;
 }
 
-static char cms_object_pem_read__doc__[] =
-  "Read a PEM-encoded CMS object from a string.\n"
+static PyObject *
+asymmetric_object_der_read_public_helper(PyTypeObject *type, BIO *bio)
+{
+  asymmetric_object *self = NULL;
+  const unsigned char *der;
+  long len = 0;
+
+  ENTERING(asymmetric_object_der_read_public_helper);
+
+  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
+    goto error;
+
+  if ((der = mem_bio_der(bio, &len)) != NULL
+      ? !d2i_PUBKEY(&self->pkey, &der, len)
+      : !d2i_PUBKEY_bio(bio, &self->pkey))
+    lose_openssl_error("Couldn't load public key");
+
+  whack_ec_key_to_namedCurve(self->pkey);
+
+  return (PyObject *) self;
+
+ error:
+
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static char asymmetric_object_pem_read_public__doc__[] =
+  "Read a PEM-encoded public key from a string.\n"
   ;
 
 static PyObject *
-cms_object_pem_read(PyTypeObject *type, PyObject *args)
+asymmetric_object_pem_read_public(PyTypeObject *type, PyObject *args)
 {
-  ENTERING(cms_object_pem_read);
-  return read_from_string_helper(cms_object_pem_read_helper, type, args);
+  ENTERING(asymmetric_object_pem_read_public);
+  return read_from_string_helper(asymmetric_object_pem_read_public_helper, type, args);
 }
 
-static char cms_object_pem_read_file__doc__[] =
-  "Read a PEM-encoded CMS object from a file.\n"
+static char asymmetric_object_pem_read_public_file__doc__[] =
+  "Read a PEM-encoded public key from a file.\n"
   ;
 
 static PyObject *
-cms_object_pem_read_file(PyTypeObject *type, PyObject *args)
+asymmetric_object_pem_read_public_file(PyTypeObject *type, PyObject *args)
 {
-  ENTERING(cms_object_pem_read_file);
-  return read_from_file_helper(cms_object_pem_read_helper, type, args);
+  ENTERING(asymmetric_object_pem_read_public_file);
+  return read_from_file_helper(asymmetric_object_pem_read_public_helper, type, args);
 }
 
-static char cms_object_der_read__doc__[] =
-  "Read a DER-encoded CMS object from a string.\n"
+static char asymmetric_object_der_read_public__doc__[] =
+  "Read a DER-encoded public key from a string.\n"
   ;
 
 static PyObject *
-cms_object_der_read(PyTypeObject *type, PyObject *args)
+asymmetric_object_der_read_public(PyTypeObject *type, PyObject *args)
 {
-  ENTERING(cms_object_der_read);
-  return read_from_string_helper(cms_object_der_read_helper, type, args);
+  ENTERING(asymmetric_object_der_read_public);
+  return read_from_string_helper(asymmetric_object_der_read_public_helper, type, args);
 }
 
-static char cms_object_der_read_file__doc__[] =
-  "Read a DER-encoded CMS object from a file.\n"
+static char asymmetric_object_der_read_public_file__doc__[] =
+  "Read a DER-encoded public key from a file.\n"
   ;
 
 static PyObject *
-cms_object_der_read_file(PyTypeObject *type, PyObject *args)
+asymmetric_object_der_read_public_file(PyTypeObject *type, PyObject *args)
 {
-  ENTERING(cms_object_der_read_file);
-  return read_from_file_helper(cms_object_der_read_helper, type, args);
+  ENTERING(asymmetric_object_der_read_public_file);
+  return read_from_file_helper(asymmetric_object_der_read_public_helper, type, args);
 }
 
-static char cms_object_pem_write__doc__[] =
-  "Return the DER encoding of this CMS message.\n"
+static char asymmetric_object_pem_write_private__doc__[] =
+  "Return the PEM encoding of an \"Asymmetric\" private key.\n"
+  "\n"
+  "This method takes an optional parameter \"passphrase\" which, if\n"
+  "specified, will be used to encrypt the private key with AES-256-CBC.\n"
+  "\n"
+  "If you don't specify a passphrase, the key will not be encrypted.\n"
   ;
 
 static PyObject *
-cms_object_pem_write(cms_object *self)
+asymmetric_object_pem_write_private(asymmetric_object *self, PyObject *args)
 {
   PyObject *result = NULL;
+  char *passphrase = NULL;
+  const EVP_CIPHER *evp_method = NULL;
   BIO *bio = NULL;
 
-  ENTERING(cms_object_pem_write);
+  ENTERING(asymmetric_object_pem_write_private);
+
+  if (!PyArg_ParseTuple(args, "|s", &passphrase))
+    goto error;
 
   if ((bio = BIO_new(BIO_s_mem())) == NULL)
     lose_no_memory();
 
-  if (!PEM_write_bio_CMS(bio, self->cms))
-    lose_openssl_error("Unable to write CMS object");
+  if (passphrase)
+    evp_method = EVP_aes_256_cbc();
+
+  if (!PEM_write_bio_PrivateKey(bio, self->pkey, evp_method, NULL, 0, NULL, passphrase))
+    lose_openssl_error("Unable to write key");
 
   result = BIO_to_PyString_helper(bio);
 
@@ -7172,23 +8077,23 @@ cms_object_pem_write(cms_object *self)
   return result;
 }
 
-static char cms_object_der_write__doc__[] =
-  "Return the DER encoding of this CMS message.\n"
+static char asymmetric_object_pem_write_public__doc__[] =
+  "Return the PEM encoding of an \"Asymmetric\" public key.\n"
   ;
 
 static PyObject *
-cms_object_der_write(cms_object *self)
+asymmetric_object_pem_write_public(asymmetric_object *self)
 {
   PyObject *result = NULL;
   BIO *bio = NULL;
 
-  ENTERING(cms_object_der_write);
+  ENTERING(asymmetric_object_pem_write_public);
 
   if ((bio = BIO_new(BIO_s_mem())) == NULL)
     lose_no_memory();
 
-  if (!i2d_CMS_bio(bio, self->cms))
-    lose_openssl_error("Unable to write CMS object");
+  if (!PEM_write_bio_PUBKEY(bio, self->pkey))
+    lose_openssl_error("Unable to write key");
 
   result = BIO_to_PyString_helper(bio);
 
@@ -7197,1179 +8102,1271 @@ cms_object_der_write(cms_object *self)
   return result;
 }
 
-static int
-cms_object_sign_helper(cms_object *self,
-                       BIO *bio,
-                       x509_object *signcert,
-                       asymmetric_object *signkey,
-                       PyObject *x509_iterable,
-                       PyObject *crl_iterable,
-                       char *oid,
-                       unsigned flags)                       
-{
-  STACK_OF(X509) *x509_stack = NULL;
-  ASN1_OBJECT *econtent_type = NULL;
-  CMS_ContentInfo *cms = NULL;
-  PyObject *iterator = NULL;
-  PyObject *item = NULL;
-  int ok = 0;
-
-  ENTERING(cms_object_sign_helper);
+static char asymmetric_object_der_write_private__doc__[] =
+  "Return the DER encoding of an \"Asymmetric\" private key.\n"
+  ;
 
-  assert_no_unhandled_openssl_errors();
+static PyObject *
+asymmetric_object_der_write_private(asymmetric_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  flags &= CMS_NOCERTS | CMS_NOATTR;
-  flags |= CMS_BINARY | CMS_NOSMIMECAP | CMS_PARTIAL | CMS_USE_KEYID;
+  ENTERING(asymmetric_object_der_write_private);
 
-  if ((x509_stack = x509_helper_iterable_to_stack(x509_iterable)) == NULL)
-    goto error;
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  assert_no_unhandled_openssl_errors();
+  if (!i2d_PrivateKey_bio(bio, self->pkey))
+    lose_openssl_error("Unable to write private key");
 
-  if (oid && (econtent_type = OBJ_txt2obj(oid, 1)) == NULL)
-    lose_openssl_error("Couldn't parse OID");
+  result = BIO_to_PyString_helper(bio);
 
-  assert_no_unhandled_openssl_errors();
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
 
-  if ((cms = CMS_sign(NULL, NULL, x509_stack, bio, flags)) == NULL)
-    lose_openssl_error("Couldn't create CMS message");
+static char asymmetric_object_der_write_public__doc__[] =
+  "Return the DER encoding of an \"Asymmetric\" public key.\n"
+  ;
 
-  assert_no_unhandled_openssl_errors();
+static PyObject *
+asymmetric_object_der_write_public(asymmetric_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  if (econtent_type)
-    CMS_set1_eContentType(cms, econtent_type);
+  ENTERING(asymmetric_object_der_write_public);
 
-  assert_no_unhandled_openssl_errors();
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  if (!CMS_add1_signer(cms, signcert->x509, signkey->pkey, EVP_sha256(), flags))
-    lose_openssl_error("Couldn't sign CMS message");
+  if (!i2d_PUBKEY_bio(bio, self->pkey))
+    lose_openssl_error("Unable to write public key");
 
-  assert_no_unhandled_openssl_errors();
+  result = BIO_to_PyString_helper(bio);
 
-  if (crl_iterable != Py_None) {
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
 
-    if ((iterator = PyObject_GetIter(crl_iterable)) == NULL)
-      goto error;
+static char asymmetric_object_generate_rsa__doc__[] =
+  "Generate a new RSA keypair.\n"
+  "\n"
+  "Optional argument key_size is the desired key size, in bits;\n"
+  "if not specified, the default is 2048."
+  ;
 
-    while ((item = PyIter_Next(iterator)) != NULL) {
+static PyObject *
+asymmetric_object_generate_rsa(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"key_size", NULL};
+  asymmetric_object *self = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  int key_size = 2048;
+  int ok = 0;
 
-      if (!POW_CRL_Check(item))
-        lose_type_error("Expected a CRL object");
+  ENTERING(asymmetric_object_generate_rsa);
 
-      if (!CMS_add1_crl(cms, ((crl_object *) item)->crl))
-        lose_openssl_error("Couldn't add CRL to CMS");
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &key_size))
+    goto error;
 
-      assert_no_unhandled_openssl_errors();
+  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-      Py_XDECREF(item);
-      item = NULL;
-    }
-  }
+  /*
+   * Explictly setting RSA_F4 would be tedious, as it requires messing
+   * about with bignums, and F4 is the default, so we leave it alone.
+   * In case this ever changes, the required sequence would be:
+   * BN_new(), BN_set_word(), EVP_PKEY_CTX_set_rsa_keygen_pubexp(),
+   * BN_free().
+   */
 
-  if (!CMS_final(cms, bio, NULL, flags))
-    lose_openssl_error("Couldn't finalize CMS signatures");
+  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, NULL)) == NULL ||
+      EVP_PKEY_keygen_init(ctx) <= 0 ||
+      EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, key_size) <= 0)
+    lose_openssl_error("Couldn't generate new RSA key");
 
-  assert_no_unhandled_openssl_errors();
+  Py_BEGIN_ALLOW_THREADS
+  ok = EVP_PKEY_keygen(ctx, &self->pkey) > 0;
+  Py_END_ALLOW_THREADS
 
-  CMS_ContentInfo_free(self->cms);
-  self->cms = cms;
-  cms = NULL;
+  if (!ok)
+    lose_openssl_error("Couldn't generate new RSA key");
 
-  ok = 1;
+ error:
+  EVP_PKEY_CTX_free(ctx);
 
- error:                          /* fall through */
-  CMS_ContentInfo_free(cms);
-  sk_X509_free(x509_stack);
-  ASN1_OBJECT_free(econtent_type);
-  Py_XDECREF(iterator);
-  Py_XDECREF(item);
+  if (ok)
+    return (PyObject *) self;
 
-  return ok;
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static char cms_object_sign__doc__[] =
-  "Sign this CMS message message with a private key.\n"
-  "\n"
-  "The \"signcert\" parameter should be the certificate against which the\n"
-  "message will eventually be verified, an X509 object.\n"
-  "\n"
-  "The \"key\" parameter should be the private key with which to sign the\n"
-  "message, an Asymmetric object.\n"
-  "\n"
-  "The \"data\" parameter should be the message to be signed, a string.\n"
-  "\n"
-  "The optional \"certs\" parameter should be an iterable supplying X509 objects\n"
-  "to be included in the signed message.\n"
-  "\n"
-  "The optional \"crls\" parameter should be an iterable supplying CRL objects\n"
-  "to be included in the signed message.\n"
-  "\n"
-  "The optional \"eContentType\" parameter should be an Object Identifier\n"
-  "to use as the eContentType value in the signed message.\n"
-  "\n"
-  "The optional \"flags\" parameters should be an integer holding a bitmask,\n"
-  "and can include the following flags:\n"
-  "\n"
-  "  * CMS_NOCERTS\n"
-  "  * CMS_NOATTR\n"
+static char asymmetric_object_generate_from_params__doc__[] =
+  "Generate a new keypair using an AsymmetricParams object.\n"
   ;
 
 static PyObject *
-cms_object_sign(cms_object *self, PyObject *args)
+asymmetric_object_generate_from_params(PyTypeObject *type, PyObject *args)
 {
-  asymmetric_object *signkey = NULL;
-  x509_object *signcert = NULL;
-  PyObject *x509_iterable = Py_None;
-  PyObject *crl_iterable = Py_None;
-  char *buf = NULL, *oid = NULL;
-  Py_ssize_t len;
-  unsigned flags = 0;
-  BIO *bio = NULL;
+  asymmetric_params_object *params = NULL;
+  asymmetric_object *self = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
   int ok = 0;
 
-  ENTERING(cms_object_sign);
+  ENTERING(asymmetric_object_generate_from_params);
 
-  if (!PyArg_ParseTuple(args, "O!O!s#|OOsI",
-                        &POW_X509_Type, &signcert,
-                        &POW_Asymmetric_Type, &signkey,
-                        &buf, &len,
-                        &x509_iterable,
-                        &crl_iterable,
-                        &oid,
-                        &flags))
+  if (!PyArg_ParseTuple(args, "O!", &POW_AsymmetricParams_Type, &params))
     goto error;
 
-  assert_no_unhandled_openssl_errors();
-
-  if ((bio = BIO_new_mem_buf(buf, len)) == NULL)
-    lose_no_memory();
+  if ((self = (asymmetric_object *) asymmetric_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-  assert_no_unhandled_openssl_errors();
+  if ((ctx = EVP_PKEY_CTX_new(params->pkey, NULL)) == NULL ||
+      EVP_PKEY_keygen_init(ctx) <= 0)
+    lose_openssl_error("Couldn't generate new key");
 
-  if (!cms_object_sign_helper(self, bio, signcert, signkey,
-                              x509_iterable, crl_iterable, oid, flags))
-    lose_openssl_error("Couldn't sign CMS object");
+  Py_BEGIN_ALLOW_THREADS
+  ok = EVP_PKEY_keygen(ctx, &self->pkey) > 0;
+  Py_END_ALLOW_THREADS
 
-  assert_no_unhandled_openssl_errors();
+  if (!ok)
+    lose_openssl_error("Couldn't generate new key");
 
-  ok = 1;
+  whack_ec_key_to_namedCurve(self->pkey);
 
  error:
-  BIO_free(bio);
+  EVP_PKEY_CTX_free(ctx);
 
   if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+    return (PyObject *) self;
+
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static BIO *
-cms_object_extract_without_verifying_helper(cms_object *self)
-{
-  const unsigned flags =
-    CMS_NOCRL | CMS_NO_SIGNER_CERT_VERIFY | CMS_NO_ATTR_VERIFY | CMS_NO_CONTENT_VERIFY;
+static char asymmetric_object_calculate_ski__doc__[] =
+  "Calculate SKI value for this key.\n"
+  "\n"
+  "The SKI is the SHA-1 hash of key's SubjectPublicKey value.\n"
+  ;
 
-  BIO *bio = NULL;
+static PyObject *
+asymmetric_object_calculate_ski(asymmetric_object *self)
+{
+  PyObject *result = NULL;
+  X509_PUBKEY *pubkey = NULL;
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned digest_length;
+  const unsigned char *key_data = NULL;
+  int key_length;
 
-  ENTERING(cms_object_extract_without_verifying_helper);
+  ENTERING(asymmetric_object_calculate_ski);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  if (!X509_PUBKEY_set(&pubkey, self->pkey) ||
+      !X509_PUBKEY_get0_param(NULL, &key_data, &key_length, NULL, pubkey))
+    lose_openssl_error("Couldn't extract public key");
 
-  if (CMS_verify(self->cms, NULL, NULL, NULL, bio, flags) <= 0)
-    lose_openssl_error("Couldn't parse CMS message");
+  if (!EVP_Digest(key_data, key_length, digest, &digest_length, EVP_sha1(), NULL))
+    lose_openssl_error("Couldn't calculate SHA-1 digest of public key");
 
-  return bio;
+  result = PyString_FromStringAndSize((char *) digest, digest_length);
 
  error:
-  BIO_free(bio);
-  return NULL;
+  X509_PUBKEY_free(pubkey);
+  return result;
 }
 
+static struct PyMethodDef asymmetric_object_methods[] = {
+  Define_Method(pemWritePrivate,          asymmetric_object_pem_write_private,          METH_VARARGS),
+  Define_Method(pemWritePublic,           asymmetric_object_pem_write_public,           METH_NOARGS),
+  Define_Method(derWritePrivate,          asymmetric_object_der_write_private,          METH_NOARGS),
+  Define_Method(derWritePublic,           asymmetric_object_der_write_public,           METH_NOARGS),
+  Define_Method(calculateSKI,             asymmetric_object_calculate_ski,              METH_NOARGS),
+  Define_Class_Method(pemReadPublic,      asymmetric_object_pem_read_public,            METH_VARARGS),
+  Define_Class_Method(pemReadPublicFile,  asymmetric_object_pem_read_public_file,       METH_VARARGS),
+  Define_Class_Method(derReadPublic,      asymmetric_object_der_read_public,            METH_VARARGS),
+  Define_Class_Method(derReadPublicFile,  asymmetric_object_der_read_public_file,       METH_VARARGS),
+  Define_Class_Method(pemReadPrivate,     asymmetric_object_pem_read_private,           METH_VARARGS),
+  Define_Class_Method(pemReadPrivateFile, asymmetric_object_pem_read_private_file,      METH_VARARGS),
+  Define_Class_Method(derReadPrivate,     asymmetric_object_der_read_private,           METH_VARARGS),
+  Define_Class_Method(derReadPrivateFile, asymmetric_object_der_read_private_file,      METH_VARARGS),
+  Define_Class_Method(generateRSA,        asymmetric_object_generate_rsa,               METH_KEYWORDS),
+  Define_Class_Method(generateFromParams, asymmetric_object_generate_from_params,       METH_VARARGS),
+  {NULL}
+};
 
-#define CMS_OBJECT_VERIFY_HELPER__DOC__                                         \
-  "\n"                                                                          \
-  "The optional \"certs\" parameter is a set of certificates to search\n"       \
-  "for the signer's certificate.\n"                                             \
-  "\n"                                                                          \
-  "The optional \"flags\" parameter is an integer of bit flags,\n"              \
-  "containing zero or more of the following:\n"                                 \
-  "\n"                                                                          \
-  "  * CMS_NOINTERN\n"                                                          \
-  "  * CMS_NOCRL\n"                                                             \
-  "  * CMS_NO_SIGNER_CERT_VERIFY\n"                                             \
-  "  * CMS_NO_ATTR_VERIFY\n"                                                    \
-  "  * CMS_NO_CONTENT_VERIFY\n"                                                 \
-  "\n"                                                                          \
-  "Note that this method does NOT verify X.509 certificates, it just\n"         \
-  "verifies the CMS signature.  Use certificate verification functions\n"       \
-  "to verify certificates."
-
-#warning Should we really allow the full range of flags here, or constrain to just the useful cases?
+static char POW_Asymmetric_Type__doc__[] =
+  "Container for OpenSSL's EVP_PKEY asymmetric key classes.\n"
+  ;
 
-static BIO *
-cms_object_verify_helper(cms_object *self, PyObject *args, PyObject *kwds)
-{
-  static char *kwlist[] = {"certs", "flags", NULL};
-  PyObject *certs_iterable = Py_None;
-  STACK_OF(X509) *certs_stack = NULL;
-  unsigned flags = 0, ok = 0;
-  BIO *bio = NULL;
+static PyTypeObject POW_Asymmetric_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                     /* ob_size */
+  "rpki.POW.Asymmetric",                 /* tp_name */
+  sizeof(asymmetric_object),             /* tp_basicsize */
+  0,                                     /* tp_itemsize */
+  (destructor)asymmetric_object_dealloc, /* tp_dealloc */
+  0,                                     /* tp_print */
+  0,                                     /* tp_getattr */
+  0,                                     /* tp_setattr */
+  0,                                     /* tp_compare */
+  0,                                     /* tp_repr */
+  0,                                     /* tp_as_number */
+  0,                                     /* tp_as_sequence */
+  0,                                     /* tp_as_mapping */
+  0,                                     /* tp_hash */
+  0,                                     /* tp_call */
+  0,                                     /* tp_str */
+  0,                                     /* tp_getattro */
+  0,                                     /* tp_setattro */
+  0,                                     /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_Asymmetric_Type__doc__,            /* tp_doc */
+  0,                                     /* tp_traverse */
+  0,                                     /* tp_clear */
+  0,                                     /* tp_richcompare */
+  0,                                     /* tp_weaklistoffset */
+  0,                                     /* tp_iter */
+  0,                                     /* tp_iternext */
+  asymmetric_object_methods,             /* tp_methods */
+  0,                                     /* tp_members */
+  0,                                     /* tp_getset */
+  0,                                     /* tp_base */
+  0,                                     /* tp_dict */
+  0,                                     /* tp_descr_get */
+  0,                                     /* tp_descr_set */
+  0,                                     /* tp_dictoffset */
+  (initproc) asymmetric_object_init,     /* tp_init */
+  0,                                     /* tp_alloc */
+  asymmetric_object_new,                 /* tp_new */
+};
 
-  const unsigned flag_mask =
-    CMS_NOINTERN | CMS_NOCRL | CMS_NO_SIGNER_CERT_VERIFY |
-    CMS_NO_ATTR_VERIFY | CMS_NO_CONTENT_VERIFY;
+
 
-  ENTERING(cms_object_verify_helper);
+/*
+ * AsymmetricParams object.
+ */
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OI", kwlist, &certs_iterable, &flags))
-    goto error;
+static PyObject *
+asymmetric_params_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+{
+  asymmetric_params_object *self = NULL;
 
-  if ((flags & ~flag_mask) != 0)
-    lose_value_error("Bad CMS_verify() flags");
+  ENTERING(asymmetric_params_object_new);
 
-  flags |= CMS_NO_SIGNER_CERT_VERIFY;
+  if ((self = (asymmetric_params_object *) type->tp_alloc(type, 0)) == NULL)
+    goto error;
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  self->pkey = NULL;
 
-  assert_no_unhandled_openssl_errors();
+  return (PyObject *) self;
 
-  if (certs_iterable != Py_None &&
-      (certs_stack = x509_helper_iterable_to_stack(certs_iterable)) == NULL)
-    goto error;
+ error:
 
-  assert_no_unhandled_openssl_errors();
+  Py_XDECREF(self);
+  return NULL;
+}
 
-  if (CMS_verify(self->cms, certs_stack, NULL, NULL, bio, flags) <= 0)
-    lose_openssl_error("Couldn't verify CMS message");
+static int
+asymmetric_params_object_init(asymmetric_params_object *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {NULL};
 
-  assert_no_unhandled_openssl_errors();
+  ENTERING(asymmetric_params_object_init);
 
-  ok = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "", kwlist))
+    goto error;
 
- error:                          /* fall through */
-  sk_X509_free(certs_stack);
+  return 0;
 
-  if (ok)
-    return bio;
+ error:
+  return -1;
+}
 
-  BIO_free(bio);
-  return NULL;
+static void
+asymmetric_params_object_dealloc(asymmetric_params_object *self)
+{
+  ENTERING(asymmetric_params_object_dealloc);
+  EVP_PKEY_free(self->pkey);
+  self->ob_type->tp_free((PyObject*) self);
 }
 
-static char cms_object_verify__doc__[] =
-  "Verify this CMS message against a trusted certificate store.\n"
-  "\n"
-  CMS_OBJECT_VERIFY_HELPER__DOC__
-  "\n"
-  "Return value is the decoded CMS content, as a Python string.\n"
-  ;
-
 static PyObject *
-cms_object_verify(cms_object *self, PyObject *args, PyObject *kwds)
+asymmetric_params_object_pem_read_helper(PyTypeObject *type, BIO *bio)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+  asymmetric_params_object *self = NULL;
 
-  ENTERING(cms_object_verify);
+  ENTERING(asymmetric_params_object_pem_read_helper);
 
-  if ((bio = cms_object_verify_helper(self, args, kwds)) != NULL)
-    result = BIO_to_PyString_helper(bio);
+  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-  BIO_free(bio);
-  return result;
+  if (!PEM_read_bio_Parameters(bio, &self->pkey))
+    lose_openssl_error("Couldn't load PEM encoded key parameters");
+
+  return (PyObject *) self;
+
+ error:
+
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static char cms_object_extract_without_verifying__doc__[] =
-  "Extract content from a CMS object without attempting CMS verification.\n"
-  "\n"
-  "NEVER USE THIS METHOD ON AN UNVERIFIED CMS OBJECT!\n"
+static char asymmetric_params_object_pem_read__doc__[] =
+  "Read PEM-encoded key parameters from a string.\n"
   ;
 
 static PyObject *
-cms_object_extract_without_verifying(cms_object *self)
+asymmetric_params_object_pem_read(PyTypeObject *type, PyObject *args)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
-
-  ENTERING(cms_object_extract_without_verifying);
-
-  if ((bio = cms_object_extract_without_verifying_helper(self)) != NULL)
-    result = BIO_to_PyString_helper(bio);
-
-  BIO_free(bio);
-  return result;
+  ENTERING(asymmetric_params_object_pem_read);
+  return read_from_string_helper(asymmetric_params_object_pem_read_helper, type, args);
 }
 
-static char cms_object_check_rpki_conformance__doc__[] =
-  "Check this CMS message for conformance to the RPKI profile.\n"
+static char asymmetric_params_object_pem_read_file__doc__[] =
+  "Read PEM-encoded key parameters from a file.\n"
   ;
 
 static PyObject *
-cms_object_check_rpki_conformance(cms_object *self, PyObject *args, PyObject *kwds)
+asymmetric_params_object_pem_read_file(PyTypeObject *type, PyObject *args)
 {
-  static char *kwlist[] = {"status", NULL};
-  PyObject *status = Py_None;
-
-  ENTERING(cms_object_check_rpki_conformance);
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PySet_Type, &status))
-    goto error;
-
-  if (!check_cms(self->cms, status))
-    goto error;
-
-  Py_RETURN_NONE;
-
- error:
-  return NULL;
+  ENTERING(asymmetric_params_object_pem_read_file);
+  return read_from_file_helper(asymmetric_params_object_pem_read_helper, type, args);
 }
 
-static char cms_object_eContentType__doc__[] =
-  "Return the eContentType OID of this CMS message.\n"
+static char asymmetric_params_object_pem_write__doc__[] =
+  "Return the PEM encoding of this set of key parameters, as a string.\n"
   ;
 
 static PyObject *
-cms_object_eContentType(cms_object *self)
+asymmetric_params_object_pem_write(asymmetric_params_object *self)
 {
-  const ASN1_OBJECT *oid = NULL;
   PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  ENTERING(cms_object_eContentType);
+  ENTERING(asymmetric_params_object_pem_write);
 
-  if ((oid = CMS_get0_eContentType(self->cms)) == NULL)
-    lose_openssl_error("Couldn't extract eContentType from CMS message");
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  assert_no_unhandled_openssl_errors();
+  if (PEM_write_bio_Parameters(bio, self->pkey) <= 0)
+    lose_openssl_error("Unable to write key parameters");
 
-  result = ASN1_OBJECT_to_PyString(oid);
+  result = BIO_to_PyString_helper(bio);
 
- error:
+ error:                         /* Fall through */
+  BIO_free(bio);
   return result;
 }
 
-static char cms_object_signingTime__doc__[] =
-  "Return the signingTime of this CMS message.\n"
+static char asymmetric_params_object_generate_ec__doc__[] =
+  "Generate a new set of EC parameters.\n"
+  "\n"
+  "Optional argument curve is a numeric code representing the curve to use;\n"
+  "if not specified, the default is P-256."
   ;
 
 static PyObject *
-cms_object_signingTime(cms_object *self)
+asymmetric_params_object_generate_ec(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-  PyObject *result = NULL;
-  STACK_OF(CMS_SignerInfo) *sis = NULL;
-  CMS_SignerInfo *si = NULL;
-  X509_ATTRIBUTE *xa = NULL;
-  ASN1_TYPE *so = NULL;
-  int i;
-
-  ENTERING(cms_object_signingTime);
-
-  if ((sis = CMS_get0_SignerInfos(self->cms)) == NULL)
-    lose_openssl_error("Couldn't extract signerInfos from CMS message[1]");
-
-  if (sk_CMS_SignerInfo_num(sis) != 1)
-    lose_openssl_error("Couldn't extract signerInfos from CMS message[2]");
+  static char *kwlist[] = {"curve", NULL};
+  asymmetric_params_object *self = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  int curve = NID_X9_62_prime256v1;
+  int ok = 0;
 
-  si = sk_CMS_SignerInfo_value(sis, 0);
+  ENTERING(asymmetric_params_object_generate_ec);
 
-  if ((i = CMS_signed_get_attr_by_NID(si, NID_pkcs9_signingTime, -1)) < 0)
-    lose_openssl_error("Couldn't extract signerInfos from CMS message[3]");
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &curve))
+    goto error;
 
-  if ((xa = CMS_signed_get_attr(si, i)) == NULL)
-    lose_openssl_error("Couldn't extract signerInfos from CMS message[4]");
+  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-  if (xa->single)
-    lose("Couldn't extract signerInfos from CMS message[5]");
+  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL)) == NULL ||
+      EVP_PKEY_paramgen_init(ctx) <= 0 ||
+      EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, curve) <= 0 ||
+      EVP_PKEY_paramgen(ctx, &self->pkey) <= 0)
+    lose_openssl_error("Couldn't generate key parameters");
 
-  if (X509_ATTRIBUTE_count(xa) != 1)
-    lose("Couldn't extract signerInfos from CMS message[6]");
+  ok = 1;
 
-  if ((so = X509_ATTRIBUTE_get0_type(xa, 0)) == NULL)
-    lose("Couldn't extract signerInfos from CMS message[7]");
+ error:
+  EVP_PKEY_CTX_free(ctx);
 
-  switch (so->type) {
-  case V_ASN1_UTCTIME:
-    result = ASN1_TIME_to_Python(so->value.utctime);
-    break;
-  case V_ASN1_GENERALIZEDTIME:
-    result = ASN1_TIME_to_Python(so->value.generalizedtime);
-    break;
-  default:
-    lose("Couldn't extract signerInfos from CMS message[8]");
-  }
+  if (ok)
+    return (PyObject *) self;
 
- error:
-  return result;
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static char cms_object_pprint__doc__[] =
-  "Return a pretty-printed representation of this CMS message.\n"
+static char asymmetric_params_object_generate_dh__doc__[] =
+  "Generate a new set of DH parameters.\n"
+  "\n"
+  "Optional argument prime_length is length of the DH prime parameter\n"
+  "to use, in bits; if not specified, the default is 2048 bits.\n"
+  "\n"
+  "Be warned that generating DH parameters with a 2048-bit prime may\n"
+  "take a ridiculously long time.\n"
   ;
 
 static PyObject *
-cms_object_pprint(cms_object *self)
+asymmetric_params_object_generate_dh(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-  BIO *bio = NULL;
-  PyObject *result = NULL;
+  static char *kwlist[] = {"prime_length", NULL};
+  asymmetric_params_object *self = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  int prime_length = 2048;
+  int ok = 0;
 
-  ENTERING(cms_object_pprint);
+  ENTERING(asymmetric_params_object_generate_dh);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &prime_length))
+    goto error;
 
-  if (!CMS_ContentInfo_print_ctx(bio, self->cms, 0, NULL))
-    lose_openssl_error("Unable to pretty-print CMS object");
+  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-  result = BIO_to_PyString_helper(bio);
+  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_DH, NULL)) == NULL ||
+      EVP_PKEY_paramgen_init(ctx) <= 0 ||
+      EVP_PKEY_CTX_set_dh_paramgen_prime_len(ctx, prime_length) <= 0 ||
+      EVP_PKEY_paramgen(ctx, &self->pkey) <= 0)
+    lose_openssl_error("Couldn't generate key parameters");
+
+  ok = 1;
 
  error:
-  BIO_free(bio);
-  return result;
+  EVP_PKEY_CTX_free(ctx);
+
+  if (ok)
+    return (PyObject *) self;
+
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static char cms_object_certs__doc__[] =
-  "Return any certificates embedded in this CMS message, as a sequence\n"
-  "of X509 objects.   This sequence will be empty if the message wrapper\n"
-  "contains no certificates.\n"
+static char asymmetric_params_object_generate_dsa__doc__[] =
+  "Generate a new set of DSA parameters.\n"
+  "\n"
+  "Optional argument key_length is the length of the key to generate, in bits;\n"
+  "if not specified, the default is 2048 bits."
   ;
 
-/*
- * Might want to accept an optional subclass argument.
- */
-
 static PyObject *
-cms_object_certs(cms_object *self)
+asymmetric_params_object_generate_dsa(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-  STACK_OF(X509) *certs = NULL;
-  PyObject *result = NULL;
+  static char *kwlist[] = {"key_length", NULL};
+  asymmetric_params_object *self = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  int key_length = 2048;
+  int ok = 0;
 
-  ENTERING(cms_object_certs);
+  ENTERING(asymmetric_params_object_generate_dsa);
 
-  if ((certs = CMS_get1_certs(self->cms)) != NULL)
-    result = stack_to_tuple_helper(CHECKED_PTR_OF(STACK_OF(X509), certs),
-                                   stack_to_tuple_helper_get_x509);
-  else if (!ERR_peek_error())
-    result = Py_BuildValue("()");
-  else
-    lose_openssl_error("Couldn't extract certs from CMS message");
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &key_length))
+    goto error;
 
- error:                          /* fall through */
-  sk_X509_pop_free(certs, X509_free);
-  return result;
-}
+  if ((self = (asymmetric_params_object *) asymmetric_params_object_new(type, NULL, NULL)) == NULL)
+    goto error;
 
-static char cms_object_crls__doc__[] =
-  "Return any CRLs embedded in this CMS message, as a sequence of CRL objects.\n"
-  "This sequence will be empty if the message contains no CRLs.\n"
-  ;
+  if ((ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_DSA, NULL)) == NULL ||
+      EVP_PKEY_paramgen_init(ctx) <= 0 ||
+      EVP_PKEY_CTX_set_dsa_paramgen_bits(ctx, key_length) <= 0 ||
+      EVP_PKEY_paramgen(ctx, &self->pkey) <= 0)
+    lose_openssl_error("Couldn't generate key parameters");
 
-/*
- * Might want to accept an optional subclass argument.
- */
-
-static PyObject *
-cms_object_crls(cms_object *self)
-{
-  STACK_OF(X509_CRL) *crls = NULL;
-  PyObject *result = NULL;
+  ok = 1;
 
-  ENTERING(cms_object_crls);
+ error:
+  EVP_PKEY_CTX_free(ctx);
 
-  if ((crls = CMS_get1_crls(self->cms)) != NULL)
-    result = stack_to_tuple_helper(CHECKED_PTR_OF(STACK_OF(X509_CRL), crls),
-                                   stack_to_tuple_helper_get_crl);
-  else if (!ERR_peek_error())
-    result = Py_BuildValue("()");
-  else
-    lose_openssl_error("Couldn't extract CRLs from CMS message");
+  if (ok)
+    return (PyObject *) self;
 
- error:                          /* fall through */
-  sk_X509_CRL_pop_free(crls, X509_CRL_free);
-  return result;
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static struct PyMethodDef cms_object_methods[] = {
-  Define_Method(pemWrite,                       cms_object_pem_write,                   METH_NOARGS),
-  Define_Method(derWrite,                       cms_object_der_write,                   METH_NOARGS),
-  Define_Method(sign,                           cms_object_sign,                        METH_VARARGS),
-  Define_Method(verify,                         cms_object_verify,                      METH_KEYWORDS),
-  Define_Method(extractWithoutVerifying,        cms_object_extract_without_verifying,   METH_NOARGS),
-  Define_Method(checkRPKIConformance,           cms_object_check_rpki_conformance,      METH_KEYWORDS),
-  Define_Method(eContentType,                   cms_object_eContentType,                METH_NOARGS),
-  Define_Method(signingTime,                    cms_object_signingTime,                 METH_NOARGS),
-  Define_Method(pprint,                         cms_object_pprint,                      METH_NOARGS),
-  Define_Method(certs,                          cms_object_certs,                       METH_NOARGS),
-  Define_Method(crls,                           cms_object_crls,                        METH_NOARGS),
-  Define_Class_Method(pemRead,                  cms_object_pem_read,                    METH_VARARGS),
-  Define_Class_Method(pemReadFile,              cms_object_pem_read_file,               METH_VARARGS),
-  Define_Class_Method(derRead,                  cms_object_der_read,                    METH_VARARGS),
-  Define_Class_Method(derReadFile,              cms_object_der_read_file,               METH_VARARGS),
+static struct PyMethodDef asymmetric_params_object_methods[] = {
+  Define_Method(pemWrite,               asymmetric_params_object_pem_write,             METH_NOARGS),
+  Define_Class_Method(pemRead,          asymmetric_params_object_pem_read,              METH_VARARGS),
+  Define_Class_Method(pemReadFile,      asymmetric_params_object_pem_read_file,         METH_VARARGS),
+  Define_Class_Method(generateEC,       asymmetric_params_object_generate_ec,		METH_KEYWORDS),
+  Define_Class_Method(generateDH,	asymmetric_params_object_generate_dh,           METH_KEYWORDS),
+  Define_Class_Method(generateDSA,	asymmetric_params_object_generate_dsa,          METH_KEYWORDS),
   {NULL}
 };
 
-static char POW_CMS_Type__doc__[] =
-  "Wrapper for OpenSSL's CMS class.  At present this only handes signed\n"
-  "objects, as those are the only kind of CMS objects used in RPKI.\n"
+static char POW_AsymmetricParams_Type__doc__[] =
+  "Container for OpenSSL's EVP_PKEY asymmetric key parameter classes.\n"
   ;
 
-static PyTypeObject POW_CMS_Type = {
+static PyTypeObject POW_AsymmetricParams_Type = {
   PyObject_HEAD_INIT(0)
-  0,                                  /* ob_size */
-  "rpki.POW.CMS",                     /* tp_name */
-  sizeof(cms_object),                 /* tp_basicsize */
-  0,                                  /* tp_itemsize */
-  (destructor)cms_object_dealloc,     /* tp_dealloc */
-  0,                                  /* tp_print */
-  0,                                  /* tp_getattr */
-  0,                                  /* tp_setattr */
-  0,                                  /* tp_compare */
-  0,                                  /* tp_repr */
-  0,                                  /* tp_as_number */
-  0,                                  /* tp_as_sequence */
-  0,                                  /* tp_as_mapping */
-  0,                                  /* tp_hash */
-  0,                                  /* tp_call */
-  0,                                  /* tp_str */
-  0,                                  /* tp_getattro */
-  0,                                  /* tp_setattro */
-  0,                                  /* tp_as_buffer */
+  0,                                     /* ob_size */
+  "rpki.POW.AsymmetricParams",           /* tp_name */
+  sizeof(asymmetric_params_object),      /* tp_basicsize */
+  0,                                     /* tp_itemsize */
+  (destructor)asymmetric_params_object_dealloc, /* tp_dealloc */
+  0,                                     /* tp_print */
+  0,                                     /* tp_getattr */
+  0,                                     /* tp_setattr */
+  0,                                     /* tp_compare */
+  0,                                     /* tp_repr */
+  0,                                     /* tp_as_number */
+  0,                                     /* tp_as_sequence */
+  0,                                     /* tp_as_mapping */
+  0,                                     /* tp_hash */
+  0,                                     /* tp_call */
+  0,                                     /* tp_str */
+  0,                                     /* tp_getattro */
+  0,                                     /* tp_setattro */
+  0,                                     /* tp_as_buffer */
   Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_CMS_Type__doc__,                /* tp_doc */
-  0,                                  /* tp_traverse */
-  0,                                  /* tp_clear */
-  0,                                  /* tp_richcompare */
-  0,                                  /* tp_weaklistoffset */
-  0,                                  /* tp_iter */
-  0,                                  /* tp_iternext */
-  cms_object_methods,                 /* tp_methods */
-  0,                                  /* tp_members */
-  0,                                  /* tp_getset */
-  0,                                  /* tp_base */
-  0,                                  /* tp_dict */
-  0,                                  /* tp_descr_get */
-  0,                                  /* tp_descr_set */
-  0,                                  /* tp_dictoffset */
-  0,                                  /* tp_init */
-  0,                                  /* tp_alloc */
-  cms_object_new,                     /* tp_new */
+  POW_AsymmetricParams_Type__doc__,      /* tp_doc */
+  0,                                     /* tp_traverse */
+  0,                                     /* tp_clear */
+  0,                                     /* tp_richcompare */
+  0,                                     /* tp_weaklistoffset */
+  0,                                     /* tp_iter */
+  0,                                     /* tp_iternext */
+  asymmetric_params_object_methods,      /* tp_methods */
+  0,                                     /* tp_members */
+  0,                                     /* tp_getset */
+  0,                                     /* tp_base */
+  0,                                     /* tp_dict */
+  0,                                     /* tp_descr_get */
+  0,                                     /* tp_descr_set */
+  0,                                     /* tp_dictoffset */
+  (initproc) asymmetric_params_object_init, /* tp_init */
+  0,                                     /* tp_alloc */
+  asymmetric_params_object_new,          /* tp_new */
 };
 
 
 
 /*
- * Manifest object.
+ * Digest object.
  */
 
 static PyObject *
-manifest_object_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+digest_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
 {
-  manifest_object *self = NULL;
+  digest_object *self = NULL;
 
-  ENTERING(manifest_object_new);
+  ENTERING(digest_object_new);
 
-  if ((self = (manifest_object *) cms_object_new(type, args, kwds)) != NULL &&
-      (self->manifest = Manifest_new()) != NULL)
-    return (PyObject *) self;
+  if ((self = (digest_object *) type->tp_alloc(type, 0)) == NULL)
+    goto error;
 
-  Py_XDECREF(self);
-  return NULL;
-}
+  self->digest_type = 0;
 
-static void
-manifest_object_dealloc(manifest_object *self)
-{
-  ENTERING(manifest_object_dealloc);
-  Manifest_free(self->manifest);
-  cms_object_dealloc(&self->cms);
-}
+  return (PyObject *) self;
 
-static char manifest_object_verify__doc__[] =
-  "Verify this manifest against a trusted certificate store.\n"
-  "\n"
-  CMS_OBJECT_VERIFY_HELPER__DOC__
-  ;
+ error:
+  return NULL;
+}
 
-static PyObject *
-manifest_object_verify(manifest_object *self, PyObject *args, PyObject *kwds)
+static int
+digest_object_init(digest_object *self, PyObject *args, PyObject *kwds)
 {
-  BIO *bio = NULL;
-  int ok = 0;
+  static char *kwlist[] = {"digest_type", NULL};
+  const EVP_MD *digest_method = NULL;
+  int digest_type = 0;
 
-  ENTERING(manifest_object_verify);
+  ENTERING(digest_object_init);
 
-  if ((bio = cms_object_verify_helper(&self->cms, args, kwds)) == NULL)
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "i", kwlist, &digest_type))
     goto error;
 
-  if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(Manifest), bio, &self->manifest))
-    lose_openssl_error("Couldn't decode manifest");
+  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
+    lose("Unsupported digest algorithm");
 
-  ok = 1;
+  self->digest_type = digest_type;
+  if (!EVP_DigestInit(&self->digest_ctx, digest_method))
+    lose_openssl_error("Couldn't initialize digest");
+
+  return 0;
 
  error:
-  BIO_free(bio);
+  return -1;
+}
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+static void
+digest_object_dealloc(digest_object *self)
+{
+  ENTERING(digest_object_dealloc);
+  EVP_MD_CTX_cleanup(&self->digest_ctx);
+  self->ob_type->tp_free((PyObject*) self);
 }
 
-static char manifest_object_extract_without_verifying__doc__[] =
-  "Extract manifest payload from CMS wrapper without attempting CMS verification.\n"
+static char digest_object_update__doc__[] =
+  "Add data to this digest.\n"
   "\n"
-  "NEVER USE THIS METHOD ON AN UNVERIFIED MANIFEST!\n"
+  "the \"data\" parameter should be a string or other object supporting\n"
+  "the buffer protocol, containing the data to be added.  Large buffers\n"
+  "are hashed without holding the Python interpreter lock.\n"
   ;
 
 static PyObject *
-manifest_object_extract_without_verifying(manifest_object *self)
+digest_object_update(digest_object *self, PyObject *args)
 {
-  BIO *bio = NULL;
-  int ok = 0;
+  Py_buffer data;
+  int ok;
 
-  ENTERING(manifest_object_extract_without_verifying);
+  ENTERING(digest_object_update);
+
+  data.obj = NULL;
 
-  if ((bio = cms_object_extract_without_verifying_helper(&self->cms)) == NULL)
+  if (!PyArg_ParseTuple(args, "s*", &data))
     goto error;
 
-  if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(Manifest), bio, &self->manifest))
-    lose_openssl_error("Couldn't decode manifest");
+  if (data.len < DIGEST_GIL_MINSIZE) {
+    ok = EVP_DigestUpdate(&self->digest_ctx, data.buf, data.len);
+  } else {
+    Py_BEGIN_ALLOW_THREADS
+    ok = EVP_DigestUpdate(&self->digest_ctx, data.buf, data.len);
+    Py_END_ALLOW_THREADS
+  }
 
-  ok = 1;
+  if (!ok)
+    lose_openssl_error("EVP_DigestUpdate() failed");
 
- error:
-  BIO_free(bio);
+  PyBuffer_Release(&data);
+  Py_RETURN_NONE;
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+ error:
+  if (data.obj != NULL)
+    PyBuffer_Release(&data);
+  return NULL;
 }
 
-static char manifest_object_check_rpki_conformance__doc__[] =
-  "Check this manifest for conformance to the RPKI profile.\n"
+static char digest_object_copy__doc__[] =
+  "Return a copy of this Digest object.\n"
   ;
 
 static PyObject *
-manifest_object_check_rpki_conformance(manifest_object *self, PyObject *args, PyObject *kwds)
+digest_object_copy(digest_object *self)
 {
-  static char *kwlist[] = {"status", NULL};
-  PyObject *status = Py_None;
+  digest_object *new = NULL;
 
-  ENTERING(manifest_object_check_rpki_conformance);
+  ENTERING(digest_object_copy);
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PySet_Type, &status))
+  if ((new = (digest_object *) digest_object_new(&POW_Digest_Type, NULL, NULL)) == NULL)
     goto error;
 
-  if (!check_cms(self->cms.cms, status) || !check_manifest(self->cms.cms, self->manifest, status))
-    goto error;
+  new->digest_type = self->digest_type;
+  if (!EVP_MD_CTX_copy(&new->digest_ctx, &self->digest_ctx))
+    lose_openssl_error("Couldn't copy digest");
 
-  Py_RETURN_NONE;
+  return (PyObject*) new;
 
  error:
+
+  Py_XDECREF(new);
   return NULL;
 }
 
+static char digest_object_digest__doc__[] =
+  "Return the digest of all the data which this Digest object has processed.\n"
+  "\n"
+  "This method can be called at any time and will not effect the internal\n"
+  "state of the Digest object.\n"
+  ;
 
-static PyObject *
-manifest_object_der_read_helper(PyTypeObject *type, BIO *bio)
+/*
+ * Do we really need to do this copy?  Nice general operation, but does
+ * anything we're doing for RPKI care?
+ */
+
+static PyObject *
+digest_object_digest(digest_object *self)
 {
-  manifest_object *self;
+  unsigned char digest_text[EVP_MAX_MD_SIZE];
+  unsigned digest_len = 0;
+  PyObject *result = NULL;
+  EVP_MD_CTX ctx;
 
-  ENTERING(manifest_object_der_read_helper);
+  ENTERING(digest_object_digest);
 
-  if ((self = (manifest_object *) cms_object_der_read_helper(type, bio)) != NULL)
-    self->manifest = NULL;
+  if (!EVP_MD_CTX_copy(&ctx, &self->digest_ctx))
+    lose_openssl_error("Couldn't copy digest");
 
-  return (PyObject *) self;
-}
+  EVP_DigestFinal(&ctx, digest_text, &digest_len);
 
-static char manifest_object_der_read__doc__[] =
-  "Read a DER-encoded manifest object from a string.\n"
-  ;
+  result = Py_BuildValue("s#", digest_text, (Py_ssize_t) digest_len);
 
-static PyObject *
-manifest_object_der_read(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(manifest_object_der_read);
-  return read_from_string_helper(manifest_object_der_read_helper, type, args);
+ error:
+  EVP_MD_CTX_cleanup(&ctx);
+  return result;
 }
 
-static char manifest_object_der_read_file__doc__[] =
-  "Read a DER-encoded manifest object from a file.\n"
+static struct PyMethodDef digest_object_methods[] = {
+  Define_Method(update,         digest_object_update,   METH_VARARGS),
+  Define_Method(digest,         digest_object_digest,   METH_NOARGS),
+  Define_Method(copy,           digest_object_copy,     METH_NOARGS),
+  {NULL}
+};
+
+static char POW_Digest_Type__doc__[] =
+  "This class provides access to the digest functionality of OpenSSL.\n"
+  "It emulates the digest modules in the Python Standard Library, but\n"
+  "does not currently support the \"hexdigest\" method.\n"
+  "\n"
+  "The constructor takes one parameter, the kind of Digest object to create.\n"
+  "This should be one of the following:\n"
+  "\n"
+  "  * SHA1_DIGEST\n"
+  "  * SHA256_DIGEST\n"
+  "  * SHA384_DIGEST\n"
+  "  * SHA512_DIGEST\n"
   ;
 
-static PyObject *
-manifest_object_der_read_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(manifest_object_der_read_file);
-  return read_from_file_helper(manifest_object_der_read_helper, type, args);
-}
+static PyTypeObject POW_Digest_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                  /* ob_size */
+  "rpki.POW.Digest",                  /* tp_name */
+  sizeof(digest_object),              /* tp_basicsize */
+  0,                                  /* tp_itemsize */
+  (destructor)digest_object_dealloc,  /* tp_dealloc */
+  0,                                  /* tp_print */
+  0,                                  /* tp_getattr */
+  0,                                  /* tp_setattr */
+  0,                                  /* tp_compare */
+  0,                                  /* tp_repr */
+  0,                                  /* tp_as_number */
+  0,                                  /* tp_as_sequence */
+  0,                                  /* tp_as_mapping */
+  0,                                  /* tp_hash */
+  0,                                  /* tp_call */
+  0,                                  /* tp_str */
+  0,                                  /* tp_getattro */
+  0,                                  /* tp_setattro */
+  0,                                  /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_Digest_Type__doc__,             /* tp_doc */
+  0,                                  /* tp_traverse */
+  0,                                  /* tp_clear */
+  0,                                  /* tp_richcompare */
+  0,                                  /* tp_weaklistoffset */
+  0,                                  /* tp_iter */
+  0,                                  /* tp_iternext */
+  digest_object_methods,              /* tp_methods */
+  0,                                  /* tp_members */
+  0,                                  /* tp_getset */
+  0,                                  /* tp_base */
+  0,                                  /* tp_dict */
+  0,                                  /* tp_descr_get */
+  0,                                  /* tp_descr_set */
+  0,                                  /* tp_dictoffset */
+  (initproc) digest_object_init,      /* tp_init */
+  0,                                  /* tp_alloc */
+  digest_object_new,                  /* tp_new */
+};
+
+
+
+/*
+ * CMS object.
+ */
 
 static PyObject *
-manifest_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+cms_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
 {
-  manifest_object *self;
+  cms_object *self;
 
-  ENTERING(manifest_object_pem_read_helper);
+  ENTERING(cms_object_new);
 
-  if ((self = (manifest_object *) cms_object_pem_read_helper(type, bio)) != NULL)
-    self->manifest = NULL;
+  if ((self = (cms_object *) type->tp_alloc(type, 0)) != NULL)
+    return (PyObject *) self;
 
-  return (PyObject *) self;
+  Py_XDECREF(self);
+  return NULL;
 }
 
-static char manifest_object_pem_read__doc__[] =
-  "Read a PEM-encoded manifest object from a string.\n"
-  ;
-
-static PyObject *
-manifest_object_pem_read(PyTypeObject *type, PyObject *args)
+static void
+cms_object_dealloc(cms_object *self)
 {
-  ENTERING(manifest_object_pem_read);
-  return read_from_string_helper(manifest_object_pem_read_helper, type, args);
+  ENTERING(cms_object_dealloc);
+  CMS_ContentInfo_free(self->cms);
+  OPENSSL_free(self->der);
+  self->ob_type->tp_free((PyObject*) self);
 }
 
-static char manifest_object_pem_read_file__doc__[] =
-  "Read a PEM-encoded manifest object from a file.\n"
-  ;
-
-static PyObject *
-manifest_object_pem_read_file(PyTypeObject *type, PyObject *args)
+/*
+ * CMS objects read from DER hang onto the DER and don't decode the
+ * CMS wrapper (certificates, signer info, and so forth) until
+ * something needs it.  Everything that wants the CMS_ContentInfo goes
+ * through this function, which returns NULL with a Python exception
+ * set if there's nothing there or the DER doesn't decode.
+ */
+static CMS_ContentInfo *
+cms_object_get_cms(cms_object *self)
 {
-  ENTERING(manifest_object_pem_read_file);
-  return read_from_file_helper(manifest_object_pem_read_helper, type, args);
-}
-
-static char manifest_object_get_version__doc__[] =
-  "Return the version number of this manifest.\n"
-  ;
+  const unsigned char *der = self->der;
 
-static PyObject *
-manifest_object_get_version(manifest_object *self)
-{
-  ENTERING(manifest_object_get_version);
+  if (self->cms == NULL && self->der != NULL) {
+    if (!d2i_CMS_ContentInfo(&self->cms, &der, self->der_len))
+      lose_openssl_error("Couldn't load DER encoded CMS message");
+    OPENSSL_free(self->der);
+    self->der = NULL;
+    self->der_len = 0;
+  }
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't report version of unverified manifest");
+  if (self->cms == NULL)
+    lose("Uninitialized CMS object");
 
-  if (self->manifest->version)
-    return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->manifest->version));
-  else
-    return PyInt_FromLong(0);
+  return self->cms;
 
  error:
   return NULL;
 }
 
-static char manifest_object_set_version__doc__[] =
-  "Set the version number of this manifest.\n"
-  "\n"
-  "The \"version\" parameter should be a non-negative integer.\n"
-  "\n"
-  "As of this writing, zero is both the default and the only defined version.\n"
-  "Attempting to set any version number other than zero will fail, as we\n"
-  "don't understand how to write other versions, by definition.\n"
-  ;
-
-static PyObject *
-manifest_object_set_version(manifest_object *self, PyObject *args)
+/*
+ * Read one DER header, check that it's what we expected, and leave
+ * *p pointing at the contents.  Rejects indefinite lengths, which
+ * can't occur in DER.
+ */
+static int
+der_get_header(const unsigned char **p, const unsigned char *end,
+               const int tag, const int xclass, const int constructed,
+               long *len)
 {
-  int version = 0;
+  int ret, t, c;
 
-  ENTERING(manifest_object_set_version);
+  if (*p >= end)
+    return 0;
 
-  if (!PyArg_ParseTuple(args, "|i", &version))
-    goto error;
+  ret = ASN1_get_object(p, len, &t, &c, end - *p);
 
-  if (version != 0)
-    lose("RFC 6486 only defines RPKI manifest version zero");
+  return ((ret & 0x80) == 0 && (ret & 1) == 0 &&
+          (ret & V_ASN1_CONSTRUCTED) == constructed &&
+          t == tag && c == xclass);
+}
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't set version of unverified manifest");
+/*
+ * Find the eContent of a DER-encoded CMS SignedData object by walking
+ * the ASN.1 headers, without decoding anything we don't need (in
+ * particular, without touching the certificates or SignerInfos).
+ * Returns zero if the DER isn't shaped the way we expect, in which
+ * case the caller should fall back to decoding the whole thing.
+ */
+static int
+cms_der_get_econtent(const unsigned char *der, const long der_len,
+                     const unsigned char **content, long *content_len)
+{
+  static const unsigned char id_signedData[] = {
+    0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02
+  };
+  const unsigned char *p = der, *end = der + der_len;
+  long len;
+  int ok = 0;
 
-  ASN1_INTEGER_free(self->manifest->version);
-  self->manifest->version = NULL;
+  ERR_set_mark();
 
-  Py_RETURN_NONE;
+  /* ContentInfo ::= SEQUENCE { contentType, [0] EXPLICIT content } */
 
- error:
-  return NULL;
-}
+  if (!der_get_header(&p, end, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL, V_ASN1_CONSTRUCTED, &len) ||
+      !der_get_header(&p, end, V_ASN1_OBJECT, V_ASN1_UNIVERSAL, 0, &len) ||
+      len != sizeof(id_signedData) || memcmp(p, id_signedData, len))
+    goto done;
 
-static char manifest_object_get_manifest_number__doc__[] =
-  "Return the manifestNumber of this manifest.\n"
-  ;
+  p += len;
 
-static PyObject *
-manifest_object_get_manifest_number(manifest_object *self)
-{
-  ENTERING(manifest_object_get_manifest_number);
+  /* SignedData ::= SEQUENCE { version, digestAlgorithms, encapContentInfo, ... } */
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't get manifestNumber of unverified manifest");
+  if (!der_get_header(&p, end, 0, V_ASN1_CONTEXT_SPECIFIC, V_ASN1_CONSTRUCTED, &len) ||
+      !der_get_header(&p, end, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL, V_ASN1_CONSTRUCTED, &len) ||
+      !der_get_header(&p, end, V_ASN1_INTEGER, V_ASN1_UNIVERSAL, 0, &len))
+    goto done;
 
-  return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->manifest->manifestNumber));
+  p += len;
 
- error:
-  return NULL;
-}
+  if (!der_get_header(&p, end, V_ASN1_SET, V_ASN1_UNIVERSAL, V_ASN1_CONSTRUCTED, &len))
+    goto done;
 
-static char manifest_object_set_manifest_number__doc__[] =
-  "Set the manifestNumber of this manifest.\n"
-  "\n"
-  "The \"manifestNumber\" parameter should be a non-negative integer.\n"
-  ;
+  p += len;
 
-static PyObject *
-manifest_object_set_manifest_number(manifest_object *self, PyObject *args)
-{
-  PyObject *manifestNumber = NULL;
-  PyObject *zero = NULL;
-  int ok = 0;
+  /* EncapsulatedContentInfo ::= SEQUENCE { eContentType, [0] EXPLICIT OCTET STRING } */
 
-  ENTERING(manifest_object_set_manifest_number);
+  if (!der_get_header(&p, end, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL, V_ASN1_CONSTRUCTED, &len) ||
+      !der_get_header(&p, end, V_ASN1_OBJECT, V_ASN1_UNIVERSAL, 0, &len))
+    goto done;
 
-  if (!PyArg_ParseTuple(args, "O", &manifestNumber))
-    goto error;
+  p += len;
 
-  if ((zero = PyInt_FromLong(0)) == NULL)
-    goto error;
+  if (!der_get_header(&p, end, 0, V_ASN1_CONTEXT_SPECIFIC, V_ASN1_CONSTRUCTED, &len) ||
+      !der_get_header(&p, end, V_ASN1_OCTET_STRING, V_ASN1_UNIVERSAL, 0, &len))
+    goto done;
 
-  switch (PyObject_RichCompareBool(manifestNumber, zero, Py_GE)) {
-  case -1:
-    goto error;
-  case 0:
-    lose("Negative manifest number is not allowed");
-  }
+  *content = p;
+  *content_len = len;
+  ok = 1;
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't set manifestNumber of unverified manifest");
+ done:
+  ERR_pop_to_mark();
+  return ok;
+}
 
-  ASN1_INTEGER_free(self->manifest->manifestNumber);
+/*
+ * Find the eContent of a CMS object, taking the cheap path through
+ * the DER if we haven't decoded the CMS wrapper yet.  The result
+ * points into storage owned by the CMS object.
+ */
+static int
+cms_object_get_econtent(cms_object *self, const unsigned char **content, long *content_len)
+{
+  ASN1_OCTET_STRING **pos = NULL;
+  CMS_ContentInfo *cms = NULL;
 
-  if ((self->manifest->manifestNumber = PyLong_to_ASN1_INTEGER(manifestNumber)) == NULL)
+  if (self->cms == NULL && self->der != NULL &&
+      cms_der_get_econtent(self->der, self->der_len, content, content_len))
+    return 1;
+
+  if ((cms = cms_object_get_cms(self)) == NULL)
     goto error;
 
-  ok = 1;
+  if ((pos = CMS_get0_content(cms)) == NULL || *pos == NULL)
+    lose_openssl_error("Couldn't parse CMS message");
 
- error:
-  Py_XDECREF(zero);
+  *content = ASN1_STRING_data(*pos);
+  *content_len = ASN1_STRING_length(*pos);
+  return 1;
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+ error:
+  return 0;
 }
 
-static char manifest_object_set_this_update__doc__[] =
-  "Set this manifest's \"thisUpdate\" value.\n"
-  "\n"
-  "The \"time\" parameter should be a datetime object.\n"
-  ;
-
 static PyObject *
-manifest_object_set_this_update (manifest_object *self, PyObject *args)
+cms_object_pem_read_helper(PyTypeObject *type, BIO *bio)
 {
-  ASN1_TIME *t = NULL;
-  PyObject *o = NULL;
+  cms_object *self;
 
-  ENTERING(manifest_object_set_this_update);
+  ENTERING(cms_object_pem_read_helper);
 
-  if (!PyArg_ParseTuple(args, "O", &o))
+  if ((self = (cms_object *) type->tp_new(type, NULL, NULL)) == NULL)
     goto error;
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't set thisUpdate value of unverified manifest");
-
-  if ((t = Python_to_ASN1_TIME(o, 0)) == NULL)
-    lose("Couldn't convert thisUpdate string");
+  if (!PEM_read_bio_CMS(bio, &self->cms, NULL, NULL))
+    lose_openssl_error("Couldn't load PEM encoded CMS message");
 
-  ASN1_TIME_free(self->manifest->thisUpdate);
-  self->manifest->thisUpdate = t;
-  Py_RETURN_NONE;
+  return (PyObject *) self;
 
  error:
-  ASN1_TIME_free(t);
+  Py_XDECREF(self);
   return NULL;
 }
 
-static char manifest_object_get_this_update__doc__[] =
-  "Return this manifest's \"thisUpdate\" value as a datetime.\n"
-  ;
-
 static PyObject *
-manifest_object_get_this_update (manifest_object *self)
+cms_object_der_read_helper(PyTypeObject *type, BIO *bio)
 {
-  ENTERING(manifest_object_get_this_update);
+  cms_object *self;
+  const unsigned char *der, *p;
+  long len = 0, n;
+  int tag, xclass;
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't get thisUpdate value of unverified manifest");
+  ENTERING(cms_object_der_read_helper);
 
-  return ASN1_TIME_to_Python(self->manifest->thisUpdate);
+  if ((self = (cms_object *) type->tp_new(type, NULL, NULL)) == NULL)
+    goto error;
+
+  /*
+   * If we can see the whole thing, just check the outer SEQUENCE and
+   * save the DER for cms_object_get_cms() to decode if and when
+   * somebody needs it.
+   */
+
+  if ((der = mem_bio_der(bio, &len)) != NULL) {
+    p = der;
+    if (ASN1_get_object(&p, &n, &tag, &xclass, len) != V_ASN1_CONSTRUCTED ||
+        tag != V_ASN1_SEQUENCE || xclass != V_ASN1_UNIVERSAL)
+      lose_openssl_error("Couldn't load DER encoded CMS message");
+    n += p - der;
+    if ((self->der = OPENSSL_malloc(n)) == NULL)
+      lose_no_memory();
+    memcpy(self->der, der, n);
+    self->der_len = n;
+  }
+
+  else if (!d2i_CMS_bio(bio, &self->cms))
+    lose_openssl_error("Couldn't load DER encoded CMS message");
+
+  return (PyObject *) self;
 
  error:
+  Py_XDECREF(self);
   return NULL;
 }
 
-static char manifest_object_set_next_update__doc__[] =
-  "Set this manifest's \"nextUpdate\" value.\n"
-  "\n"
-  "The \"time\" parameter should be a datetime object.\n"
+static char cms_object_pem_read__doc__[] =
+  "Read a PEM-encoded CMS object from a string.\n"
   ;
 
 static PyObject *
-manifest_object_set_next_update (manifest_object *self, PyObject *args)
+cms_object_pem_read(PyTypeObject *type, PyObject *args)
 {
-  ASN1_TIME *t = NULL;
-  PyObject *o = NULL;
-
-  ENTERING(manifest_object_set_next_update);
-
-  if (!PyArg_ParseTuple(args, "O", &o))
-    goto error;
-
-  if (self->manifest == NULL)
-    lose_not_verified("Can't set nextUpdate value of unverified manifest"); 
-
-  if ((t = Python_to_ASN1_TIME(o, 0)) == NULL)
-    lose("Couldn't parse nextUpdate string");
+  ENTERING(cms_object_pem_read);
+  return read_from_string_helper(cms_object_pem_read_helper, type, args);
+}
 
-  ASN1_TIME_free(self->manifest->nextUpdate);
-  self->manifest->nextUpdate = t;
-  Py_RETURN_NONE;
+static char cms_object_pem_read_file__doc__[] =
+  "Read a PEM-encoded CMS object from a file.\n"
+  ;
 
- error:
-  ASN1_TIME_free(t);
-  return NULL;
+static PyObject *
+cms_object_pem_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(cms_object_pem_read_file);
+  return read_from_file_helper(cms_object_pem_read_helper, type, args);
 }
 
-static char manifest_object_get_next_update__doc__[] =
-  "Return this manifest's \"nextUpdate\" value as a datetime.\n"
+static char cms_object_der_read__doc__[] =
+  "Read a DER-encoded CMS object from a string.\n"
   ;
 
 static PyObject *
-manifest_object_get_next_update (manifest_object *self)
+cms_object_der_read(PyTypeObject *type, PyObject *args)
 {
-  ENTERING(manifest_object_get_next_update);
-
-  if (self->manifest == NULL)
-    lose_not_verified("Can't extract nextUpdate value of unverified manifest");
+  ENTERING(cms_object_der_read);
+  return read_from_string_helper(cms_object_der_read_helper, type, args);
+}
 
-  return ASN1_TIME_to_Python(self->manifest->nextUpdate);
+static char cms_object_der_read_file__doc__[] =
+  "Read a DER-encoded CMS object from a file.\n"
+  ;
 
- error:
-  return NULL;
+static PyObject *
+cms_object_der_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(cms_object_der_read_file);
+  return read_from_file_helper(cms_object_der_read_helper, type, args);
 }
 
-static char manifest_object_get_algorithm__doc__[] =
-  "Return this manifest's fileHashAlg OID.\n"
+static char cms_object_pem_write__doc__[] =
+  "Return the DER encoding of this CMS message.\n"
   ;
 
 static PyObject *
-manifest_object_get_algorithm(manifest_object *self)
+cms_object_pem_write(cms_object *self)
 {
   PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  ENTERING(manifest_object_get_algorithm);
+  ENTERING(cms_object_pem_write);
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't extract algorithm OID of unverified manifest");
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
 
-  result = ASN1_OBJECT_to_PyString(self->manifest->fileHashAlg);
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
- error:
+  if (!PEM_write_bio_CMS(bio, self->cms))
+    lose_openssl_error("Unable to write CMS object");
+
+  result = BIO_to_PyString_helper(bio);
+
+ error:                         /* Fall through */
+  BIO_free(bio);
   return result;
 }
 
-static char manifest_object_set_algorithm__doc__[] =
-  "Set this manifest's fileHashAlg OID.\n"
+static char cms_object_der_write__doc__[] =
+  "Return the DER encoding of this CMS message.\n"
   ;
 
 static PyObject *
-manifest_object_set_algorithm(manifest_object *self, PyObject *args)
+cms_object_der_write(cms_object *self)
 {
-  ASN1_OBJECT *oid = NULL;
-  const char *s = NULL;
+  PyObject *result = NULL;
+  BIO *bio = NULL;
 
-  ENTERING(manifest_object_set_algorithm);
+  ENTERING(cms_object_der_write);
 
-  if (!PyArg_ParseTuple(args, "s", &s))
-    goto error;
+  if (self->cms == NULL && self->der != NULL)
+    return PyString_FromStringAndSize((char *) self->der, self->der_len);
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't set algorithm OID for unverified manifest");
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
 
-  if ((oid = OBJ_txt2obj(s, 1)) == NULL)
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
     lose_no_memory();
 
-  ASN1_OBJECT_free(self->manifest->fileHashAlg);
-  self->manifest->fileHashAlg = oid;
-  Py_RETURN_NONE;
+  if (!i2d_CMS_bio(bio, self->cms))
+    lose_openssl_error("Unable to write CMS object");
 
- error:
-  ASN1_OBJECT_free(oid);
-  return NULL;
-}
+  result = BIO_to_PyString_helper(bio);
 
-static char manifest_object_add_files__doc__[] =
-  "Add a collection of <filename, hash> pairs to this manifest.\n"
-  "\n"
-  "The \"iterable\" parameter should be an iterable object supplying\n"
-  "returning two-element sequences; the first element of each sequence\n"
-  "should be the filename (a text string), the second element should be the\n"
-  "hash (a binary string).\n"
-  ;
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
 
-static PyObject *
-manifest_object_add_files(manifest_object *self, PyObject *args)
+static int
+cms_object_sign_helper(cms_object *self,
+                       BIO *bio,
+                       x509_object *signcert,
+                       asymmetric_object *signkey,
+                       PyObject *x509_iterable,
+                       PyObject *crl_iterable,
+                       char *oid,
+                       unsigned flags)                       
 {
-  PyObject *iterable = NULL;
+  STACK_OF(X509) *x509_stack = NULL;
+  ASN1_OBJECT *econtent_type = NULL;
+  CMS_ContentInfo *cms = NULL;
   PyObject *iterator = NULL;
   PyObject *item = NULL;
-  PyObject *fast = NULL;
-  FileAndHash *fah = NULL;
-  char *file = NULL;
-  char *hash = NULL;
-  Py_ssize_t filelen, hashlen;
-  int ok = 0;
+  int finalized, ok = 0;
 
-  ENTERING(manifest_object_add_files);
+  ENTERING(cms_object_sign_helper);
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't add files to unverified manifest");
+  assert_no_unhandled_openssl_errors();
 
-  if (!PyArg_ParseTuple(args, "O", &iterable) ||
-      (iterator = PyObject_GetIter(iterable)) == NULL)
+  flags &= CMS_NOCERTS | CMS_NOATTR;
+  flags |= CMS_BINARY | CMS_NOSMIMECAP | CMS_PARTIAL | CMS_USE_KEYID;
+
+  if ((x509_stack = x509_helper_iterable_to_stack(x509_iterable)) == NULL)
     goto error;
 
-  while ((item = PyIter_Next(iterator)) != NULL) {
+  assert_no_unhandled_openssl_errors();
 
-    if ((fast = PySequence_Fast(item, "FileAndHash entry must be a sequence")) == NULL)
-      goto error;
+  if (oid && (econtent_type = OBJ_txt2obj(oid, 1)) == NULL)
+    lose_openssl_error("Couldn't parse OID");
 
-    if (PySequence_Fast_GET_SIZE(fast) != 2)
-      lose_type_error("FileAndHash entry must be two-element sequence");
+  assert_no_unhandled_openssl_errors();
 
-    if (PyString_AsStringAndSize(PySequence_Fast_GET_ITEM(fast, 0), &file, &filelen) < 0 ||
-        PyString_AsStringAndSize(PySequence_Fast_GET_ITEM(fast, 1), &hash, &hashlen) < 0)
-      goto error;
+  if ((cms = CMS_sign(NULL, NULL, x509_stack, bio, flags)) == NULL)
+    lose_openssl_error("Couldn't create CMS message");
 
-    if ((fah = FileAndHash_new()) == NULL ||
-        !ASN1_OCTET_STRING_set(fah->file, (unsigned char *) file, filelen) ||
-        !ASN1_BIT_STRING_set(fah->hash, (unsigned char *) hash, hashlen) ||
-        !sk_FileAndHash_push(self->manifest->fileList, fah))
-      lose_no_memory();
+  assert_no_unhandled_openssl_errors();
 
-    fah->hash->flags &= ~7;
-    fah->hash->flags |= ASN1_STRING_FLAG_BITS_LEFT;
+  if (econtent_type)
+    CMS_set1_eContentType(cms, econtent_type);
 
-    fah = NULL;
-    Py_XDECREF(item);
-    Py_XDECREF(fast);
-    item = fast = NULL;
-  }
+  assert_no_unhandled_openssl_errors();
 
-  ok = 1;
+  if (!CMS_add1_signer(cms, signcert->x509, signkey->pkey, EVP_sha256(), flags))
+    lose_openssl_error("Couldn't sign CMS message");
 
- error:
-  Py_XDECREF(iterator);
-  Py_XDECREF(item);
-  Py_XDECREF(fast);
-  FileAndHash_free(fah);
+  assert_no_unhandled_openssl_errors();
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
-}
+  if (crl_iterable != Py_None) {
 
-static char manifest_object_get_files__doc__[] =
-  "Return a tuple of <filename, hash> pairs representing the contents of\n"
-  "this manifest.\n"
-  ;
+    if ((iterator = PyObject_GetIter(crl_iterable)) == NULL)
+      goto error;
 
-static PyObject *
-manifest_object_get_files(manifest_object *self)
-{
-  PyObject *result = NULL;
-  PyObject *item = NULL;
-  int i;
+    while ((item = PyIter_Next(iterator)) != NULL) {
 
-  ENTERING(manifest_object_get_files);
+      if (!POW_CRL_Check(item))
+        lose_type_error("Expected a CRL object");
 
-  if (self->manifest == NULL)
-    lose_not_verified("Can't get files from unverified manifest");
+      if (!CMS_add1_crl(cms, ((crl_object *) item)->crl))
+        lose_openssl_error("Couldn't add CRL to CMS");
 
-  if (self->manifest->fileList == NULL)
-    lose("Inexplicable NULL manifest fileList pointer");
+      assert_no_unhandled_openssl_errors();
 
-  if ((result = PyTuple_New(sk_FileAndHash_num(self->manifest->fileList))) == NULL)
-    goto error;
+      Py_XDECREF(item);
+      item = NULL;
+    }
+  }
 
-  for (i = 0; i < sk_FileAndHash_num(self->manifest->fileList); i++) {
-    FileAndHash *fah = sk_FileAndHash_value(self->manifest->fileList, i);
+  Py_BEGIN_ALLOW_THREADS
+  finalized = CMS_final(cms, bio, NULL, flags);
+  Py_END_ALLOW_THREADS
 
-    item = Py_BuildValue("(s#s#)",
-                         ASN1_STRING_data(fah->file),
-                         (Py_ssize_t) ASN1_STRING_length(fah->file),
-                         ASN1_STRING_data(fah->hash),
-                         (Py_ssize_t) ASN1_STRING_length(fah->hash));
-    if (item == NULL)
-      goto error;
+  if (!finalized)
+    lose_openssl_error("Couldn't finalize CMS signatures");
 
-    PyTuple_SET_ITEM(result, i, item);
-    item = NULL;
-  }
+  assert_no_unhandled_openssl_errors();
 
-  return result;
+  CMS_ContentInfo_free(self->cms);
+  self->cms = cms;
+  cms = NULL;
 
- error:
-  Py_XDECREF(result);
+  OPENSSL_free(self->der);
+  self->der = NULL;
+  self->der_len = 0;
+
+  ok = 1;
+
+ error:                          /* fall through */
+  CMS_ContentInfo_free(cms);
+  sk_X509_free(x509_stack);
+  ASN1_OBJECT_free(econtent_type);
+  Py_XDECREF(iterator);
   Py_XDECREF(item);
-  return NULL;
+
+  return ok;
 }
 
-static char manifest_object_sign__doc__[] =
-  "Sign this manifest.  See the CMS class's .sign() method for details.\n"
+static char cms_object_sign__doc__[] =
+  "Sign this CMS message message with a private key.\n"
+  "\n"
+  "The \"signcert\" parameter should be the certificate against which the\n"
+  "message will eventually be verified, an X509 object.\n"
+  "\n"
+  "The \"key\" parameter should be the private key with which to sign the\n"
+  "message, an Asymmetric object.\n"
+  "\n"
+  "The \"data\" parameter should be the message to be signed, a string.\n"
+  "\n"
+  "The optional \"certs\" parameter should be an iterable supplying X509 objects\n"
+  "to be included in the signed message.\n"
+  "\n"
+  "The optional \"crls\" parameter should be an iterable supplying CRL objects\n"
+  "to be included in the signed message.\n"
+  "\n"
+  "The optional \"eContentType\" parameter should be an Object Identifier\n"
+  "to use as the eContentType value in the signed message.\n"
+  "\n"
+  "The optional \"flags\" parameters should be an integer holding a bitmask,\n"
+  "and can include the following flags:\n"
+  "\n"
+  "  * CMS_NOCERTS\n"
+  "  * CMS_NOATTR\n"
   ;
 
 static PyObject *
-manifest_object_sign(manifest_object *self, PyObject *args)
+cms_object_sign(cms_object *self, PyObject *args)
 {
   asymmetric_object *signkey = NULL;
   x509_object *signcert = NULL;
   PyObject *x509_iterable = Py_None;
   PyObject *crl_iterable = Py_None;
-  char *oid = NULL;
+  char *buf = NULL, *oid = NULL;
+  Py_ssize_t len;
   unsigned flags = 0;
   BIO *bio = NULL;
   int ok = 0;
 
-  ENTERING(manifest_object_sign);
+  ENTERING(cms_object_sign);
 
-  if (!PyArg_ParseTuple(args, "O!O!|OOsI",
+  if (!PyArg_ParseTuple(args, "O!O!s#|OOsI",
                         &POW_X509_Type, &signcert,
                         &POW_Asymmetric_Type, &signkey,
+                        &buf, &len,
                         &x509_iterable,
                         &crl_iterable,
                         &oid,
                         &flags))
     goto error;
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
   assert_no_unhandled_openssl_errors();
 
-  if (!ASN1_item_i2d_bio(ASN1_ITEM_rptr(Manifest), bio, self->manifest))
-    lose_openssl_error("Couldn't encode manifest");
+  if ((bio = BIO_new_mem_buf(buf, len)) == NULL)
+    lose_no_memory();
 
   assert_no_unhandled_openssl_errors();
 
-  if (!cms_object_sign_helper(&self->cms, bio, signcert, signkey,
+  if (!cms_object_sign_helper(self, bio, signcert, signkey,
                               x509_iterable, crl_iterable, oid, flags))
-    lose_openssl_error("Couldn't sign manifest");
+    lose_openssl_error("Couldn't sign CMS object");
 
   assert_no_unhandled_openssl_errors();
 
@@ -8384,185 +9381,148 @@ manifest_object_sign(manifest_object *self, PyObject *args)
     return NULL;
 }
 
-static struct PyMethodDef manifest_object_methods[] = {
-  Define_Method(getVersion,			manifest_object_get_version,                    METH_NOARGS),
-  Define_Method(setVersion,			manifest_object_set_version,                    METH_VARARGS),
-  Define_Method(getManifestNumber,		manifest_object_get_manifest_number,            METH_NOARGS),
-  Define_Method(setManifestNumber,		manifest_object_set_manifest_number,            METH_VARARGS),
-  Define_Method(getThisUpdate,			manifest_object_get_this_update,                METH_NOARGS),
-  Define_Method(setThisUpdate,			manifest_object_set_this_update,                METH_VARARGS),
-  Define_Method(getNextUpdate,			manifest_object_get_next_update,                METH_NOARGS),
-  Define_Method(setNextUpdate,			manifest_object_set_next_update,                METH_VARARGS),
-  Define_Method(getAlgorithm,			manifest_object_get_algorithm,                  METH_NOARGS),
-  Define_Method(setAlgorithm,			manifest_object_set_algorithm,                  METH_VARARGS),
-  Define_Method(getFiles,			manifest_object_get_files,                      METH_NOARGS),
-  Define_Method(addFiles,			manifest_object_add_files,                      METH_VARARGS),
-  Define_Method(sign,				manifest_object_sign,                           METH_VARARGS),
-  Define_Method(verify,				manifest_object_verify,                         METH_KEYWORDS),
-  Define_Method(checkRPKIConformance,		manifest_object_check_rpki_conformance,         METH_KEYWORDS),
-  Define_Method(extractWithoutVerifying,	manifest_object_extract_without_verifying,      METH_NOARGS),
-  Define_Class_Method(pemRead,			manifest_object_pem_read,                       METH_VARARGS),
-  Define_Class_Method(pemReadFile,		manifest_object_pem_read_file,                  METH_VARARGS),
-  Define_Class_Method(derRead,			manifest_object_der_read,                       METH_VARARGS),
-  Define_Class_Method(derReadFile,		manifest_object_der_read_file,                  METH_VARARGS),
-  {NULL}
-};
-
-static char POW_Manifest_Type__doc__[] =
-  "This class provides access to RPKI manifest payload.\n"
-  "Most methods are inherited from or share code with the CMS class.\n"
-  ;
-
-static PyTypeObject POW_Manifest_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                            /* ob_size */
-  "rpki.POW.Manifest",                          /* tp_name */
-  sizeof(manifest_object),                      /* tp_basicsize */
-  0,                                            /* tp_itemsize */
-  (destructor)manifest_object_dealloc,          /* tp_dealloc */
-  0,                                            /* tp_print */
-  0,                                            /* tp_getattr */
-  0,                                            /* tp_setattr */
-  0,                                            /* tp_compare */
-  0,                                            /* tp_repr */
-  0,                                            /* tp_as_number */
-  0,                                            /* tp_as_sequence */
-  0,                                            /* tp_as_mapping */
-  0,                                            /* tp_hash */
-  0,                                            /* tp_call */
-  0,                                            /* tp_str */
-  0,                                            /* tp_getattro */
-  0,                                            /* tp_setattro */
-  0,                                            /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,     /* tp_flags */
-  POW_Manifest_Type__doc__,                     /* tp_doc */
-  0,                                            /* tp_traverse */
-  0,                                            /* tp_clear */
-  0,                                            /* tp_richcompare */
-  0,                                            /* tp_weaklistoffset */
-  0,                                            /* tp_iter */
-  0,                                            /* tp_iternext */
-  manifest_object_methods,                      /* tp_methods */
-  0,                                            /* tp_members */
-  0,                                            /* tp_getset */
-  &POW_CMS_Type,                                /* tp_base */
-  0,                                            /* tp_dict */
-  0,                                            /* tp_descr_get */
-  0,                                            /* tp_descr_set */
-  0,                                            /* tp_dictoffset */
-  0,                                            /* tp_init */
-  0,                                            /* tp_alloc */
-  manifest_object_new,                          /* tp_new */
-};
 
-
+#define CMS_OBJECT_VERIFY_HELPER__DOC__                                         \
+  "\n"                                                                          \
+  "The optional \"certs\" parameter is a set of certificates to search\n"       \
+  "for the signer's certificate.\n"                                             \
+  "\n"                                                                          \
+  "The optional \"flags\" parameter is an integer of bit flags,\n"              \
+  "containing zero or more of the following:\n"                                 \
+  "\n"                                                                          \
+  "  * CMS_NOINTERN\n"                                                          \
+  "  * CMS_NOCRL\n"                                                             \
+  "  * CMS_NO_SIGNER_CERT_VERIFY\n"                                             \
+  "  * CMS_NO_ATTR_VERIFY\n"                                                    \
+  "  * CMS_NO_CONTENT_VERIFY\n"                                                 \
+  "\n"                                                                          \
+  "Note that this method does NOT verify X.509 certificates, it just\n"         \
+  "verifies the CMS signature.  Use certificate verification functions\n"       \
+  "to verify certificates."
 
-/*
- * ROA object.
- */
+#warning Should we really allow the full range of flags here, or constrain to just the useful cases?
 
-static PyObject *
-roa_object_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+static BIO *
+cms_object_verify_helper(cms_object *self, PyObject *args, PyObject *kwds)
 {
-  roa_object *self = NULL;
+  static char *kwlist[] = {"certs", "flags", NULL};
+  PyObject *certs_iterable = Py_None;
+  STACK_OF(X509) *certs_stack = NULL;
+  unsigned flags = 0, ok = 0;
+  BIO *bio = NULL;
+  int verified;
 
-  ENTERING(roa_object_new);
+  const unsigned flag_mask =
+    CMS_NOINTERN | CMS_NOCRL | CMS_NO_SIGNER_CERT_VERIFY |
+    CMS_NO_ATTR_VERIFY | CMS_NO_CONTENT_VERIFY;
 
-  if ((self = (roa_object *) cms_object_new(type, args, kwds)) != NULL &&
-      (self->roa = ROA_new()) != NULL)
-    return (PyObject *) self;
+  ENTERING(cms_object_verify_helper);
 
-  Py_XDECREF(self);
-  return NULL;
-}
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OI", kwlist, &certs_iterable, &flags))
+    goto error;
 
-static void
-roa_object_dealloc(roa_object *self)
-{
-  ENTERING(roa_object_dealloc);
-  ROA_free(self->roa);
-  cms_object_dealloc(&self->cms);
-}
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
 
-static char roa_object_verify__doc__[] =
-  "Verify this ROA against a trusted certificate store.\n"
-  "\n"
-  CMS_OBJECT_VERIFY_HELPER__DOC__
-  ;
+  if ((flags & ~flag_mask) != 0)
+    lose_value_error("Bad CMS_verify() flags");
 
-static PyObject *
-roa_object_verify(roa_object *self, PyObject *args, PyObject *kwds)
-{
-  BIO *bio = NULL;
-  int ok = 0;
+  flags |= CMS_NO_SIGNER_CERT_VERIFY;
 
-  ENTERING(roa_object_verify);
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  if ((bio = cms_object_verify_helper(&self->cms, args, kwds)) == NULL)
+  assert_no_unhandled_openssl_errors();
+
+  if (certs_iterable != Py_None &&
+      (certs_stack = x509_helper_iterable_to_stack(certs_iterable)) == NULL)
     goto error;
-  
-  if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(ROA), bio, &self->roa))
-    lose_openssl_error("Couldn't decode ROA");
 
-  ok = 1;
+  assert_no_unhandled_openssl_errors();
 
- error:
-  BIO_free(bio);
+  Py_BEGIN_ALLOW_THREADS
+  verified = CMS_verify(self->cms, certs_stack, NULL, NULL, bio, flags) > 0;
+  Py_END_ALLOW_THREADS
+
+  if (!verified)
+    lose_openssl_error("Couldn't verify CMS message");
+
+  assert_no_unhandled_openssl_errors();
+
+  ok = 1;
+
+ error:                          /* fall through */
+  sk_X509_free(certs_stack);
 
   if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
-}
+    return bio;
 
+  BIO_free(bio);
+  return NULL;
+}
 
-static char roa_object_extract_without_verifying__doc__[] =
-  "Extract ROA payload from CMS wrapper without attempting CMS verification.\n"
+static char cms_object_verify__doc__[] =
+  "Verify this CMS message against a trusted certificate store.\n"
   "\n"
-  "NEVER USE THIS METHOD ON AN UNVERIFIED ROA!\n"
+  CMS_OBJECT_VERIFY_HELPER__DOC__
+  "\n"
+  "Return value is the decoded CMS content, as a Python string.\n"
   ;
 
 static PyObject *
-roa_object_extract_without_verifying(roa_object *self)
+cms_object_verify(cms_object *self, PyObject *args, PyObject *kwds)
 {
+  PyObject *result = NULL;
   BIO *bio = NULL;
-  int ok = 0;
 
-  ENTERING(roa_object_extract_without_verifying);
+  ENTERING(cms_object_verify);
 
-  if ((bio = cms_object_extract_without_verifying_helper(&self->cms)) == NULL)
-    goto error;
+  if ((bio = cms_object_verify_helper(self, args, kwds)) != NULL)
+    result = BIO_to_PyString_helper(bio);
 
-  if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(ROA), bio, &self->roa))
-    lose_openssl_error("Couldn't decode ROA");
+  BIO_free(bio);
+  return result;
+}
 
-  ok = 1;
+static char cms_object_extract_without_verifying__doc__[] =
+  "Extract content from a CMS object without attempting CMS verification.\n"
+  "\n"
+  "NEVER USE THIS METHOD ON AN UNVERIFIED CMS OBJECT!\n"
+  ;
 
- error:
-  BIO_free(bio);
+static PyObject *
+cms_object_extract_without_verifying(cms_object *self)
+{
+  const unsigned char *content = NULL;
+  long content_len = 0;
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
+  ENTERING(cms_object_extract_without_verifying);
+
+  if (!cms_object_get_econtent(self, &content, &content_len))
     return NULL;
+
+  return PyString_FromStringAndSize((const char *) content, content_len);
 }
 
-static char roa_object_check_rpki_conformance__doc__[] =
-  "Check this ROA for conformance to the RPKI profile.\n"
+static char cms_object_check_rpki_conformance__doc__[] =
+  "Check this CMS message for conformance to the RPKI profile.\n"
   ;
 
 static PyObject *
-roa_object_check_rpki_conformance(roa_object *self, PyObject *args, PyObject *kwds)
+cms_object_check_rpki_conformance(cms_object *self, PyObject *args, PyObject *kwds)
 {
   static char *kwlist[] = {"status", NULL};
   PyObject *status = Py_None;
 
-  ENTERING(roa_object_check_rpki_conformance);
+  ENTERING(cms_object_check_rpki_conformance);
 
   if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PySet_Type, &status))
     goto error;
 
-  if (!check_cms(self->cms.cms, status) || !check_roa(self->cms.cms, self->roa, status))
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
+
+  if (!check_cms(self->cms, status))
     goto error;
 
   Py_RETURN_NONE;
@@ -8571,190 +9531,303 @@ roa_object_check_rpki_conformance(roa_object *self, PyObject *args, PyObject *kw
   return NULL;
 }
 
+static char cms_object_eContentType__doc__[] =
+  "Return the eContentType OID of this CMS message.\n"
+  ;
+
 static PyObject *
-roa_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+cms_object_eContentType(cms_object *self)
 {
-  roa_object *self;
-
-  ENTERING(roa_object_pem_read_helper);
+  const ASN1_OBJECT *oid = NULL;
+  PyObject *result = NULL;
 
-  if ((self = (roa_object *) cms_object_pem_read_helper(type, bio)) != NULL)
-    self->roa = NULL;
+  ENTERING(cms_object_eContentType);
 
-  return (PyObject *) self;
-}
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
 
-static PyObject *
-roa_object_der_read_helper(PyTypeObject *type, BIO *bio)
-{
-  roa_object *self;
+  if ((oid = CMS_get0_eContentType(self->cms)) == NULL)
+    lose_openssl_error("Couldn't extract eContentType from CMS message");
 
-  ENTERING(roa_object_der_read_helper);
+  assert_no_unhandled_openssl_errors();
 
-  if ((self = (roa_object *) cms_object_der_read_helper(type, bio)) != NULL)
-    self->roa = NULL;
+  result = ASN1_OBJECT_to_PyString(oid);
 
-  return (PyObject *) self;
+ error:
+  return result;
 }
 
-static char roa_object_pem_read__doc__[] =
-  "Read a PEM-encoded ROA object from a string.\n"
+static char cms_object_signingTime__doc__[] =
+  "Return the signingTime of this CMS message.\n"
   ;
 
 static PyObject *
-roa_object_pem_read(PyTypeObject *type, PyObject *args)
+cms_object_signingTime(cms_object *self)
 {
-  ENTERING(roa_object_pem_read);
-  return read_from_string_helper(roa_object_pem_read_helper, type, args);
-}
+  PyObject *result = NULL;
+  STACK_OF(CMS_SignerInfo) *sis = NULL;
+  CMS_SignerInfo *si = NULL;
+  X509_ATTRIBUTE *xa = NULL;
+  ASN1_TYPE *so = NULL;
+  int i;
 
-static char roa_object_pem_read_file__doc__[] =
-  "Read a PEM-encoded ROA object from a file.\n"
-  ;
+  ENTERING(cms_object_signingTime);
 
-static PyObject *
-roa_object_pem_read_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(roa_object_pem_read_file);
-  return read_from_file_helper(roa_object_pem_read_helper, type, args);
-}
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
 
-static char roa_object_der_read__doc__[] =
-  "Read a DER-encoded ROA object from a string.\n"
-  ;
+  if ((sis = CMS_get0_SignerInfos(self->cms)) == NULL)
+    lose_openssl_error("Couldn't extract signerInfos from CMS message[1]");
 
-static PyObject *
-roa_object_der_read(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(roa_object_der_read);
-  return read_from_string_helper(roa_object_der_read_helper, type, args);
-}
+  if (sk_CMS_SignerInfo_num(sis) != 1)
+    lose_openssl_error("Couldn't extract signerInfos from CMS message[2]");
 
-static char roa_object_der_read_file__doc__[] =
-  "Read a DER-encoded ROA object from a file.\n"
-  ;
+  si = sk_CMS_SignerInfo_value(sis, 0);
 
-static PyObject *
-roa_object_der_read_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(roa_object_der_read_file);
-  return read_from_file_helper(roa_object_der_read_helper, type, args);
-}
+  if ((i = CMS_signed_get_attr_by_NID(si, NID_pkcs9_signingTime, -1)) < 0)
+    lose_openssl_error("Couldn't extract signerInfos from CMS message[3]");
 
-static char roa_object_get_version__doc__[] =
-  "Return the version number of this ROA.\n"
-  ;
+  if ((xa = CMS_signed_get_attr(si, i)) == NULL)
+    lose_openssl_error("Couldn't extract signerInfos from CMS message[4]");
 
-static PyObject *
-roa_object_get_version(roa_object *self)
-{
-  ENTERING(roa_object_get_version);
+  if (xa->single)
+    lose("Couldn't extract signerInfos from CMS message[5]");
 
-  if (self->roa == NULL)
-    lose_not_verified("Can't get version of unverified ROA");
+  if (X509_ATTRIBUTE_count(xa) != 1)
+    lose("Couldn't extract signerInfos from CMS message[6]");
 
-  if (self->roa->version)
-    return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->roa->version));
-  else
-    return PyInt_FromLong(0);
+  if ((so = X509_ATTRIBUTE_get0_type(xa, 0)) == NULL)
+    lose("Couldn't extract signerInfos from CMS message[7]");
+
+  switch (so->type) {
+  case V_ASN1_UTCTIME:
+    result = ASN1_TIME_to_Python(so->value.utctime);
+    break;
+  case V_ASN1_GENERALIZEDTIME:
+    result = ASN1_TIME_to_Python(so->value.generalizedtime);
+    break;
+  default:
+    lose("Couldn't extract signerInfos from CMS message[8]");
+  }
 
  error:
-  return NULL;
+  return result;
 }
 
-static char roa_object_set_version__doc__[] =
-  "Set the version number of this ROA.\n"
-  "\n"
-  "The \"version\" parameter should be a non-negative integer.\n"
-  "\n"
-  "As of this writing, zero is both the default and the only defined version.\n"
-  "Attempting to set any version number other than zero will fail, as we\n"
-  "don't understand how to write other versions, by definition.\n"
+static char cms_object_pprint__doc__[] =
+  "Return a pretty-printed representation of this CMS message.\n"
   ;
 
 static PyObject *
-roa_object_set_version(roa_object *self, PyObject *args)
+cms_object_pprint(cms_object *self)
 {
-  int version = 0;
-
-  ENTERING(roa_object_set_version);
+  BIO *bio = NULL;
+  PyObject *result = NULL;
 
-  if (self->roa == NULL)
-    lose_not_verified("Can't set version of unverified ROA");
+  ENTERING(cms_object_pprint);
 
-  if (!PyArg_ParseTuple(args, "|i", &version))
+  if (cms_object_get_cms(self) == NULL)
     goto error;
 
-  if (version != 0)
-    lose("RFC 6482 only defines ROA version zero");
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
 
-  ASN1_INTEGER_free(self->roa->version);
-  self->roa->version = NULL;
+  if (!CMS_ContentInfo_print_ctx(bio, self->cms, 0, NULL))
+    lose_openssl_error("Unable to pretty-print CMS object");
 
-  Py_RETURN_NONE;
+  result = BIO_to_PyString_helper(bio);
 
  error:
-  return NULL;
+  BIO_free(bio);
+  return result;
 }
 
-static char roa_object_get_asid__doc__[] =
-  "Return the Autonomous System ID of this ROA.\n"
+static char cms_object_certs__doc__[] =
+  "Return any certificates embedded in this CMS message, as a sequence\n"
+  "of X509 objects.   This sequence will be empty if the message wrapper\n"
+  "contains no certificates.\n"
   ;
 
+/*
+ * Might want to accept an optional subclass argument.
+ */
+
 static PyObject *
-roa_object_get_asid(roa_object *self)
+cms_object_certs(cms_object *self)
 {
-  ENTERING(roa_object_get_asid);
+  STACK_OF(X509) *certs = NULL;
+  PyObject *result = NULL;
 
-  if (self->roa == NULL)
-    lose_not_verified("Can't get ASN of unverified ROA");
+  ENTERING(cms_object_certs);
 
-  return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->roa->asID));
+  if (cms_object_get_cms(self) == NULL)
+    goto error;
 
- error:
-  return NULL;
+  if ((certs = CMS_get1_certs(self->cms)) != NULL)
+    result = stack_to_tuple_helper(CHECKED_PTR_OF(STACK_OF(X509), certs),
+                                   stack_to_tuple_helper_get_x509);
+  else if (!ERR_peek_error())
+    result = Py_BuildValue("()");
+  else
+    lose_openssl_error("Couldn't extract certs from CMS message");
+
+ error:                          /* fall through */
+  sk_X509_pop_free(certs, X509_free);
+  return result;
 }
 
-static char roa_object_set_asid__doc__[] =
-  "Sets the Autonomous System ID of this ROA.\n"
-  "\n"
-  "The \"asID\" parameter should be a non-negative integer.\n"
+static char cms_object_crls__doc__[] =
+  "Return any CRLs embedded in this CMS message, as a sequence of CRL objects.\n"
+  "This sequence will be empty if the message contains no CRLs.\n"
   ;
 
+/*
+ * Might want to accept an optional subclass argument.
+ */
+
 static PyObject *
-roa_object_set_asid(roa_object *self, PyObject *args)
+cms_object_crls(cms_object *self)
 {
-  PyObject *asID = NULL;
-  PyObject *zero = NULL;
-  int ok = 0;
-
-  ENTERING(roa_object_set_asid);
+  STACK_OF(X509_CRL) *crls = NULL;
+  PyObject *result = NULL;
 
-  if (self->roa == NULL)
-    lose_not_verified("Can't set ASN of unverified ROA");
+  ENTERING(cms_object_crls);
 
-  if (!PyArg_ParseTuple(args, "O", &asID))
+  if (cms_object_get_cms(self) == NULL)
     goto error;
 
-  if ((zero = PyInt_FromLong(0)) == NULL)
-    goto error;
+  if ((crls = CMS_get1_crls(self->cms)) != NULL)
+    result = stack_to_tuple_helper(CHECKED_PTR_OF(STACK_OF(X509_CRL), crls),
+                                   stack_to_tuple_helper_get_crl);
+  else if (!ERR_peek_error())
+    result = Py_BuildValue("()");
+  else
+    lose_openssl_error("Couldn't extract CRLs from CMS message");
 
-  switch (PyObject_RichCompareBool(asID, zero, Py_GE)) {
-  case -1:
-    goto error;
-  case 0:
-    lose("Negative asID is not allowed");
-  }
+ error:                          /* fall through */
+  sk_X509_CRL_pop_free(crls, X509_CRL_free);
+  return result;
+}
 
-  ASN1_INTEGER_free(self->roa->asID);
+static struct PyMethodDef cms_object_methods[] = {
+  Define_Method(pemWrite,                       cms_object_pem_write,                   METH_NOARGS),
+  Define_Method(derWrite,                       cms_object_der_write,                   METH_NOARGS),
+  Define_Method(sign,                           cms_object_sign,                        METH_VARARGS),
+  Define_Method(verify,                         cms_object_verify,                      METH_KEYWORDS),
+  Define_Method(extractWithoutVerifying,        cms_object_extract_without_verifying,   METH_NOARGS),
+  Define_Method(checkRPKIConformance,           cms_object_check_rpki_conformance,      METH_KEYWORDS),
+  Define_Method(eContentType,                   cms_object_eContentType,                METH_NOARGS),
+  Define_Method(signingTime,                    cms_object_signingTime,                 METH_NOARGS),
+  Define_Method(pprint,                         cms_object_pprint,                      METH_NOARGS),
+  Define_Method(certs,                          cms_object_certs,                       METH_NOARGS),
+  Define_Method(crls,                           cms_object_crls,                        METH_NOARGS),
+  Define_Class_Method(pemRead,                  cms_object_pem_read,                    METH_VARARGS),
+  Define_Class_Method(pemReadFile,              cms_object_pem_read_file,               METH_VARARGS),
+  Define_Class_Method(derRead,                  cms_object_der_read,                    METH_VARARGS),
+  Define_Class_Method(derReadFile,              cms_object_der_read_file,               METH_VARARGS),
+  {NULL}
+};
 
-  if ((self->roa->asID = PyLong_to_ASN1_INTEGER(asID)) == NULL)
+static char POW_CMS_Type__doc__[] =
+  "Wrapper for OpenSSL's CMS class.  At present this only handes signed\n"
+  "objects, as those are the only kind of CMS objects used in RPKI.\n"
+  ;
+
+static PyTypeObject POW_CMS_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                  /* ob_size */
+  "rpki.POW.CMS",                     /* tp_name */
+  sizeof(cms_object),                 /* tp_basicsize */
+  0,                                  /* tp_itemsize */
+  (destructor)cms_object_dealloc,     /* tp_dealloc */
+  0,                                  /* tp_print */
+  0,                                  /* tp_getattr */
+  0,                                  /* tp_setattr */
+  0,                                  /* tp_compare */
+  0,                                  /* tp_repr */
+  0,                                  /* tp_as_number */
+  0,                                  /* tp_as_sequence */
+  0,                                  /* tp_as_mapping */
+  0,                                  /* tp_hash */
+  0,                                  /* tp_call */
+  0,                                  /* tp_str */
+  0,                                  /* tp_getattro */
+  0,                                  /* tp_setattro */
+  0,                                  /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_CMS_Type__doc__,                /* tp_doc */
+  0,                                  /* tp_traverse */
+  0,                                  /* tp_clear */
+  0,                                  /* tp_richcompare */
+  0,                                  /* tp_weaklistoffset */
+  0,                                  /* tp_iter */
+  0,                                  /* tp_iternext */
+  cms_object_methods,                 /* tp_methods */
+  0,                                  /* tp_members */
+  0,                                  /* tp_getset */
+  0,                                  /* tp_base */
+  0,                                  /* tp_dict */
+  0,                                  /* tp_descr_get */
+  0,                                  /* tp_descr_set */
+  0,                                  /* tp_dictoffset */
+  0,                                  /* tp_init */
+  0,                                  /* tp_alloc */
+  cms_object_new,                     /* tp_new */
+};
+
+
+
+/*
+ * Manifest object.
+ */
+
+static PyObject *
+manifest_object_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  manifest_object *self = NULL;
+
+  ENTERING(manifest_object_new);
+
+  if ((self = (manifest_object *) cms_object_new(type, args, kwds)) != NULL &&
+      (self->manifest = Manifest_new()) != NULL)
+    return (PyObject *) self;
+
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static void
+manifest_object_dealloc(manifest_object *self)
+{
+  ENTERING(manifest_object_dealloc);
+  Manifest_free(self->manifest);
+  cms_object_dealloc(&self->cms);
+}
+
+static char manifest_object_verify__doc__[] =
+  "Verify this manifest against a trusted certificate store.\n"
+  "\n"
+  CMS_OBJECT_VERIFY_HELPER__DOC__
+  ;
+
+static PyObject *
+manifest_object_verify(manifest_object *self, PyObject *args, PyObject *kwds)
+{
+  BIO *bio = NULL;
+  int ok = 0;
+
+  ENTERING(manifest_object_verify);
+
+  if ((bio = cms_object_verify_helper(&self->cms, args, kwds)) == NULL)
     goto error;
 
+  if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(Manifest), bio, &self->manifest))
+    lose_openssl_error("Couldn't decode manifest");
+
   ok = 1;
 
  error:
-  Py_XDECREF(zero);
+  BIO_free(bio);
 
   if (ok)
     Py_RETURN_NONE;
@@ -8762,313 +9835,255 @@ roa_object_set_asid(roa_object *self, PyObject *args)
     return NULL;
 }
 
-static char roa_object_get_prefixes__doc__[] =
-  "Return this ROA's prefix list.  This is a two-element\n"
-  "tuple: the first element is the IPv4 prefix set, the second is the\n"
-  "IPv6 prefix set.\n"
-  "\n"
-  "Each prefix set is either None, if there are no prefixes for this IP\n"
-  "version, or a sequence of three-element tuple representing ROA prefix\n"
-  "entries.\n"
+static char manifest_object_extract_without_verifying__doc__[] =
+  "Extract manifest payload from CMS wrapper without attempting CMS verification.\n"
   "\n"
-  "Each ROA prefix entry consists of the prefix itself (an IPAddress),\n"
-  "the prefix length (an integer), and the maxPrefixLen value, which is\n"
-  "either an integer or None depending on whether the maxPrefixLen value\n"
-  "is set for this prefix.\n"
+  "NEVER USE THIS METHOD ON AN UNVERIFIED MANIFEST!\n"
   ;
 
 static PyObject *
-roa_object_get_prefixes(roa_object *self)
+manifest_object_extract_without_verifying(manifest_object *self)
 {
-  PyObject *result = NULL;
-  PyObject *ipv4_result = NULL;
-  PyObject *ipv6_result = NULL;
-  PyObject *item = NULL;
-  ipaddress_object *addr = NULL;
-  int i, j;
+  const unsigned char *content = NULL;
+  long content_len = 0;
 
-  ENTERING(roa_object_get_prefixes);
+  ENTERING(manifest_object_extract_without_verifying);
 
-  if (self->roa == NULL)
-    lose_not_verified("Can't get prefixes from unverified ROA");
+  /*
+   * Once decoded, the payload doesn't change, so don't do it again.
+   */
 
-  for (i = 0; i < sk_ROAIPAddressFamily_num(self->roa->ipAddrBlocks); i++) {
-    ROAIPAddressFamily *fam = sk_ROAIPAddressFamily_value(self->roa->ipAddrBlocks, i);
-    const unsigned afi = (fam->addressFamily->data[0] << 8) | (fam->addressFamily->data[1]);
-    const ipaddress_version *ip_type = NULL;
-    PyObject **resultp = NULL;
+  if (self->manifest != NULL)
+    Py_RETURN_NONE;
 
-    switch (afi) {
-    case IANA_AFI_IPV4: resultp = &ipv4_result; ip_type = &ipaddress_version_4; break;
-    case IANA_AFI_IPV6: resultp = &ipv6_result; ip_type = &ipaddress_version_6; break;
-    default:            lose_value_error("Unknown AFI");
-    }
+  if (!cms_object_get_econtent(&self->cms, &content, &content_len))
+    goto error;
 
-    if (fam->addressFamily->length > 2)
-      lose_value_error("Unsupported SAFI");
+  if (!ASN1_item_d2i((ASN1_VALUE **) &self->manifest, &content, content_len, ASN1_ITEM_rptr(Manifest)))
+    lose_openssl_error("Couldn't decode manifest");
 
-    if (*resultp != NULL)
-      lose_value_error("Duplicate ROAIPAddressFamily");
+  Py_RETURN_NONE;
 
-    if ((*resultp = PyTuple_New(sk_ROAIPAddress_num(fam->addresses))) == NULL)
-      goto error;
+ error:
+  return NULL;
+}
 
-    for (j = 0; j < sk_ROAIPAddress_num(fam->addresses); j++) {
-      ROAIPAddress *a = sk_ROAIPAddress_value(fam->addresses, j);
-      unsigned prefixlen = ((a->IPAddress)->length * 8 - ((a->IPAddress)->flags & 7));
+static char manifest_object_check_rpki_conformance__doc__[] =
+  "Check this manifest for conformance to the RPKI profile.\n"
+  ;
 
-      if ((addr = (ipaddress_object *) POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL)
-        goto error;
+static PyObject *
+manifest_object_check_rpki_conformance(manifest_object *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"status", NULL};
+  PyObject *status = Py_None;
 
-      addr->type = ip_type;
+  ENTERING(manifest_object_check_rpki_conformance);
 
-      memset(addr->address, 0, sizeof(addr->address));
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PySet_Type, &status))
+    goto error;
 
-      if ((unsigned) a->IPAddress->length > addr->type->length)
-        lose("ROAIPAddress BIT STRING too long for AFI");
+  if (cms_object_get_cms(&self->cms) == NULL)
+    goto error;
 
-      if (a->IPAddress->length > 0) {
-        memcpy(addr->address, a->IPAddress->data, a->IPAddress->length);
+  if (!check_cms(self->cms.cms, status) || !check_manifest(self->cms.cms, self->manifest, status))
+    goto error;
 
-        if ((a->IPAddress->flags & 7) != 0) {
-          unsigned char mask = 0xFF >> (8 - (a->IPAddress->flags & 7));
-          addr->address[a->IPAddress->length - 1] &= ~mask;
-        }
-      }
+  Py_RETURN_NONE;
 
-      if (a->maxLength == NULL)
-        item = Py_BuildValue("(NIO)", addr, prefixlen, Py_None);
-      else
-        item = Py_BuildValue("(NIl)", addr, prefixlen, ASN1_INTEGER_get(a->maxLength));
+ error:
+  return NULL;
+}
 
-      if (item == NULL)
-        goto error;
 
-      PyTuple_SET_ITEM(*resultp, j, item);
-      item = NULL;
-      addr = NULL;
-    }
-  }
+static PyObject *
+manifest_object_der_read_helper(PyTypeObject *type, BIO *bio)
+{
+  manifest_object *self;
 
-  result = Py_BuildValue("(OO)",
-                         (ipv4_result == NULL ? Py_None : ipv4_result),
-                         (ipv6_result == NULL ? Py_None : ipv6_result));
+  ENTERING(manifest_object_der_read_helper);
 
- error:                         /* Fall through */
-  Py_XDECREF(addr);
-  Py_XDECREF(item);
-  Py_XDECREF(ipv4_result);
-  Py_XDECREF(ipv6_result);
+  if ((self = (manifest_object *) cms_object_der_read_helper(type, bio)) != NULL) {
+    Manifest_free(self->manifest);
+    self->manifest = NULL;
+  }
 
-  return result;
+  return (PyObject *) self;
 }
 
-static char roa_object_set_prefixes__doc__[] =
-  "Set this ROA's prefix list.\n"
-  "\n"
-  "This method takes two arguments, \"ipv4\" and \"ipv6\".  Each of these\n"
-  "is either None, if no prefixes should be set for this IP version, or\n"
-  "an iterable object returning ROA prefix entries in the same format as\n"
-  "returned by the .getPrefixes() method.  The maxPrefixLen value may be\n"
-  "omitted (that is, the ROA prefix entry tuple may be of length two\n"
-  "rather than of length three); this will be taken as equivalent to\n"
-  "specifying a maxPrefixLen value of None.\n"
+static char manifest_object_der_read__doc__[] =
+  "Read a DER-encoded manifest object from a string.\n"
   ;
 
 static PyObject *
-roa_object_set_prefixes(roa_object *self, PyObject *args, PyObject *kwds)
+manifest_object_der_read(PyTypeObject *type, PyObject *args)
 {
-  static char *kwlist[] = {"ipv4", "ipv6", NULL};
-  STACK_OF(ROAIPAddressFamily) *prefixes = NULL;
-  ROAIPAddressFamily *fam = NULL;
-  ROAIPAddress *a = NULL;
-  PyObject *ipv4_arg = Py_None;
-  PyObject *ipv6_arg = Py_None;
-  PyObject *iterator = NULL;
-  PyObject *item = NULL;
-  PyObject *fast = NULL;
-  int ok = 0;
-  int v;
+  ENTERING(manifest_object_der_read);
+  return read_from_string_helper(manifest_object_der_read_helper, type, args);
+}
 
-  ENTERING(roa_object_set_prefixes);
+static char manifest_object_der_read_file__doc__[] =
+  "Read a DER-encoded manifest object from a file.\n"
+  ;
 
-  if (self->roa == NULL)
-    lose_not_verified("Can't set prefixes of unverified ROA");
+static PyObject *
+manifest_object_der_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(manifest_object_der_read_file);
+  return read_from_file_helper(manifest_object_der_read_helper, type, args);
+}
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO", kwlist, &ipv4_arg, &ipv6_arg))
-    goto error;
+static PyObject *
+manifest_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+{
+  manifest_object *self;
 
-  if ((prefixes = sk_ROAIPAddressFamily_new_null()) == NULL)
-    lose_no_memory();
+  ENTERING(manifest_object_pem_read_helper);
 
-  for (v = 0; v < (int) (sizeof(ipaddress_versions)/sizeof(*ipaddress_versions)); v++) {
-    const struct ipaddress_version *ip_type = ipaddress_versions[v];
-    unsigned char afibuf[2];
-    PyObject **argp;
+  if ((self = (manifest_object *) cms_object_pem_read_helper(type, bio)) != NULL) {
+    Manifest_free(self->manifest);
+    self->manifest = NULL;
+  }
 
-    switch (ip_type->version) {
-    case 4: argp = &ipv4_arg; break;
-    case 6: argp = &ipv6_arg; break;
-    default: continue;
-    }
+  return (PyObject *) self;
+}
 
-    if (*argp == Py_None)
-      continue;
+static char manifest_object_pem_read__doc__[] =
+  "Read a PEM-encoded manifest object from a string.\n"
+  ;
 
-    afibuf[0] = (ip_type->afi >> 8) & 0xFF;
-    afibuf[1] = (ip_type->afi     ) & 0xFF;
+static PyObject *
+manifest_object_pem_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(manifest_object_pem_read);
+  return read_from_string_helper(manifest_object_pem_read_helper, type, args);
+}
 
-    if ((iterator = PyObject_GetIter(*argp)) == NULL)
-      goto error;
+static char manifest_object_pem_read_file__doc__[] =
+  "Read a PEM-encoded manifest object from a file.\n"
+  ;
 
-    while ((item = PyIter_Next(iterator)) != NULL) {
-      unsigned prefixlen, maxprefixlen, bitlen, bytelen;
-      ipaddress_object *addr = NULL;
-      PyObject *maxlenobj = Py_None;
+static PyObject *
+manifest_object_pem_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(manifest_object_pem_read_file);
+  return read_from_file_helper(manifest_object_pem_read_helper, type, args);
+}
 
-      if ((fast = PySequence_Fast(item, "ROA prefix must be a sequence")) == NULL)
-        goto error;
+static char manifest_object_get_version__doc__[] =
+  "Return the version number of this manifest.\n"
+  ;
 
-      switch (PySequence_Fast_GET_SIZE(fast)) {
-      case 3:
-        maxlenobj = PySequence_Fast_GET_ITEM(fast, 2);
-        /* Fall through */
-      case 2:
-        if (!POW_IPAddress_Check(PySequence_Fast_GET_ITEM(fast, 0)))
-          lose_type_error("First element of ROA prefix must be an IPAddress object");
-        addr = (ipaddress_object *) PySequence_Fast_GET_ITEM(fast, 0);
-        prefixlen = (unsigned) PyInt_AsLong(PySequence_Fast_GET_ITEM(fast, 1));
-        if (PyErr_Occurred())
-          goto error;
-        break;
-      default:
-        lose_type_error("ROA prefix must be a two- or three-element sequence");
-      }
+static PyObject *
+manifest_object_get_version(manifest_object *self)
+{
+  ENTERING(manifest_object_get_version);
 
-      if (maxlenobj == Py_None) {
-        maxprefixlen = prefixlen;
-      } else {
-        maxprefixlen = (unsigned) PyInt_AsLong(maxlenobj);
-        if (PyErr_Occurred())
-          goto error;
-      }
+  if (self->manifest == NULL)
+    lose_not_verified("Can't report version of unverified manifest");
 
-      if (addr->type != ip_type)
-        lose_value_error("Bad ROA prefix");
+  if (self->manifest->version)
+    return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->manifest->version));
+  else
+    return PyInt_FromLong(0);
 
-      if (prefixlen > addr->type->length * 8)
-        lose("Bad prefix length");
+ error:
+  return NULL;
+}
 
-      if (maxprefixlen > addr->type->length * 8 || maxprefixlen < prefixlen)
-        lose("Bad maxLength value");
+static char manifest_object_set_version__doc__[] =
+  "Set the version number of this manifest.\n"
+  "\n"
+  "The \"version\" parameter should be a non-negative integer.\n"
+  "\n"
+  "As of this writing, zero is both the default and the only defined version.\n"
+  "Attempting to set any version number other than zero will fail, as we\n"
+  "don't understand how to write other versions, by definition.\n"
+  ;
 
-      bytelen = (prefixlen + 7) / 8;
-      bitlen = prefixlen % 8;
+static PyObject *
+manifest_object_set_version(manifest_object *self, PyObject *args)
+{
+  int version = 0;
 
-      if ((a = ROAIPAddress_new()) == NULL ||
-          (a->IPAddress == NULL && (a->IPAddress = ASN1_BIT_STRING_new()) == NULL) ||
-          !ASN1_BIT_STRING_set(a->IPAddress, addr->address, bytelen))
-        lose_no_memory();
+  ENTERING(manifest_object_set_version);
 
-      a->IPAddress->flags &= ~7;
-      a->IPAddress->flags |= ASN1_STRING_FLAG_BITS_LEFT;
-      if (bitlen > 0) {
-        a->IPAddress->data[bytelen - 1] &= ~(0xFF >> bitlen);
-        a->IPAddress->flags |= 8 - bitlen;
-      }
+  if (!PyArg_ParseTuple(args, "|i", &version))
+    goto error;
 
-      if (prefixlen != maxprefixlen &&
-          ((a->maxLength = ASN1_INTEGER_new()) == NULL ||
-           !ASN1_INTEGER_set(a->maxLength, maxprefixlen)))
-        lose_no_memory();
+  if (version != 0)
+    lose("RFC 6486 only defines RPKI manifest version zero");
 
-      if (fam == NULL &&
-          ((fam = ROAIPAddressFamily_new()) == NULL ||
-           !sk_ROAIPAddressFamily_push(prefixes, fam) ||
-           !ASN1_OCTET_STRING_set(fam->addressFamily, afibuf, sizeof(afibuf))))
-        lose_no_memory();
+  if (self->manifest == NULL)
+    lose_not_verified("Can't set version of unverified manifest");
 
-      if (!sk_ROAIPAddress_push(fam->addresses, a))
-        lose_no_memory();
+  ASN1_INTEGER_free(self->manifest->version);
+  self->manifest->version = NULL;
 
-      a = NULL;
-      Py_XDECREF(item);
-      Py_XDECREF(fast);
-      item = fast = NULL;
-    }
+  Py_RETURN_NONE;
 
-    fam = NULL;
-    Py_XDECREF(iterator);
-    iterator = NULL;
-  }
+ error:
+  return NULL;
+}
 
-  sk_ROAIPAddressFamily_pop_free(self->roa->ipAddrBlocks, ROAIPAddressFamily_free);
-  self->roa->ipAddrBlocks = prefixes;
-  prefixes = NULL;
+static char manifest_object_get_manifest_number__doc__[] =
+  "Return the manifestNumber of this manifest.\n"
+  ;
 
-  ok = 1;
+static PyObject *
+manifest_object_get_manifest_number(manifest_object *self)
+{
+  ENTERING(manifest_object_get_manifest_number);
 
- error:
-  sk_ROAIPAddressFamily_pop_free(prefixes, ROAIPAddressFamily_free);
-  ROAIPAddressFamily_free(fam);
-  ROAIPAddress_free(a);
-  Py_XDECREF(iterator);
-  Py_XDECREF(item);
-  Py_XDECREF(fast);
+  if (self->manifest == NULL)
+    lose_not_verified("Can't get manifestNumber of unverified manifest");
 
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+  return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->manifest->manifestNumber));
+
+ error:
+  return NULL;
 }
 
-static char roa_object_sign__doc__[] =
-  "Sign this ROA.  See CMS.sign() for details.\n"
+static char manifest_object_set_manifest_number__doc__[] =
+  "Set the manifestNumber of this manifest.\n"
+  "\n"
+  "The \"manifestNumber\" parameter should be a non-negative integer.\n"
   ;
 
 static PyObject *
-roa_object_sign(roa_object *self, PyObject *args)
+manifest_object_set_manifest_number(manifest_object *self, PyObject *args)
 {
-  asymmetric_object *signkey = NULL;
-  x509_object *signcert = NULL;
-  PyObject *x509_iterable = Py_None;
-  PyObject *crl_iterable = Py_None;
-  char *oid = NULL;
-  unsigned flags = 0;
-  BIO *bio = NULL;
+  PyObject *manifestNumber = NULL;
+  PyObject *zero = NULL;
   int ok = 0;
 
-  ENTERING(roa_object_sign);
+  ENTERING(manifest_object_set_manifest_number);
 
-  if (!PyArg_ParseTuple(args, "O!O!|OOsI",
-                        &POW_X509_Type, &signcert,
-                        &POW_Asymmetric_Type, &signkey,
-                        &x509_iterable,
-                        &crl_iterable,
-                        &oid,
-                        &flags))
+  if (!PyArg_ParseTuple(args, "O", &manifestNumber))
     goto error;
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
-
-  assert_no_unhandled_openssl_errors();
+  if ((zero = PyInt_FromLong(0)) == NULL)
+    goto error;
 
-  if (!ASN1_item_i2d_bio(ASN1_ITEM_rptr(ROA), bio, self->roa))
-    lose_openssl_error("Couldn't encode ROA");
+  switch (PyObject_RichCompareBool(manifestNumber, zero, Py_GE)) {
+  case -1:
+    goto error;
+  case 0:
+    lose("Negative manifest number is not allowed");
+  }
 
-  assert_no_unhandled_openssl_errors();
+  if (self->manifest == NULL)
+    lose_not_verified("Can't set manifestNumber of unverified manifest");
 
-  if (!cms_object_sign_helper(&self->cms, bio, signcert, signkey,
-                              x509_iterable, crl_iterable, oid, flags))
-    lose_openssl_error("Couldn't sign ROA");
+  ASN1_INTEGER_free(self->manifest->manifestNumber);
 
-  assert_no_unhandled_openssl_errors();
+  if ((self->manifest->manifestNumber = PyLong_to_ASN1_INTEGER(manifestNumber)) == NULL)
+    goto error;
 
   ok = 1;
 
  error:
-  BIO_free(bio);
+  Py_XDECREF(zero);
 
   if (ok)
     Py_RETURN_NONE;
@@ -9076,1087 +10091,5076 @@ roa_object_sign(roa_object *self, PyObject *args)
     return NULL;
 }
 
-static struct PyMethodDef roa_object_methods[] = {
-  Define_Method(getVersion,                     roa_object_get_version,                 METH_NOARGS),
-  Define_Method(setVersion,                     roa_object_set_version,                 METH_VARARGS),
-  Define_Method(getASID,                        roa_object_get_asid,                    METH_NOARGS),
-  Define_Method(setASID,                        roa_object_set_asid,                    METH_VARARGS),
-  Define_Method(getPrefixes,                    roa_object_get_prefixes,                METH_NOARGS),
-  Define_Method(setPrefixes,                    roa_object_set_prefixes,                METH_KEYWORDS),
-  Define_Method(sign,                           roa_object_sign,                        METH_VARARGS),
-  Define_Method(verify,                         roa_object_verify,                      METH_KEYWORDS),
-  Define_Method(extractWithoutVerifying,        roa_object_extract_without_verifying,   METH_NOARGS),
-  Define_Method(checkRPKIConformance,           roa_object_check_rpki_conformance,      METH_KEYWORDS),
-  Define_Class_Method(pemRead,                  roa_object_pem_read,                    METH_VARARGS),
-  Define_Class_Method(pemReadFile,              roa_object_pem_read_file,               METH_VARARGS),
-  Define_Class_Method(derRead,                  roa_object_der_read,                    METH_VARARGS),
-  Define_Class_Method(derReadFile,              roa_object_der_read_file,               METH_VARARGS),
-  {NULL}
-};
+static char manifest_object_set_this_update__doc__[] =
+  "Set this manifest's \"thisUpdate\" value.\n"
+  "\n"
+  "The \"time\" parameter should be a datetime object.\n"
+  ;
 
-static char POW_ROA_Type__doc__[] =
-  "This class provides access to RPKI ROA payload.\n"
-  "Most methods are inherited from or share code with the CMS class.\n"
+static PyObject *
+manifest_object_set_this_update (manifest_object *self, PyObject *args)
+{
+  ASN1_TIME *t = NULL;
+  PyObject *o = NULL;
+
+  ENTERING(manifest_object_set_this_update);
+
+  if (!PyArg_ParseTuple(args, "O", &o))
+    goto error;
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't set thisUpdate value of unverified manifest");
+
+  if ((t = Python_to_ASN1_TIME(o, 0)) == NULL)
+    lose("Couldn't convert thisUpdate string");
+
+  ASN1_TIME_free(self->manifest->thisUpdate);
+  self->manifest->thisUpdate = t;
+  Py_RETURN_NONE;
+
+ error:
+  ASN1_TIME_free(t);
+  return NULL;
+}
+
+static char manifest_object_get_this_update__doc__[] =
+  "Return this manifest's \"thisUpdate\" value as a datetime.\n"
   ;
 
-static PyTypeObject POW_ROA_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                            /* ob_size */
-  "rpki.POW.ROA",                               /* tp_name */
-  sizeof(roa_object),                           /* tp_basicsize */
-  0,                                            /* tp_itemsize */
-  (destructor)roa_object_dealloc,               /* tp_dealloc */
-  0,                                            /* tp_print */
-  0,                                            /* tp_getattr */
-  0,                                            /* tp_setattr */
-  0,                                            /* tp_compare */
-  0,                                            /* tp_repr */
-  0,                                            /* tp_as_number */
-  0,                                            /* tp_as_sequence */
-  0,                                            /* tp_as_mapping */
-  0,                                            /* tp_hash */
-  0,                                            /* tp_call */
-  0,                                            /* tp_str */
-  0,                                            /* tp_getattro */
-  0,                                            /* tp_setattro */
-  0,                                            /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,     /* tp_flags */
-  POW_ROA_Type__doc__,                          /* tp_doc */
-  0,                                            /* tp_traverse */
-  0,                                            /* tp_clear */
-  0,                                            /* tp_richcompare */
-  0,                                            /* tp_weaklistoffset */
-  0,                                            /* tp_iter */
-  0,                                            /* tp_iternext */
-  roa_object_methods,                           /* tp_methods */
-  0,                                            /* tp_members */
-  0,                                            /* tp_getset */
-  &POW_CMS_Type,                                /* tp_base */
-  0,                                            /* tp_dict */
-  0,                                            /* tp_descr_get */
-  0,                                            /* tp_descr_set */
-  0,                                            /* tp_dictoffset */
-  0,                                            /* tp_init */
-  0,                                            /* tp_alloc */
-  roa_object_new,                               /* tp_new */
-};
+static PyObject *
+manifest_object_get_this_update (manifest_object *self)
+{
+  ENTERING(manifest_object_get_this_update);
 
-
+  if (self->manifest == NULL)
+    lose_not_verified("Can't get thisUpdate value of unverified manifest");
 
-/*
- * PKCS10 object.
- */
+  return ASN1_TIME_to_Python(self->manifest->thisUpdate);
+
+ error:
+  return NULL;
+}
+
+static char manifest_object_set_next_update__doc__[] =
+  "Set this manifest's \"nextUpdate\" value.\n"
+  "\n"
+  "The \"time\" parameter should be a datetime object.\n"
+  ;
 
 static PyObject *
-pkcs10_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+manifest_object_set_next_update (manifest_object *self, PyObject *args)
+{
+  ASN1_TIME *t = NULL;
+  PyObject *o = NULL;
+
+  ENTERING(manifest_object_set_next_update);
+
+  if (!PyArg_ParseTuple(args, "O", &o))
+    goto error;
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't set nextUpdate value of unverified manifest"); 
+
+  if ((t = Python_to_ASN1_TIME(o, 0)) == NULL)
+    lose("Couldn't parse nextUpdate string");
+
+  ASN1_TIME_free(self->manifest->nextUpdate);
+  self->manifest->nextUpdate = t;
+  Py_RETURN_NONE;
+
+ error:
+  ASN1_TIME_free(t);
+  return NULL;
+}
+
+static char manifest_object_get_next_update__doc__[] =
+  "Return this manifest's \"nextUpdate\" value as a datetime.\n"
+  ;
+
+static PyObject *
+manifest_object_get_next_update (manifest_object *self)
+{
+  ENTERING(manifest_object_get_next_update);
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't extract nextUpdate value of unverified manifest");
+
+  return ASN1_TIME_to_Python(self->manifest->nextUpdate);
+
+ error:
+  return NULL;
+}
+
+static char manifest_object_get_algorithm__doc__[] =
+  "Return this manifest's fileHashAlg OID.\n"
+  ;
+
+static PyObject *
+manifest_object_get_algorithm(manifest_object *self)
+{
+  PyObject *result = NULL;
+
+  ENTERING(manifest_object_get_algorithm);
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't extract algorithm OID of unverified manifest");
+
+  result = ASN1_OBJECT_to_PyString(self->manifest->fileHashAlg);
+
+ error:
+  return result;
+}
+
+static char manifest_object_set_algorithm__doc__[] =
+  "Set this manifest's fileHashAlg OID.\n"
+  ;
+
+static PyObject *
+manifest_object_set_algorithm(manifest_object *self, PyObject *args)
+{
+  ASN1_OBJECT *oid = NULL;
+  const char *s = NULL;
+
+  ENTERING(manifest_object_set_algorithm);
+
+  if (!PyArg_ParseTuple(args, "s", &s))
+    goto error;
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't set algorithm OID for unverified manifest");
+
+  if ((oid = OBJ_txt2obj(s, 1)) == NULL)
+    lose_no_memory();
+
+  ASN1_OBJECT_free(self->manifest->fileHashAlg);
+  self->manifest->fileHashAlg = oid;
+  Py_RETURN_NONE;
+
+ error:
+  ASN1_OBJECT_free(oid);
+  return NULL;
+}
+
+static char manifest_object_add_files__doc__[] =
+  "Add a collection of <filename, hash> pairs to this manifest.\n"
+  "\n"
+  "The \"iterable\" parameter should be an iterable object supplying\n"
+  "returning two-element sequences; the first element of each sequence\n"
+  "should be the filename (a text string), the second element should be the\n"
+  "hash (a binary string).\n"
+  ;
+
+static PyObject *
+manifest_object_add_files(manifest_object *self, PyObject *args)
+{
+  PyObject *iterable = NULL;
+  PyObject *iterator = NULL;
+  PyObject *item = NULL;
+  PyObject *fast = NULL;
+  FileAndHash *fah = NULL;
+  char *file = NULL;
+  char *hash = NULL;
+  Py_ssize_t filelen, hashlen;
+  int ok = 0;
+
+  ENTERING(manifest_object_add_files);
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't add files to unverified manifest");
+
+  if (!PyArg_ParseTuple(args, "O", &iterable) ||
+      (iterator = PyObject_GetIter(iterable)) == NULL)
+    goto error;
+
+  while ((item = PyIter_Next(iterator)) != NULL) {
+
+    if ((fast = PySequence_Fast(item, "FileAndHash entry must be a sequence")) == NULL)
+      goto error;
+
+    if (PySequence_Fast_GET_SIZE(fast) != 2)
+      lose_type_error("FileAndHash entry must be two-element sequence");
+
+    if (PyString_AsStringAndSize(PySequence_Fast_GET_ITEM(fast, 0), &file, &filelen) < 0 ||
+        PyString_AsStringAndSize(PySequence_Fast_GET_ITEM(fast, 1), &hash, &hashlen) < 0)
+      goto error;
+
+    if ((fah = FileAndHash_new()) == NULL ||
+        !ASN1_OCTET_STRING_set(fah->file, (unsigned char *) file, filelen) ||
+        !ASN1_BIT_STRING_set(fah->hash, (unsigned char *) hash, hashlen) ||
+        !sk_FileAndHash_push(self->manifest->fileList, fah))
+      lose_no_memory();
+
+    fah->hash->flags &= ~7;
+    fah->hash->flags |= ASN1_STRING_FLAG_BITS_LEFT;
+
+    fah = NULL;
+    Py_XDECREF(item);
+    Py_XDECREF(fast);
+    item = fast = NULL;
+  }
+
+  ok = 1;
+
+ error:
+  Py_XDECREF(iterator);
+  Py_XDECREF(item);
+  Py_XDECREF(fast);
+  FileAndHash_free(fah);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+static char manifest_object_get_files__doc__[] =
+  "Return a tuple of <filename, hash> pairs representing the contents of\n"
+  "this manifest.\n"
+  ;
+
+static PyObject *
+manifest_object_get_files(manifest_object *self)
+{
+  PyObject *result = NULL;
+  PyObject *item = NULL;
+  int i;
+
+  ENTERING(manifest_object_get_files);
+
+  if (self->manifest == NULL)
+    lose_not_verified("Can't get files from unverified manifest");
+
+  if (self->manifest->fileList == NULL)
+    lose("Inexplicable NULL manifest fileList pointer");
+
+  if ((result = PyTuple_New(sk_FileAndHash_num(self->manifest->fileList))) == NULL)
+    goto error;
+
+  for (i = 0; i < sk_FileAndHash_num(self->manifest->fileList); i++) {
+    FileAndHash *fah = sk_FileAndHash_value(self->manifest->fileList, i);
+
+    item = Py_BuildValue("(s#s#)",
+                         ASN1_STRING_data(fah->file),
+                         (Py_ssize_t) ASN1_STRING_length(fah->file),
+                         ASN1_STRING_data(fah->hash),
+                         (Py_ssize_t) ASN1_STRING_length(fah->hash));
+    if (item == NULL)
+      goto error;
+
+    PyTuple_SET_ITEM(result, i, item);
+    item = NULL;
+  }
+
+  return result;
+
+ error:
+  Py_XDECREF(result);
+  Py_XDECREF(item);
+  return NULL;
+}
+
+static char manifest_object_sign__doc__[] =
+  "Sign this manifest.  See the CMS class's .sign() method for details.\n"
+  ;
+
+static PyObject *
+manifest_object_sign(manifest_object *self, PyObject *args)
+{
+  asymmetric_object *signkey = NULL;
+  x509_object *signcert = NULL;
+  PyObject *x509_iterable = Py_None;
+  PyObject *crl_iterable = Py_None;
+  char *oid = NULL;
+  unsigned flags = 0;
+  BIO *bio = NULL;
+  int ok = 0;
+
+  ENTERING(manifest_object_sign);
+
+  if (!PyArg_ParseTuple(args, "O!O!|OOsI",
+                        &POW_X509_Type, &signcert,
+                        &POW_Asymmetric_Type, &signkey,
+                        &x509_iterable,
+                        &crl_iterable,
+                        &oid,
+                        &flags))
+    goto error;
+
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
+
+  assert_no_unhandled_openssl_errors();
+
+  if (!ASN1_item_i2d_bio(ASN1_ITEM_rptr(Manifest), bio, self->manifest))
+    lose_openssl_error("Couldn't encode manifest");
+
+  assert_no_unhandled_openssl_errors();
+
+  if (!cms_object_sign_helper(&self->cms, bio, signcert, signkey,
+                              x509_iterable, crl_iterable, oid, flags))
+    lose_openssl_error("Couldn't sign manifest");
+
+  assert_no_unhandled_openssl_errors();
+
+  ok = 1;
+
+ error:
+  BIO_free(bio);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+static struct PyMethodDef manifest_object_methods[] = {
+  Define_Method(getVersion,			manifest_object_get_version,                    METH_NOARGS),
+  Define_Method(setVersion,			manifest_object_set_version,                    METH_VARARGS),
+  Define_Method(getManifestNumber,		manifest_object_get_manifest_number,            METH_NOARGS),
+  Define_Method(setManifestNumber,		manifest_object_set_manifest_number,            METH_VARARGS),
+  Define_Method(getThisUpdate,			manifest_object_get_this_update,                METH_NOARGS),
+  Define_Method(setThisUpdate,			manifest_object_set_this_update,                METH_VARARGS),
+  Define_Method(getNextUpdate,			manifest_object_get_next_update,                METH_NOARGS),
+  Define_Method(setNextUpdate,			manifest_object_set_next_update,                METH_VARARGS),
+  Define_Method(getAlgorithm,			manifest_object_get_algorithm,                  METH_NOARGS),
+  Define_Method(setAlgorithm,			manifest_object_set_algorithm,                  METH_VARARGS),
+  Define_Method(getFiles,			manifest_object_get_files,                      METH_NOARGS),
+  Define_Method(addFiles,			manifest_object_add_files,                      METH_VARARGS),
+  Define_Method(sign,				manifest_object_sign,                           METH_VARARGS),
+  Define_Method(verify,				manifest_object_verify,                         METH_KEYWORDS),
+  Define_Method(checkRPKIConformance,		manifest_object_check_rpki_conformance,         METH_KEYWORDS),
+  Define_Method(extractWithoutVerifying,	manifest_object_extract_without_verifying,      METH_NOARGS),
+  Define_Class_Method(pemRead,			manifest_object_pem_read,                       METH_VARARGS),
+  Define_Class_Method(pemReadFile,		manifest_object_pem_read_file,                  METH_VARARGS),
+  Define_Class_Method(derRead,			manifest_object_der_read,                       METH_VARARGS),
+  Define_Class_Method(derReadFile,		manifest_object_der_read_file,                  METH_VARARGS),
+  {NULL}
+};
+
+static char POW_Manifest_Type__doc__[] =
+  "This class provides access to RPKI manifest payload.\n"
+  "Most methods are inherited from or share code with the CMS class.\n"
+  ;
+
+static PyTypeObject POW_Manifest_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                            /* ob_size */
+  "rpki.POW.Manifest",                          /* tp_name */
+  sizeof(manifest_object),                      /* tp_basicsize */
+  0,                                            /* tp_itemsize */
+  (destructor)manifest_object_dealloc,          /* tp_dealloc */
+  0,                                            /* tp_print */
+  0,                                            /* tp_getattr */
+  0,                                            /* tp_setattr */
+  0,                                            /* tp_compare */
+  0,                                            /* tp_repr */
+  0,                                            /* tp_as_number */
+  0,                                            /* tp_as_sequence */
+  0,                                            /* tp_as_mapping */
+  0,                                            /* tp_hash */
+  0,                                            /* tp_call */
+  0,                                            /* tp_str */
+  0,                                            /* tp_getattro */
+  0,                                            /* tp_setattro */
+  0,                                            /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,     /* tp_flags */
+  POW_Manifest_Type__doc__,                     /* tp_doc */
+  0,                                            /* tp_traverse */
+  0,                                            /* tp_clear */
+  0,                                            /* tp_richcompare */
+  0,                                            /* tp_weaklistoffset */
+  0,                                            /* tp_iter */
+  0,                                            /* tp_iternext */
+  manifest_object_methods,                      /* tp_methods */
+  0,                                            /* tp_members */
+  0,                                            /* tp_getset */
+  &POW_CMS_Type,                                /* tp_base */
+  0,                                            /* tp_dict */
+  0,                                            /* tp_descr_get */
+  0,                                            /* tp_descr_set */
+  0,                                            /* tp_dictoffset */
+  0,                                            /* tp_init */
+  0,                                            /* tp_alloc */
+  manifest_object_new,                          /* tp_new */
+};
+
+
+
+/*
+ * ROA object.
+ */
+
+static PyObject *
+roa_object_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  roa_object *self = NULL;
+
+  ENTERING(roa_object_new);
+
+  if ((self = (roa_object *) cms_object_new(type, args, kwds)) != NULL &&
+      (self->roa = ROA_new()) != NULL)
+    return (PyObject *) self;
+
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static void
+roa_object_dealloc(roa_object *self)
+{
+  ENTERING(roa_object_dealloc);
+  ROA_free(self->roa);
+  cms_object_dealloc(&self->cms);
+}
+
+static char roa_object_verify__doc__[] =
+  "Verify this ROA against a trusted certificate store.\n"
+  "\n"
+  CMS_OBJECT_VERIFY_HELPER__DOC__
+  ;
+
+static PyObject *
+roa_object_verify(roa_object *self, PyObject *args, PyObject *kwds)
+{
+  BIO *bio = NULL;
+  int ok = 0;
+
+  ENTERING(roa_object_verify);
+
+  if ((bio = cms_object_verify_helper(&self->cms, args, kwds)) == NULL)
+    goto error;
+  
+  if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(ROA), bio, &self->roa))
+    lose_openssl_error("Couldn't decode ROA");
+
+  ok = 1;
+
+ error:
+  BIO_free(bio);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+
+static char roa_object_extract_without_verifying__doc__[] =
+  "Extract ROA payload from CMS wrapper without attempting CMS verification.\n"
+  "\n"
+  "NEVER USE THIS METHOD ON AN UNVERIFIED ROA!\n"
+  ;
+
+static PyObject *
+roa_object_extract_without_verifying(roa_object *self)
+{
+  const unsigned char *content = NULL;
+  long content_len = 0;
+
+  ENTERING(roa_object_extract_without_verifying);
+
+  /*
+   * Once decoded, the payload doesn't change, so don't do it again.
+   */
+
+  if (self->roa != NULL)
+    Py_RETURN_NONE;
+
+  if (!cms_object_get_econtent(&self->cms, &content, &content_len))
+    goto error;
+
+  if (!ASN1_item_d2i((ASN1_VALUE **) &self->roa, &content, content_len, ASN1_ITEM_rptr(ROA)))
+    lose_openssl_error("Couldn't decode ROA");
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
+}
+
+static char roa_object_check_rpki_conformance__doc__[] =
+  "Check this ROA for conformance to the RPKI profile.\n"
+  ;
+
+static PyObject *
+roa_object_check_rpki_conformance(roa_object *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"status", NULL};
+  PyObject *status = Py_None;
+
+  ENTERING(roa_object_check_rpki_conformance);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!", kwlist, &PySet_Type, &status))
+    goto error;
+
+  if (cms_object_get_cms(&self->cms) == NULL)
+    goto error;
+
+  if (!check_cms(self->cms.cms, status) || !check_roa(self->cms.cms, self->roa, status))
+    goto error;
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
+}
+
+static PyObject *
+roa_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+{
+  roa_object *self;
+
+  ENTERING(roa_object_pem_read_helper);
+
+  if ((self = (roa_object *) cms_object_pem_read_helper(type, bio)) != NULL) {
+    ROA_free(self->roa);
+    self->roa = NULL;
+  }
+
+  return (PyObject *) self;
+}
+
+static PyObject *
+roa_object_der_read_helper(PyTypeObject *type, BIO *bio)
+{
+  roa_object *self;
+
+  ENTERING(roa_object_der_read_helper);
+
+  if ((self = (roa_object *) cms_object_der_read_helper(type, bio)) != NULL) {
+    ROA_free(self->roa);
+    self->roa = NULL;
+  }
+
+  return (PyObject *) self;
+}
+
+static char roa_object_pem_read__doc__[] =
+  "Read a PEM-encoded ROA object from a string.\n"
+  ;
+
+static PyObject *
+roa_object_pem_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(roa_object_pem_read);
+  return read_from_string_helper(roa_object_pem_read_helper, type, args);
+}
+
+static char roa_object_pem_read_file__doc__[] =
+  "Read a PEM-encoded ROA object from a file.\n"
+  ;
+
+static PyObject *
+roa_object_pem_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(roa_object_pem_read_file);
+  return read_from_file_helper(roa_object_pem_read_helper, type, args);
+}
+
+static char roa_object_der_read__doc__[] =
+  "Read a DER-encoded ROA object from a string.\n"
+  ;
+
+static PyObject *
+roa_object_der_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(roa_object_der_read);
+  return read_from_string_helper(roa_object_der_read_helper, type, args);
+}
+
+static char roa_object_der_read_file__doc__[] =
+  "Read a DER-encoded ROA object from a file.\n"
+  ;
+
+static PyObject *
+roa_object_der_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(roa_object_der_read_file);
+  return read_from_file_helper(roa_object_der_read_helper, type, args);
+}
+
+static char roa_object_get_version__doc__[] =
+  "Return the version number of this ROA.\n"
+  ;
+
+static PyObject *
+roa_object_get_version(roa_object *self)
+{
+  ENTERING(roa_object_get_version);
+
+  if (self->roa == NULL)
+    lose_not_verified("Can't get version of unverified ROA");
+
+  if (self->roa->version)
+    return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->roa->version));
+  else
+    return PyInt_FromLong(0);
+
+ error:
+  return NULL;
+}
+
+static char roa_object_set_version__doc__[] =
+  "Set the version number of this ROA.\n"
+  "\n"
+  "The \"version\" parameter should be a non-negative integer.\n"
+  "\n"
+  "As of this writing, zero is both the default and the only defined version.\n"
+  "Attempting to set any version number other than zero will fail, as we\n"
+  "don't understand how to write other versions, by definition.\n"
+  ;
+
+static PyObject *
+roa_object_set_version(roa_object *self, PyObject *args)
+{
+  int version = 0;
+
+  ENTERING(roa_object_set_version);
+
+  if (self->roa == NULL)
+    lose_not_verified("Can't set version of unverified ROA");
+
+  if (!PyArg_ParseTuple(args, "|i", &version))
+    goto error;
+
+  if (version != 0)
+    lose("RFC 6482 only defines ROA version zero");
+
+  ASN1_INTEGER_free(self->roa->version);
+  self->roa->version = NULL;
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
+}
+
+static char roa_object_get_asid__doc__[] =
+  "Return the Autonomous System ID of this ROA.\n"
+  ;
+
+static PyObject *
+roa_object_get_asid(roa_object *self)
+{
+  ENTERING(roa_object_get_asid);
+
+  if (self->roa == NULL)
+    lose_not_verified("Can't get ASN of unverified ROA");
+
+  return Py_BuildValue("N", ASN1_INTEGER_to_PyLong(self->roa->asID));
+
+ error:
+  return NULL;
+}
+
+static char roa_object_set_asid__doc__[] =
+  "Sets the Autonomous System ID of this ROA.\n"
+  "\n"
+  "The \"asID\" parameter should be a non-negative integer.\n"
+  ;
+
+static PyObject *
+roa_object_set_asid(roa_object *self, PyObject *args)
+{
+  PyObject *asID = NULL;
+  PyObject *zero = NULL;
+  int ok = 0;
+
+  ENTERING(roa_object_set_asid);
+
+  if (self->roa == NULL)
+    lose_not_verified("Can't set ASN of unverified ROA");
+
+  if (!PyArg_ParseTuple(args, "O", &asID))
+    goto error;
+
+  if ((zero = PyInt_FromLong(0)) == NULL)
+    goto error;
+
+  switch (PyObject_RichCompareBool(asID, zero, Py_GE)) {
+  case -1:
+    goto error;
+  case 0:
+    lose("Negative asID is not allowed");
+  }
+
+  ASN1_INTEGER_free(self->roa->asID);
+
+  if ((self->roa->asID = PyLong_to_ASN1_INTEGER(asID)) == NULL)
+    goto error;
+
+  ok = 1;
+
+ error:
+  Py_XDECREF(zero);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+static char roa_object_get_prefixes__doc__[] =
+  "Return this ROA's prefix list.  This is a two-element\n"
+  "tuple: the first element is the IPv4 prefix set, the second is the\n"
+  "IPv6 prefix set.\n"
+  "\n"
+  "Each prefix set is either None, if there are no prefixes for this IP\n"
+  "version, or a sequence of three-element tuple representing ROA prefix\n"
+  "entries.\n"
+  "\n"
+  "Each ROA prefix entry consists of the prefix itself (an IPAddress),\n"
+  "the prefix length (an integer), and the maxPrefixLen value, which is\n"
+  "either an integer or None depending on whether the maxPrefixLen value\n"
+  "is set for this prefix.\n"
+  ;
+
+/*
+ * Convert a ROA's prefix list to the Python representation described
+ * above.  Shared by ROA.getPrefixes() and roaPayload().
+ */
+static PyObject *
+roa_prefixes_helper(const ROA *roa)
+{
+  PyObject *result = NULL;
+  PyObject *ipv4_result = NULL;
+  PyObject *ipv6_result = NULL;
+  PyObject *item = NULL;
+  ipaddress_object *addr = NULL;
+  int i, j;
+
+  for (i = 0; i < sk_ROAIPAddressFamily_num(roa->ipAddrBlocks); i++) {
+    ROAIPAddressFamily *fam = sk_ROAIPAddressFamily_value(roa->ipAddrBlocks, i);
+    const unsigned afi = (fam->addressFamily->data[0] << 8) | (fam->addressFamily->data[1]);
+    const ipaddress_version *ip_type = NULL;
+    PyObject **resultp = NULL;
+
+    switch (afi) {
+    case IANA_AFI_IPV4: resultp = &ipv4_result; ip_type = &ipaddress_version_4; break;
+    case IANA_AFI_IPV6: resultp = &ipv6_result; ip_type = &ipaddress_version_6; break;
+    default:            lose_value_error("Unknown AFI");
+    }
+
+    if (fam->addressFamily->length > 2)
+      lose_value_error("Unsupported SAFI");
+
+    if (*resultp != NULL)
+      lose_value_error("Duplicate ROAIPAddressFamily");
+
+    if ((*resultp = PyTuple_New(sk_ROAIPAddress_num(fam->addresses))) == NULL)
+      goto error;
+
+    for (j = 0; j < sk_ROAIPAddress_num(fam->addresses); j++) {
+      ROAIPAddress *a = sk_ROAIPAddress_value(fam->addresses, j);
+      unsigned prefixlen = ((a->IPAddress)->length * 8 - ((a->IPAddress)->flags & 7));
+
+      if ((addr = (ipaddress_object *) POW_IPAddress_Type.tp_alloc(&POW_IPAddress_Type, 0)) == NULL)
+        goto error;
+
+      addr->type = ip_type;
+
+      memset(addr->address, 0, sizeof(addr->address));
+
+      if ((unsigned) a->IPAddress->length > addr->type->length)
+        lose("ROAIPAddress BIT STRING too long for AFI");
+
+      if (a->IPAddress->length > 0) {
+        memcpy(addr->address, a->IPAddress->data, a->IPAddress->length);
+
+        if ((a->IPAddress->flags & 7) != 0) {
+          unsigned char mask = 0xFF >> (8 - (a->IPAddress->flags & 7));
+          addr->address[a->IPAddress->length - 1] &= ~mask;
+        }
+      }
+
+      if (a->maxLength == NULL)
+        item = Py_BuildValue("(NIO)", addr, prefixlen, Py_None);
+      else
+        item = Py_BuildValue("(NIl)", addr, prefixlen, ASN1_INTEGER_get(a->maxLength));
+
+      if (item == NULL)
+        goto error;
+
+      PyTuple_SET_ITEM(*resultp, j, item);
+      item = NULL;
+      addr = NULL;
+    }
+  }
+
+  result = Py_BuildValue("(OO)",
+                         (ipv4_result == NULL ? Py_None : ipv4_result),
+                         (ipv6_result == NULL ? Py_None : ipv6_result));
+
+ error:                         /* Fall through */
+  Py_XDECREF(addr);
+  Py_XDECREF(item);
+  Py_XDECREF(ipv4_result);
+  Py_XDECREF(ipv6_result);
+
+  return result;
+}
+
+static PyObject *
+roa_object_get_prefixes(roa_object *self)
+{
+  ENTERING(roa_object_get_prefixes);
+
+  if (self->roa == NULL)
+    lose_not_verified("Can't get prefixes from unverified ROA");
+
+  return roa_prefixes_helper(self->roa);
+
+ error:
+  return NULL;
+}
+
+static char roa_object_set_prefixes__doc__[] =
+  "Set this ROA's prefix list.\n"
+  "\n"
+  "This method takes two arguments, \"ipv4\" and \"ipv6\".  Each of these\n"
+  "is either None, if no prefixes should be set for this IP version, or\n"
+  "an iterable object returning ROA prefix entries in the same format as\n"
+  "returned by the .getPrefixes() method.  The maxPrefixLen value may be\n"
+  "omitted (that is, the ROA prefix entry tuple may be of length two\n"
+  "rather than of length three); this will be taken as equivalent to\n"
+  "specifying a maxPrefixLen value of None.\n"
+  ;
+
+static PyObject *
+roa_object_set_prefixes(roa_object *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"ipv4", "ipv6", NULL};
+  STACK_OF(ROAIPAddressFamily) *prefixes = NULL;
+  ROAIPAddressFamily *fam = NULL;
+  ROAIPAddress *a = NULL;
+  PyObject *ipv4_arg = Py_None;
+  PyObject *ipv6_arg = Py_None;
+  PyObject *iterator = NULL;
+  PyObject *item = NULL;
+  PyObject *fast = NULL;
+  int ok = 0;
+  int v;
+
+  ENTERING(roa_object_set_prefixes);
+
+  if (self->roa == NULL)
+    lose_not_verified("Can't set prefixes of unverified ROA");
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO", kwlist, &ipv4_arg, &ipv6_arg))
+    goto error;
+
+  if ((prefixes = sk_ROAIPAddressFamily_new_null()) == NULL)
+    lose_no_memory();
+
+  for (v = 0; v < (int) (sizeof(ipaddress_versions)/sizeof(*ipaddress_versions)); v++) {
+    const struct ipaddress_version *ip_type = ipaddress_versions[v];
+    unsigned char afibuf[2];
+    PyObject **argp;
+
+    switch (ip_type->version) {
+    case 4: argp = &ipv4_arg; break;
+    case 6: argp = &ipv6_arg; break;
+    default: continue;
+    }
+
+    if (*argp == Py_None)
+      continue;
+
+    afibuf[0] = (ip_type->afi >> 8) & 0xFF;
+    afibuf[1] = (ip_type->afi     ) & 0xFF;
+
+    if ((iterator = PyObject_GetIter(*argp)) == NULL)
+      goto error;
+
+    while ((item = PyIter_Next(iterator)) != NULL) {
+      unsigned prefixlen, maxprefixlen, bitlen, bytelen;
+      ipaddress_object *addr = NULL;
+      PyObject *maxlenobj = Py_None;
+
+      if ((fast = PySequence_Fast(item, "ROA prefix must be a sequence")) == NULL)
+        goto error;
+
+      switch (PySequence_Fast_GET_SIZE(fast)) {
+      case 3:
+        maxlenobj = PySequence_Fast_GET_ITEM(fast, 2);
+        /* Fall through */
+      case 2:
+        if (!POW_IPAddress_Check(PySequence_Fast_GET_ITEM(fast, 0)))
+          lose_type_error("First element of ROA prefix must be an IPAddress object");
+        addr = (ipaddress_object *) PySequence_Fast_GET_ITEM(fast, 0);
+        prefixlen = (unsigned) PyInt_AsLong(PySequence_Fast_GET_ITEM(fast, 1));
+        if (PyErr_Occurred())
+          goto error;
+        break;
+      default:
+        lose_type_error("ROA prefix must be a two- or three-element sequence");
+      }
+
+      if (maxlenobj == Py_None) {
+        maxprefixlen = prefixlen;
+      } else {
+        maxprefixlen = (unsigned) PyInt_AsLong(maxlenobj);
+        if (PyErr_Occurred())
+          goto error;
+      }
+
+      if (addr->type != ip_type)
+        lose_value_error("Bad ROA prefix");
+
+      if (prefixlen > addr->type->length * 8)
+        lose("Bad prefix length");
+
+      if (maxprefixlen > addr->type->length * 8 || maxprefixlen < prefixlen)
+        lose("Bad maxLength value");
+
+      bytelen = (prefixlen + 7) / 8;
+      bitlen = prefixlen % 8;
+
+      if ((a = ROAIPAddress_new()) == NULL ||
+          (a->IPAddress == NULL && (a->IPAddress = ASN1_BIT_STRING_new()) == NULL) ||
+          !ASN1_BIT_STRING_set(a->IPAddress, addr->address, bytelen))
+        lose_no_memory();
+
+      a->IPAddress->flags &= ~7;
+      a->IPAddress->flags |= ASN1_STRING_FLAG_BITS_LEFT;
+      if (bitlen > 0) {
+        a->IPAddress->data[bytelen - 1] &= ~(0xFF >> bitlen);
+        a->IPAddress->flags |= 8 - bitlen;
+      }
+
+      if (prefixlen != maxprefixlen &&
+          ((a->maxLength = ASN1_INTEGER_new()) == NULL ||
+           !ASN1_INTEGER_set(a->maxLength, maxprefixlen)))
+        lose_no_memory();
+
+      if (fam == NULL &&
+          ((fam = ROAIPAddressFamily_new()) == NULL ||
+           !sk_ROAIPAddressFamily_push(prefixes, fam) ||
+           !ASN1_OCTET_STRING_set(fam->addressFamily, afibuf, sizeof(afibuf))))
+        lose_no_memory();
+
+      if (!sk_ROAIPAddress_push(fam->addresses, a))
+        lose_no_memory();
+
+      a = NULL;
+      Py_XDECREF(item);
+      Py_XDECREF(fast);
+      item = fast = NULL;
+    }
+
+    fam = NULL;
+    Py_XDECREF(iterator);
+    iterator = NULL;
+  }
+
+  sk_ROAIPAddressFamily_pop_free(self->roa->ipAddrBlocks, ROAIPAddressFamily_free);
+  self->roa->ipAddrBlocks = prefixes;
+  prefixes = NULL;
+
+  ok = 1;
+
+ error:
+  sk_ROAIPAddressFamily_pop_free(prefixes, ROAIPAddressFamily_free);
+  ROAIPAddressFamily_free(fam);
+  ROAIPAddress_free(a);
+  Py_XDECREF(iterator);
+  Py_XDECREF(item);
+  Py_XDECREF(fast);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+static char roa_object_sign__doc__[] =
+  "Sign this ROA.  See CMS.sign() for details.\n"
+  ;
+
+static PyObject *
+roa_object_sign(roa_object *self, PyObject *args)
+{
+  asymmetric_object *signkey = NULL;
+  x509_object *signcert = NULL;
+  PyObject *x509_iterable = Py_None;
+  PyObject *crl_iterable = Py_None;
+  char *oid = NULL;
+  unsigned flags = 0;
+  BIO *bio = NULL;
+  int ok = 0;
+
+  ENTERING(roa_object_sign);
+
+  if (!PyArg_ParseTuple(args, "O!O!|OOsI",
+                        &POW_X509_Type, &signcert,
+                        &POW_Asymmetric_Type, &signkey,
+                        &x509_iterable,
+                        &crl_iterable,
+                        &oid,
+                        &flags))
+    goto error;
+
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
+
+  assert_no_unhandled_openssl_errors();
+
+  if (!ASN1_item_i2d_bio(ASN1_ITEM_rptr(ROA), bio, self->roa))
+    lose_openssl_error("Couldn't encode ROA");
+
+  assert_no_unhandled_openssl_errors();
+
+  if (!cms_object_sign_helper(&self->cms, bio, signcert, signkey,
+                              x509_iterable, crl_iterable, oid, flags))
+    lose_openssl_error("Couldn't sign ROA");
+
+  assert_no_unhandled_openssl_errors();
+
+  ok = 1;
+
+ error:
+  BIO_free(bio);
+
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+static struct PyMethodDef roa_object_methods[] = {
+  Define_Method(getVersion,                     roa_object_get_version,                 METH_NOARGS),
+  Define_Method(setVersion,                     roa_object_set_version,                 METH_VARARGS),
+  Define_Method(getASID,                        roa_object_get_asid,                    METH_NOARGS),
+  Define_Method(setASID,                        roa_object_set_asid,                    METH_VARARGS),
+  Define_Method(getPrefixes,                    roa_object_get_prefixes,                METH_NOARGS),
+  Define_Method(setPrefixes,                    roa_object_set_prefixes,                METH_KEYWORDS),
+  Define_Method(sign,                           roa_object_sign,                        METH_VARARGS),
+  Define_Method(verify,                         roa_object_verify,                      METH_KEYWORDS),
+  Define_Method(extractWithoutVerifying,        roa_object_extract_without_verifying,   METH_NOARGS),
+  Define_Method(checkRPKIConformance,           roa_object_check_rpki_conformance,      METH_KEYWORDS),
+  Define_Class_Method(pemRead,                  roa_object_pem_read,                    METH_VARARGS),
+  Define_Class_Method(pemReadFile,              roa_object_pem_read_file,               METH_VARARGS),
+  Define_Class_Method(derRead,                  roa_object_der_read,                    METH_VARARGS),
+  Define_Class_Method(derReadFile,              roa_object_der_read_file,               METH_VARARGS),
+  {NULL}
+};
+
+static char POW_ROA_Type__doc__[] =
+  "This class provides access to RPKI ROA payload.\n"
+  "Most methods are inherited from or share code with the CMS class.\n"
+  ;
+
+static PyTypeObject POW_ROA_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                            /* ob_size */
+  "rpki.POW.ROA",                               /* tp_name */
+  sizeof(roa_object),                           /* tp_basicsize */
+  0,                                            /* tp_itemsize */
+  (destructor)roa_object_dealloc,               /* tp_dealloc */
+  0,                                            /* tp_print */
+  0,                                            /* tp_getattr */
+  0,                                            /* tp_setattr */
+  0,                                            /* tp_compare */
+  0,                                            /* tp_repr */
+  0,                                            /* tp_as_number */
+  0,                                            /* tp_as_sequence */
+  0,                                            /* tp_as_mapping */
+  0,                                            /* tp_hash */
+  0,                                            /* tp_call */
+  0,                                            /* tp_str */
+  0,                                            /* tp_getattro */
+  0,                                            /* tp_setattro */
+  0,                                            /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,     /* tp_flags */
+  POW_ROA_Type__doc__,                          /* tp_doc */
+  0,                                            /* tp_traverse */
+  0,                                            /* tp_clear */
+  0,                                            /* tp_richcompare */
+  0,                                            /* tp_weaklistoffset */
+  0,                                            /* tp_iter */
+  0,                                            /* tp_iternext */
+  roa_object_methods,                           /* tp_methods */
+  0,                                            /* tp_members */
+  0,                                            /* tp_getset */
+  &POW_CMS_Type,                                /* tp_base */
+  0,                                            /* tp_dict */
+  0,                                            /* tp_descr_get */
+  0,                                            /* tp_descr_set */
+  0,                                            /* tp_dictoffset */
+  0,                                            /* tp_init */
+  0,                                            /* tp_alloc */
+  roa_object_new,                               /* tp_new */
+};
+
+
+
+/*
+ * PKCS10 object.
+ */
+
+static PyObject *
+pkcs10_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+{
+  pkcs10_object *self;
+
+  ENTERING(pkcs10_object_new);
+
+  if ((self = (pkcs10_object *) type->tp_alloc(type, 0)) != NULL &&
+      (self->pkcs10 = X509_REQ_new()) != NULL &&
+      (self->exts = sk_X509_EXTENSION_new_null()) != NULL)
+    return (PyObject *) self;
+
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static void
+pkcs10_object_dealloc(pkcs10_object *self)
+{
+  ENTERING(pkcs10_object_dealloc);
+  X509_REQ_free(self->pkcs10);
+  sk_X509_EXTENSION_pop_free(self->exts, X509_EXTENSION_free);
+  self->ob_type->tp_free((PyObject*) self);
+}
+
+static PyObject *
+pkcs10_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+{
+  pkcs10_object *self = NULL;
+
+  ENTERING(pkcs10_object_pem_read_helper);
+
+  assert_no_unhandled_openssl_errors();
+
+  if ((self = (pkcs10_object *) pkcs10_object_new(type, NULL, NULL)) == NULL)
+    goto error;
+
+  assert_no_unhandled_openssl_errors();
+
+  if (!PEM_read_bio_X509_REQ(bio, &self->pkcs10, NULL, NULL))
+    lose_openssl_error("Couldn't load PEM encoded PKCS#10 request");
+
+  sk_X509_EXTENSION_pop_free(self->exts, X509_EXTENSION_free);
+  self->exts = X509_REQ_get_extensions(self->pkcs10);
+
+  assert_no_unhandled_openssl_errors();
+
+  return (PyObject *) self;
+
+ error:
+
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static PyObject *
+pkcs10_object_der_read_helper(PyTypeObject *type, BIO *bio)
+{
+  pkcs10_object *self = NULL;
+  const unsigned char *der;
+  long len = 0;
+
+  ENTERING(pkcs10_object_der_read_helper);
+
+  assert_no_unhandled_openssl_errors();
+
+  if ((self = (pkcs10_object *) pkcs10_object_new(type, NULL, NULL)) == NULL)
+    goto error;
+
+  assert_no_unhandled_openssl_errors();
+
+  if ((der = mem_bio_der(bio, &len)) != NULL
+      ? !d2i_X509_REQ(&self->pkcs10, &der, len)
+      : !d2i_X509_REQ_bio(bio, &self->pkcs10))
+    lose_openssl_error("Couldn't load DER encoded PKCS#10 request");
+
+  sk_X509_EXTENSION_pop_free(self->exts, X509_EXTENSION_free);
+  self->exts = X509_REQ_get_extensions(self->pkcs10);
+
+  assert_no_unhandled_openssl_errors();
+
+  return (PyObject *) self;
+
+ error:
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static char pkcs10_object_pem_read__doc__[] =
+  "Read a PEM-encoded PKCS#10 object from a string.\n"
+  ;
+
+static PyObject *
+pkcs10_object_pem_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(pkcs10_object_pem_read);
+  return read_from_string_helper(pkcs10_object_pem_read_helper, type, args);
+}
+
+static char pkcs10_object_pem_read_file__doc__[] =
+  "Read a PEM-encoded PKCS#10 object from a file.\n"
+  ;
+
+static PyObject *
+pkcs10_object_pem_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(pkcs10_object_pem_read_file);
+  return read_from_file_helper(pkcs10_object_pem_read_helper, type, args);
+}
+
+static char pkcs10_object_der_read__doc__[] =
+  "Read a DER-encoded PKCS#10 object from a string.\n"
+  ;
+
+static PyObject *
+pkcs10_object_der_read(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(pkcs10_object_der_read);
+  return read_from_string_helper(pkcs10_object_der_read_helper, type, args);
+}
+
+static char pkcs10_object_der_read_file__doc__[] =
+  "Read a DER-encoded PKCS#10 object from a file.\n"
+  ;
+
+static PyObject *
+pkcs10_object_der_read_file(PyTypeObject *type, PyObject *args)
+{
+  ENTERING(pkcs10_object_der_read_file);
+  return read_from_file_helper(pkcs10_object_der_read_helper, type, args);
+}
+
+static char pkcs10_object_pem_write__doc__[] =
+  "Returns the PEM encoding of this PKCS#10 object.\n"
+  ;
+
+static PyObject *
+pkcs10_object_pem_write(pkcs10_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
+
+  ENTERING(pkcs10_object_pem_write);
+
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
+
+  if (!PEM_write_bio_X509_REQ(bio, self->pkcs10))
+    lose_openssl_error("Unable to write PKCS#10 request");
+
+  result = BIO_to_PyString_helper(bio);
+
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
+
+static char pkcs10_object_der_write__doc__[] =
+  "Return the DER encoding of this PKCS#10 object.\n"
+  ;
+
+static PyObject *
+pkcs10_object_der_write(pkcs10_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
+
+  ENTERING(pkcs10_object_der_write);
+
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
+
+  if (!i2d_X509_REQ_bio(bio, self->pkcs10))
+    lose_openssl_error("Unable to write PKCS#10 request");
+
+  result = BIO_to_PyString_helper(bio);
+
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
+
+static X509_EXTENSION *
+pkcs10_object_extension_get_helper(pkcs10_object *self, int nid)
+{
+  if (self != NULL && self->exts != NULL)
+    return X509v3_get_ext(self->exts, X509v3_get_ext_by_NID(self->exts, nid, -1));
+  else
+    return NULL;
+}
+
+static PyObject *
+pkcs10_object_extension_set_helper(pkcs10_object *self, extension_wrapper ext)
+{
+  int ok = 0;
+
+  if (ext.value == NULL)
+    goto error;
+
+  if (!X509V3_add1_i2d(&self->exts, ext.nid, ext.value, ext.critical, X509V3_ADD_REPLACE))
+    lose_openssl_error("Couldn't add extension to PKCS #10 object");
+
+  ok = 1;
+
+ error:
+  ext.destructor(ext.value);
+  if (ok)
+    Py_RETURN_NONE;
+  else
+    return NULL;
+}
+
+static char pkcs10_object_get_public_key__doc__[] =
+  "Return the public key from this PKCS#10 request, as an Asymmetric\n"
+  "object.\n"
+  ;
+
+static PyObject *
+pkcs10_object_get_public_key(pkcs10_object *self)
+{
+  PyTypeObject *type = &POW_Asymmetric_Type;
+  asymmetric_object *asym = NULL;
+
+  ENTERING(pkcs10_object_get_public_key);
+
+  if ((asym = (asymmetric_object *) type->tp_alloc(type, 0)) == NULL)
+    goto error;
+
+  if ((asym->pkey = X509_REQ_get_pubkey(self->pkcs10)) == NULL)
+    lose_openssl_error("Couldn't extract public key from PKCS#10 request");
+
+  whack_ec_key_to_namedCurve(asym->pkey);
+
+  return (PyObject *) asym;
+
+ error:
+  Py_XDECREF(asym);
+  return NULL;
+}
+
+static char pkcs10_object_set_public_key__doc__[] =
+  "Set the public key for this PKCS#10 request.\n"
+  "\n"
+  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
+  "containing a public key.\n"
+  ;
+
+static PyObject *
+pkcs10_object_set_public_key(pkcs10_object *self, PyObject *args)
+{
+  asymmetric_object *asym;
+
+  ENTERING(pkcs10_object_set_public_key);
+
+  if (!PyArg_ParseTuple(args, "O!", &POW_Asymmetric_Type, &asym))
+    goto error;
+
+  if (!X509_REQ_set_pubkey(self->pkcs10, asym->pkey))
+    lose_openssl_error("Couldn't set certificate's PKCS#10 request");
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
+}
+
+static char pkcs10_object_sign__doc__[] =
+  "Sign a PKCS#10 request with a private key.\n"
+  "\n"
+  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
+  "containing a private key.\n"
+  "\n"
+  "The optional \"digest\" parameter indicates which digest to compute and\n"
+  "sign, and should be one of the following:\n"
+  "\n"
+  "* SHA1_DIGEST\n"
+  "* SHA256_DIGEST\n"
+  "* SHA384_DIGEST\n"
+  "* SHA512_DIGEST\n"
+  "\n"
+  "The default digest algorithm is SHA-256.\n"
+  ;
+
+static PyObject *
+pkcs10_object_sign(pkcs10_object *self, PyObject *args)
+{
+  asymmetric_object *asym;
+  int ok, loc, digest_type = SHA256_DIGEST;
+  const EVP_MD *digest_method = NULL;
+
+  ENTERING(pkcs10_object_sign);
+
+  if (!PyArg_ParseTuple(args, "O!|i", &POW_Asymmetric_Type, &asym, &digest_type))
+    goto error;
+
+  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
+    lose("Unsupported digest algorithm");
+
+  while ((loc = X509_REQ_get_attr_by_NID(self->pkcs10, NID_ext_req, -1)) >= 0)
+    X509_ATTRIBUTE_free(X509_REQ_delete_attr(self->pkcs10, loc));
+
+  if (sk_X509_EXTENSION_num(self->exts) > 0 &&
+      !X509_REQ_add_extensions(self->pkcs10, self->exts))
+    lose_openssl_error("Couldn't add extensions block to PKCS#10 request");
+
+  Py_BEGIN_ALLOW_THREADS
+  ok = X509_REQ_sign(self->pkcs10, asym->pkey, digest_method);
+  Py_END_ALLOW_THREADS
+
+  if (!ok)
+    lose_openssl_error("Couldn't sign PKCS#10 request");
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
+}
+
+static char pkcs10_object_verify__doc__[] =
+  "Verify a PKCS#10 request.\n"
+  "\n"
+  "This calls OpenSSL's X509_REQ_verify() method to check the request's\n"
+  "self-signature.\n"
+  ;
+
+static PyObject *
+pkcs10_object_verify(pkcs10_object *self)
+{
+  EVP_PKEY *pkey = NULL;
+  int status;
+
+  ENTERING(pkcs10_object_verify);
+
+  if ((pkey = X509_REQ_get_pubkey(self->pkcs10)) == NULL)
+    lose_openssl_error("Couldn't extract public key from PKCS#10 for verification");
+
+  Py_BEGIN_ALLOW_THREADS
+  status = X509_REQ_verify(self->pkcs10, pkey);
+  Py_END_ALLOW_THREADS
+
+  if (status < 0)
+    lose_openssl_error("Couldn't verify PKCS#10 signature");
+
+  EVP_PKEY_free(pkey);
+  return PyBool_FromLong(status);
+
+ error:
+  EVP_PKEY_free(pkey);
+  return NULL;
+}
+
+static char pkcs10_object_get_version__doc__[] =
+  "Return the version number of this PKCS#10 request.\n"
+  ;
+
+static PyObject *
+pkcs10_object_get_version(pkcs10_object *self)
+{
+  ENTERING(pkcs10_object_get_version);
+  return Py_BuildValue("l", X509_REQ_get_version(self->pkcs10));
+}
+
+static char pkcs10_object_set_version__doc__[] =
+  "Set the version number of this PKCS#10 request.\n"
+  "\n"
+  "The \"version\" parameter should be an integer, but the only defined\n"
+  "value is zero, so this field is optional and defaults to zero.\n"
+;
+
+static PyObject *
+pkcs10_object_set_version(pkcs10_object *self, PyObject *args)
+{
+  long version = 0;
+
+  ENTERING(pkcs10_object_set_version);
+
+  if (!PyArg_ParseTuple(args, "|l", &version))
+    goto error;
+
+  if (version != 0)
+    lose("RFC 6487 6.1.1 forbids non-zero values for this field");
+
+  if (!X509_REQ_set_version(self->pkcs10, version))
+    lose("Couldn't set certificate version");
+
+  Py_RETURN_NONE;
+
+ error:
+
+  return NULL;
+}
+
+static char pkcs10_object_get_subject__doc__[] =
+  "Return this PKCS #10 request's subject name.\n"
+  "\n"
+  "See the X509.getIssuer() method for details of the return value and\n"
+  "use of the optional \"format\" parameter.\n"
+  ;
+
+static PyObject *
+pkcs10_object_get_subject(pkcs10_object *self, PyObject *args)
+{
+  PyObject *result = NULL;
+  int format = OIDNAME_FORMAT;
+
+  ENTERING(pkcs10_object_get_subject);
+
+  if (!PyArg_ParseTuple(args, "|i", &format))
+    goto error;
+
+  result = x509_object_helper_get_name(X509_REQ_get_subject_name(self->pkcs10),
+                                       format);
+
+ error:                         /* Fall through */
+  return result;
+}
+
+static char pkcs10_object_set_subject__doc__[] =
+  "Set this PKCS#10 request's subject name.\n"
+  "\n"
+  "The \"name\" parameter should be in the same format as the return\n"
+  "value from the \"getSubject\" method.\n"
+  ;
+
+static PyObject *
+pkcs10_object_set_subject(pkcs10_object *self, PyObject *args)
+{
+  PyObject *name_sequence = NULL;
+  X509_NAME *name = NULL;
+
+  ENTERING(pkcs10_object_set_subject);
+
+  if (!PyArg_ParseTuple(args, "O", &name_sequence))
+    goto error;
+
+  if (!PySequence_Check(name_sequence))
+    lose_type_error("Expected a sequence object");
+
+  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
+    goto error;
+
+  if (!X509_REQ_set_subject_name(self->pkcs10, name))
+    lose("Unable to set subject name");
+
+  X509_NAME_free(name);
+
+  Py_RETURN_NONE;
+
+ error:
+  X509_NAME_free(name);
+  return NULL;
+}
+
+static char pkcs10_object_get_key_usage__doc__[] =
+  EXTENSION_GET_KEY_USAGE__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_get_key_usage(pkcs10_object *self)
+{
+  return extension_get_key_usage(pkcs10_object_extension_get_helper(self, NID_key_usage));
+}
+
+static char pkcs10_object_set_key_usage__doc__[] =
+  "Set the KeyUsage extension for this PKCS#10 request.\n"
+  "\n"
+  EXTENSION_SET_KEY_USAGE__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_set_key_usage(pkcs10_object *self, PyObject *args)
+{
+  return pkcs10_object_extension_set_helper(self, extension_set_key_usage(args));
+}
+
+static char pkcs10_object_get_eku__doc__[] =
+  EXTENSION_GET_EKU__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_get_eku(pkcs10_object *self)
+{
+  return extension_get_eku(pkcs10_object_extension_get_helper(self, NID_ext_key_usage));
+}
+
+static char pkcs10_object_set_eku__doc__[] =
+  "Set the ExtendedKeyUsage extension for this PKCS #10 request.\n"
+  "\n"
+  EXTENSION_SET_EKU__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_set_eku(pkcs10_object *self, PyObject *args)
+{
+  return pkcs10_object_extension_set_helper(self, extension_set_eku(args));
+}
+
+static char pkcs10_object_get_basic_constraints__doc__[] =
+  "Return BasicConstraints value for this PKCS#10 request.\n"
+  "\n"
+  EXTENSION_GET_BASIC_CONSTRAINTS__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_get_basic_constraints(pkcs10_object *self)
+{
+  return extension_get_basic_constraints(pkcs10_object_extension_get_helper(self, NID_basic_constraints));
+}
+
+static char pkcs10_object_set_basic_constraints__doc__[] =
+  "Set BasicConstraints value for this PKCS#10 request.\n"
+  "\n"
+  EXTENSION_SET_BASIC_CONSTRAINTS__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_set_basic_constraints(pkcs10_object *self, PyObject *args)
+{
+  return pkcs10_object_extension_set_helper(self, extension_set_basic_constraints(args));
+}
+
+static char pkcs10_object_get_sia__doc__[] =
+  "Return the SIA values for this PKCS#10 request.\n"
+  "\n"
+  EXTENSION_GET_SIA__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_get_sia(pkcs10_object *self)
+{
+  return extension_get_sia(pkcs10_object_extension_get_helper(self, NID_sinfo_access));
+}
+
+static char pkcs10_object_set_sia__doc__[] =
+  "Set SIA values for this PKCS#10 request.\n"
+  "\n"
+  EXTENSION_SET_SIA__DOC__
+  ;
+
+static PyObject *
+pkcs10_object_set_sia(pkcs10_object *self, PyObject *args, PyObject *kwds)
+{
+  return pkcs10_object_extension_set_helper(self, extension_set_sia(args, kwds));
+}
+
+static char pkcs10_object_get_signature_algorithm__doc__[] =
+  "Return this PKCS #10 reqeuest's signature algorithm OID.\n"
+  ;
+
+static PyObject *
+pkcs10_object_get_signature_algorithm(pkcs10_object *self)
+{
+  ASN1_OBJECT *oid = NULL;
+
+  ENTERING(pkcs10_object_get_signature_algorithm);
+
+  X509_ALGOR_get0(&oid, NULL, NULL, self->pkcs10->sig_alg);
+
+  return ASN1_OBJECT_to_PyString(oid);
+}
+
+static char pkcs10_object_get_extension_oids__doc__[] =
+  "Return the set of extension OIDs used in this request.  This is mostly\n"
+  "useful for enforcing restrictions on what extensions are allowed to be\n"
+  "present, eg, to conform with the RPKI profile.\n"
+  ;
+
+static PyObject *
+pkcs10_object_get_extension_oids(pkcs10_object *self)
+{
+  PyObject *result = NULL;
+  PyObject *oid = NULL;
+  int i;
+
+  ENTERING(pkcs10_object_get_extension_oids);
+
+  if ((result = PyFrozenSet_New(NULL)) == NULL)
+    goto error;
+
+  for (i = 0; i < sk_X509_EXTENSION_num(self->exts); i++) {
+    X509_EXTENSION *ext = sk_X509_EXTENSION_value(self->exts, i);
+    if ((oid = ASN1_OBJECT_to_PyString(X509_EXTENSION_get_object(ext))) == NULL ||
+        PySet_Add(result, oid) < 0)
+      goto error;
+    Py_XDECREF(oid);
+    oid = NULL;
+  }
+
+  return result;
+
+ error:
+  Py_XDECREF(result);
+  Py_XDECREF(oid);
+  return NULL;  
+}
+
+static char pkcs10_object_pprint__doc__[] =
+  "Return a pretty-printed rendition of this PKCS#10 request.\n"
+  ;
+
+static PyObject *
+pkcs10_object_pprint(pkcs10_object *self)
+{
+  PyObject *result = NULL;
+  BIO *bio = NULL;
+
+  ENTERING(pkcs10_object_pprint);
+
+  if ((bio = BIO_new(BIO_s_mem())) == NULL)
+    lose_no_memory();
+
+  if (!X509_REQ_print(bio, self->pkcs10))
+    lose_openssl_error("Unable to pretty-print PKCS#10 request");
+
+  result = BIO_to_PyString_helper(bio);
+
+ error:                         /* Fall through */
+  BIO_free(bio);
+  return result;
+}
+
+static struct PyMethodDef pkcs10_object_methods[] = {
+  Define_Method(pemWrite,               pkcs10_object_pem_write,                METH_NOARGS),
+  Define_Method(derWrite,               pkcs10_object_der_write,                METH_NOARGS),
+  Define_Method(sign,                   pkcs10_object_sign,                     METH_VARARGS),
+  Define_Method(verify,                 pkcs10_object_verify,                   METH_NOARGS),
+  Define_Method(getPublicKey,           pkcs10_object_get_public_key,           METH_NOARGS),
+  Define_Method(setPublicKey,           pkcs10_object_set_public_key,           METH_VARARGS),
+  Define_Method(getVersion,             pkcs10_object_get_version,              METH_NOARGS),
+  Define_Method(setVersion,             pkcs10_object_set_version,              METH_VARARGS),
+  Define_Method(getSubject,             pkcs10_object_get_subject,              METH_VARARGS),
+  Define_Method(setSubject,             pkcs10_object_set_subject,              METH_VARARGS),
+  Define_Method(pprint,                 pkcs10_object_pprint,                   METH_NOARGS),
+  Define_Method(getKeyUsage,            pkcs10_object_get_key_usage,            METH_NOARGS),
+  Define_Method(setKeyUsage,            pkcs10_object_set_key_usage,            METH_VARARGS),
+  Define_Method(getEKU,                 pkcs10_object_get_eku,                  METH_NOARGS),
+  Define_Method(setEKU,                 pkcs10_object_set_eku,                  METH_VARARGS),
+  Define_Method(getBasicConstraints,    pkcs10_object_get_basic_constraints,    METH_NOARGS),
+  Define_Method(setBasicConstraints,    pkcs10_object_set_basic_constraints,    METH_VARARGS),
+  Define_Method(getSIA,                 pkcs10_object_get_sia,                  METH_NOARGS),
+  Define_Method(setSIA,                 pkcs10_object_set_sia,                  METH_KEYWORDS),
+  Define_Method(getSignatureAlgorithm,  pkcs10_object_get_signature_algorithm,  METH_NOARGS),
+  Define_Method(getExtensionOIDs,       pkcs10_object_get_extension_oids,       METH_NOARGS),
+  Define_Class_Method(pemRead,          pkcs10_object_pem_read,                 METH_VARARGS),
+  Define_Class_Method(pemReadFile,      pkcs10_object_pem_read_file,            METH_VARARGS),
+  Define_Class_Method(derRead,          pkcs10_object_der_read,                 METH_VARARGS),
+  Define_Class_Method(derReadFile,      pkcs10_object_der_read_file,            METH_VARARGS),
+  {NULL}
+};
+
+static char POW_PKCS10_Type__doc__[] =
+  "This class represents a PKCS#10 request.\n"
+  ;
+
+static PyTypeObject POW_PKCS10_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                        /* ob_size */
+  "rpki.POW.PKCS10",                        /* tp_name */
+  sizeof(pkcs10_object),                    /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)pkcs10_object_dealloc,        /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  0,                                        /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_PKCS10_Type__doc__,                   /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  pkcs10_object_methods,                    /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  0,                                        /* tp_init */
+  0,                                        /* tp_alloc */
+  pkcs10_object_new,                        /* tp_new */
+};
+
+
+
+/*
+ * RPKI-RTR PDU codec.  The packed representation of a set of RPKI-RTR
+ * payload PDUs is simply their wire format, concatenated; this is
+ * what the rpki-rtr cronjob writes to its AXFR and IXFR files, so
+ * encoding, sorting, and diffing in this form keeps the whole pipeline
+ * free of per-PDU Python objects.  Lexical ordering of the wire format
+ * is the ordering used by the Python PDU classes, so results are
+ * byte-for-byte identical to what the pure Python code produced.
+ */
+
+#define RTR_PDU_TYPE_IPV4_PREFIX        4
+#define RTR_PDU_TYPE_IPV6_PREFIX        6
+#define RTR_PDU_TYPE_ROUTER_KEY         9
+
+#define RTR_PDU_HEADER_LENGTH           8
+#define RTR_PDU_IPV4_PREFIX_LENGTH      20
+#define RTR_PDU_IPV6_PREFIX_LENGTH      32
+#define RTR_PDU_ROUTER_KEY_MIN_LENGTH   32
+
+typedef struct {
+  const unsigned char *pdu;
+  size_t len;
+} rtr_pdu;
+
+static uint32_t
+rtr_get_u32(const unsigned char *b)
+{
+  return (((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) |
+          ((uint32_t) b[2] <<  8) | ((uint32_t) b[3]));
+}
+
+static void
+rtr_put_u32(unsigned char *b, uint32_t u)
+{
+  b[0] = (unsigned char) (u >> 24);
+  b[1] = (unsigned char) (u >> 16);
+  b[2] = (unsigned char) (u >>  8);
+  b[3] = (unsigned char) (u);
+}
+
+/*
+ * Offset of the flags (announce/withdraw) byte in a payload PDU.
+ */
+
+static int
+rtr_pdu_flags_offset(const unsigned char *pdu)
+{
+  return pdu[1] == RTR_PDU_TYPE_ROUTER_KEY ? 2 : 8;
+}
+
+static int
+rtr_pdu_cmp(const void *a_, const void *b_)
+{
+  const rtr_pdu *a = a_, *b = b_;
+  int c = memcmp(a->pdu, b->pdu, a->len < b->len ? a->len : b->len);
+  if (c != 0)
+    return c;
+  return a->len < b->len ? -1 : a->len > b->len;
+}
+
+/*
+ * Compare two payload PDUs ignoring their flags bytes, that is, by
+ * the wire format they would have if both were announcements.  This
+ * is the order of the sorted sets, so it is also the order in which
+ * rtrDiffPDUs() emits changes.
+ */
+
+static int
+rtr_pdu_key_cmp(const rtr_pdu *a, const rtr_pdu *b)
+{
+  const size_t off = rtr_pdu_flags_offset(a->pdu);
+  const size_t len = a->len < b->len ? a->len : b->len;
+  int c;
+
+  if ((c = memcmp(a->pdu, b->pdu, off)) != 0)
+    return c;
+  if (rtr_pdu_flags_offset(b->pdu) != off)
+    return (int) off - rtr_pdu_flags_offset(b->pdu);
+  if ((c = memcmp(a->pdu + off + 1, b->pdu + off + 1, len - off - 1)) != 0)
+    return c;
+  return a->len < b->len ? -1 : a->len > b->len;
+}
+
+/*
+ * Walk a buffer of concatenated PDUs, checking framing.  If payload
+ * is set, only prefix and router key PDUs of a single protocol
+ * version are accepted, and prefix PDUs must satisfy prefixlen <=
+ * maxlen <= address length, which the prefix table code relies on.
+ * If pdus is not NULL, it is filled in with the location of each PDU.
+ * Returns the number of PDUs, or -1 (with a Python exception set) if
+ * the buffer is not well formed.
+ */
+
+static Py_ssize_t
+rtr_pdu_split(const unsigned char *buf, size_t len, int payload, rtr_pdu *pdus)
+{
+  Py_ssize_t n = 0;
+  size_t i = 0;
+  uint32_t pdulen;
+  int ok;
+
+  while (i < len) {
+
+    if (len - i < RTR_PDU_HEADER_LENGTH)
+      lose_value_error("Truncated PDU header");
+
+    pdulen = rtr_get_u32(buf + i + 4);
+
+    if (pdulen < RTR_PDU_HEADER_LENGTH || pdulen > len - i)
+      lose_value_error("Bad PDU length");
+
+    if (payload) {
+      switch (buf[i + 1]) {
+      case RTR_PDU_TYPE_IPV4_PREFIX: ok = pdulen == RTR_PDU_IPV4_PREFIX_LENGTH;         break;
+      case RTR_PDU_TYPE_IPV6_PREFIX: ok = pdulen == RTR_PDU_IPV6_PREFIX_LENGTH;         break;
+      case RTR_PDU_TYPE_ROUTER_KEY:  ok = pdulen > RTR_PDU_ROUTER_KEY_MIN_LENGTH;       break;
+      default:                       lose_value_error("Unexpected PDU type in payload set");
+      }
+      if (!ok)
+        lose_value_error("Bad length for payload PDU");
+      if (buf[i + 1] != RTR_PDU_TYPE_ROUTER_KEY &&
+          (buf[i + 9] > buf[i + 10] ||
+           buf[i + 10] > (buf[i + 1] == RTR_PDU_TYPE_IPV6_PREFIX ? 128 : 32)))
+        lose_value_error("Bad prefix length or max length in prefix PDU");
+      if (buf[i] != buf[0])
+        lose_value_error("Mixed protocol versions in payload set");
+    }
+
+    if (pdus != NULL) {
+      pdus[n].pdu = buf + i;
+      pdus[n].len = pdulen;
+    }
+
+    i += pdulen;
+    n++;
+  }
+
+  return n;
+
+ error:
+  return -1;
+}
+
+/*
+ * Split a buffer into an allocated array of PDU locations.
+ */
+
+static rtr_pdu *
+rtr_pdu_vector(const Py_buffer *src, Py_ssize_t *n)
+{
+  rtr_pdu *pdus = NULL;
+
+  if ((*n = rtr_pdu_split(src->buf, src->len, 1, NULL)) < 0)
+    goto error;
+
+  if ((pdus = PyMem_New(rtr_pdu, *n + 1)) == NULL)
+    lose_no_memory();
+
+  (void) rtr_pdu_split(src->buf, src->len, 1, pdus);
+  return pdus;
+
+ error:
+  return NULL;
+}
+
+
+
+/*
+ * PrefixTable object.
+ *
+ * A table of Validated ROA Payloads, kept as a path-compressed binary
+ * (Patricia) trie per address family.  Each node holds a prefix and
+ * the set of (origin AS, max length) pairs authorized for it.  Keys
+ * are left-aligned in 128 bits so that IPv4 and IPv6 share the same
+ * code.  Tables are loaded in bulk from packed RPKI-RTR PDUs, and
+ * answer RFC 6811 route origin validation queries in batches.
+ */
+
+#define ORIGIN_NOT_FOUND        0
+#define ORIGIN_VALID            1
+#define ORIGIN_INVALID          2
+
+typedef struct {
+  uint32_t asn;
+  unsigned char maxlen;
+} prefix_table_origin;
+
+typedef struct prefix_table_node {
+  resource_u128 key;
+  unsigned len;
+  struct prefix_table_node *child[2];
+  prefix_table_origin *origins;
+  unsigned n_origins, n_allocated;
+} prefix_table_node;
+
+typedef struct {
+  PyObject_HEAD
+  prefix_table_node *root[2];   /* IPv4, IPv6 */
+  Py_ssize_t n;                 /* Number of VRPs */
+} prefix_table_object;
+
+static resource_u128
+prefix_table_key(const unsigned char *b, const unsigned length)
+{
+  resource_u128 k;
+  unsigned i;
+
+  k.hi = k.lo = 0;
+
+  for (i = 0; i < length; i++) {
+    if (i < 8)
+      k.hi |= (uint64_t) b[i] << (56 - 8 * i);
+    else
+      k.lo |= (uint64_t) b[i] << (120 - 8 * i);
+  }
+
+  return k;
+}
+
+static unsigned
+prefix_table_bit(const resource_u128 k, const unsigned i)
+{
+  return (unsigned) ((i < 64 ? k.hi >> (63 - i) : k.lo >> (127 - i)) & 1);
+}
+
+/*
+ * Number of leading bits two keys have in common, capped at n.
+ */
+static unsigned
+prefix_table_common(const resource_u128 a, const resource_u128 b, const unsigned n)
+{
+  uint64_t x;
+  unsigned c;
+
+  if ((x = a.hi ^ b.hi) != 0)
+    c = __builtin_clzll(x);
+  else if ((x = a.lo ^ b.lo) != 0)
+    c = 64 + __builtin_clzll(x);
+  else
+    c = 128;
+
+  return c < n ? c : n;
+}
+
+static resource_u128
+prefix_table_truncate(const resource_u128 k, const unsigned len)
+{
+  resource_u128 r;
+
+  r.hi = len >= 64 ? k.hi : len == 0 ? 0 : k.hi & (~(uint64_t) 0 << (64 - len));
+  r.lo = len >= 128 ? k.lo : len <= 64 ? 0 : k.lo & (~(uint64_t) 0 << (128 - len));
+
+  return r;
+}
+
+static prefix_table_node *
+prefix_table_node_new(const resource_u128 key, const unsigned len)
+{
+  prefix_table_node *n = PyMem_Malloc(sizeof(*n));
+
+  if (n != NULL) {
+    memset(n, 0, sizeof(*n));
+    n->key = prefix_table_truncate(key, len);
+    n->len = len;
+  }
+
+  return n;
+}
+
+static void
+prefix_table_node_free(prefix_table_node *n)
+{
+  if (n != NULL) {
+    prefix_table_node_free(n->child[0]);
+    prefix_table_node_free(n->child[1]);
+    PyMem_Free(n->origins);
+    PyMem_Free(n);
+  }
+}
+
+/*
+ * Find the node for a prefix, creating it (and any glue node needed to
+ * keep the trie path-compressed) if it doesn't exist and create is set.
+ */
+static prefix_table_node *
+prefix_table_find(prefix_table_node **pp, const resource_u128 key, const unsigned len, const int create)
+{
+  prefix_table_node *n, *leaf, *glue;
+  unsigned common;
+
+  while ((n = *pp) != NULL) {
+    common = prefix_table_common(n->key, key, n->len < len ? n->len : len);
+
+    if (common < n->len) {
+      if (!create)
+        return NULL;
+
+      if (common == len) {
+        if ((leaf = prefix_table_node_new(key, len)) == NULL)
+          return NULL;
+        leaf->child[prefix_table_bit(n->key, len)] = n;
+        return *pp = leaf;
+      }
+
+      if ((leaf = prefix_table_node_new(key, len)) == NULL)
+        return NULL;
+      if ((glue = prefix_table_node_new(key, common)) == NULL) {
+        PyMem_Free(leaf);
+        return NULL;
+      }
+      glue->child[prefix_table_bit(n->key, common)] = n;
+      glue->child[prefix_table_bit(key, common)] = leaf;
+      *pp = glue;
+      return leaf;
+    }
+
+    if (n->len == len)
+      return n;
+
+    pp = &n->child[prefix_table_bit(key, n->len)];
+  }
+
+  return create ? (*pp = prefix_table_node_new(key, len)) : NULL;
+}
+
+/*
+ * Walk back up the path to a prefix that just lost its last origin,
+ * removing nodes that no longer hold any origins and splicing out
+ * glue nodes left with a single child, so that a table under constant
+ * announce/withdraw churn doesn't keep every prefix it has ever seen.
+ */
+static void
+prefix_table_prune(prefix_table_node **pp, const resource_u128 key, const unsigned len)
+{
+  prefix_table_node *n = *pp;
+
+  if (n == NULL)
+    return;
+
+  if (n->len < len)
+    prefix_table_prune(&n->child[prefix_table_bit(key, n->len)], key, len);
+
+  if (n->n_origins == 0 && (n->child[0] == NULL || n->child[1] == NULL)) {
+    *pp = n->child[0] != NULL ? n->child[0] : n->child[1];
+    PyMem_Free(n->origins);
+    PyMem_Free(n);
+  }
+}
+
+/*
+ * Apply one prefix PDU: add the VRP if the announce flag is set,
+ * otherwise remove it.  The PDU must have come through
+ * rtr_pdu_split(), which guarantees that the prefix length fits the
+ * address family, so prefix_table_bit() never sees a bit past 127.
+ * Returns 0 only if we ran out of memory.
+ */
+static int
+prefix_table_apply(prefix_table_object *self, const unsigned char *pdu)
+{
+  const int v6 = pdu[1] == RTR_PDU_TYPE_IPV6_PREFIX;
+  const resource_u128 key = prefix_table_key(pdu + 12, v6 ? 16 : 4);
+  const uint32_t asn = rtr_get_u32(pdu + (v6 ? 28 : 16));
+  const unsigned len = pdu[9];
+  const unsigned char maxlen = pdu[10];
+  prefix_table_origin *o;
+  prefix_table_node *n;
+  unsigned i;
+
+  if ((n = prefix_table_find(&self->root[v6], key, len, pdu[8] & 1)) == NULL)
+    return (pdu[8] & 1) == 0;
+
+  for (i = 0; i < n->n_origins; i++)
+    if (n->origins[i].asn == asn && n->origins[i].maxlen == maxlen)
+      break;
+
+  if ((pdu[8] & 1) == 0) {
+    if (i < n->n_origins) {
+      n->origins[i] = n->origins[--n->n_origins];
+      self->n--;
+      if (n->n_origins == 0)
+        prefix_table_prune(&self->root[v6], key, len);
+    }
+    return 1;
+  }
+
+  if (i < n->n_origins)
+    return 1;
+
+  if (n->n_origins == n->n_allocated) {
+    if ((o = PyMem_Realloc(n->origins, (n->n_allocated + 2) * sizeof(*o))) == NULL)
+      return 0;
+    n->origins = o;
+    n->n_allocated += 2;
+  }
+
+  n->origins[n->n_origins].asn = asn;
+  n->origins[n->n_origins].maxlen = maxlen;
+  n->n_origins++;
+  self->n++;
+  return 1;
+}
+
+/*
+ * RFC 6811 validation of one route.  asn is negative for a route
+ * whose origin can't be determined (AS_SET), which can never be valid.
+ */
+static int
+prefix_table_validate_one(const prefix_table_node *n, const resource_u128 key,
+                          const unsigned len, const PY_LONG_LONG asn)
+{
+  int result = ORIGIN_NOT_FOUND;
+  unsigned i;
+
+  while (n != NULL && n->len <= len && prefix_table_common(n->key, key, n->len) == n->len) {
+    for (i = 0; i < n->n_origins; i++) {
+      if (asn >= 0 && n->origins[i].asn == asn && len <= n->origins[i].maxlen)
+        return ORIGIN_VALID;
+      result = ORIGIN_INVALID;
+    }
+    if (n->len >= len)
+      break;
+    n = n->child[prefix_table_bit(key, n->len)];
+  }
+
+  return result;
+}
+
+static PyObject *
+prefix_table_object_new(PyTypeObject *type, GCC_UNUSED PyObject *args, GCC_UNUSED PyObject *kwds)
+{
+  ENTERING(prefix_table_object_new);
+  return type->tp_alloc(type, 0);
+}
+
+static void
+prefix_table_object_clear_helper(prefix_table_object *self)
+{
+  prefix_table_node_free(self->root[0]);
+  prefix_table_node_free(self->root[1]);
+  self->root[0] = self->root[1] = NULL;
+  self->n = 0;
+}
+
+static void
+prefix_table_object_dealloc(prefix_table_object *self)
+{
+  ENTERING(prefix_table_object_dealloc);
+  prefix_table_object_clear_helper(self);
+  self->ob_type->tp_free((PyObject*) self);
+}
+
+static Py_ssize_t
+prefix_table_object_length(prefix_table_object *self)
+{
+  return self->n;
+}
+
+static size_t
+prefix_table_node_size(const prefix_table_node *n)
+{
+  size_t size = 0;
+
+  for (; n != NULL; n = n->child[1])
+    size += sizeof(*n) + n->n_allocated * sizeof(*n->origins) + prefix_table_node_size(n->child[0]);
+
+  return size;
+}
+
+static char prefix_table_object_sizeof__doc__[] =
+  "Return the memory used by this table, including its trie nodes.\n"
+  ;
+
+static PyObject *
+prefix_table_object_sizeof(prefix_table_object *self)
+{
+  ENTERING(prefix_table_object_sizeof);
+  return PyInt_FromSsize_t(self->ob_type->tp_basicsize +
+                           prefix_table_node_size(self->root[0]) +
+                           prefix_table_node_size(self->root[1]));
+}
+
+static char prefix_table_object_load__doc__[] =
+  "Load a batch of RPKI-RTR PDUs into this table.\n"
+  "\n"
+  "The argument is a string (or other buffer) of concatenated payload\n"
+  "PDUs, such as the content of an AXFR or IXFR file or the body of a\n"
+  "cache response.  Prefix PDUs with the announce flag set add VRPs,\n"
+  "those without remove them; router key PDUs are ignored.  Nodes\n"
+  "left empty by withdrawals are freed.\n"
+  ;
+
+static PyObject *
+prefix_table_object_load(prefix_table_object *self, PyObject *args)
+{
+  PyObject *result = NULL;
+  rtr_pdu *pdus = NULL;
+  Py_buffer src;
+  Py_ssize_t i, n;
+
+  ENTERING(prefix_table_object_load);
+
+  src.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*", &src))
+    goto error;
+
+  if ((pdus = rtr_pdu_vector(&src, &n)) == NULL)
+    goto error;
+
+  for (i = 0; i < n; i++)
+    if (pdus[i].pdu[1] != RTR_PDU_TYPE_ROUTER_KEY && !prefix_table_apply(self, pdus[i].pdu))
+      lose_no_memory();
+
+  result = Py_None;
+  Py_INCREF(result);
+
+ error:
+  PyMem_Free(pdus);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return result;
+}
+
+static char prefix_table_object_clear__doc__[] =
+  "Remove all VRPs from this table.\n"
+  ;
+
+static PyObject *
+prefix_table_object_clear(prefix_table_object *self)
+{
+  ENTERING(prefix_table_object_clear);
+  prefix_table_object_clear_helper(self);
+  Py_RETURN_NONE;
+}
+
+static char prefix_table_object_validate__doc__[] =
+  "Perform RFC 6811 route origin validation on a batch of routes.\n"
+  "\n"
+  "The argument is a sequence of (prefix, prefixlen, asn) tuples, where\n"
+  "prefix is an IPAddress and asn is the route's origin AS, or None if\n"
+  "the origin can't be determined (eg, the AS_PATH ends with an AS_SET).\n"
+  "\n"
+  "Returns a list with one of ORIGIN_VALID, ORIGIN_INVALID, or\n"
+  "ORIGIN_NOT_FOUND for each route.\n"
+  ;
+
+static PyObject *
+prefix_table_object_validate(prefix_table_object *self, PyObject *args)
+{
+  PyObject *routes = NULL, *seq = NULL, *result = NULL, *asn_obj = NULL, *state;
+  ipaddress_object *addr = NULL;
+  PY_LONG_LONG asn;
+  Py_ssize_t i, n;
+  unsigned len;
+
+  ENTERING(prefix_table_object_validate);
+
+  if (!PyArg_ParseTuple(args, "O", &routes))
+    goto error;
+
+  if ((seq = PySequence_Fast(routes, "Expected a sequence of routes")) == NULL)
+    goto error;
+
+  n = PySequence_Fast_GET_SIZE(seq);
+
+  if ((result = PyList_New(n)) == NULL)
+    goto error;
+
+  for (i = 0; i < n; i++) {
+    if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "O!IO;route must be (prefix, prefixlen, asn)",
+                          &POW_IPAddress_Type, &addr, &len, &asn_obj))
+      goto error;
+
+    if (len > addr->type->length * 8)
+      lose_value_error("Prefix length out of range");
+
+    if (asn_obj == Py_None) {
+      asn = -1;
+    } else {
+      asn = PyLong_AsLongLong(asn_obj);
+      if (asn == -1 && PyErr_Occurred())
+        goto error;
+      if (asn < 0 || asn > 0xFFFFFFFFLL)
+        lose_value_error("ASN out of range");
+    }
+
+    state = PyInt_FromLong(prefix_table_validate_one(self->root[addr->type->length == 16],
+                                                     prefix_table_key(addr->address, addr->type->length),
+                                                     len, asn));
+    if (state == NULL)
+      goto error;
+
+    PyList_SET_ITEM(result, i, state);
+  }
+
+  Py_XDECREF(seq);
+  return result;
+
+ error:
+  Py_XDECREF(seq);
+  Py_XDECREF(result);
+  return NULL;
+}
+
+static PySequenceMethods prefix_table_object_as_sequence = {
+  (lenfunc) prefix_table_object_length,         /* sq_length */
+};
+
+static struct PyMethodDef prefix_table_object_methods[] = {
+  Define_Method(load,                   prefix_table_object_load,                       METH_VARARGS),
+  Define_Method(clear,                  prefix_table_object_clear,                      METH_NOARGS),
+  Define_Method(validate,               prefix_table_object_validate,                   METH_VARARGS),
+  Define_Method(__sizeof__,             prefix_table_object_sizeof,                     METH_NOARGS),
+  {NULL}
+};
+
+static char POW_PrefixTable_Type__doc__[] =
+  "Table of Validated ROA Payloads for route origin validation.\n"
+  "\n"
+  "The constructor takes no arguments and returns an empty table.  Use\n"
+  "the .load() method to add or withdraw VRPs from packed RPKI-RTR PDUs,\n"
+  "and the .validate() method to check routes against the table.  len()\n"
+  "returns the number of VRPs in the table.\n"
+  ;
+
+static PyTypeObject POW_PrefixTable_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                        /* ob_size */
+  "rpki.POW.PrefixTable",                   /* tp_name */
+  sizeof(prefix_table_object),              /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)prefix_table_object_dealloc,  /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  &prefix_table_object_as_sequence,         /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_PrefixTable_Type__doc__,              /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  prefix_table_object_methods,              /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  0,                                        /* tp_init */
+  0,                                        /* tp_alloc */
+  prefix_table_object_new,                  /* tp_new */
+};
+
+
+
+/*
+ * OriginValidator object.
+ *
+ * A frozen copy of a VRP table laid out for lookup speed rather than
+ * for update.  VRPs are sorted by address family, prefix length, key,
+ * and origin AS, then stored as parallel arrays, so each (family,
+ * length) pair is a contiguous, sorted run of keys.  A query does a
+ * branch-free binary search in each populated prefix length no longer
+ * than the route's, so it touches a handful of cache lines from dense
+ * key arrays instead of chasing trie pointers.  Since the structure
+ * never changes once built, batches are validated with the GIL
+ * released.
+ */
+
+typedef struct {
+  resource_u128 key;
+  uint32_t asn;
+  unsigned char v6, len, maxlen;
+} origin_validator_vrp;
+
+typedef struct {
+  size_t start, n;
+} origin_validator_level;
+
+typedef struct {
+  resource_u128 key;
+  PY_LONG_LONG asn;
+  unsigned char v6, len;
+} origin_validator_route;
+
+typedef struct {
+  PyObject_HEAD
+  origin_validator_level level[2][129];
+  unsigned char lengths[2][129];        /* Populated lengths, longest first */
+  unsigned n_lengths[2];
+  uint64_t *hi, *lo;
+  uint32_t *asn;
+  unsigned char *maxlen;
+  Py_ssize_t n;
+} origin_validator_object;
+
+static int
+origin_validator_vrp_cmp(const void *a_, const void *b_)
+{
+  const origin_validator_vrp *a = a_, *b = b_;
+
+  if (a->v6 != b->v6)
+    return a->v6 < b->v6 ? -1 : 1;
+  if (a->len != b->len)
+    return a->len < b->len ? -1 : 1;
+  if (a->key.hi != b->key.hi)
+    return a->key.hi < b->key.hi ? -1 : 1;
+  if (a->key.lo != b->key.lo)
+    return a->key.lo < b->key.lo ? -1 : 1;
+  if (a->asn != b->asn)
+    return a->asn < b->asn ? -1 : 1;
+  return (int) a->maxlen - (int) b->maxlen;
+}
+
+/*
+ * Collect the VRPs in a PrefixTable trie.
+ */
+static void
+origin_validator_collect(const prefix_table_node *n, const int v6, origin_validator_vrp *vrps, size_t *n_vrps)
+{
+  unsigned i;
+
+  for (; n != NULL; n = n->child[1]) {
+    for (i = 0; i < n->n_origins; i++) {
+      vrps[*n_vrps].key = n->key;
+      vrps[*n_vrps].asn = n->origins[i].asn;
+      vrps[*n_vrps].v6 = v6;
+      vrps[*n_vrps].len = n->len;
+      vrps[*n_vrps].maxlen = n->origins[i].maxlen;
+      ++*n_vrps;
+    }
+    origin_validator_collect(n->child[0], v6, vrps, n_vrps);
+  }
+}
+
+/*
+ * Sort and deduplicate VRPs, then lay them out in the object's arrays.
+ * Returns 0 only if we ran out of memory.
+ */
+static int
+origin_validator_build(origin_validator_object *self, origin_validator_vrp *vrps, size_t n)
+{
+  origin_validator_level *l;
+  size_t i, j;
+  int v6, len;
+
+  qsort(vrps, n, sizeof(*vrps), origin_validator_vrp_cmp);
+
+  for (i = j = 0; i < n; i++)
+    if (j == 0 || origin_validator_vrp_cmp(&vrps[j - 1], &vrps[i]) != 0)
+      vrps[j++] = vrps[i];
+  n = j;
+
+  if ((self->hi     = PyMem_New(uint64_t,      n + 1)) == NULL ||
+      (self->lo     = PyMem_New(uint64_t,      n + 1)) == NULL ||
+      (self->asn    = PyMem_New(uint32_t,      n + 1)) == NULL ||
+      (self->maxlen = PyMem_New(unsigned char, n + 1)) == NULL)
+    return 0;
+
+  for (i = 0; i < n; i++) {
+    l = &self->level[vrps[i].v6][vrps[i].len];
+    if (l->n++ == 0)
+      l->start = i;
+    self->hi[i]     = vrps[i].key.hi;
+    self->lo[i]     = vrps[i].key.lo;
+    self->asn[i]    = vrps[i].asn;
+    self->maxlen[i] = vrps[i].maxlen;
+  }
+
+  for (v6 = 0; v6 < 2; v6++)
+    for (len = v6 ? 128 : 32; len >= 0; len--)
+      if (self->level[v6][len].n > 0)
+        self->lengths[v6][self->n_lengths[v6]++] = len;
+
+  self->n = n;
+  return 1;
+}
+
+/*
+ * Index of the first key in a sorted run not less than the search
+ * key.  The loop body compiles to a conditional move, so the search
+ * costs one (cache-missing) load per level and no mispredictions.
+ * The low half of the key only matters for prefixes longer than 64.
+ */
+static size_t
+origin_validator_search(const uint64_t *hi, const uint64_t *lo, size_t n,
+                        const resource_u128 key, const int wide)
+{
+  size_t base = 0, half;
+
+  if (n == 0)
+    return 0;
+
+  if (!wide) {
+    while (n > 1) {
+      half = n / 2;
+      base = hi[base + half] < key.hi ? base + half : base;
+      n -= half;
+    }
+    return base + (hi[base] < key.hi);
+  }
+
+  while (n > 1) {
+    half = n / 2;
+    base = (hi[base + half] < key.hi || (hi[base + half] == key.hi && lo[base + half] < key.lo)) ? base + half : base;
+    n -= half;
+  }
+  return base + (hi[base] < key.hi || (hi[base] == key.hi && lo[base] < key.lo));
+}
+
+/*
+ * RFC 6811 validation of one route.  asn is negative for a route
+ * whose origin can't be determined (AS_SET), which can never be valid.
+ */
+static int
+origin_validator_validate_one(const origin_validator_object *self, const origin_validator_route *r)
+{
+  const origin_validator_level *l;
+  int result = ORIGIN_NOT_FOUND;
+  resource_u128 key;
+  unsigned i, len;
+  size_t j, end;
+
+  for (i = 0; i < self->n_lengths[r->v6]; i++) {
+    if ((len = self->lengths[r->v6][i]) > r->len)
+      continue;
+    l = &self->level[r->v6][len];
+    key = prefix_table_truncate(r->key, len);
+    end = l->start + l->n;
+    for (j = l->start + origin_validator_search(self->hi + l->start, self->lo + l->start, l->n, key, len > 64);
+         j < end && self->hi[j] == key.hi && self->lo[j] == key.lo; j++) {
+      if (r->asn >= 0 && self->asn[j] == r->asn && r->len <= self->maxlen[j])
+        return ORIGIN_VALID;
+      result = ORIGIN_INVALID;
+    }
+  }
+
+  return result;
+}
+
+static PyObject *
+origin_validator_object_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"source", NULL};
+  origin_validator_object *self = NULL;
+  origin_validator_vrp *vrps = NULL;
+  PyObject *source = NULL;
+  rtr_pdu *pdus = NULL;
+  Py_buffer src;
+  Py_ssize_t i, n;
+  size_t n_vrps = 0;
+  int v6;
+
+  ENTERING(origin_validator_object_new);
+
+  src.obj = NULL;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &source) ||
+      (self = (origin_validator_object *) type->tp_alloc(type, 0)) == NULL)
+    goto error;
+
+  if (PyObject_TypeCheck(source, &POW_PrefixTable_Type)) {
+    prefix_table_object *table = (prefix_table_object *) source;
+
+    if ((vrps = PyMem_New(origin_validator_vrp, table->n + 1)) == NULL)
+      lose_no_memory();
+
+    for (v6 = 0; v6 < 2; v6++)
+      origin_validator_collect(table->root[v6], v6, vrps, &n_vrps);
+  }
+
+  else {
+    if (!PyArg_Parse(source, "s*;Expected PrefixTable or buffer of PDUs", &src))
+      goto error;
+
+    if ((pdus = rtr_pdu_vector(&src, &n)) == NULL)
+      goto error;
+
+    if ((vrps = PyMem_New(origin_validator_vrp, n + 1)) == NULL)
+      lose_no_memory();
+
+    for (i = 0; i < n; i++) {
+      const unsigned char *pdu = pdus[i].pdu;
+      if (pdu[1] == RTR_PDU_TYPE_ROUTER_KEY)
+        continue;
+      if ((pdu[8] & 1) == 0)
+        lose_value_error("Withdrawal PDU in VRP set");
+      v6 = pdu[1] == RTR_PDU_TYPE_IPV6_PREFIX;
+      vrps[n_vrps].key = prefix_table_truncate(prefix_table_key(pdu + 12, v6 ? 16 : 4), pdu[9]);
+      vrps[n_vrps].asn = rtr_get_u32(pdu + (v6 ? 28 : 16));
+      vrps[n_vrps].v6 = v6;
+      vrps[n_vrps].len = pdu[9];
+      vrps[n_vrps].maxlen = pdu[10];
+      n_vrps++;
+    }
+  }
+
+  if (!origin_validator_build(self, vrps, n_vrps))
+    lose_no_memory();
+
+  PyMem_Free(pdus);
+  PyMem_Free(vrps);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return (PyObject *) self;
+
+ error:
+  PyMem_Free(pdus);
+  PyMem_Free(vrps);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  Py_XDECREF(self);
+  return NULL;
+}
+
+static void
+origin_validator_object_dealloc(origin_validator_object *self)
+{
+  ENTERING(origin_validator_object_dealloc);
+  PyMem_Free(self->hi);
+  PyMem_Free(self->lo);
+  PyMem_Free(self->asn);
+  PyMem_Free(self->maxlen);
+  self->ob_type->tp_free((PyObject*) self);
+}
+
+static Py_ssize_t
+origin_validator_object_length(origin_validator_object *self)
+{
+  return self->n;
+}
+
+static char origin_validator_object_validate__doc__[] =
+  "Perform RFC 6811 route origin validation on a batch of routes.\n"
+  "\n"
+  "The argument is a sequence of (prefix, prefixlen, asn) tuples, as for\n"
+  "PrefixTable.validate().  The routes are checked with the GIL released,\n"
+  "so several threads may validate against the same object at once.\n"
+  "\n"
+  "Returns a list with one of ORIGIN_VALID, ORIGIN_INVALID, or\n"
+  "ORIGIN_NOT_FOUND for each route.\n"
+  ;
+
+static PyObject *
+origin_validator_object_validate(origin_validator_object *self, PyObject *args)
+{
+  PyObject *routes = NULL, *seq = NULL, *result = NULL, *asn_obj = NULL, *state;
+  origin_validator_route *r = NULL;
+  ipaddress_object *addr = NULL;
+  unsigned char *states = NULL;
+  Py_ssize_t i, n;
+  unsigned len;
+
+  ENTERING(origin_validator_object_validate);
+
+  if (!PyArg_ParseTuple(args, "O", &routes))
+    goto error;
+
+  if ((seq = PySequence_Fast(routes, "Expected a sequence of routes")) == NULL)
+    goto error;
+
+  n = PySequence_Fast_GET_SIZE(seq);
+
+  if ((r = PyMem_New(origin_validator_route, n + 1)) == NULL ||
+      (states = PyMem_New(unsigned char, n + 1)) == NULL)
+    lose_no_memory();
+
+  for (i = 0; i < n; i++) {
+    if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "O!IO;route must be (prefix, prefixlen, asn)",
+                          &POW_IPAddress_Type, &addr, &len, &asn_obj))
+      goto error;
+
+    if (len > addr->type->length * 8)
+      lose_value_error("Prefix length out of range");
+
+    if (asn_obj == Py_None) {
+      r[i].asn = -1;
+    } else {
+      r[i].asn = PyLong_AsLongLong(asn_obj);
+      if (r[i].asn == -1 && PyErr_Occurred())
+        goto error;
+      if (r[i].asn < 0 || r[i].asn > 0xFFFFFFFFLL)
+        lose_value_error("ASN out of range");
+    }
+
+    r[i].key = prefix_table_key(addr->address, addr->type->length);
+    r[i].v6 = addr->type->length == 16;
+    r[i].len = len;
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  for (i = 0; i < n; i++)
+    states[i] = origin_validator_validate_one(self, &r[i]);
+  Py_END_ALLOW_THREADS
+
+  if ((result = PyList_New(n)) == NULL)
+    goto error;
+
+  for (i = 0; i < n; i++) {
+    if ((state = PyInt_FromLong(states[i])) == NULL)
+      goto error;
+    PyList_SET_ITEM(result, i, state);
+  }
+
+  PyMem_Free(r);
+  PyMem_Free(states);
+  Py_XDECREF(seq);
+  return result;
+
+ error:
+  PyMem_Free(r);
+  PyMem_Free(states);
+  Py_XDECREF(seq);
+  Py_XDECREF(result);
+  return NULL;
+}
+
+static PySequenceMethods origin_validator_object_as_sequence = {
+  (lenfunc) origin_validator_object_length,     /* sq_length */
+};
+
+static struct PyMethodDef origin_validator_object_methods[] = {
+  Define_Method(validate,               origin_validator_object_validate,               METH_VARARGS),
+  {NULL}
+};
+
+static char POW_OriginValidator_Type__doc__[] =
+  "Read-only table of Validated ROA Payloads optimized for route origin\n"
+  "validation.\n"
+  "\n"
+  "The constructor takes one argument, either a PrefixTable or a string\n"
+  "(or other buffer) of packed RPKI-RTR PDUs such as an AXFR file or the\n"
+  "PDU section of a snapshot, and returns a table holding a copy of the\n"
+  "VRPs.  Withdrawals are not allowed in the PDU buffer.  Use the\n"
+  ".validate() method to check routes against the table.  len() returns\n"
+  "the number of distinct VRPs in the table.\n"
+  ;
+
+static PyTypeObject POW_OriginValidator_Type = {
+  PyObject_HEAD_INIT(0)
+  0,                                        /* ob_size */
+  "rpki.POW.OriginValidator",               /* tp_name */
+  sizeof(origin_validator_object),          /* tp_basicsize */
+  0,                                        /* tp_itemsize */
+  (destructor)origin_validator_object_dealloc, /* tp_dealloc */
+  0,                                        /* tp_print */
+  0,                                        /* tp_getattr */
+  0,                                        /* tp_setattr */
+  0,                                        /* tp_compare */
+  0,                                        /* tp_repr */
+  0,                                        /* tp_as_number */
+  &origin_validator_object_as_sequence,     /* tp_as_sequence */
+  0,                                        /* tp_as_mapping */
+  0,                                        /* tp_hash */
+  0,                                        /* tp_call */
+  0,                                        /* tp_str */
+  0,                                        /* tp_getattro */
+  0,                                        /* tp_setattro */
+  0,                                        /* tp_as_buffer */
+  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
+  POW_OriginValidator_Type__doc__,          /* tp_doc */
+  0,                                        /* tp_traverse */
+  0,                                        /* tp_clear */
+  0,                                        /* tp_richcompare */
+  0,                                        /* tp_weaklistoffset */
+  0,                                        /* tp_iter */
+  0,                                        /* tp_iternext */
+  origin_validator_object_methods,          /* tp_methods */
+  0,                                        /* tp_members */
+  0,                                        /* tp_getset */
+  0,                                        /* tp_base */
+  0,                                        /* tp_dict */
+  0,                                        /* tp_descr_get */
+  0,                                        /* tp_descr_set */
+  0,                                        /* tp_dictoffset */
+  0,                                        /* tp_init */
+  0,                                        /* tp_alloc */
+  origin_validator_object_new,              /* tp_new */
+};
+
+
+
+/*
+ * Module functions.
+ */
+
+static char pow_module_add_object__doc__[] =
+  "Add new a new object identifier to OpenSSL's internal database.\n"
+  "\n"
+  "The \"oid\" should be an ASN.1 object identifer, represented as a string\n"
+  "in dotted-decimal format.\n"
+  "\n"
+  "The \"shortName\" parameter should be the OpenSSL \"short name\" to use.\n"
+  "\n"
+  "The \"longName\" parameter should be the OpenSSL \"long name\" to use.\n"
+  ;
+
+static PyObject *
+pow_module_add_object(GCC_UNUSED PyObject *self, PyObject *args)
+{
+  char *oid = NULL, *sn = NULL, *ln = NULL;
+
+  ENTERING(pow_module_add_object);
+
+  if (!PyArg_ParseTuple(args, "sss", &oid, &sn, &ln))
+    goto error;
+
+  if (!OBJ_create(oid, sn, ln))
+    lose_openssl_error("Unable to add object");
+
+  Py_RETURN_NONE;
+
+ error:
+
+  return NULL;
+}
+
+static char pow_module_get_error__doc__[] =
+  "Pop one error off OpenSSL's global error stack and returns it as a string.\n"
+  "\n"
+  "Returns None if the error stack is empty.\n"
+  ;
+
+static PyObject *
+pow_module_get_error(GCC_UNUSED PyObject *self)
+{
+  unsigned long error = ERR_get_error();
+  char buf[256];
+
+  ENTERING(pow_module_get_error);
+
+  if (!error)
+    Py_RETURN_NONE;
+
+  ERR_error_string_n(error, buf, sizeof(buf));
+  return Py_BuildValue("s", buf);
+}
+
+static char pow_module_clear_error__doc__[] =
+  "Remove all errors from OpenSSL's global error stack.\n"
+  ;
+
+static PyObject *
+pow_module_clear_error(GCC_UNUSED PyObject *self)
+{
+  ENTERING(pow_module_clear_error);
+  ERR_clear_error();
+  Py_RETURN_NONE;
+}
+
+static char pow_module_get_verification_errors__doc__[] =
+  "Return strings for known OpenSSL certificate verification errors.\n"
+  "Returns a list of (number, symbol, text) tuples.\n"
+  ;
+
+static PyObject *
+pow_module_get_verification_errors(GCC_UNUSED PyObject *self)
+{
+  PyObject *result = NULL, *item = NULL;
+
+  ENTERING(pow_module_get_verification_errors);
+
+  /*
+   * This function is only called once, and doesn't need to be
+   * particularly efficient, so we use a list to keep the code simple.
+   */
+
+  if ((result = PyList_New(0)) == NULL)
+    goto error;
+
+#define Verification_Error(_v_)                                         \
+  do {                                                                  \
+    const char *msg = X509_verify_cert_error_string(_v_);               \
+    if ((item = Py_BuildValue("(iss)", _v_, #_v_, msg)) == NULL ||      \
+        PyList_Append(result, item) < 0)                                \
+      goto error;                                                       \
+    Py_XDECREF(item);                                                   \
+    item = NULL;                                                        \
+  } while (0)
+
+  Verification_Error( X509_V_OK );
+  Verification_Error( X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT );
+  Verification_Error( X509_V_ERR_UNABLE_TO_GET_CRL );
+  Verification_Error( X509_V_ERR_UNABLE_TO_DECRYPT_CERT_SIGNATURE );
+  Verification_Error( X509_V_ERR_UNABLE_TO_DECRYPT_CRL_SIGNATURE );
+  Verification_Error( X509_V_ERR_UNABLE_TO_DECODE_ISSUER_PUBLIC_KEY );
+  Verification_Error( X509_V_ERR_CERT_SIGNATURE_FAILURE );
+  Verification_Error( X509_V_ERR_CRL_SIGNATURE_FAILURE );
+  Verification_Error( X509_V_ERR_CERT_NOT_YET_VALID );
+  Verification_Error( X509_V_ERR_CERT_HAS_EXPIRED );
+  Verification_Error( X509_V_ERR_CRL_NOT_YET_VALID );
+  Verification_Error( X509_V_ERR_CRL_HAS_EXPIRED );
+  Verification_Error( X509_V_ERR_ERROR_IN_CERT_NOT_BEFORE_FIELD );
+  Verification_Error( X509_V_ERR_ERROR_IN_CERT_NOT_AFTER_FIELD );
+  Verification_Error( X509_V_ERR_ERROR_IN_CRL_LAST_UPDATE_FIELD );
+  Verification_Error( X509_V_ERR_ERROR_IN_CRL_NEXT_UPDATE_FIELD );
+  Verification_Error( X509_V_ERR_OUT_OF_MEM );
+  Verification_Error( X509_V_ERR_DEPTH_ZERO_SELF_SIGNED_CERT );
+  Verification_Error( X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN );
+  Verification_Error( X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY );
+  Verification_Error( X509_V_ERR_UNABLE_TO_VERIFY_LEAF_SIGNATURE );
+  Verification_Error( X509_V_ERR_CERT_CHAIN_TOO_LONG );
+  Verification_Error( X509_V_ERR_CERT_REVOKED );
+  Verification_Error( X509_V_ERR_INVALID_CA );
+  Verification_Error( X509_V_ERR_PATH_LENGTH_EXCEEDED );
+  Verification_Error( X509_V_ERR_INVALID_PURPOSE );
+  Verification_Error( X509_V_ERR_CERT_UNTRUSTED );
+  Verification_Error( X509_V_ERR_CERT_REJECTED );
+  Verification_Error( X509_V_ERR_SUBJECT_ISSUER_MISMATCH );
+  Verification_Error( X509_V_ERR_AKID_SKID_MISMATCH );
+  Verification_Error( X509_V_ERR_AKID_ISSUER_SERIAL_MISMATCH );
+  Verification_Error( X509_V_ERR_KEYUSAGE_NO_CERTSIGN );
+  Verification_Error( X509_V_ERR_UNABLE_TO_GET_CRL_ISSUER );
+  Verification_Error( X509_V_ERR_UNHANDLED_CRITICAL_EXTENSION );
+  Verification_Error( X509_V_ERR_KEYUSAGE_NO_CRL_SIGN );
+  Verification_Error( X509_V_ERR_UNHANDLED_CRITICAL_CRL_EXTENSION );
+  Verification_Error( X509_V_ERR_INVALID_NON_CA );
+  Verification_Error( X509_V_ERR_PROXY_PATH_LENGTH_EXCEEDED );
+  Verification_Error( X509_V_ERR_KEYUSAGE_NO_DIGITAL_SIGNATURE );
+  Verification_Error( X509_V_ERR_PROXY_CERTIFICATES_NOT_ALLOWED );
+  Verification_Error( X509_V_ERR_INVALID_EXTENSION );
+  Verification_Error( X509_V_ERR_INVALID_POLICY_EXTENSION );
+  Verification_Error( X509_V_ERR_NO_EXPLICIT_POLICY );
+  Verification_Error( X509_V_ERR_DIFFERENT_CRL_SCOPE );
+  Verification_Error( X509_V_ERR_UNSUPPORTED_EXTENSION_FEATURE );
+  Verification_Error( X509_V_ERR_UNNESTED_RESOURCE );
+  Verification_Error( X509_V_ERR_PERMITTED_VIOLATION );
+  Verification_Error( X509_V_ERR_EXCLUDED_VIOLATION );
+  Verification_Error( X509_V_ERR_SUBTREE_MINMAX );
+  Verification_Error( X509_V_ERR_UNSUPPORTED_CONSTRAINT_TYPE );
+  Verification_Error( X509_V_ERR_UNSUPPORTED_CONSTRAINT_SYNTAX );
+  Verification_Error( X509_V_ERR_UNSUPPORTED_NAME_SYNTAX );
+  Verification_Error( X509_V_ERR_CRL_PATH_VALIDATION_ERROR );
+#ifdef X509_V_ERR_SUITE_B_INVALID_VERSION
+  Verification_Error( X509_V_ERR_SUITE_B_INVALID_VERSION );
+#endif
+#ifdef X509_V_ERR_SUITE_B_INVALID_ALGORITHM
+  Verification_Error( X509_V_ERR_SUITE_B_INVALID_ALGORITHM );
+#endif
+#ifdef X509_V_ERR_SUITE_B_INVALID_CURVE
+  Verification_Error( X509_V_ERR_SUITE_B_INVALID_CURVE );
+#endif
+#ifdef X509_V_ERR_SUITE_B_INVALID_SIGNATURE_ALGORITHM
+  Verification_Error( X509_V_ERR_SUITE_B_INVALID_SIGNATURE_ALGORITHM );
+#endif
+#ifdef X509_V_ERR_SUITE_B_LOS_NOT_ALLOWED
+  Verification_Error( X509_V_ERR_SUITE_B_LOS_NOT_ALLOWED );
+#endif
+#ifdef X509_V_ERR_SUITE_B_CANNOT_SIGN_P_384_WITH_P_256
+  Verification_Error( X509_V_ERR_SUITE_B_CANNOT_SIGN_P_384_WITH_P_256 );
+#endif
+#ifdef X509_V_ERR_HOSTNAME_MISMATCH
+  Verification_Error( X509_V_ERR_HOSTNAME_MISMATCH );
+#endif
+#ifdef X509_V_ERR_EMAIL_MISMATCH
+  Verification_Error( X509_V_ERR_EMAIL_MISMATCH );
+#endif
+#ifdef X509_V_ERR_IP_ADDRESS_MISMATCH
+  Verification_Error( X509_V_ERR_IP_ADDRESS_MISMATCH );
+#endif
+  Verification_Error( X509_V_ERR_APPLICATION_VERIFICATION );
+
+#undef Verification_Error
+
+  return result;
+
+ error:
+  Py_XDECREF(result);
+  Py_XDECREF(item);
+  return NULL;
+}
+
+static char pow_module_seed__doc__[] =
+  "Add data to OpenSSL's pseudo-random number generator state.\n"
+  "\n"
+  "The \"data\" parameter is the seed to add.  Entropy of the data is\n"
+  "assumed to be equal to the length of the data.\n"
+  ;
+
+static PyObject *
+pow_module_seed(GCC_UNUSED PyObject *self, PyObject *args)
+{
+  char *data = NULL;
+  Py_ssize_t datalen = 0;
+
+  ENTERING(pow_module_seed);
+
+  if (!PyArg_ParseTuple(args, "s#", &data, &datalen))
+    goto error;
+
+  RAND_seed(data, datalen);
+
+  Py_RETURN_NONE;
+
+ error:
+
+  return NULL;
+}
+
+static char pow_module_add__doc__[] =
+  "Add data to OpenSSL's pseudo-random number generator state.\n"
+  "\n"
+  "The \"data\" parameter is the data to add.\n"
+  "\n"
+  "The \"entropy\" parameter should be an estimate of the number of\n"
+  "random bytes in the data parameter.\n"
+  ;
+
+static PyObject *
+pow_module_add(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  pkcs10_object *self;
+  char *data = NULL;
+  Py_ssize_t datalen = 0;
+  double entropy = 0;
 
-  ENTERING(pkcs10_object_new);
+  ENTERING(pow_module_add);
 
-  if ((self = (pkcs10_object *) type->tp_alloc(type, 0)) != NULL &&
-      (self->pkcs10 = X509_REQ_new()) != NULL &&
-      (self->exts = sk_X509_EXTENSION_new_null()) != NULL)
-    return (PyObject *) self;
+  if (!PyArg_ParseTuple(args, "s#d", &data, &datalen, &entropy))
+    goto error;
 
-  Py_XDECREF(self);
+  RAND_add(data, datalen, entropy);
+
+  Py_RETURN_NONE;
+
+ error:
   return NULL;
 }
 
-static void
-pkcs10_object_dealloc(pkcs10_object *self)
-{
-  ENTERING(pkcs10_object_dealloc);
-  X509_REQ_free(self->pkcs10);
-  sk_X509_EXTENSION_pop_free(self->exts, X509_EXTENSION_free);
-  self->ob_type->tp_free((PyObject*) self);
-}
+static char pow_module_write_random_file__doc__[] =
+  "Write the current state of OpenSSL's pseduo-random number generator to\n"
+  "a file.\n"
+  "\n"
+  "The \"filename\" parameter is the name of the file to write.\n"
+  ;
 
 static PyObject *
-pkcs10_object_pem_read_helper(PyTypeObject *type, BIO *bio)
+pow_module_write_random_file(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  pkcs10_object *self = NULL;
-
-  ENTERING(pkcs10_object_pem_read_helper);
+  char *filename = NULL;
 
-  assert_no_unhandled_openssl_errors();
+  ENTERING(pow_module_write_random_file);
 
-  if ((self = (pkcs10_object *) pkcs10_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "s", &filename))
     goto error;
 
-  assert_no_unhandled_openssl_errors();
-
-  if (!PEM_read_bio_X509_REQ(bio, &self->pkcs10, NULL, NULL))
-    lose_openssl_error("Couldn't load PEM encoded PKCS#10 request");
-
-  sk_X509_EXTENSION_pop_free(self->exts, X509_EXTENSION_free);
-  self->exts = X509_REQ_get_extensions(self->pkcs10);
-
-  assert_no_unhandled_openssl_errors();
+  if (RAND_write_file(filename) == -1)
+    lose("Couldn't write random file");
 
-  return (PyObject *) self;
+  Py_RETURN_NONE;
 
  error:
-
-  Py_XDECREF(self);
   return NULL;
 }
 
+static char pow_module_read_random_file__doc__[] =
+  "Restore the state of OpenSSLs pseudo-random number generator from\n"
+  "data previously saved to a file.\n"
+  "\n"
+  "The \"filename\" parameter is the name of the file to read.\n"
+  ;
+
 static PyObject *
-pkcs10_object_der_read_helper(PyTypeObject *type, BIO *bio)
+pow_module_read_random_file(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  pkcs10_object *self = NULL;
-
-  ENTERING(pkcs10_object_der_read_helper);
+  char *file = NULL;
+  int len = -1;
 
-  assert_no_unhandled_openssl_errors();
+  ENTERING(pow_module_read_random_file);
 
-  if ((self = (pkcs10_object *) pkcs10_object_new(type, NULL, NULL)) == NULL)
+  if (!PyArg_ParseTuple(args, "s|i", &file, &len))
     goto error;
 
-  assert_no_unhandled_openssl_errors();
-
-  if (!d2i_X509_REQ_bio(bio, &self->pkcs10))
-    lose_openssl_error("Couldn't load DER encoded PKCS#10 request");
-
-  sk_X509_EXTENSION_pop_free(self->exts, X509_EXTENSION_free);
-  self->exts = X509_REQ_get_extensions(self->pkcs10);
-
-  assert_no_unhandled_openssl_errors();
+  if (!RAND_load_file(file, len))
+    lose("Couldn't load random file");
 
-  return (PyObject *) self;
+  Py_RETURN_NONE;
 
  error:
-  Py_XDECREF(self);
   return NULL;
 }
 
-static char pkcs10_object_pem_read__doc__[] =
-  "Read a PEM-encoded PKCS#10 object from a string.\n"
+static char pow_module_custom_datetime__doc__[] =
+  "Set constructor callback for customized datetime class.\n"
   ;
 
 static PyObject *
-pkcs10_object_pem_read(PyTypeObject *type, PyObject *args)
+pow_module_custom_datetime(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  ENTERING(pkcs10_object_pem_read);
-  return read_from_string_helper(pkcs10_object_pem_read_helper, type, args);
-}
+  PyObject *cb = NULL;
 
-static char pkcs10_object_pem_read_file__doc__[] =
-  "Read a PEM-encoded PKCS#10 object from a file.\n"
-  ;
+  ENTERING(pow_module_custom_datetime);
 
-static PyObject *
-pkcs10_object_pem_read_file(PyTypeObject *type, PyObject *args)
-{
-  ENTERING(pkcs10_object_pem_read_file);
-  return read_from_file_helper(pkcs10_object_pem_read_helper, type, args);
+  if (!PyArg_ParseTuple(args, "O", &cb))
+    goto error;
+
+  Py_XINCREF(cb);
+  Py_XDECREF(custom_datetime);
+  custom_datetime = cb;
+
+  Py_RETURN_NONE;
+
+ error:
+  return NULL;
 }
 
-static char pkcs10_object_der_read__doc__[] =
-  "Read a DER-encoded PKCS#10 object from a string.\n"
-  ;
+/*
+ * Batch verification.  rcynicng checks every object listed on a
+ * manifest against the same issuer chain and CRL, one object at a
+ * time, which means a trip through X509StoreCTX setup and several
+ * trips through Python's method call machinery per object.  This does
+ * the expensive part (certificate path validation and CMS signature
+ * checking) for a whole batch of objects without holding the
+ * interpreter lock, optionally spread across a few threads, then runs
+ * the same conformance checks as the checkRPKIConformance() methods.
+ */
 
-static PyObject *
-pkcs10_object_der_read(PyTypeObject *type, PyObject *args)
+typedef struct {
+  PyObject *object;             /* Borrowed from caller's sequence */
+  X509 *x;                      /* Certificate to validate (EE cert for CMS) */
+  CMS_ContentInfo *cms;         /* Borrowed, NULL for certificates */
+  BIO *content;                 /* eContent, if CMS_verify() succeeded */
+  int x509_ok, cms_ok;
+  int n_errors;
+  int errors[BATCH_MAX_ERRORS];
+} batch_item;
+
+/*
+ * Work queue shared by verifyBatch() and signBatch().  The work
+ * function pulls item indices from the queue with batch_next() until
+ * there are none left, and must not touch anything Python.  Contexts
+ * for particular kinds of batch embed this as their first member.
+ */
+
+typedef struct batch_queue {
+  int n_items, next;
+  void (*work)(struct batch_queue *);
+#ifdef WITH_THREAD
+  pthread_mutex_t lock;
+  int threaded;
+#endif
+} batch_queue;
+
+typedef struct {
+  batch_queue q;                /* Must be first */
+  batch_item *items;
+  X509_STORE *store;
+  STACK_OF(X509) *trusted;
+  STACK_OF(X509_CRL) *crls;
+  ASN1_OBJECT *policy;
+} batch_context;
+
+/*
+ * X509_verify_cert() callback for batch verification.  Records errors
+ * in the batch item rather than calling back into Python, using the
+ * same policy as rcynicng's X509StoreCTX.verify_callback(): a stale
+ * CRL is accepted without being recorded (the caller reports stale
+ * CRLs itself), and everything else is recorded.
+ */
+
+static int
+batch_verify_cb(int ok, X509_STORE_CTX *ctx)
 {
-  ENTERING(pkcs10_object_der_read);
-  return read_from_string_helper(pkcs10_object_der_read_helper, type, args);
+  batch_item *item = X509_STORE_CTX_get_app_data(ctx);
+  int err = X509_STORE_CTX_get_error(ctx);
+
+  if (item == NULL || err == X509_V_OK || err == X509_V_ERR_SUBJECT_ISSUER_MISMATCH)
+    return ok;
+
+  if (err == X509_V_ERR_CRL_HAS_EXPIRED)
+    return 1;
+
+  if (item->n_errors < BATCH_MAX_ERRORS)
+    item->errors[item->n_errors++] = err;
+
+  return ok;
 }
 
-static char pkcs10_object_der_read_file__doc__[] =
-  "Read a DER-encoded PKCS#10 object from a file.\n"
-  ;
+/*
+ * Check one batch item.  Must not touch anything Python, as we're
+ * running without the interpreter lock, possibly in a worker thread.
+ */
 
-static PyObject *
-pkcs10_object_der_read_file(PyTypeObject *type, PyObject *args)
+static void
+batch_verify_item(batch_context *b, X509_STORE_CTX *ctx, batch_item *item)
 {
-  ENTERING(pkcs10_object_der_read_file);
-  return read_from_file_helper(pkcs10_object_der_read_helper, type, args);
+  ASN1_OBJECT *policy = NULL;
+
+  if (item->x != NULL && X509_STORE_CTX_init(ctx, b->store, item->x, NULL)) {
+    X509_STORE_CTX_set_app_data(ctx, item);
+    X509_STORE_CTX_trusted_stack(ctx, b->trusted);
+    X509_STORE_CTX_set_verify_cb(ctx, batch_verify_cb);
+    X509_VERIFY_PARAM_set_flags(ctx->param, X509_V_FLAG_X509_STRICT);
+
+    if (b->crls != NULL) {
+      X509_STORE_CTX_set0_crls(ctx, b->crls);
+      X509_VERIFY_PARAM_set_flags(ctx->param, X509_V_FLAG_CRL_CHECK);
+    }
+
+    if (b->policy != NULL && (policy = OBJ_dup(b->policy)) != NULL) {
+      X509_VERIFY_PARAM_set_flags(ctx->param, X509_V_FLAG_POLICY_CHECK | X509_V_FLAG_EXPLICIT_POLICY);
+      X509_VERIFY_PARAM_add0_policy(ctx->param, policy);
+    }
+
+    item->x509_ok = X509_verify_cert(ctx) > 0;
+
+    X509_STORE_CTX_set0_crls(ctx, NULL);
+    X509_STORE_CTX_trusted_stack(ctx, NULL);
+    X509_STORE_CTX_cleanup(ctx);
+  }
+
+  if (item->cms != NULL && (item->content = BIO_new(BIO_s_mem())) != NULL)
+    item->cms_ok = CMS_verify(item->cms, NULL, NULL, NULL, item->content, CMS_NO_SIGNER_CERT_VERIFY) > 0;
+
+  ERR_clear_error();
 }
 
-static char pkcs10_object_pem_write__doc__[] =
-  "Returns the PEM encoding of this PKCS#10 object.\n"
-  ;
+/*
+ * Claim the next unprocessed item in a batch, or return -1 if none left.
+ */
 
-static PyObject *
-pkcs10_object_pem_write(pkcs10_object *self)
+static int
+batch_next(batch_queue *q)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+  int i;
 
-  ENTERING(pkcs10_object_pem_write);
+#ifdef WITH_THREAD
+  if (q->threaded)
+    pthread_mutex_lock(&q->lock);
+#endif
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  i = q->next < q->n_items ? q->next++ : -1;
 
-  if (!PEM_write_bio_X509_REQ(bio, self->pkcs10))
-    lose_openssl_error("Unable to write PKCS#10 request");
+#ifdef WITH_THREAD
+  if (q->threaded)
+    pthread_mutex_unlock(&q->lock);
+#endif
 
-  result = BIO_to_PyString_helper(bio);
+  return i;
+}
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+#ifdef WITH_THREAD
+
+static void *
+batch_thread(void *arg)
+{
+  batch_queue *q = arg;
+  q->work(q);
+  ERR_remove_thread_state(NULL);
+  return NULL;
 }
 
-static char pkcs10_object_der_write__doc__[] =
-  "Return the DER encoding of this PKCS#10 object.\n"
-  ;
+#endif
 
-static PyObject *
-pkcs10_object_der_write(pkcs10_object *self)
+/*
+ * Run a batch, in the calling thread plus up to the requested number
+ * of worker threads.  The calling thread does the same thing as the
+ * workers, so a worker which can't get started just means that
+ * everybody else has more to do.  Call without the interpreter lock.
+ */
+
+static void
+batch_run(batch_queue *q, int threads)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+#ifdef WITH_THREAD
+  pthread_t tids[BATCH_MAX_THREADS];
+  int n_tids = 0;
 
-  ENTERING(pkcs10_object_der_write);
+  if (threads > BATCH_MAX_THREADS)
+    threads = BATCH_MAX_THREADS;
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  if (threads > q->n_items - 1)
+    threads = q->n_items - 1;
 
-  if (!i2d_X509_REQ_bio(bio, self->pkcs10))
-    lose_openssl_error("Unable to write PKCS#10 request");
+  q->threaded = threads > 0 && pthread_mutex_init(&q->lock, NULL) == 0;
+  for (n_tids = 0; q->threaded && n_tids < threads; n_tids++)
+    if (pthread_create(&tids[n_tids], NULL, batch_thread, q) != 0)
+      break;
+#endif
 
-  result = BIO_to_PyString_helper(bio);
+  q->work(q);
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
+#ifdef WITH_THREAD
+  while (n_tids > 0)
+    pthread_join(tids[--n_tids], NULL);
+  if (q->threaded)
+    pthread_mutex_destroy(&q->lock);
+#endif
 }
 
-static X509_EXTENSION *
-pkcs10_object_extension_get_helper(pkcs10_object *self, int nid)
+/*
+ * Work function for verifyBatch().
+ */
+
+static void
+batch_verify_work(batch_queue *q)
 {
-  if (self != NULL && self->exts != NULL)
-    return X509v3_get_ext(self->exts, X509v3_get_ext_by_NID(self->exts, nid, -1));
-  else
-    return NULL;
+  batch_context *b = (batch_context *) q;
+  X509_STORE_CTX *ctx = X509_STORE_CTX_new();
+  int i;
+
+  if (ctx != NULL)
+    while ((i = batch_next(q)) >= 0)
+      batch_verify_item(b, ctx, &b->items[i]);
+
+  X509_STORE_CTX_free(ctx);
 }
 
+/*
+ * Convert results for one batch item to a (status, payload) tuple,
+ * running conformance checks and decoding ROA and manifest payloads
+ * along the way.  Runs with the interpreter lock held.
+ */
+
 static PyObject *
-pkcs10_object_extension_set_helper(pkcs10_object *self, extension_wrapper ext)
+batch_item_result(batch_item *item)
 {
-  int ok = 0;
+  PyObject *status = NULL, *payload = NULL, *code = NULL, *result = NULL;
+  X509_EXTENSION *ext;
+  EXTENDED_KEY_USAGE *eku = NULL;
+  int i, ekunid = NID_undef;
+
+  if ((status = PySet_New(NULL)) == NULL)
+    goto error;
+
+  /*
+   * Same mapping as X509StoreCTX.verify_callback() in rcynicng: a
+   * chain that doesn't reach a trusted certificate means the trust
+   * anchor wasn't self-signed.
+   */
+
+  for (i = 0; i < item->n_errors; i++) {
+    if (item->errors[i] == X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT) {
+      record_validation_status(status, TRUST_ANCHOR_NOT_SELF_SIGNED);
+      continue;
+    }
+    if ((code = PyInt_FromLong(item->errors[i])) == NULL || PySet_Add(status, code) < 0)
+      goto error;
+    Py_XDECREF(code);
+    code = NULL;
+  }
+
+  if (item->x == NULL || !item->x509_ok || (item->cms != NULL && !item->cms_ok))
+    record_validation_status(status, OBJECT_REJECTED);
+
+  /*
+   * Same test for router certificates that rcynicng uses: a non-CA
+   * certificate (not an EE certificate in a CMS wrapper) which
+   * carries the BGPSEC router EKU.
+   */
+
+  if (item->x != NULL && item->cms == NULL && !X509_check_ca(item->x) &&
+      (ext = X509_get_ext(item->x, X509_get_ext_by_NID(item->x, NID_ext_key_usage, -1))) != NULL &&
+      (eku = X509V3_EXT_d2i(ext)) != NULL)
+    for (i = 0; ekunid == NID_undef && i < sk_ASN1_OBJECT_num(eku); i++)
+      if (OBJ_obj2nid(sk_ASN1_OBJECT_value(eku, i)) == NID_id_kp_bgpsec_router)
+        ekunid = NID_id_kp_bgpsec_router;
+
+  if (item->x != NULL && !check_x509(item->x, ekunid, status))
+    goto error;
 
-  if (ext.value == NULL)
+  if (item->cms != NULL && !check_cms(item->cms, status))
     goto error;
 
-  if (!X509V3_add1_i2d(&self->exts, ext.nid, ext.value, ext.critical, X509V3_ADD_REPLACE))
-    lose_openssl_error("Couldn't add extension to PKCS #10 object");
+  if (item->cms != NULL && item->cms_ok) {
 
-  ok = 1;
+    if (POW_ROA_Check(item->object)) {
+      roa_object *r = (roa_object *) item->object;
+      if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(ROA), item->content, &r->roa))
+        record_validation_status(status, OBJECT_REJECTED);
+      else if (!check_roa(item->cms, r->roa, status))
+        goto error;
+    }
+
+    else if (POW_Manifest_Check(item->object)) {
+      manifest_object *m = (manifest_object *) item->object;
+      if (!ASN1_item_d2i_bio(ASN1_ITEM_rptr(Manifest), item->content, &m->manifest))
+        record_validation_status(status, OBJECT_REJECTED);
+      else if (!check_manifest(item->cms, m->manifest, status))
+        goto error;
+    }
+
+    else {
+      char *ptr = NULL;
+      long len = BIO_get_mem_data(item->content, &ptr);
+      if ((payload = PyString_FromStringAndSize(ptr, len)) == NULL)
+        goto error;
+    }
+  }
+
+  ERR_clear_error();
+
+  result = Py_BuildValue("(OO)", status, payload == NULL ? Py_None : payload);
 
  error:
-  ext.destructor(ext.value);
-  if (ok)
-    Py_RETURN_NONE;
-  else
-    return NULL;
+  sk_ASN1_OBJECT_pop_free(eku, ASN1_OBJECT_free);
+  Py_XDECREF(status);
+  Py_XDECREF(payload);
+  Py_XDECREF(code);
+  return result;
 }
 
-static char pkcs10_object_get_public_key__doc__[] =
-  "Return the public key from this PKCS#10 request, as an Asymmetric\n"
-  "object.\n"
+static char pow_module_verify_batch__doc__[] =
+  "Verify a batch of objects issued by the same CA.\n"
+  "\n"
+  "The \"objects\" parameter is a sequence of X509, CMS, ROA, and Manifest\n"
+  "objects.  The \"trusted\" parameter is a sequence of X509 objects making\n"
+  "up the issuer's chain, starting with the issuer itself.  The optional\n"
+  "\"crl\" parameter is the issuer's CRL, and the optional \"policy\"\n"
+  "parameter is a certificate policy OID, as with X509.verify().\n"
+  "\n"
+  "Certificate path validation (of the object itself, or of the EE\n"
+  "certificate in a CMS object) and CMS signature checking run without\n"
+  "holding the Python interpreter lock.  The optional \"threads\"\n"
+  "parameter specifies how many additional threads to use for this;\n"
+  "the default is to do everything in the calling thread.\n"
+  "\n"
+  "Returns a list containing one (status, payload) tuple per object.\n"
+  "\"status\" is a set containing validation status codes, including\n"
+  "integer X509_V_ERR_* codes from path validation, suitable for\n"
+  "normalizing via rpki.POW.validation_status.  \"payload\" is the eContent\n"
+  "of a plain CMS object (eg, a Ghostbuster vCard), and None otherwise;\n"
+  "ROA and Manifest payloads are decoded in place, exactly as their\n"
+  "verify() methods would.\n"
   ;
 
 static PyObject *
-pkcs10_object_get_public_key(pkcs10_object *self)
+pow_module_verify_batch(GCC_UNUSED PyObject *self, PyObject *args, PyObject *kwds)
 {
-  PyTypeObject *type = &POW_Asymmetric_Type;
-  asymmetric_object *asym = NULL;
+  static char *kwlist[] = {"objects", "trusted", "crl", "policy", "threads", NULL};
+  PyObject *objects = NULL, *trusted = NULL, *crl = Py_None, *policy = Py_None;
+  PyObject *seq = NULL, *result = NULL, *item_result = NULL, *obj;
+  STACK_OF(X509) *certs = NULL;
+  batch_context b;
+  int i, threads = 0, ok = 0;
 
-  ENTERING(pkcs10_object_get_public_key);
+  ENTERING(pow_module_verify_batch);
 
-  if ((asym = (asymmetric_object *) type->tp_alloc(type, 0)) == NULL)
+  memset(&b, 0, sizeof(b));
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OOi", kwlist,
+                                   &objects, &trusted, &crl, &policy, &threads))
     goto error;
 
-  if ((asym->pkey = X509_REQ_get_pubkey(self->pkcs10)) == NULL)
-    lose_openssl_error("Couldn't extract public key from PKCS#10 request");
+  if ((seq = PySequence_Fast(objects, "Expected a sequence of objects")) == NULL)
+    goto error;
 
-  whack_ec_key_to_namedCurve(asym->pkey);
+  b.q.n_items = (int) PySequence_Fast_GET_SIZE(seq);
+  b.q.work = batch_verify_work;
 
-  return (PyObject *) asym;
+  if ((b.trusted = x509_helper_iterable_to_stack(trusted)) == NULL)
+    goto error;
 
- error:
-  Py_XDECREF(asym);
-  return NULL;
-}
+  if (crl != Py_None && !POW_CRL_Check(crl))
+    lose_type_error("Not a CRL");
 
-static char pkcs10_object_set_public_key__doc__[] =
-  "Set the public key for this PKCS#10 request.\n"
-  "\n"
-  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
-  "containing a public key.\n"
-  ;
+  if (crl != Py_None && ((b.crls = sk_X509_CRL_new_null()) == NULL ||
+                         !sk_X509_CRL_push(b.crls, ((crl_object *) crl)->crl)))
+    lose_no_memory();
 
-static PyObject *
-pkcs10_object_set_public_key(pkcs10_object *self, PyObject *args)
-{
-  asymmetric_object *asym;
+  if (policy != Py_None) {
+    const char *oid_txt = PyString_AsString(policy);
+    if (oid_txt == NULL)
+      goto error;
+    if ((b.policy = OBJ_txt2obj(oid_txt, 1)) == NULL)
+      lose("Couldn't parse policy OID");
+  }
 
-  ENTERING(pkcs10_object_set_public_key);
+  if ((b.store = X509_STORE_new()) == NULL ||
+      (b.items = PyMem_Malloc((b.q.n_items > 0 ? b.q.n_items : 1) * sizeof(*b.items))) == NULL)
+    lose_no_memory();
 
-  if (!PyArg_ParseTuple(args, "O!", &POW_Asymmetric_Type, &asym))
-    goto error;
+  memset(b.items, 0, (b.q.n_items > 0 ? b.q.n_items : 1) * sizeof(*b.items));
 
-  if (!X509_REQ_set_pubkey(self->pkcs10, asym->pkey))
-    lose_openssl_error("Couldn't set certificate's PKCS#10 request");
+  /*
+   * X509_check_ca() is just a way of getting x509v3_cache_extensions()
+   * run while we're still single-threaded.
+   */
 
-  Py_RETURN_NONE;
+  for (i = 0; i < sk_X509_num(b.trusted); i++)
+    (void) X509_check_ca(sk_X509_value(b.trusted, i));
 
- error:
-  return NULL;
-}
+  for (i = 0; i < b.q.n_items; i++) {
+    batch_item *item = &b.items[i];
+    item->object = obj = PySequence_Fast_GET_ITEM(seq, i);
 
-static char pkcs10_object_sign__doc__[] =
-  "Sign a PKCS#10 request with a private key.\n"
-  "\n"
-  "The \"key\" parameter should be an instance of the Asymmetric class,\n"
-  "containing a private key.\n"
-  "\n"
-  "The optional \"digest\" parameter indicates which digest to compute and\n"
-  "sign, and should be one of the following:\n"
-  "\n"
-  "* SHA1_DIGEST\n"
-  "* SHA256_DIGEST\n"
-  "* SHA384_DIGEST\n"
-  "* SHA512_DIGEST\n"
-  "\n"
-  "The default digest algorithm is SHA-256.\n"
-  ;
+    if (POW_X509_Check(obj)) {
+      item->x = ((x509_object *) obj)->x509;
+      CRYPTO_add(&item->x->references, 1, CRYPTO_LOCK_X509);
+    }
 
-static PyObject *
-pkcs10_object_sign(pkcs10_object *self, PyObject *args)
-{
-  asymmetric_object *asym;
-  int loc, digest_type = SHA256_DIGEST;
-  const EVP_MD *digest_method = NULL;
+    else if (POW_CMS_Check(obj)) {
+      if ((item->cms = cms_object_get_cms((cms_object *) obj)) == NULL) {
+        PyErr_Clear();          /* Undecodable, batch_item_result() rejects it */
+        ERR_clear_error();
+      }
+      else if ((certs = CMS_get1_certs(item->cms)) != NULL && sk_X509_num(certs) == 1) {
+        item->x = sk_X509_value(certs, 0);
+        CRYPTO_add(&item->x->references, 1, CRYPTO_LOCK_X509);
+      }
+      sk_X509_pop_free(certs, X509_free);
+      certs = NULL;
+    }
 
-  ENTERING(pkcs10_object_sign);
+    else {
+      lose_type_error("Expected an X509 or CMS object");
+    }
 
-  if (!PyArg_ParseTuple(args, "O!|i", &POW_Asymmetric_Type, &asym, &digest_type))
-    goto error;
+    if (item->x != NULL)
+      (void) X509_check_ca(item->x);
+  }
 
-  if ((digest_method = evp_digest_factory(digest_type)) == NULL)
-    lose("Unsupported digest algorithm");
+  assert_no_unhandled_openssl_errors();
 
-  while ((loc = X509_REQ_get_attr_by_NID(self->pkcs10, NID_ext_req, -1)) >= 0)
-    X509_ATTRIBUTE_free(X509_REQ_delete_attr(self->pkcs10, loc));
+  Py_BEGIN_ALLOW_THREADS
+  batch_run(&b.q, threads);
+  Py_END_ALLOW_THREADS
 
-  if (sk_X509_EXTENSION_num(self->exts) > 0 &&
-      !X509_REQ_add_extensions(self->pkcs10, self->exts))
-    lose_openssl_error("Couldn't add extensions block to PKCS#10 request");
+  if ((result = PyList_New(b.q.n_items)) == NULL)
+    goto error;
 
-  if (!X509_REQ_sign(self->pkcs10, asym->pkey, digest_method))
-    lose_openssl_error("Couldn't sign PKCS#10 request");
+  for (i = 0; i < b.q.n_items; i++) {
+    if ((item_result = batch_item_result(&b.items[i])) == NULL)
+      goto error;
+    PyList_SET_ITEM(result, i, item_result);
+  }
 
-  Py_RETURN_NONE;
+  ok = 1;
 
  error:
+  if (b.items != NULL) {
+    for (i = 0; i < b.q.n_items; i++) {
+      X509_free(b.items[i].x);
+      BIO_free(b.items[i].content);
+    }
+    PyMem_Free(b.items);
+  }
+  X509_STORE_free(b.store);
+  sk_X509_free(b.trusted);
+  sk_X509_CRL_free(b.crls);
+  ASN1_OBJECT_free(b.policy);
+  Py_XDECREF(seq);
+
+  if (ok)
+    return result;
+
+  Py_XDECREF(result);
   return NULL;
 }
 
-static char pkcs10_object_verify__doc__[] =
-  "Verify a PKCS#10 request.\n"
-  "\n"
-  "This calls OpenSSL's X509_REQ_verify() method to check the request's\n"
-  "self-signature.\n"
-  ;
 
-static PyObject *
-pkcs10_object_verify(pkcs10_object *self)
-{
-  EVP_PKEY *pkey = NULL;
-  int status;
+/*
+ * Batch signing.  rpkid regenerates certificates, CRLs, ROAs and
+ * manifests one at a time, and the public key operations dominate.
+ * This does the signing and DER encoding for a whole batch of objects
+ * without holding the interpreter lock, optionally spread across a
+ * few threads, then installs the results in the objects just as their
+ * sign() methods would.
+ */
 
-  ENTERING(pkcs10_object_verify);
+typedef struct {
+  PyObject *object;             /* Borrowed from caller's sequence */
+  EVP_PKEY *pkey;               /* Borrowed */
+  X509 *signcert;               /* Borrowed, CMS objects only */
+  X509 *x509;                   /* Borrowed, certificates only */
+  X509_CRL *crl;                /* Borrowed, CRLs only */
+  const ASN1_ITEM *it;          /* Payload type, CMS objects only */
+  void *payload;                /* Borrowed, CMS objects only */
+  ASN1_OBJECT *econtent_type;   /* Static, CMS objects only */
+  CMS_ContentInfo *cms;         /* New signed CMS */
+  unsigned char *der;
+  int der_len;
+  unsigned long err;            /* First OpenSSL error, if we failed */
+  const char *err_file;
+  int err_line;
+} sign_item;
 
-  if ((pkey = X509_REQ_get_pubkey(self->pkcs10)) == NULL)
-    lose_openssl_error("Couldn't extract public key from PKCS#10 for verification");
+typedef struct {
+  batch_queue q;                /* Must be first */
+  sign_item *items;
+  STACK_OF(X509) *certs;
+  STACK_OF(X509_CRL) *crls;
+  const EVP_MD *digest;
+  unsigned flags;
+} sign_context;
 
-  if ((status = X509_REQ_verify(self->pkcs10, pkey)) < 0)
-    lose_openssl_error("Couldn't verify PKCS#10 signature");
+/*
+ * Sign and encode one batch item.  Must not touch anything Python.
+ */
 
-  EVP_PKEY_free(pkey);
-  return PyBool_FromLong(status);
+static void
+sign_batch_item(sign_context *s, sign_item *item)
+{
+  CMS_ContentInfo *cms = NULL;
+  BIO *bio = NULL;
+  int i, ok = 0;
+
+  if (item->x509 != NULL)
+    ok = (X509_sign(item->x509, item->pkey, s->digest) > 0 &&
+          (item->der_len = i2d_X509(item->x509, &item->der)) > 0);
+
+  else if (item->crl != NULL)
+    ok = (X509_CRL_sign(item->crl, item->pkey, s->digest) > 0 &&
+          (item->der_len = i2d_X509_CRL(item->crl, &item->der)) > 0);
+
+  else if ((bio = BIO_new(BIO_s_mem())) != NULL &&
+           ASN1_item_i2d_bio(item->it, bio, item->payload) &&
+           (cms = CMS_sign(NULL, NULL, s->certs, bio, s->flags)) != NULL &&
+           CMS_set1_eContentType(cms, item->econtent_type) &&
+           CMS_add1_signer(cms, item->signcert, item->pkey, s->digest, s->flags) != NULL) {
+    for (ok = 1, i = 0; ok && i < sk_X509_CRL_num(s->crls); i++)
+      ok = CMS_add1_crl(cms, sk_X509_CRL_value(s->crls, i));
+    ok = (ok &&
+          CMS_final(cms, bio, NULL, s->flags) &&
+          (item->der_len = i2d_CMS_ContentInfo(cms, &item->der)) > 0);
+  }
 
- error:
-  EVP_PKEY_free(pkey);
-  return NULL;
-}
+  if (ok) {
+    item->cms = cms;
+    cms = NULL;
+  } else {
+    item->err = ERR_peek_error_line(&item->err_file, &item->err_line);
+    OPENSSL_free(item->der);
+    item->der = NULL;
+  }
 
-static char pkcs10_object_get_version__doc__[] =
-  "Return the version number of this PKCS#10 request.\n"
-  ;
+  CMS_ContentInfo_free(cms);
+  BIO_free(bio);
+  ERR_clear_error();
+}
 
-static PyObject *
-pkcs10_object_get_version(pkcs10_object *self)
+static void
+sign_batch_work(batch_queue *q)
 {
-  ENTERING(pkcs10_object_get_version);
-  return Py_BuildValue("l", X509_REQ_get_version(self->pkcs10));
+  sign_context *s = (sign_context *) q;
+  int i;
+
+  while ((i = batch_next(q)) >= 0)
+    sign_batch_item(s, &s->items[i]);
 }
 
-static char pkcs10_object_set_version__doc__[] =
-  "Set the version number of this PKCS#10 request.\n"
+static char pow_module_sign_batch__doc__[] =
+  "Sign a batch of objects, returning their DER encodings.\n"
   "\n"
-  "The \"version\" parameter should be an integer, but the only defined\n"
-  "value is zero, so this field is optional and defaults to zero.\n"
-;
+  "The \"objects\" parameter is a sequence of X509, CRL, ROA, and Manifest\n"
+  "objects.  Certificates and CRLs are signed with \"key\", an Asymmetric\n"
+  "object, as their sign() methods would.  ROAs and Manifests are signed\n"
+  "with \"key\" and \"signcert\", an X509 object, as their sign() methods\n"
+  "would, with the optional \"certs\" and \"crls\" parameters supplying\n"
+  "additional certificates and CRLs to include in each signed message\n"
+  "and the optional \"flags\" parameter taking CMS_NOCERTS and CMS_NOATTR.\n"
+  "\n"
+  "Since RPKI signed objects each have their own EE certificate, any\n"
+  "element of \"objects\" may instead be a tuple (object, key) or\n"
+  "(object, key, signcert) overriding the shared values for that object.\n"
+  "\n"
+  "The optional \"digest\" parameter is as for CRL.sign(), defaulting to\n"
+  "SHA-256.  Signing runs without holding the Python interpreter lock.\n"
+  "The optional \"threads\" parameter specifies how many additional\n"
+  "threads to use for this; the default is to do everything in the\n"
+  "calling thread.\n"
+  "\n"
+  "Returns a list of DER strings, one per object.  The objects themselves\n"
+  "are updated in place.  Do not include the same object twice.\n"
+  ;
 
 static PyObject *
-pkcs10_object_set_version(pkcs10_object *self, PyObject *args)
+pow_module_sign_batch(GCC_UNUSED PyObject *self, PyObject *args, PyObject *kwds)
 {
-  long version = 0;
+  static char *kwlist[] = {"objects", "key", "signcert", "certs", "crls", "digest", "flags", "threads", NULL};
+  PyObject *objects = NULL, *key = Py_None, *signcert = Py_None, *certs = Py_None, *crls = Py_None;
+  PyObject *seq = NULL, *result = NULL, *der = NULL, *entry, *obj, *item_key, *item_signcert;
+  int i, digest_type = SHA256_DIGEST, threads = 0, ok = 0;
+  unsigned flags = 0;
+  sign_context s;
 
-  ENTERING(pkcs10_object_set_version);
+  ENTERING(pow_module_sign_batch);
 
-  if (!PyArg_ParseTuple(args, "|l", &version))
+  memset(&s, 0, sizeof(s));
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OOOOiIi", kwlist,
+                                   &objects, &key, &signcert, &certs, &crls,
+                                   &digest_type, &flags, &threads))
     goto error;
 
-  if (version != 0)
-    lose("RFC 6487 6.1.1 forbids non-zero values for this field");
+  if ((seq = PySequence_Fast(objects, "Expected a sequence of objects")) == NULL)
+    goto error;
 
-  if (!X509_REQ_set_version(self->pkcs10, version))
-    lose("Couldn't set certificate version");
+  s.q.n_items = (int) PySequence_Fast_GET_SIZE(seq);
+  s.q.work = sign_batch_work;
+  s.flags = (flags & (CMS_NOCERTS | CMS_NOATTR)) | CMS_BINARY | CMS_NOSMIMECAP | CMS_PARTIAL | CMS_USE_KEYID;
 
-  Py_RETURN_NONE;
+  if ((s.digest = evp_digest_factory(digest_type)) == NULL)
+    lose("Unsupported digest algorithm");
 
- error:
+  if ((s.certs = x509_helper_iterable_to_stack(certs)) == NULL)
+    goto error;
 
-  return NULL;
-}
+  if ((s.crls = sk_X509_CRL_new_null()) == NULL)
+    lose_no_memory();
 
-static char pkcs10_object_get_subject__doc__[] =
-  "Return this PKCS #10 request's subject name.\n"
-  "\n"
-  "See the X509.getIssuer() method for details of the return value and\n"
-  "use of the optional \"format\" parameter.\n"
-  ;
+  if (crls != Py_None) {
+    PyObject *iterator = NULL, *crl = NULL;
 
-static PyObject *
-pkcs10_object_get_subject(pkcs10_object *self, PyObject *args)
-{
-  PyObject *result = NULL;
-  int format = OIDNAME_FORMAT;
+    if ((iterator = PyObject_GetIter(crls)) == NULL)
+      goto error;
 
-  ENTERING(pkcs10_object_get_subject);
+    while ((crl = PyIter_Next(iterator)) != NULL && POW_CRL_Check(crl)) {
+      if (sk_X509_CRL_push(s.crls, ((crl_object *) crl)->crl))
+        CRYPTO_add(&((crl_object *) crl)->crl->references, 1, CRYPTO_LOCK_X509_CRL);
+      else
+        PyErr_NoMemory();
+      Py_DECREF(crl);
+      crl = NULL;
+      if (PyErr_Occurred())
+        break;
+    }
 
-  if (!PyArg_ParseTuple(args, "|i", &format))
-    goto error;
+    Py_XDECREF(iterator);
 
-  result = x509_object_helper_get_name(X509_REQ_get_subject_name(self->pkcs10),
-                                       format);
+    if (crl != NULL) {
+      Py_DECREF(crl);
+      lose_type_error("Expected a CRL object");
+    }
 
- error:                         /* Fall through */
-  return result;
-}
+    if (PyErr_Occurred())
+      goto error;
+  }
 
-static char pkcs10_object_set_subject__doc__[] =
-  "Set this PKCS#10 request's subject name.\n"
-  "\n"
-  "The \"name\" parameter should be in the same format as the return\n"
-  "value from the \"getSubject\" method.\n"
-  ;
+  if ((s.items = PyMem_Malloc((s.q.n_items > 0 ? s.q.n_items : 1) * sizeof(*s.items))) == NULL)
+    lose_no_memory();
 
-static PyObject *
-pkcs10_object_set_subject(pkcs10_object *self, PyObject *args)
-{
-  PyObject *name_sequence = NULL;
-  X509_NAME *name = NULL;
+  memset(s.items, 0, (s.q.n_items > 0 ? s.q.n_items : 1) * sizeof(*s.items));
 
-  ENTERING(pkcs10_object_set_subject);
+  for (i = 0; i < s.q.n_items; i++) {
+    sign_item *item = &s.items[i];
 
-  if (!PyArg_ParseTuple(args, "O", &name_sequence))
-    goto error;
+    entry = obj = PySequence_Fast_GET_ITEM(seq, i);
+    item_key = key;
+    item_signcert = signcert;
 
-  if (!PySequence_Check(name_sequence))
-    lose_type_error("Expected a sequence object");
+    if (PyTuple_Check(entry) &&
+        !PyArg_ParseTuple(entry, "OO|O", &obj, &item_key, &item_signcert))
+      goto error;
 
-  if ((name = x509_object_helper_set_name(name_sequence)) == NULL)
-    goto error;
+    item->object = obj;
 
-  if (!X509_REQ_set_subject_name(self->pkcs10, name))
-    lose("Unable to set subject name");
+    if (!POW_Asymmetric_Check(item_key))
+      lose_type_error("Expected an Asymmetric key");
 
-  X509_NAME_free(name);
+    item->pkey = ((asymmetric_object *) item_key)->pkey;
+
+    if (POW_X509_Check(obj)) {
+      item->x509 = ((x509_object *) obj)->x509;
+    }
+
+    else if (POW_CRL_Check(obj)) {
+      item->crl = ((crl_object *) obj)->crl;
+    }
+
+    else if (POW_ROA_Check(obj) || POW_Manifest_Check(obj)) {
 
-  Py_RETURN_NONE;
+      if (!POW_X509_Check(item_signcert))
+        lose_type_error("Expected an X509 signing certificate");
 
- error:
-  X509_NAME_free(name);
-  return NULL;
-}
+      item->signcert = ((x509_object *) item_signcert)->x509;
 
-static char pkcs10_object_get_key_usage__doc__[] =
-  EXTENSION_GET_KEY_USAGE__DOC__
-  ;
+      if (POW_ROA_Check(obj)) {
+        item->it = ASN1_ITEM_rptr(ROA);
+        item->payload = ((roa_object *) obj)->roa;
+        item->econtent_type = OBJ_nid2obj(NID_ct_ROA);
+      } else {
+        item->it = ASN1_ITEM_rptr(Manifest);
+        item->payload = ((manifest_object *) obj)->manifest;
+        item->econtent_type = OBJ_nid2obj(NID_ct_rpkiManifest);
+      }
 
-static PyObject *
-pkcs10_object_get_key_usage(pkcs10_object *self)
-{
-  return extension_get_key_usage(pkcs10_object_extension_get_helper(self, NID_key_usage));
-}
+      if (item->payload == NULL || item->econtent_type == NULL)
+        lose("Object has no content to sign");
 
-static char pkcs10_object_set_key_usage__doc__[] =
-  "Set the KeyUsage extension for this PKCS#10 request.\n"
-  "\n"
-  EXTENSION_SET_KEY_USAGE__DOC__
-  ;
+      (void) X509_check_ca(item->signcert);
+    }
 
-static PyObject *
-pkcs10_object_set_key_usage(pkcs10_object *self, PyObject *args)
-{
-  return pkcs10_object_extension_set_helper(self, extension_set_key_usage(args));
-}
+    else {
+      lose_type_error("Expected an X509, CRL, ROA, or Manifest object");
+    }
+  }
 
-static char pkcs10_object_get_eku__doc__[] =
-  EXTENSION_GET_EKU__DOC__
-  ;
+  assert_no_unhandled_openssl_errors();
 
-static PyObject *
-pkcs10_object_get_eku(pkcs10_object *self)
-{
-  return extension_get_eku(pkcs10_object_extension_get_helper(self, NID_ext_key_usage));
-}
+  Py_BEGIN_ALLOW_THREADS
+  batch_run(&s.q, threads);
+  Py_END_ALLOW_THREADS
 
-static char pkcs10_object_set_eku__doc__[] =
-  "Set the ExtendedKeyUsage extension for this PKCS #10 request.\n"
-  "\n"
-  EXTENSION_SET_EKU__DOC__
-  ;
+  for (i = 0; i < s.q.n_items; i++) {
+    sign_item *item = &s.items[i];
+    if (item->der == NULL) {
+      ERR_put_error(ERR_GET_LIB(item->err), ERR_GET_FUNC(item->err), ERR_GET_REASON(item->err),
+                    item->err_file, item->err_line);
+      lose_openssl_error("Couldn't sign object in batch");
+    }
+  }
 
-static PyObject *
-pkcs10_object_set_eku(pkcs10_object *self, PyObject *args)
-{
-  return pkcs10_object_extension_set_helper(self, extension_set_eku(args));
-}
+  if ((result = PyList_New(s.q.n_items)) == NULL)
+    goto error;
 
-static char pkcs10_object_get_basic_constraints__doc__[] =
-  "Return BasicConstraints value for this PKCS#10 request.\n"
-  "\n"
-  EXTENSION_GET_BASIC_CONSTRAINTS__DOC__
-  ;
+  for (i = 0; i < s.q.n_items; i++) {
+    sign_item *item = &s.items[i];
 
-static PyObject *
-pkcs10_object_get_basic_constraints(pkcs10_object *self)
-{
-  return extension_get_basic_constraints(pkcs10_object_extension_get_helper(self, NID_basic_constraints));
-}
+    if ((der = PyString_FromStringAndSize((char *) item->der, item->der_len)) == NULL)
+      goto error;
 
-static char pkcs10_object_set_basic_constraints__doc__[] =
-  "Set BasicConstraints value for this PKCS#10 request.\n"
-  "\n"
-  EXTENSION_SET_BASIC_CONSTRAINTS__DOC__
-  ;
+    PyList_SET_ITEM(result, i, der);
 
-static PyObject *
-pkcs10_object_set_basic_constraints(pkcs10_object *self, PyObject *args)
-{
-  return pkcs10_object_extension_set_helper(self, extension_set_basic_constraints(args));
-}
+    if (item->cms != NULL) {
+      cms_object *c = (cms_object *) item->object;
+      CMS_ContentInfo_free(c->cms);
+      c->cms = item->cms;
+      item->cms = NULL;
+      OPENSSL_free(c->der);
+      c->der = NULL;
+      c->der_len = 0;
+    }
+  }
 
-static char pkcs10_object_get_sia__doc__[] =
-  "Return the SIA values for this PKCS#10 request.\n"
-  "\n"
-  EXTENSION_GET_SIA__DOC__
-  ;
+  ok = 1;
 
-static PyObject *
-pkcs10_object_get_sia(pkcs10_object *self)
-{
-  return extension_get_sia(pkcs10_object_extension_get_helper(self, NID_sinfo_access));
-}
+ error:
+  if (s.items != NULL) {
+    for (i = 0; i < s.q.n_items; i++) {
+      CMS_ContentInfo_free(s.items[i].cms);
+      OPENSSL_free(s.items[i].der);
+    }
+    PyMem_Free(s.items);
+  }
+  sk_X509_free(s.certs);
+  sk_X509_CRL_pop_free(s.crls, X509_CRL_free);
+  Py_XDECREF(seq);
 
-static char pkcs10_object_set_sia__doc__[] =
-  "Set SIA values for this PKCS#10 request.\n"
-  "\n"
-  EXTENSION_SET_SIA__DOC__
-  ;
+  if (ok)
+    return result;
 
-static PyObject *
-pkcs10_object_set_sia(pkcs10_object *self, PyObject *args, PyObject *kwds)
-{
-  return pkcs10_object_extension_set_helper(self, extension_set_sia(args, kwds));
+  Py_XDECREF(result);
+  return NULL;
 }
 
-static char pkcs10_object_get_signature_algorithm__doc__[] =
-  "Return this PKCS #10 reqeuest's signature algorithm OID.\n"
-  ;
-
-static PyObject *
-pkcs10_object_get_signature_algorithm(pkcs10_object *self)
-{
-  ASN1_OBJECT *oid = NULL;
 
-  ENTERING(pkcs10_object_get_signature_algorithm);
+/*
+ * Batch hashing.  rcynicng hashes every object it pulls out of an
+ * rsync tree, and RRDP and manifest checks hash lots of small objects;
+ * this hashes a whole list of files or buffers in one call without
+ * holding the interpreter lock, optionally spread across a few threads.
+ */
 
-  X509_ALGOR_get0(&oid, NULL, NULL, self->pkcs10->sig_alg);
+typedef struct {
+  const char *filename;         /* Borrowed, files only */
+  Py_buffer buf;                /* Buffers only */
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned md_len;
+  int ok;
+} digest_item;
 
-  return ASN1_OBJECT_to_PyString(oid);
-}
+typedef struct {
+  batch_queue q;                /* Must be first */
+  digest_item *items;
+  const EVP_MD *md;
+} digest_context;
 
-static char pkcs10_object_get_extension_oids__doc__[] =
-  "Return the set of extension OIDs used in this request.  This is mostly\n"
-  "useful for enforcing restrictions on what extensions are allowed to be\n"
-  "present, eg, to conform with the RPKI profile.\n"
-  ;
+/*
+ * Hash one file, mapping it into memory if we can, otherwise reading it.
+ */
 
-static PyObject *
-pkcs10_object_get_extension_oids(pkcs10_object *self)
+static int
+digest_batch_file(const EVP_MD *md, digest_item *item)
 {
-  PyObject *result = NULL;
-  PyObject *oid = NULL;
-  int i;
+  void *map = MAP_FAILED;
+  struct stat sb;
+  ssize_t n = 0;
+  int ok = 0, fd;
 
-  ENTERING(pkcs10_object_get_extension_oids);
+  if ((fd = open(item->filename, O_RDONLY)) < 0)
+    return 0;
 
-  if ((result = PyFrozenSet_New(NULL)) == NULL)
-    goto error;
+  if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0 &&
+      (map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+    ok = EVP_Digest(map, (size_t) sb.st_size, item->md, &item->md_len, md, NULL);
+    (void) munmap(map, (size_t) sb.st_size);
+  }
 
-  for (i = 0; i < sk_X509_EXTENSION_num(self->exts); i++) {
-    X509_EXTENSION *ext = sk_X509_EXTENSION_value(self->exts, i);
-    if ((oid = ASN1_OBJECT_to_PyString(X509_EXTENSION_get_object(ext))) == NULL ||
-        PySet_Add(result, oid) < 0)
-      goto error;
-    Py_XDECREF(oid);
-    oid = NULL;
+  else {
+    unsigned char buf[16384];
+    EVP_MD_CTX ctx;
+
+    EVP_MD_CTX_init(&ctx);
+    ok = EVP_DigestInit_ex(&ctx, md, NULL);
+    while (ok && (n = read(fd, buf, sizeof(buf))) > 0)
+      ok = EVP_DigestUpdate(&ctx, buf, (size_t) n);
+    ok = ok && n == 0 && EVP_DigestFinal_ex(&ctx, item->md, &item->md_len);
+    EVP_MD_CTX_cleanup(&ctx);
   }
 
-  return result;
+  (void) close(fd);
+  return ok;
+}
 
- error:
-  Py_XDECREF(result);
-  Py_XDECREF(oid);
-  return NULL;  
+static void
+digest_batch_work(batch_queue *q)
+{
+  digest_context *d = (digest_context *) q;
+  digest_item *item;
+  int i;
+
+  while ((i = batch_next(q)) >= 0) {
+    item = &d->items[i];
+    if (item->filename != NULL)
+      item->ok = digest_batch_file(d->md, item);
+    else
+      item->ok = EVP_Digest(item->buf.buf, item->buf.len, item->md, &item->md_len, d->md, NULL);
+    ERR_clear_error();
+  }
 }
 
-static char pkcs10_object_pprint__doc__[] =
-  "Return a pretty-printed rendition of this PKCS#10 request.\n"
+static char pow_module_digest_batch__doc__[] =
+  "Compute digests of a batch of buffers or files.\n"
+  "\n"
+  "The \"objects\" parameter is a sequence of objects supporting the buffer\n"
+  "protocol, or, if the optional \"files\" parameter is true, a sequence\n"
+  "of filenames.  The optional \"digest\" parameter is as for the Digest\n"
+  "constructor, defaulting to SHA-256.\n"
+  "\n"
+  "Hashing runs without holding the Python interpreter lock.  The\n"
+  "optional \"threads\" parameter specifies how many additional threads\n"
+  "to use for this; the default is to do everything in the calling\n"
+  "thread.\n"
+  "\n"
+  "Returns a list of binary digests, one per object.  The entry for a\n"
+  "file which couldn't be read is None.\n"
   ;
 
 static PyObject *
-pkcs10_object_pprint(pkcs10_object *self)
+pow_module_digest_batch(GCC_UNUSED PyObject *self, PyObject *args, PyObject *kwds)
 {
-  PyObject *result = NULL;
-  BIO *bio = NULL;
+  static char *kwlist[] = {"objects", "digest", "files", "threads", NULL};
+  PyObject *objects = NULL, *files = Py_False;
+  PyObject *seq = NULL, *result = NULL, *md = NULL, *obj;
+  int i, digest_type = SHA256_DIGEST, threads = 0, use_files, ok = 0;
+  digest_context d;
 
-  ENTERING(pkcs10_object_pprint);
+  ENTERING(pow_module_digest_batch);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL)
-    lose_no_memory();
+  memset(&d, 0, sizeof(d));
 
-  if (!X509_REQ_print(bio, self->pkcs10))
-    lose_openssl_error("Unable to pretty-print PKCS#10 request");
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iOi", kwlist,
+                                   &objects, &digest_type, &files, &threads))
+    goto error;
 
-  result = BIO_to_PyString_helper(bio);
+  if ((use_files = PyObject_IsTrue(files)) < 0)
+    goto error;
 
- error:                         /* Fall through */
-  BIO_free(bio);
-  return result;
-}
+  if ((d.md = evp_digest_factory(digest_type)) == NULL)
+    lose("Unsupported digest algorithm");
 
-static struct PyMethodDef pkcs10_object_methods[] = {
-  Define_Method(pemWrite,               pkcs10_object_pem_write,                METH_NOARGS),
-  Define_Method(derWrite,               pkcs10_object_der_write,                METH_NOARGS),
-  Define_Method(sign,                   pkcs10_object_sign,                     METH_VARARGS),
-  Define_Method(verify,                 pkcs10_object_verify,                   METH_NOARGS),
-  Define_Method(getPublicKey,           pkcs10_object_get_public_key,           METH_NOARGS),
-  Define_Method(setPublicKey,           pkcs10_object_set_public_key,           METH_VARARGS),
-  Define_Method(getVersion,             pkcs10_object_get_version,              METH_NOARGS),
-  Define_Method(setVersion,             pkcs10_object_set_version,              METH_VARARGS),
-  Define_Method(getSubject,             pkcs10_object_get_subject,              METH_VARARGS),
-  Define_Method(setSubject,             pkcs10_object_set_subject,              METH_VARARGS),
-  Define_Method(pprint,                 pkcs10_object_pprint,                   METH_NOARGS),
-  Define_Method(getKeyUsage,            pkcs10_object_get_key_usage,            METH_NOARGS),
-  Define_Method(setKeyUsage,            pkcs10_object_set_key_usage,            METH_VARARGS),
-  Define_Method(getEKU,                 pkcs10_object_get_eku,                  METH_NOARGS),
-  Define_Method(setEKU,                 pkcs10_object_set_eku,                  METH_VARARGS),
-  Define_Method(getBasicConstraints,    pkcs10_object_get_basic_constraints,    METH_NOARGS),
-  Define_Method(setBasicConstraints,    pkcs10_object_set_basic_constraints,    METH_VARARGS),
-  Define_Method(getSIA,                 pkcs10_object_get_sia,                  METH_NOARGS),
-  Define_Method(setSIA,                 pkcs10_object_set_sia,                  METH_KEYWORDS),
-  Define_Method(getSignatureAlgorithm,  pkcs10_object_get_signature_algorithm,  METH_NOARGS),
-  Define_Method(getExtensionOIDs,       pkcs10_object_get_extension_oids,       METH_NOARGS),
-  Define_Class_Method(pemRead,          pkcs10_object_pem_read,                 METH_VARARGS),
-  Define_Class_Method(pemReadFile,      pkcs10_object_pem_read_file,            METH_VARARGS),
-  Define_Class_Method(derRead,          pkcs10_object_der_read,                 METH_VARARGS),
-  Define_Class_Method(derReadFile,      pkcs10_object_der_read_file,            METH_VARARGS),
-  {NULL}
-};
+  if ((seq = PySequence_Fast(objects, "Expected a sequence of objects")) == NULL)
+    goto error;
 
-static char POW_PKCS10_Type__doc__[] =
-  "This class represents a PKCS#10 request.\n"
-  ;
+  d.q.n_items = (int) PySequence_Fast_GET_SIZE(seq);
+  d.q.work = digest_batch_work;
 
-static PyTypeObject POW_PKCS10_Type = {
-  PyObject_HEAD_INIT(0)
-  0,                                        /* ob_size */
-  "rpki.POW.PKCS10",                        /* tp_name */
-  sizeof(pkcs10_object),                    /* tp_basicsize */
-  0,                                        /* tp_itemsize */
-  (destructor)pkcs10_object_dealloc,        /* tp_dealloc */
-  0,                                        /* tp_print */
-  0,                                        /* tp_getattr */
-  0,                                        /* tp_setattr */
-  0,                                        /* tp_compare */
-  0,                                        /* tp_repr */
-  0,                                        /* tp_as_number */
-  0,                                        /* tp_as_sequence */
-  0,                                        /* tp_as_mapping */
-  0,                                        /* tp_hash */
-  0,                                        /* tp_call */
-  0,                                        /* tp_str */
-  0,                                        /* tp_getattro */
-  0,                                        /* tp_setattro */
-  0,                                        /* tp_as_buffer */
-  Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE, /* tp_flags */
-  POW_PKCS10_Type__doc__,                   /* tp_doc */
-  0,                                        /* tp_traverse */
-  0,                                        /* tp_clear */
-  0,                                        /* tp_richcompare */
-  0,                                        /* tp_weaklistoffset */
-  0,                                        /* tp_iter */
-  0,                                        /* tp_iternext */
-  pkcs10_object_methods,                    /* tp_methods */
-  0,                                        /* tp_members */
-  0,                                        /* tp_getset */
-  0,                                        /* tp_base */
-  0,                                        /* tp_dict */
-  0,                                        /* tp_descr_get */
-  0,                                        /* tp_descr_set */
-  0,                                        /* tp_dictoffset */
-  0,                                        /* tp_init */
-  0,                                        /* tp_alloc */
-  pkcs10_object_new,                        /* tp_new */
-};
+  if ((d.items = PyMem_Malloc((d.q.n_items > 0 ? d.q.n_items : 1) * sizeof(*d.items))) == NULL)
+    lose_no_memory();
+
+  memset(d.items, 0, (d.q.n_items > 0 ? d.q.n_items : 1) * sizeof(*d.items));
+
+  for (i = 0; i < d.q.n_items; i++) {
+    obj = PySequence_Fast_GET_ITEM(seq, i);
+    if (use_files) {
+      if ((d.items[i].filename = PyString_AsString(obj)) == NULL)
+        goto error;
+    } else {
+      if (PyObject_GetBuffer(obj, &d.items[i].buf, PyBUF_SIMPLE) < 0)
+        goto error;
+    }
+  }
 
-
+  Py_BEGIN_ALLOW_THREADS
+  batch_run(&d.q, threads);
+  Py_END_ALLOW_THREADS
 
-/*
- * Module functions.
- */
+  if ((result = PyList_New(d.q.n_items)) == NULL)
+    goto error;
 
-static char pow_module_add_object__doc__[] =
-  "Add new a new object identifier to OpenSSL's internal database.\n"
-  "\n"
-  "The \"oid\" should be an ASN.1 object identifer, represented as a string\n"
-  "in dotted-decimal format.\n"
+  for (i = 0; i < d.q.n_items; i++) {
+    if (!d.items[i].ok && !use_files)
+      lose_openssl_error("Couldn't compute digest");
+    if (!d.items[i].ok) {
+      md = Py_None;
+      Py_INCREF(md);
+    } else if ((md = PyString_FromStringAndSize((char *) d.items[i].md, d.items[i].md_len)) == NULL) {
+      goto error;
+    }
+    PyList_SET_ITEM(result, i, md);
+  }
+
+  ok = 1;
+
+ error:
+  if (d.items != NULL) {
+    for (i = 0; i < d.q.n_items; i++)
+      if (d.items[i].buf.obj != NULL)
+        PyBuffer_Release(&d.items[i].buf);
+    PyMem_Free(d.items);
+  }
+  Py_XDECREF(seq);
+
+  if (ok)
+    return result;
+
+  Py_XDECREF(result);
+  return NULL;
+}
+
+
+static char pow_module_sendfile__doc__[] =
+  "Copy data from one file descriptor to another without going through\n"
+  "Python, for serving pre-encoded RPKI-RTR responses.\n"
   "\n"
-  "The \"shortName\" parameter should be the OpenSSL \"short name\" to use.\n"
+  "Arguments are the output file descriptor (usually a socket), the input\n"
+  "file descriptor (a regular file), the offset in the input file at which\n"
+  "to start, and the maximum number of bytes to copy.  The input file's\n"
+  "own position is not changed.\n"
   "\n"
-  "The \"longName\" parameter should be the OpenSSL \"long name\" to use.\n"
+  "Returns the number of bytes copied, which may be less than requested\n"
+  "if the output is non-blocking.  Errors (including EAGAIN) raise OSError.\n"
+  "Uses sendfile(2) where available, otherwise pread(2) and write(2).\n"
   ;
 
 static PyObject *
-pow_module_add_object(GCC_UNUSED PyObject *self, PyObject *args)
+pow_module_sendfile(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  char *oid = NULL, *sn = NULL, *ln = NULL;
+  PY_LONG_LONG offset = 0;
+  Py_ssize_t count = 0;
+  ssize_t n = -1;
+  int out_fd, in_fd;
 
-  ENTERING(pow_module_add_object);
+  ENTERING(pow_module_sendfile);
 
-  if (!PyArg_ParseTuple(args, "sss", &oid, &sn, &ln))
+  if (!PyArg_ParseTuple(args, "iiLn", &out_fd, &in_fd, &offset, &count))
     goto error;
 
-  if (!OBJ_create(oid, sn, ln))
-    lose_openssl_error("Unable to add object");
+  if (offset < 0 || count < 0)
+    lose_value_error("Offset and count must not be negative");
 
-  Py_RETURN_NONE;
+  Py_BEGIN_ALLOW_THREADS
 
- error:
+#ifdef __linux__
+  {
+    off_t off = (off_t) offset;
+    n = sendfile(out_fd, in_fd, &off, (size_t) count);
+  }
+#else
+  {
+    char buf[65536];
+    if ((size_t) count > sizeof(buf))
+      count = sizeof(buf);
+    if ((n = pread(in_fd, buf, (size_t) count, (off_t) offset)) > 0)
+      n = write(out_fd, buf, (size_t) n);
+  }
+#endif
+
+  Py_END_ALLOW_THREADS
 
+  if (n < 0)
+    return PyErr_SetFromErrno(PyExc_OSError);
+
+  return PyInt_FromSsize_t(n);
+
+ error:
   return NULL;
 }
 
-static char pow_module_get_error__doc__[] =
-  "Pop one error off OpenSSL's global error stack and returns it as a string.\n"
+static char pow_module_watch_directory__doc__[] =
+  "Start watching a directory for files renamed into it.\n"
   "\n"
-  "Returns None if the error stack is empty.\n"
+  "The argument is the name of the directory.  Returns a non-blocking\n"
+  "file descriptor which becomes readable when a file is renamed into\n"
+  "(or, on some platforms, created in or removed from) the directory;\n"
+  "pass it to watchEvents() to collect the events.  Any number of\n"
+  "processes can watch the same directory, and the kernel wakes all of\n"
+  "them, so one rename() reaches every watcher at constant cost to the\n"
+  "writer.\n"
+  "\n"
+  "Uses inotify(7) on Linux and kqueue(2) on BSD.  On BSD the directory\n"
+  "stays open until the process exits.  Raises NotImplementedError on\n"
+  "other platforms.\n"
   ;
 
 static PyObject *
-pow_module_get_error(GCC_UNUSED PyObject *self)
+pow_module_watch_directory(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  unsigned long error = ERR_get_error();
-  char buf[256];
+  const char *path = NULL;
+  int fd = -1;
 
-  ENTERING(pow_module_get_error);
+  ENTERING(pow_module_watch_directory);
 
-  if (!error)
-    Py_RETURN_NONE;
+  if (!PyArg_ParseTuple(args, "s", &path))
+    goto error;
 
-  ERR_error_string_n(error, buf, sizeof(buf));
-  return Py_BuildValue("s", buf);
+#if defined(__linux__)
+
+  if ((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 ||
+      inotify_add_watch(fd, path, IN_MOVED_TO | IN_ONLYDIR) < 0)
+    goto oserror;
+
+#elif defined(HAVE_KQUEUE)
+
+  {
+    struct kevent ev;
+    int dfd;
+
+    if ((dfd = open(path, O_RDONLY)) < 0)
+      goto oserror;
+    if ((fd = kqueue()) < 0 || fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+      (void) close(dfd);
+      goto oserror;
+    }
+    EV_SET(&ev, dfd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, NULL);
+    if (kevent(fd, &ev, 1, NULL, 0, NULL) < 0) {
+      (void) close(dfd);
+      goto oserror;
+    }
+  }
+
+#else
+
+  PyErr_SetString(PyExc_NotImplementedError, "No directory watch mechanism on this platform");
+  goto error;
+
+#endif
+
+  return PyInt_FromLong(fd);
+
+#if defined(__linux__) || defined(HAVE_KQUEUE)
+ oserror:
+  PyErr_SetFromErrnoWithFilename(PyExc_OSError, (char *) path);
+#endif
+
+ error:
+  if (fd >= 0)
+    (void) close(fd);
+  return NULL;
 }
 
-static char pow_module_clear_error__doc__[] =
-  "Remove all errors from OpenSSL's global error stack.\n"
+static char pow_module_watch_events__doc__[] =
+  "Collect pending events from a descriptor returned by watchDirectory().\n"
+  "\n"
+  "Returns the number of events read, zero if there were none.  Never\n"
+  "blocks.\n"
   ;
 
 static PyObject *
-pow_module_clear_error(GCC_UNUSED PyObject *self)
+pow_module_watch_events(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  ENTERING(pow_module_clear_error);
-  ERR_clear_error();
-  Py_RETURN_NONE;
+  long count = 0;
+  int fd;
+
+  ENTERING(pow_module_watch_events);
+
+  if (!PyArg_ParseTuple(args, "i", &fd))
+    goto error;
+
+#if defined(__linux__)
+
+  {
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    ssize_t n;
+    char *p;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+      for (p = buf; p < buf + n; p += sizeof(*ev) + ev->len) {
+        ev = (const struct inotify_event *) p;
+        count++;
+      }
+
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+      return PyErr_SetFromErrno(PyExc_OSError);
+  }
+
+#elif defined(HAVE_KQUEUE)
+
+  {
+    static const struct timespec zero = {0, 0};
+    struct kevent evs[16];
+    int n;
+
+    while ((n = kevent(fd, NULL, 0, evs, sizeof(evs)/sizeof(*evs), &zero)) > 0)
+      count += n;
+
+    if (n < 0)
+      return PyErr_SetFromErrno(PyExc_OSError);
+  }
+
+#else
+
+  PyErr_SetString(PyExc_NotImplementedError, "No directory watch mechanism on this platform");
+  goto error;
+
+#endif
+
+  return PyInt_FromLong(count);
+
+ error:
+  return NULL;
 }
 
-static char pow_module_get_verification_errors__doc__[] =
-  "Return strings for known OpenSSL certificate verification errors.\n"
-  "Returns a list of (number, symbol, text) tuples.\n"
+static char pow_module_roa_payload__doc__[] =
+  "Extract the payload from a DER-encoded ROA without building a ROA object.\n"
+  "\n"
+  "The argument may be any object supporting the buffer protocol.  The\n"
+  "return value is a two-element tuple: the ROA's Autonomous System ID,\n"
+  "and its prefixes in the format returned by ROA.getPrefixes().\n"
+  "\n"
+  "This only decodes as much of the CMS wrapper as it takes to find the\n"
+  "eContent, so it's much cheaper than reading the ROA and calling\n"
+  ".extractWithoutVerifying(), and, like that method, it does no\n"
+  "verification at all.  NEVER USE THIS ON AN UNVERIFIED ROA!\n"
   ;
 
 static PyObject *
-pow_module_get_verification_errors(GCC_UNUSED PyObject *self)
+pow_module_roa_payload(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  PyObject *result = NULL, *item = NULL;
+  const unsigned char *content = NULL, *der;
+  ASN1_OCTET_STRING **pos = NULL;
+  CMS_ContentInfo *cms = NULL;
+  PyObject *prefixes = NULL;
+  PyObject *result = NULL;
+  long content_len = 0;
+  ROA *roa = NULL;
+  Py_buffer src;
 
-  ENTERING(pow_module_get_verification_errors);
+  ENTERING(pow_module_roa_payload);
 
-  /*
-   * This function is only called once, and doesn't need to be
-   * particularly efficient, so we use a list to keep the code simple.
-   */
+  src.obj = NULL;
 
-  if ((result = PyList_New(0)) == NULL)
+  if (!PyArg_ParseTuple(args, "s*", &src))
     goto error;
 
-#define Verification_Error(_v_)                                         \
-  do {                                                                  \
-    const char *msg = X509_verify_cert_error_string(_v_);               \
-    if ((item = Py_BuildValue("(iss)", _v_, #_v_, msg)) == NULL ||      \
-        PyList_Append(result, item) < 0)                                \
-      goto error;                                                       \
-    Py_XDECREF(item);                                                   \
-    item = NULL;                                                        \
-  } while (0)
+  if (!cms_der_get_econtent(src.buf, src.len, &content, &content_len)) {
+    der = src.buf;
+    if ((cms = d2i_CMS_ContentInfo(NULL, &der, src.len)) == NULL)
+      lose_openssl_error("Couldn't load DER encoded CMS message");
+    if ((pos = CMS_get0_content(cms)) == NULL || *pos == NULL)
+      lose_openssl_error("Couldn't parse CMS message");
+    content = ASN1_STRING_data(*pos);
+    content_len = ASN1_STRING_length(*pos);
+  }
 
-  Verification_Error( X509_V_OK );
-  Verification_Error( X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT );
-  Verification_Error( X509_V_ERR_UNABLE_TO_GET_CRL );
-  Verification_Error( X509_V_ERR_UNABLE_TO_DECRYPT_CERT_SIGNATURE );
-  Verification_Error( X509_V_ERR_UNABLE_TO_DECRYPT_CRL_SIGNATURE );
-  Verification_Error( X509_V_ERR_UNABLE_TO_DECODE_ISSUER_PUBLIC_KEY );
-  Verification_Error( X509_V_ERR_CERT_SIGNATURE_FAILURE );
-  Verification_Error( X509_V_ERR_CRL_SIGNATURE_FAILURE );
-  Verification_Error( X509_V_ERR_CERT_NOT_YET_VALID );
-  Verification_Error( X509_V_ERR_CERT_HAS_EXPIRED );
-  Verification_Error( X509_V_ERR_CRL_NOT_YET_VALID );
-  Verification_Error( X509_V_ERR_CRL_HAS_EXPIRED );
-  Verification_Error( X509_V_ERR_ERROR_IN_CERT_NOT_BEFORE_FIELD );
-  Verification_Error( X509_V_ERR_ERROR_IN_CERT_NOT_AFTER_FIELD );
-  Verification_Error( X509_V_ERR_ERROR_IN_CRL_LAST_UPDATE_FIELD );
-  Verification_Error( X509_V_ERR_ERROR_IN_CRL_NEXT_UPDATE_FIELD );
-  Verification_Error( X509_V_ERR_OUT_OF_MEM );
-  Verification_Error( X509_V_ERR_DEPTH_ZERO_SELF_SIGNED_CERT );
-  Verification_Error( X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN );
-  Verification_Error( X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY );
-  Verification_Error( X509_V_ERR_UNABLE_TO_VERIFY_LEAF_SIGNATURE );
-  Verification_Error( X509_V_ERR_CERT_CHAIN_TOO_LONG );
-  Verification_Error( X509_V_ERR_CERT_REVOKED );
-  Verification_Error( X509_V_ERR_INVALID_CA );
-  Verification_Error( X509_V_ERR_PATH_LENGTH_EXCEEDED );
-  Verification_Error( X509_V_ERR_INVALID_PURPOSE );
-  Verification_Error( X509_V_ERR_CERT_UNTRUSTED );
-  Verification_Error( X509_V_ERR_CERT_REJECTED );
-  Verification_Error( X509_V_ERR_SUBJECT_ISSUER_MISMATCH );
-  Verification_Error( X509_V_ERR_AKID_SKID_MISMATCH );
-  Verification_Error( X509_V_ERR_AKID_ISSUER_SERIAL_MISMATCH );
-  Verification_Error( X509_V_ERR_KEYUSAGE_NO_CERTSIGN );
-  Verification_Error( X509_V_ERR_UNABLE_TO_GET_CRL_ISSUER );
-  Verification_Error( X509_V_ERR_UNHANDLED_CRITICAL_EXTENSION );
-  Verification_Error( X509_V_ERR_KEYUSAGE_NO_CRL_SIGN );
-  Verification_Error( X509_V_ERR_UNHANDLED_CRITICAL_CRL_EXTENSION );
-  Verification_Error( X509_V_ERR_INVALID_NON_CA );
-  Verification_Error( X509_V_ERR_PROXY_PATH_LENGTH_EXCEEDED );
-  Verification_Error( X509_V_ERR_KEYUSAGE_NO_DIGITAL_SIGNATURE );
-  Verification_Error( X509_V_ERR_PROXY_CERTIFICATES_NOT_ALLOWED );
-  Verification_Error( X509_V_ERR_INVALID_EXTENSION );
-  Verification_Error( X509_V_ERR_INVALID_POLICY_EXTENSION );
-  Verification_Error( X509_V_ERR_NO_EXPLICIT_POLICY );
-  Verification_Error( X509_V_ERR_DIFFERENT_CRL_SCOPE );
-  Verification_Error( X509_V_ERR_UNSUPPORTED_EXTENSION_FEATURE );
-  Verification_Error( X509_V_ERR_UNNESTED_RESOURCE );
-  Verification_Error( X509_V_ERR_PERMITTED_VIOLATION );
-  Verification_Error( X509_V_ERR_EXCLUDED_VIOLATION );
-  Verification_Error( X509_V_ERR_SUBTREE_MINMAX );
-  Verification_Error( X509_V_ERR_UNSUPPORTED_CONSTRAINT_TYPE );
-  Verification_Error( X509_V_ERR_UNSUPPORTED_CONSTRAINT_SYNTAX );
-  Verification_Error( X509_V_ERR_UNSUPPORTED_NAME_SYNTAX );
-  Verification_Error( X509_V_ERR_CRL_PATH_VALIDATION_ERROR );
-#ifdef X509_V_ERR_SUITE_B_INVALID_VERSION
-  Verification_Error( X509_V_ERR_SUITE_B_INVALID_VERSION );
-#endif
-#ifdef X509_V_ERR_SUITE_B_INVALID_ALGORITHM
-  Verification_Error( X509_V_ERR_SUITE_B_INVALID_ALGORITHM );
-#endif
-#ifdef X509_V_ERR_SUITE_B_INVALID_CURVE
-  Verification_Error( X509_V_ERR_SUITE_B_INVALID_CURVE );
-#endif
-#ifdef X509_V_ERR_SUITE_B_INVALID_SIGNATURE_ALGORITHM
-  Verification_Error( X509_V_ERR_SUITE_B_INVALID_SIGNATURE_ALGORITHM );
-#endif
-#ifdef X509_V_ERR_SUITE_B_LOS_NOT_ALLOWED
-  Verification_Error( X509_V_ERR_SUITE_B_LOS_NOT_ALLOWED );
-#endif
-#ifdef X509_V_ERR_SUITE_B_CANNOT_SIGN_P_384_WITH_P_256
-  Verification_Error( X509_V_ERR_SUITE_B_CANNOT_SIGN_P_384_WITH_P_256 );
-#endif
-#ifdef X509_V_ERR_HOSTNAME_MISMATCH
-  Verification_Error( X509_V_ERR_HOSTNAME_MISMATCH );
-#endif
-#ifdef X509_V_ERR_EMAIL_MISMATCH
-  Verification_Error( X509_V_ERR_EMAIL_MISMATCH );
-#endif
-#ifdef X509_V_ERR_IP_ADDRESS_MISMATCH
-  Verification_Error( X509_V_ERR_IP_ADDRESS_MISMATCH );
-#endif
-  Verification_Error( X509_V_ERR_APPLICATION_VERIFICATION );
+  if ((roa = (ROA *) ASN1_item_d2i(NULL, &content, content_len, ASN1_ITEM_rptr(ROA))) == NULL)
+    lose_openssl_error("Couldn't decode ROA");
+
+  if ((prefixes = roa_prefixes_helper(roa)) == NULL)
+    goto error;
+
+  result = Py_BuildValue("(NO)", ASN1_INTEGER_to_PyLong(roa->asID), prefixes);
+
+ error:
+  Py_XDECREF(prefixes);
+  ROA_free(roa);
+  CMS_ContentInfo_free(cms);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return result;
+}
+
+/*
+ * Encode the payload of a ROA as prefix PDUs.  Returns the number of
+ * bytes needed, or -1 if the ROA can't be encoded.  If b is not NULL,
+ * it must have room for that many bytes, and gets the PDUs.  Doesn't
+ * touch anything Python, so it can run in batch worker threads.
+ */
+
+static long
+rtr_roa_encode(const ROA *roa, unsigned char version, unsigned char *b)
+{
+  uint32_t asn = 0;
+  long len = 0;
+  int i, j;
+
+  if (roa->asID->type != V_ASN1_INTEGER || roa->asID->length > 4)
+    return -1;
+
+  for (i = 0; i < roa->asID->length; i++)
+    asn = (asn << 8) | roa->asID->data[i];
+
+  for (i = 0; i < sk_ROAIPAddressFamily_num(roa->ipAddrBlocks); i++) {
+    ROAIPAddressFamily *fam = sk_ROAIPAddressFamily_value(roa->ipAddrBlocks, i);
+    unsigned afi, addrlen, pdulen;
+
+    if (fam->addressFamily->length != 2)
+      return -1;
+
+    afi = (fam->addressFamily->data[0] << 8) | (fam->addressFamily->data[1]);
+
+    switch (afi) {
+    case IANA_AFI_IPV4: addrlen = 4;  pdulen = RTR_PDU_IPV4_PREFIX_LENGTH; break;
+    case IANA_AFI_IPV6: addrlen = 16; pdulen = RTR_PDU_IPV6_PREFIX_LENGTH; break;
+    default:            return -1;
+    }
+
+    for (j = 0; j < sk_ROAIPAddress_num(fam->addresses); j++) {
+      ROAIPAddress *a = sk_ROAIPAddress_value(fam->addresses, j);
+      unsigned prefixlen = ((a->IPAddress)->length * 8 - ((a->IPAddress)->flags & 7));
+      long maxlen = a->maxLength == NULL ? (long) prefixlen : ASN1_INTEGER_get(a->maxLength);
+
+      if ((unsigned) a->IPAddress->length > addrlen)
+        return -1;
+
+      if (maxlen < (long) prefixlen || maxlen > (long) addrlen * 8)
+        return -1;
+
+      len += pdulen;
+
+      if (b == NULL)
+        continue;
+
+      memset(b, 0, pdulen);
+      b[0] = version;
+      b[1] = afi == IANA_AFI_IPV4 ? RTR_PDU_TYPE_IPV4_PREFIX : RTR_PDU_TYPE_IPV6_PREFIX;
+      rtr_put_u32(b + 4, pdulen);
+      b[8] = 1;
+      b[9] = (unsigned char) prefixlen;
+      b[10] = (unsigned char) maxlen;
+
+      if (a->IPAddress->length > 0) {
+        memcpy(b + 12, a->IPAddress->data, a->IPAddress->length);
+        if ((a->IPAddress->flags & 7) != 0)
+          b[12 + a->IPAddress->length - 1] &= ~(0xFF >> (8 - (a->IPAddress->flags & 7)));
+      }
+
+      rtr_put_u32(b + 12 + addrlen, asn);
+      b += pdulen;
+    }
+  }
 
-#undef Verification_Error
+  return len;
+}
+
+static char pow_module_rtr_encode_roa__doc__[] =
+  "Encode the payload of a ROA as RPKI-RTR prefix PDUs.\n"
+  "\n"
+  "The first argument is a ROA object whose payload has already been\n"
+  "extracted (by .verify() or .extractWithoutVerifying()); the second is\n"
+  "the RPKI-RTR protocol version number.\n"
+  "\n"
+  "Returns a string containing one wire format prefix PDU, with the\n"
+  "announce flag set, for each prefix in the ROA, concatenated in the\n"
+  "order they appear in the ROA.\n"
+  ;
+
+static PyObject *
+pow_module_rtr_encode_roa(GCC_UNUSED PyObject *self, PyObject *args)
+{
+  PyObject *result = NULL;
+  roa_object *r = NULL;
+  unsigned char version;
+  long len;
+
+  ENTERING(pow_module_rtr_encode_roa);
+
+  if (!PyArg_ParseTuple(args, "O!B", &POW_ROA_Type, &r, &version))
+    goto error;
+
+  if (r->roa == NULL)
+    lose_not_verified("Can't encode unverified ROA");
+
+  if ((len = rtr_roa_encode(r->roa, version, NULL)) < 0)
+    lose_value_error("ROA payload can't be encoded as RPKI-RTR PDUs");
+
+  if ((result = PyString_FromStringAndSize(NULL, len)) == NULL)
+    goto error;
+
+  (void) rtr_roa_encode(r->roa, version, (unsigned char *) PyString_AS_STRING(result));
 
   return result;
 
  error:
   Py_XDECREF(result);
-  Py_XDECREF(item);
   return NULL;
 }
 
-static char pow_module_seed__doc__[] =
-  "Add data to OpenSSL's pseudo-random number generator state.\n"
+static char pow_module_rtr_sort_pdus__doc__[] =
+  "Sort and deduplicate a string of concatenated RPKI-RTR payload PDUs.\n"
   "\n"
-  "The \"data\" parameter is the seed to add.  Entropy of the data is\n"
-  "assumed to be equal to the length of the data.\n"
+  "The argument may be any object supporting the buffer protocol, and\n"
+  "must contain nothing but prefix and router key PDUs, all for the same\n"
+  "protocol version.  Returns a new string containing the same PDUs in\n"
+  "lexical order of their wire format, with duplicates removed.\n"
+  "\n"
+  "Raises ValueError if the input is not a well-formed set of PDUs.\n"
   ;
 
 static PyObject *
-pow_module_seed(GCC_UNUSED PyObject *self, PyObject *args)
+pow_module_rtr_sort_pdus(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  char *data = NULL;
-  Py_ssize_t datalen = 0;
+  PyObject *result = NULL;
+  rtr_pdu *pdus = NULL;
+  Py_ssize_t i, j, n;
+  size_t len = 0;
+  unsigned char *b;
+  Py_buffer src;
 
-  ENTERING(pow_module_seed);
+  ENTERING(pow_module_rtr_sort_pdus);
 
-  if (!PyArg_ParseTuple(args, "s#", &data, &datalen))
+  src.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*", &src))
     goto error;
 
-  RAND_seed(data, datalen);
+  if ((pdus = rtr_pdu_vector(&src, &n)) == NULL)
+    goto error;
 
-  Py_RETURN_NONE;
+  Py_BEGIN_ALLOW_THREADS
 
- error:
+  qsort(pdus, n, sizeof(*pdus), rtr_pdu_cmp);
 
-  return NULL;
+  for (i = j = 0; i < n; i++) {
+    if (j > 0 && rtr_pdu_cmp(&pdus[j - 1], &pdus[i]) == 0)
+      continue;
+    pdus[j++] = pdus[i];
+    len += pdus[i].len;
+  }
+
+  Py_END_ALLOW_THREADS
+
+  if ((result = PyString_FromStringAndSize(NULL, len)) == NULL)
+    goto error;
+
+  b = (unsigned char *) PyString_AS_STRING(result);
+
+  for (i = 0; i < j; i++) {
+    memcpy(b, pdus[i].pdu, pdus[i].len);
+    b += pdus[i].len;
+  }
+
+ error:
+  PyMem_Free(pdus);
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return result;
 }
 
-static char pow_module_add__doc__[] =
-  "Add data to OpenSSL's pseudo-random number generator state.\n"
-  "\n"
-  "The \"data\" parameter is the data to add.\n"
+static char pow_module_rtr_diff_pdus__doc__[] =
+  "Compute the RPKI-RTR incremental update between two sets of PDUs.\n"
   "\n"
-  "The \"entropy\" parameter should be an estimate of the number of\n"
-  "random bytes in the data parameter.\n"
+  "Arguments are the old and new sets, each a string (or other buffer)\n"
+  "of concatenated payload PDUs in the sorted, deduplicated form returned\n"
+  "by rtrSortPDUs().  Returns a string containing every PDU present only\n"
+  "in the old set with its announce flag cleared, and every PDU present\n"
+  "only in the new set with its announce flag set, in merge order.\n"
   ;
 
 static PyObject *
-pow_module_add(GCC_UNUSED PyObject *self, PyObject *args)
+pow_module_rtr_diff_pdus(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  char *data = NULL;
-  Py_ssize_t datalen = 0;
-  double entropy = 0;
+  PyObject *result = NULL;
+  rtr_pdu *o = NULL, *n = NULL;
+  Py_ssize_t i_o = 0, i_n = 0, n_o, n_n;
+  Py_buffer src_o, src_n;
+  unsigned char *b;
+  size_t len = 0;
+  int c;
 
-  ENTERING(pow_module_add);
+  ENTERING(pow_module_rtr_diff_pdus);
 
-  if (!PyArg_ParseTuple(args, "s#d", &data, &datalen, &entropy))
+  src_o.obj = src_n.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*s*", &src_o, &src_n))
     goto error;
 
-  RAND_add(data, datalen, entropy);
+  if ((o = rtr_pdu_vector(&src_o, &n_o)) == NULL ||
+      (n = rtr_pdu_vector(&src_n, &n_n)) == NULL)
+    goto error;
 
-  Py_RETURN_NONE;
+  if ((result = PyString_FromStringAndSize(NULL, src_o.len + src_n.len)) == NULL)
+    goto error;
+
+  b = (unsigned char *) PyString_AS_STRING(result);
+
+  while (i_o < n_o || i_n < n_n) {
+    if (i_o == n_o)
+      c = 1;
+    else if (i_n == n_n)
+      c = -1;
+    else
+      c = rtr_pdu_cmp(&o[i_o], &n[i_n]);
+
+    if (c < 0) {
+      memcpy(b + len, o[i_o].pdu, o[i_o].len);
+      b[len + rtr_pdu_flags_offset(o[i_o].pdu)] = 0;
+      len += o[i_o++].len;
+    }
+
+    else if (c > 0) {
+      memcpy(b + len, n[i_n].pdu, n[i_n].len);
+      b[len + rtr_pdu_flags_offset(n[i_n].pdu)] = 1;
+      len += n[i_n++].len;
+    }
+
+    else {
+      i_o++;
+      i_n++;
+    }
+  }
+
+  if (_PyString_Resize(&result, len) < 0)
+    goto error;
 
  error:
-  return NULL;
+  PyMem_Free(o);
+  PyMem_Free(n);
+  if (src_o.obj != NULL)
+    PyBuffer_Release(&src_o);
+  if (src_n.obj != NULL)
+    PyBuffer_Release(&src_n);
+  return result;
 }
 
-static char pow_module_write_random_file__doc__[] =
-  "Write the current state of OpenSSL's pseduo-random number generator to\n"
-  "a file.\n"
+static char pow_module_rtr_compose_pdus__doc__[] =
+  "Compose two consecutive RPKI-RTR incremental updates into one.\n"
   "\n"
-  "The \"filename\" parameter is the name of the file to write.\n"
+  "Arguments are the IXFR from serial A to serial B and the IXFR from\n"
+  "serial B to serial C, each in the form returned by rtrDiffPDUs().\n"
+  "Returns the IXFR from serial A to serial C: changes made by only one\n"
+  "of the inputs are kept, an announcement and a withdrawal of the same\n"
+  "PDU cancel each other out, and otherwise the later change wins.\n"
   ;
 
 static PyObject *
-pow_module_write_random_file(GCC_UNUSED PyObject *self, PyObject *args)
+pow_module_rtr_compose_pdus(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  char *filename = NULL;
+  PyObject *result = NULL;
+  rtr_pdu *x = NULL, *y = NULL;
+  Py_ssize_t i_x = 0, i_y = 0, n_x, n_y;
+  Py_buffer src_x, src_y;
+  const rtr_pdu *p;
+  unsigned char *b;
+  size_t len = 0;
+  int c;
 
-  ENTERING(pow_module_write_random_file);
+  ENTERING(pow_module_rtr_compose_pdus);
 
-  if (!PyArg_ParseTuple(args, "s", &filename))
+  src_x.obj = src_y.obj = NULL;
+
+  if (!PyArg_ParseTuple(args, "s*s*", &src_x, &src_y))
     goto error;
 
-  if (RAND_write_file(filename) == -1)
-    lose("Couldn't write random file");
+  if ((x = rtr_pdu_vector(&src_x, &n_x)) == NULL ||
+      (y = rtr_pdu_vector(&src_y, &n_y)) == NULL)
+    goto error;
 
-  Py_RETURN_NONE;
+  if ((result = PyString_FromStringAndSize(NULL, src_x.len + src_y.len)) == NULL)
+    goto error;
+
+  b = (unsigned char *) PyString_AS_STRING(result);
+
+  while (i_x < n_x || i_y < n_y) {
+    if (i_x == n_x)
+      c = 1;
+    else if (i_y == n_y)
+      c = -1;
+    else
+      c = rtr_pdu_key_cmp(&x[i_x], &y[i_y]);
+
+    if (c < 0) {
+      p = &x[i_x++];
+    }
+
+    else if (c > 0) {
+      p = &y[i_y++];
+    }
+
+    else {
+      const int flags_x = x[i_x].pdu[rtr_pdu_flags_offset(x[i_x].pdu)];
+      const int flags_y = y[i_y].pdu[rtr_pdu_flags_offset(y[i_y].pdu)];
+      p = flags_x == flags_y ? &y[i_y] : NULL;
+      i_x++;
+      i_y++;
+    }
+
+    if (p != NULL) {
+      memcpy(b + len, p->pdu, p->len);
+      len += p->len;
+    }
+  }
+
+  if (_PyString_Resize(&result, len) < 0)
+    goto error;
 
  error:
-  return NULL;
+  PyMem_Free(x);
+  PyMem_Free(y);
+  if (src_x.obj != NULL)
+    PyBuffer_Release(&src_x);
+  if (src_y.obj != NULL)
+    PyBuffer_Release(&src_y);
+  return result;
 }
 
-static char pow_module_read_random_file__doc__[] =
-  "Restore the state of OpenSSLs pseudo-random number generator from\n"
-  "data previously saved to a file.\n"
+static char pow_module_rtr_count_pdus__doc__[] =
+  "Check the framing of a string of concatenated RPKI-RTR PDUs.\n"
   "\n"
-  "The \"filename\" parameter is the name of the file to read.\n"
+  "The first argument may be any object supporting the buffer protocol.\n"
+  "If the optional second argument is true, the buffer must contain only\n"
+  "prefix and router key PDUs, all for the same protocol version.\n"
+  "\n"
+  "Returns the number of PDUs; raises ValueError if the buffer is not\n"
+  "well formed.\n"
   ;
 
 static PyObject *
-pow_module_read_random_file(GCC_UNUSED PyObject *self, PyObject *args)
+pow_module_rtr_count_pdus(GCC_UNUSED PyObject *self, PyObject *args)
 {
-  char *file = NULL;
-  int len = -1;
+  PyObject *payload = Py_False;
+  PyObject *result = NULL;
+  Py_buffer src;
+  Py_ssize_t n;
 
-  ENTERING(pow_module_read_random_file);
+  ENTERING(pow_module_rtr_count_pdus);
 
-  if (!PyArg_ParseTuple(args, "s|i", &file, &len))
-    goto error;
+  src.obj = NULL;
 
-  if (!RAND_load_file(file, len))
-    lose("Couldn't load random file");
+  if (!PyArg_ParseTuple(args, "s*|O", &src, &payload))
+    goto error;
 
-  Py_RETURN_NONE;
+  if ((n = rtr_pdu_split(src.buf, src.len, PyObject_IsTrue(payload), NULL)) >= 0)
+    result = PyInt_FromSsize_t(n);
 
  error:
-  return NULL;
+  if (src.obj != NULL)
+    PyBuffer_Release(&src);
+  return result;
 }
 
-static char pow_module_custom_datetime__doc__[] =
-  "Set constructor callback for customized datetime class.\n"
+/*
+ * Parallel AXFR construction.  Each worker decodes ROAs straight from
+ * DER, encodes their payloads as prefix PDUs, and sorts what it has
+ * collected; the calling thread then merges the sorted runs, dropping
+ * duplicates, to produce the same table as rtrSortPDUs() would.
+ */
+
+typedef struct {
+  const char *filename;         /* Borrowed, files only */
+  Py_buffer buf;                /* Buffers only */
+  unsigned char *pdus;          /* malloc()ed, encoded payload */
+  long len;
+  int ok;
+} rtr_scan_item;
+
+typedef struct {
+  rtr_pdu *pdus;
+  size_t n;
+} rtr_scan_run;
+
+typedef struct {
+  batch_queue q;                /* Must be first */
+  rtr_scan_item *items;
+  unsigned char version;
+  rtr_scan_run runs[BATCH_MAX_THREADS + 1];
+  int n_runs;
+  int no_memory;
+} rtr_scan_context;
+
+/*
+ * Decode one ROA from DER and encode its payload.
+ */
+
+static int
+rtr_scan_der(rtr_scan_context *c, rtr_scan_item *item, const unsigned char *der, long der_len)
+{
+  const unsigned char *content = NULL;
+  ASN1_OCTET_STRING **pos = NULL;
+  CMS_ContentInfo *cms = NULL;
+  long content_len = 0;
+  ROA *roa = NULL;
+  int ok = 0;
+
+  if (!cms_der_get_econtent(der, der_len, &content, &content_len)) {
+    if ((cms = d2i_CMS_ContentInfo(NULL, &der, der_len)) == NULL ||
+        (pos = CMS_get0_content(cms)) == NULL || *pos == NULL)
+      goto done;
+    content = ASN1_STRING_data(*pos);
+    content_len = ASN1_STRING_length(*pos);
+  }
+
+  if ((roa = (ROA *) ASN1_item_d2i(NULL, &content, content_len, ASN1_ITEM_rptr(ROA))) == NULL ||
+      (item->len = rtr_roa_encode(roa, c->version, NULL)) < 0 ||
+      (item->pdus = malloc(item->len > 0 ? item->len : 1)) == NULL)
+    goto done;
+
+  ok = rtr_roa_encode(roa, c->version, item->pdus) == item->len;
+
+ done:
+  ROA_free(roa);
+  CMS_ContentInfo_free(cms);
+  return ok;
+}
+
+static int
+rtr_scan_file(rtr_scan_context *c, rtr_scan_item *item)
+{
+  unsigned char *der = NULL;
+  void *map = MAP_FAILED;
+  struct stat sb;
+  ssize_t n = 0;
+  size_t len = 0;
+  int ok = 0, fd;
+
+  if ((fd = open(item->filename, O_RDONLY)) < 0)
+    return 0;
+
+  if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0 &&
+      (map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+    ok = rtr_scan_der(c, item, map, (long) sb.st_size);
+    (void) munmap(map, (size_t) sb.st_size);
+  }
+
+  else if (fstat(fd, &sb) == 0 && (der = malloc(sb.st_size > 0 ? (size_t) sb.st_size : 1)) != NULL) {
+    while (len < (size_t) sb.st_size && (n = read(fd, der + len, (size_t) sb.st_size - len)) > 0)
+      len += (size_t) n;
+    ok = n >= 0 && rtr_scan_der(c, item, der, (long) len);
+    free(der);
+  }
+
+  (void) close(fd);
+  return ok;
+}
+
+static void
+rtr_scan_work(batch_queue *q)
+{
+  rtr_scan_context *c = (rtr_scan_context *) q;
+  rtr_scan_run run = {NULL, 0};
+  size_t allocated = 0;
+  rtr_scan_item *item;
+  rtr_pdu *p;
+  long off;
+  int i;
+
+  while ((i = batch_next(q)) >= 0) {
+    item = &c->items[i];
+
+    if (item->filename != NULL)
+      item->ok = rtr_scan_file(c, item);
+    else
+      item->ok = rtr_scan_der(c, item, item->buf.buf, (long) item->buf.len);
+
+    ERR_clear_error();
+
+    for (off = 0; item->ok && off < item->len; off += (long) run.pdus[run.n++].len) {
+      if (run.n == allocated) {
+        allocated = allocated ? allocated * 2 : 4096;
+        if ((p = realloc(run.pdus, allocated * sizeof(*p))) == NULL) {
+          c->no_memory = 1;
+          free(run.pdus);
+          return;
+        }
+        run.pdus = p;
+      }
+      run.pdus[run.n].pdu = item->pdus + off;
+      run.pdus[run.n].len = rtr_get_u32(item->pdus + off + 4);
+    }
+  }
+
+  qsort(run.pdus, run.n, sizeof(*run.pdus), rtr_pdu_cmp);
+
+#ifdef WITH_THREAD
+  if (q->threaded)
+    pthread_mutex_lock(&q->lock);
+#endif
+
+  c->runs[c->n_runs++] = run;
+
+#ifdef WITH_THREAD
+  if (q->threaded)
+    pthread_mutex_unlock(&q->lock);
+#endif
+}
+
+/*
+ * Merge the sorted runs, dropping duplicates, into one vector.
+ * Returns the number of PDUs, or -1 if we couldn't allocate memory.
+ */
+
+static Py_ssize_t
+rtr_scan_merge(rtr_scan_context *c, rtr_pdu **result, size_t *len)
+{
+  size_t pos[BATCH_MAX_THREADS + 1], total = 0;
+  const rtr_pdu *best;
+  rtr_pdu *out;
+  Py_ssize_t n = 0;
+  int i, j = 0;
+
+  for (i = 0; i < c->n_runs; i++) {
+    pos[i] = 0;
+    total += c->runs[i].n;
+  }
+
+  if ((out = malloc((total > 0 ? total : 1) * sizeof(*out))) == NULL)
+    return -1;
+
+  *len = 0;
+
+  for (;;) {
+    best = NULL;
+    for (i = 0; i < c->n_runs; i++)
+      if (pos[i] < c->runs[i].n && (best == NULL || rtr_pdu_cmp(&c->runs[i].pdus[pos[i]], best) < 0))
+        best = &c->runs[j = i].pdus[pos[i]];
+    if (best == NULL)
+      break;
+    pos[j]++;
+    if (n > 0 && rtr_pdu_cmp(&out[n - 1], best) == 0)
+      continue;
+    out[n++] = *best;
+    *len += best->len;
+  }
+
+  *result = out;
+  return n;
+}
+
+static char pow_module_rtr_scan_roas__doc__[] =
+  "Build a sorted, deduplicated RPKI-RTR AXFR table from a batch of ROAs.\n"
+  "\n"
+  "The \"objects\" parameter is a sequence of DER-encoded ROAs as objects\n"
+  "supporting the buffer protocol, or, if the optional \"files\" parameter\n"
+  "is true, a sequence of names of files containing DER-encoded ROAs.\n"
+  "The \"version\" parameter is the RPKI-RTR protocol version number.\n"
+  "\n"
+  "Decoding, encoding, and sorting all run without holding the Python\n"
+  "interpreter lock.  The optional \"threads\" parameter specifies how\n"
+  "many additional threads to use for this; the default is to do\n"
+  "everything in the calling thread.\n"
+  "\n"
+  "Like roaPayload(), this does no verification at all, so it's only for\n"
+  "ROAs which have already been validated.  Returns a two-element tuple:\n"
+  "the packed table, as would be returned by rtrSortPDUs(), and a list of\n"
+  "the indices of any objects which couldn't be read or decoded.\n"
   ;
 
 static PyObject *
-pow_module_custom_datetime(GCC_UNUSED PyObject *self, PyObject *args)
+pow_module_rtr_scan_roas(GCC_UNUSED PyObject *self, PyObject *args, PyObject *kwds)
 {
-  PyObject *cb = NULL;
+  static char *kwlist[] = {"objects", "version", "files", "threads", NULL};
+  PyObject *objects = NULL, *files = Py_False;
+  PyObject *seq = NULL, *result = NULL, *pdus = NULL, *failed = NULL, *index = NULL, *obj;
+  int i, threads = 0, use_files, ok = 0;
+  rtr_pdu *merged = NULL;
+  rtr_scan_context c;
+  Py_ssize_t n = 0, k;
+  size_t len = 0;
+  unsigned char *b;
 
-  ENTERING(pow_module_custom_datetime);
+  ENTERING(pow_module_rtr_scan_roas);
 
-  if (!PyArg_ParseTuple(args, "O", &cb))
+  memset(&c, 0, sizeof(c));
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OB|Oi", kwlist,
+                                   &objects, &c.version, &files, &threads))
     goto error;
 
-  Py_XINCREF(cb);
-  Py_XDECREF(custom_datetime);
-  custom_datetime = cb;
+  if ((use_files = PyObject_IsTrue(files)) < 0)
+    goto error;
 
-  Py_RETURN_NONE;
+  if ((seq = PySequence_Fast(objects, "Expected a sequence of objects")) == NULL)
+    goto error;
 
- error:
+  c.q.n_items = (int) PySequence_Fast_GET_SIZE(seq);
+  c.q.work = rtr_scan_work;
+
+  if ((c.items = PyMem_Malloc((c.q.n_items > 0 ? c.q.n_items : 1) * sizeof(*c.items))) == NULL)
+    lose_no_memory();
+
+  memset(c.items, 0, (c.q.n_items > 0 ? c.q.n_items : 1) * sizeof(*c.items));
+
+  for (i = 0; i < c.q.n_items; i++) {
+    obj = PySequence_Fast_GET_ITEM(seq, i);
+    if (use_files) {
+      if ((c.items[i].filename = PyString_AsString(obj)) == NULL)
+        goto error;
+    } else {
+      if (PyObject_GetBuffer(obj, &c.items[i].buf, PyBUF_SIMPLE) < 0)
+        goto error;
+    }
+  }
+
+  Py_BEGIN_ALLOW_THREADS
+  batch_run(&c.q, threads);
+  if (!c.no_memory)
+    n = rtr_scan_merge(&c, &merged, &len);
+  Py_END_ALLOW_THREADS
+
+  if (c.no_memory || n < 0)
+    lose_no_memory();
+
+  if ((pdus = PyString_FromStringAndSize(NULL, len)) == NULL)
+    goto error;
+
+  b = (unsigned char *) PyString_AS_STRING(pdus);
+
+  for (k = 0; k < n; k++) {
+    memcpy(b, merged[k].pdu, merged[k].len);
+    b += merged[k].len;
+  }
+
+  if ((failed = PyList_New(0)) == NULL)
+    goto error;
+
+  for (i = 0; i < c.q.n_items; i++) {
+    if (c.items[i].ok)
+      continue;
+    if ((index = PyInt_FromLong(i)) == NULL || PyList_Append(failed, index) < 0)
+      goto error;
+    Py_CLEAR(index);
+  }
+
+  result = Py_BuildValue("(OO)", pdus, failed);
+  ok = result != NULL;
+
+ error:
+  Py_XDECREF(index);
+  Py_XDECREF(pdus);
+  Py_XDECREF(failed);
+  free(merged);
+  for (i = 0; i < c.n_runs; i++)
+    free(c.runs[i].pdus);
+  if (c.items != NULL) {
+    for (i = 0; i < c.q.n_items; i++) {
+      free(c.items[i].pdus);
+      if (c.items[i].buf.obj != NULL)
+        PyBuffer_Release(&c.items[i].buf);
+    }
+    PyMem_Free(c.items);
+  }
+  Py_XDECREF(seq);
+
+  if (ok)
+    return result;
+
+  Py_XDECREF(result);
   return NULL;
 }
 
-
 static struct PyMethodDef pow_module_methods[] = {
   Define_Method(getError,               pow_module_get_error,                   METH_NOARGS),
   Define_Method(clearError,             pow_module_clear_error,                 METH_NOARGS),
@@ -10167,6 +15171,19 @@ static struct PyMethodDef pow_module_methods[] = {
   Define_Method(writeRandomFile,        pow_module_write_random_file,           METH_VARARGS),
   Define_Method(addObject,              pow_module_add_object,                  METH_VARARGS),
   Define_Method(customDatetime,         pow_module_custom_datetime,             METH_VARARGS),
+  Define_Method(verifyBatch,            pow_module_verify_batch,                METH_KEYWORDS),
+  Define_Method(signBatch,              pow_module_sign_batch,                  METH_KEYWORDS),
+  Define_Method(digestBatch,            pow_module_digest_batch,                METH_KEYWORDS),
+  Define_Method(roaPayload,             pow_module_roa_payload,                 METH_VARARGS),
+  Define_Method(sendfile,               pow_module_sendfile,                    METH_VARARGS),
+  Define_Method(watchDirectory,         pow_module_watch_directory,             METH_VARARGS),
+  Define_Method(watchEvents,            pow_module_watch_events,                METH_VARARGS),
+  Define_Method(rtrEncodeROA,           pow_module_rtr_encode_roa,              METH_VARARGS),
+  Define_Method(rtrSortPDUs,            pow_module_rtr_sort_pdus,               METH_VARARGS),
+  Define_Method(rtrDiffPDUs,            pow_module_rtr_diff_pdus,               METH_VARARGS),
+  Define_Method(rtrComposePDUs,         pow_module_rtr_compose_pdus,            METH_VARARGS),
+  Define_Method(rtrCountPDUs,           pow_module_rtr_count_pdus,              METH_VARARGS),
+  Define_Method(rtrScanROAs,            pow_module_rtr_scan_roas,               METH_KEYWORDS),
   {NULL}
 };
 
@@ -10200,6 +15217,21 @@ init_POW(void)
    */
   CRYPTO_set_mem_functions(PyMem_Malloc, PyMem_Realloc, PyMem_Free);
 
+  /*
+   * Give OpenSSL locks so that we can release the interpreter lock
+   * around expensive operations.  In a normal Python 2 build the
+   * PyMem_*() functions are thin wrappers around malloc(), so they're
+   * safe to call without the interpreter lock; the debugging allocator
+   * isn't, so in that case OpenSSL gets the libc functions instead.
+   */
+#ifdef WITH_THREAD
+#ifdef PYMALLOC_DEBUG
+  CRYPTO_set_mem_functions(malloc, realloc, free);
+#endif
+  if (!openssl_setup_threads())
+    OpenSSL_ok = 0;
+#endif
+
   /*
    * Import the DateTime API
    */
@@ -10217,15 +15249,19 @@ init_POW(void)
 
   Define_Class(POW_X509_Type);
   Define_Class(POW_X509StoreCTX_Type);
+  Define_Class(POW_X509Store_Type);
   Define_Class(POW_CRL_Type);
   Define_Class(POW_Asymmetric_Type);
   Define_Class(POW_AsymmetricParams_Type);
   Define_Class(POW_Digest_Type);
   Define_Class(POW_CMS_Type);
   Define_Class(POW_IPAddress_Type);
+  Define_Class(POW_ResourceSet_Type);
   Define_Class(POW_Manifest_Type);
   Define_Class(POW_ROA_Type);
   Define_Class(POW_PKCS10_Type);
+  Define_Class(POW_PrefixTable_Type);
+  Define_Class(POW_OriginValidator_Type);
 
 #undef Define_Class
 
@@ -10255,6 +15291,11 @@ init_POW(void)
   Define_Integer_Constant(SHA384_DIGEST);
   Define_Integer_Constant(SHA512_DIGEST);
 
+  /* Route origin validation states */
+  Define_Integer_Constant(ORIGIN_NOT_FOUND);
+  Define_Integer_Constant(ORIGIN_VALID);
+  Define_Integer_Constant(ORIGIN_INVALID);
+
   /* CMS flags */
   Define_Integer_Constant(CMS_NOCERTS);
   Define_Integer_Constant(CMS_NOATTR);
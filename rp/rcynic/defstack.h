@@ -106,6 +106,31 @@
 #define sk_rsync_history_t_sort(st)                    SKM_sk_sort(rsync_history_t, (st))
 #define sk_rsync_history_t_is_sorted(st)               SKM_sk_is_sorted(rsync_history_t, (st))
 
+/*
+ * Safestack macros for rsync_stats_t.
+ */
+#define sk_rsync_stats_t_new(st)                     SKM_sk_new(rsync_stats_t, (st))
+#define sk_rsync_stats_t_new_null()                  SKM_sk_new_null(rsync_stats_t)
+#define sk_rsync_stats_t_free(st)                    SKM_sk_free(rsync_stats_t, (st))
+#define sk_rsync_stats_t_num(st)                     SKM_sk_num(rsync_stats_t, (st))
+#define sk_rsync_stats_t_value(st, i)                SKM_sk_value(rsync_stats_t, (st), (i))
+#define sk_rsync_stats_t_set(st, i, val)             SKM_sk_set(rsync_stats_t, (st), (i), (val))
+#define sk_rsync_stats_t_zero(st)                    SKM_sk_zero(rsync_stats_t, (st))
+#define sk_rsync_stats_t_push(st, val)               SKM_sk_push(rsync_stats_t, (st), (val))
+#define sk_rsync_stats_t_unshift(st, val)            SKM_sk_unshift(rsync_stats_t, (st), (val))
+#define sk_rsync_stats_t_find(st, val)               SKM_sk_find(rsync_stats_t, (st), (val))
+#define sk_rsync_stats_t_find_ex(st, val)            SKM_sk_find_ex(rsync_stats_t, (st), (val))
+#define sk_rsync_stats_t_delete(st, i)               SKM_sk_delete(rsync_stats_t, (st), (i))
+#define sk_rsync_stats_t_delete_ptr(st, ptr)         SKM_sk_delete_ptr(rsync_stats_t, (st), (ptr))
+#define sk_rsync_stats_t_insert(st, val, i)          SKM_sk_insert(rsync_stats_t, (st), (val), (i))
+#define sk_rsync_stats_t_set_cmp_func(st, cmp)       SKM_sk_set_cmp_func(rsync_stats_t, (st), (cmp))
+#define sk_rsync_stats_t_dup(st)                     SKM_sk_dup(rsync_stats_t, st)
+#define sk_rsync_stats_t_pop_free(st, free_func)     SKM_sk_pop_free(rsync_stats_t, (st), (free_func))
+#define sk_rsync_stats_t_shift(st)                   SKM_sk_shift(rsync_stats_t, (st))
+#define sk_rsync_stats_t_pop(st)                     SKM_sk_pop(rsync_stats_t, (st))
+#define sk_rsync_stats_t_sort(st)                    SKM_sk_sort(rsync_stats_t, (st))
+#define sk_rsync_stats_t_is_sorted(st)               SKM_sk_is_sorted(rsync_stats_t, (st))
+
 /*
  * Safestack macros for task_t.
  */
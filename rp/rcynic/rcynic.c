@@ -119,6 +119,27 @@
  */
 #define	HASH_SHA256_LEN		32
 
+/**
+ * How long to remember rsync statistics for a URI we haven't fetched.
+ */
+#define	RSYNC_STATS_MAX_AGE	(30 * 24 * 60 * 60)
+
+/**
+ * How many attempts before we start aging out old rsync statistics.
+ */
+#define	RSYNC_STATS_DECAY	32
+
+/**
+ * Size of blocks in which arenas allocate memory.
+ */
+#define	ARENA_BLOCK_SIZE	(16 * 1024)
+
+/**
+ * Alignment of memory returned by arena_alloc().
+ */
+#define	ARENA_ALIGN		16
+#define	ARENA_ROUND(n)		(((n) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
 /**
  * Logging levels.  Same general idea as syslog(), but our own
  * catagories based on what makes sense for this program.  Default
@@ -258,7 +279,6 @@ static const struct {
   QB(nonconformant_certificate_uid,	"Nonconformant certificate UID")    \
   QB(object_rejected,			"Object rejected")		    \
   QB(rfc3779_inheritance_required,	"RFC 3779 inheritance required")    \
-  QB(roa_contains_bad_afi_value,	"ROA contains bad AFI value")	    \
   QB(roa_max_prefixlen_too_short,	"ROA maxPrefixlen too short")	    \
   QB(roa_resource_not_in_ee,		"ROA resource not in EE")	    \
   QB(roa_resources_malformed,		"ROA resources malformed")	    \
@@ -386,6 +406,38 @@ typedef struct { char s[FILENAME_MAX]; } path_t;
  */
 typedef struct { unsigned char h[EVP_MAX_MD_SIZE]; } hashbuf_t;
 
+/**
+ * Flat representation of an address range, used for fast RFC 3779
+ * subset checks.  Addresses are stored left-justified and zero-padded
+ * in fixed-width buffers regardless of AFI, so that ranges sort with
+ * memcmp(); family combines AFI and SAFI (if any), and sorts the same
+ * way RFC 3779 says address families should.
+ */
+typedef struct {
+  unsigned family;
+  unsigned char min[ADDR_RAW_BUF_LEN], max[ADDR_RAW_BUF_LEN];
+} addr_range_t;
+
+/**
+ * Arena allocator for rcynic's own short-lived temporaries.  Memory
+ * in an arena is never freed piecemeal: callers either rewind to a
+ * mark or release the whole arena at once.  We keep one spare block
+ * around so that rewinding in a loop doesn't thrash malloc().
+ */
+typedef struct arena_block {
+  struct arena_block *next;
+  size_t size, used;
+} arena_block_t;
+
+typedef struct {
+  arena_block_t *head, *spare;
+} arena_t;
+
+typedef struct {
+  arena_block_t *block;
+  size_t used;
+} arena_mark_t;
+
 /**
  * Type-safe wrapper for timestamp strings.
  */
@@ -447,6 +499,7 @@ typedef struct walk_ctx {
   uri_t crldp;
   STACK_OF(X509) *certs;
   STACK_OF(X509_CRL) *crls;
+  arena_t arena;
 } walk_ctx_t;
 
 DECLARE_STACK_OF(walk_ctx_t)
@@ -492,7 +545,8 @@ typedef struct rsync_ctx {
     rsync_problem_timed_out,
     rsync_problem_refused
   } problem;
-  unsigned tries;
+  unsigned tries, objects;
+  unsigned long cost, expected_objects;
   pid_t pid;
   int fd;
   time_t started, deadline;
@@ -515,11 +569,28 @@ typedef struct rsync_history {
 DECLARE_STACK_OF(rsync_history_t)
 
 /**
- * Deferred task.
+ * rsync statistics which we carry over from one run to the next, so
+ * that we can start the slowest and largest fetches first.  duration
+ * is a smoothed average in seconds, objects is the number of changes
+ * rsync reported the last time the transfer succeeded.
+ */
+typedef struct rsync_stats {
+  uri_t uri;
+  time_t updated;
+  unsigned long duration, objects;
+  unsigned attempts, failures;
+} rsync_stats_t;
+
+DECLARE_STACK_OF(rsync_stats_t)
+
+/**
+ * Deferred task.  Higher priority tasks run first; tasks of equal
+ * priority run in the order in which they were queued.
  */
 typedef struct task {
   void (*handler)(rcynic_ctx_t *, void *);
   void *cookie;
+  int priority;
 } task_t;
 
 DECLARE_STACK_OF(task_t)
@@ -552,9 +623,10 @@ typedef struct rcynic_x509_store_ctx {
  */
 struct rcynic_ctx {
   path_t authenticated, old_authenticated, new_authenticated, unauthenticated;
-  char *jane, *rsync_program;
+  char *jane, *rsync_program, *rsync_stats_file;
   STACK_OF(validation_status_t) *validation_status;
   STACK_OF(rsync_history_t) *rsync_history;
+  STACK_OF(rsync_stats_t) *rsync_stats;
   STACK_OF(rsync_ctx_t) *rsync_queue;
   STACK_OF(task_t) *task_queue;
   int use_syslog, allow_stale_crl, allow_stale_manifest, use_links;
@@ -564,12 +636,13 @@ struct rcynic_ctx {
   int allow_digest_mismatch, allow_crl_digest_mismatch;
   int allow_nonconformant_name, allow_ee_without_signedObject;
   int allow_1024_bit_ee_key, allow_wrong_cms_si_attributes;
-  int rsync_early;
+  int rsync_early, task_quantum;
   unsigned max_select_time;
   validation_status_t *validation_status_in_waiting;
   validation_status_t *validation_status_root;
   log_level_t log_level;
   X509_STORE *x509_store;
+  BIO *scratch_bio;
 };
 
 
@@ -715,24 +788,16 @@ create_missing_nids(void)
 
 
 
-/**
- * Type-safe wrapper around free() to keep safestack macros happy.
- */
-static void OPENSSL_STRING_free(OPENSSL_STRING s)
-{
-  if (s)
-    free(s);
-}
-
 /**
  * Wrapper around an idiom we use with OPENSSL_STRING stacks.  There's
  * a bug in the current sk_OPENSSL_STRING_delete() macro that casts
  * the return value to the wrong type, so we cast it to something
- * innocuous here and avoid using that macro elsewhere.
+ * innocuous here and avoid using that macro elsewhere.  The strings
+ * on these stacks belong to arenas, so we don't free them here.
  */
 static void sk_OPENSSL_STRING_remove(STACK_OF(OPENSSL_STRING) *sk, const char *str)
 {
-  OPENSSL_STRING_free((void *) sk_OPENSSL_STRING_delete(sk, sk_OPENSSL_STRING_find(sk, str)));
+  (void) sk_OPENSSL_STRING_delete(sk, sk_OPENSSL_STRING_find(sk, str));
 }
 
 /**
@@ -785,6 +850,34 @@ static int rsync_history_cmp(const rsync_history_t * const *a, const rsync_histo
   return strcmp((*a)->uri.s, (*b)->uri.s);
 }
 
+/**
+ * Allocate a new rsync_stats_t object.
+ */
+static rsync_stats_t *rsync_stats_t_new(void)
+{
+  rsync_stats_t *s = malloc(sizeof(*s));
+  if (s)
+    memset(s, 0, sizeof(*s));
+  return s;
+}
+
+/**
+ * Type-safe wrapper around free() to keep safestack macros happy.
+ */
+static void rsync_stats_t_free(rsync_stats_t *s)
+{
+  if (s)
+    free(s);
+}
+
+/**
+ * Compare two rsync_stats_t objects.
+ */
+static int rsync_stats_cmp(const rsync_stats_t * const *a, const rsync_stats_t * const *b)
+{
+  return strcmp((*a)->uri.s, (*b)->uri.s);
+}
+
 
 
 /**
@@ -1023,17 +1116,125 @@ static int mkdir_maybe(const rcynic_ctx_t *rc, const path_t *name)
 }
 
 /**
- * strdup() a string and push it onto a stack.
+ * Allocate memory from an arena.  Returns NULL on memory exhaustion.
  */
-static int sk_OPENSSL_STRING_push_strdup(STACK_OF(OPENSSL_STRING) *sk, const char *str)
+static void *arena_alloc(arena_t *a, size_t n)
 {
-  OPENSSL_STRING s = strdup(str);
+  const size_t header = ARENA_ROUND(sizeof(arena_block_t));
+  arena_block_t *b = a->head;
+  void *p;
 
-  if (s && sk_OPENSSL_STRING_push(sk, s))
-    return 1;
-  if (s)
-    free(s);
-  return 0;
+  assert(a);
+
+  n = ARENA_ROUND(n > 0 ? n : 1);
+
+  if (b == NULL || b->size - b->used < n) {
+    if (a->spare != NULL && a->spare->size - header >= n) {
+      b = a->spare;
+      a->spare = NULL;
+    } else if ((b = malloc(n + header > ARENA_BLOCK_SIZE ? n + header : ARENA_BLOCK_SIZE)) != NULL) {
+      b->size = n + header > ARENA_BLOCK_SIZE ? n + header : ARENA_BLOCK_SIZE;
+    } else {
+      return NULL;
+    }
+    b->used = header;
+    b->next = a->head;
+    a->head = b;
+  }
+
+  p = (char *) b + b->used;
+  b->used += n;
+  return p;
+}
+
+/**
+ * Copy a string into an arena.
+ */
+static char *arena_strdup(arena_t *a, const char *str)
+{
+  size_t n = strlen(str) + 1;
+  char *s = arena_alloc(a, n);
+
+  if (s != NULL)
+    memcpy(s, str, n);
+  return s;
+}
+
+/**
+ * Remember how much of an arena is in use, for arena_release().
+ * Marks nest like a stack: releasing a mark discards everything
+ * allocated from the arena since, by anyone.  So while holding a mark,
+ * don't call anything that keeps long-lived data in the same arena
+ * (such as a walk context's filename list); set that up first.
+ */
+static arena_mark_t arena_mark(const arena_t *a)
+{
+  arena_mark_t m;
+
+  assert(a);
+
+  m.block = a->head;
+  m.used = a->head == NULL ? 0 : a->head->used;
+  return m;
+}
+
+/**
+ * Discard everything allocated from an arena since a mark.
+ */
+static void arena_release(arena_t *a, const arena_mark_t m)
+{
+  arena_block_t *b;
+
+  assert(a);
+
+  while ((b = a->head) != m.block) {
+    assert(b != NULL);
+    a->head = b->next;
+    if (a->spare == NULL && b->size == ARENA_BLOCK_SIZE) {
+      a->spare = b;
+    } else {
+      free(b);
+    }
+  }
+
+  if (a->head != NULL)
+    a->head->used = m.used;
+}
+
+/**
+ * Free all memory belonging to an arena.
+ */
+static void arena_free(arena_t *a)
+{
+  arena_block_t *b;
+
+  if (a == NULL)
+    return;
+
+  while ((b = a->head) != NULL) {
+    a->head = b->next;
+    free(b);
+  }
+
+  free(a->spare);
+  a->spare = NULL;
+}
+
+/**
+ * Get our scratch memory BIO, emptied and ready for reuse.  CMS
+ * content passes through this on its way to the ASN.1 decoders;
+ * reusing it saves allocating and growing a new buffer per object.
+ */
+static BIO *scratch_bio(rcynic_ctx_t *rc)
+{
+  assert(rc);
+
+  if (rc->scratch_bio == NULL)
+    rc->scratch_bio = BIO_new(BIO_s_mem());
+  else
+    (void) BIO_reset(rc->scratch_bio);
+
+  return rc->scratch_bio;
 }
 
 /**
@@ -1844,9 +2045,11 @@ static int conflicting_uris(const uri_t *a, const uri_t *b)
 
 /**
  * Read non-directory filenames from a directory, so we can check to
- * see what's missing from a manifest.
+ * see what's missing from a manifest.  The filenames themselves are
+ * allocated from an arena, so caller should only free the stack.
  */
 static STACK_OF(OPENSSL_STRING) *directory_filenames(const rcynic_ctx_t *rc,
+						     arena_t *arena,
 						     const walk_state_t state,
 						     const uri_t *uri)
 {
@@ -1855,9 +2058,10 @@ static STACK_OF(OPENSSL_STRING) *directory_filenames(const rcynic_ctx_t *rc,
   const path_t *prefix = NULL;
   DIR *dir = NULL;
   struct dirent *d;
+  char *name;
   int ok = 0;
 
-  assert(rc && uri);
+  assert(rc && arena && uri);
 
   switch (state) {
   case walk_state_current:
@@ -1880,8 +2084,9 @@ static STACK_OF(OPENSSL_STRING) *directory_filenames(const rcynic_ctx_t *rc,
       logmsg(rc, log_data_err, "Local path name %s/%s too long", dpath.s, d->d_name);
       goto done;
     }
-    else if (!is_directory(&fpath) && !sk_OPENSSL_STRING_push_strdup(result, d->d_name)) {
-      logmsg(rc, log_sys_err, "sk_OPENSSL_STRING_push_strdup() failed, probably memory exhaustion");
+    else if (!is_directory(&fpath) &&
+	     ((name = arena_strdup(arena, d->d_name)) == NULL || !sk_OPENSSL_STRING_push(result, name))) {
+      logmsg(rc, log_sys_err, "Couldn't save filename %s, probably memory exhaustion", d->d_name);
       goto done;
     }
 
@@ -1894,12 +2099,129 @@ static STACK_OF(OPENSSL_STRING) *directory_filenames(const rcynic_ctx_t *rc,
   if (ok)
     return result;
 
-  sk_OPENSSL_STRING_pop_free(result, OPENSSL_STRING_free);
+  sk_OPENSSL_STRING_free(result);
   return NULL;
 }
 
 
 
+/**
+ * Convert an RFC 3779 addressFamily value to an addr_range_t family.
+ * Returns zero for a malformed addressFamily.
+ */
+static unsigned addr_range_family(const ASN1_OCTET_STRING *af)
+{
+  if (af == NULL || af->data == NULL || af->length < 2 || af->length > 3)
+    return 0;
+  return ((af->data[0] << 24) | (af->data[1] << 16) |
+	  (af->length == 3 ? 0x100 | af->data[2] : 0));
+}
+
+/**
+ * Compare two addr_range_t objects by family and low end of range.
+ */
+static int addr_range_cmp(const void *a_, const void *b_)
+{
+  const addr_range_t *a = a_, *b = b_;
+  if (a->family != b->family)
+    return a->family < b->family ? -1 : 1;
+  return memcmp(a->min, b->min, sizeof(a->min));
+}
+
+/**
+ * Flatten an RFC 3779 IP address extension into a sorted array of
+ * addr_range_t.  Inherited families contribute no ranges, but we
+ * report their presence via *inherit so that the caller can decide
+ * what to do about them.  Families other than IPv4 and IPv6 are
+ * ignored rather than treated as decoding failures, because the only
+ * user is ROA checking, and only the families a ROA can name matter
+ * there.  Result is allocated from an arena.  Returns NULL on
+ * allocation or decoding failure.
+ */
+static addr_range_t *addr_ranges_from_rfc3779(arena_t *arena,
+					      const STACK_OF(IPAddressFamily) *addr,
+					      int *n_ranges,
+					      int *inherit)
+{
+  addr_range_t *r, *result = NULL;
+  IPAddressOrRanges *aors;
+  IPAddressFamily *f;
+  int i, j, n = 0;
+  unsigned afi;
+
+  assert(arena && n_ranges && inherit);
+
+  *inherit = 0;
+
+  for (i = 0; i < sk_IPAddressFamily_num(addr); i++) {
+    f = sk_IPAddressFamily_value(addr, i);
+    afi = v3_addr_get_afi(f);
+    if (afi != IANA_AFI_IPV4 && afi != IANA_AFI_IPV6)
+      continue;
+    if (f->ipAddressChoice->type == IPAddressChoice_addressesOrRanges)
+      n += sk_IPAddressOrRange_num(f->ipAddressChoice->u.addressesOrRanges);
+    else
+      *inherit = 1;
+  }
+
+  if ((result = arena_alloc(arena, n * sizeof(*result))) == NULL)
+    return NULL;
+
+  for (r = result, i = 0; i < sk_IPAddressFamily_num(addr); i++) {
+    f = sk_IPAddressFamily_value(addr, i);
+    afi = v3_addr_get_afi(f);
+    if (f->ipAddressChoice->type != IPAddressChoice_addressesOrRanges ||
+	(afi != IANA_AFI_IPV4 && afi != IANA_AFI_IPV6))
+      continue;
+    aors = f->ipAddressChoice->u.addressesOrRanges;
+    for (j = 0; j < sk_IPAddressOrRange_num(aors); j++, r++) {
+      memset(r, 0, sizeof(*r));
+      if ((r->family = addr_range_family(f->addressFamily)) == 0 ||
+	  v3_addr_get_range(sk_IPAddressOrRange_value(aors, j), afi,
+			    r->min, r->max, sizeof(r->min)) == 0) {
+	return NULL;
+      }
+    }
+  }
+
+  assert(r - result == n);
+
+  qsort(result, n, sizeof(*result), addr_range_cmp);
+  *n_ranges = n;
+  return result;
+}
+
+/**
+ * Check whether every range in a sorted array is contained in some
+ * range of another sorted array.  The superset must be canonical
+ * (no overlapping or adjacent ranges), which is what RFC 3779
+ * requires of certificates; the subset needn't be, which lets us
+ * skip normalizing ROA prefixes, since any set of prefixes (nested
+ * or not) is covered by a canonical set if and only if each prefix
+ * is.  Linear merge, so this is O(n + m) after sorting.
+ */
+static int addr_ranges_subset(const addr_range_t *a, const int n_a,
+			      const addr_range_t *b, const int n_b)
+{
+  int i, j;
+
+  for (i = j = 0; i < n_a; i++) {
+    while (j < n_b && (b[j].family < a[i].family ||
+		       (b[j].family == a[i].family &&
+			memcmp(b[j].max, a[i].min, sizeof(a[i].min)) < 0)))
+      j++;
+    if (j >= n_b || b[j].family != a[i].family ||
+	memcmp(b[j].min, a[i].min, sizeof(a[i].min)) > 0 ||
+	memcmp(b[j].max, a[i].max, sizeof(a[i].max)) < 0)
+      return 0;
+  }
+
+  return 1;
+}
+
+
+
+
 /**
  * Increment walk context reference count.
  */
@@ -1923,7 +2245,8 @@ static void walk_ctx_detach(walk_ctx_t *w)
     Manifest_free(w->manifest);
     sk_X509_free(w->certs);
     sk_X509_CRL_pop_free(w->crls, X509_CRL_free);
-    sk_OPENSSL_STRING_pop_free(w->filenames, OPENSSL_STRING_free);
+    sk_OPENSSL_STRING_free(w->filenames);
+    arena_free(&w->arena);
     free(w);
   }
 }
@@ -1990,8 +2313,8 @@ static void walk_ctx_loop_next(const rcynic_ctx_t *rc, STACK_OF(walk_ctx_t) *wsk
     w->state++;
     w->manifest_iteration = 0;
     w->filename_iteration = 0;
-    sk_OPENSSL_STRING_pop_free(w->filenames, OPENSSL_STRING_free);
-    w->filenames = directory_filenames(rc, w->state, &w->certinfo.sia);
+    sk_OPENSSL_STRING_free(w->filenames);
+    w->filenames = directory_filenames(rc, &w->arena, w->state, &w->certinfo.sia);
     if (w->manifest != NULL || w->filenames != NULL)
       return;
   }
@@ -2028,7 +2351,7 @@ static void walk_ctx_loop_init(rcynic_ctx_t *rc, STACK_OF(walk_ctx_t) *wsk)
   assert(w->state == walk_state_current);
 
   assert(w->filenames == NULL);
-  w->filenames = directory_filenames(rc, w->state, &w->certinfo.sia);
+  w->filenames = directory_filenames(rc, &w->arena, w->state, &w->certinfo.sia);
 
   w->stale_manifest = w->manifest != NULL && X509_cmp_current_time(w->manifest->nextUpdate) < 0;
 
@@ -2191,13 +2514,17 @@ static void walk_ctx_stack_free(STACK_OF(walk_ctx_t) *wsk)
 static int rsync_count_running(const rcynic_ctx_t *);
 
 /**
- * Add a task to the task queue.
+ * Add a task to the task queue.  The queue is kept sorted by
+ * priority, so we insert the new task after every task of equal or
+ * higher priority.
  */
 static int task_add(const rcynic_ctx_t *rc,
 		    void (*handler)(rcynic_ctx_t *, void *),
-		    void *cookie)
+		    void *cookie,
+		    const int priority)
 {
   task_t *t = malloc(sizeof(*t));
+  int i;
 
   assert(rc && rc->task_queue && handler);
 
@@ -2208,8 +2535,13 @@ static int task_add(const rcynic_ctx_t *rc,
 
   t->handler = handler;
   t->cookie = cookie;
+  t->priority = priority;
+
+  for (i = sk_task_t_num(rc->task_queue); i > 0; i--)
+    if (sk_task_t_value(rc->task_queue, i - 1)->priority >= priority)
+      break;
 
-  if (sk_task_t_push(rc->task_queue, t))
+  if (sk_task_t_insert(rc->task_queue, t, i))
     return 1;
 
   free(t);
@@ -2217,15 +2549,21 @@ static int task_add(const rcynic_ctx_t *rc,
 }
 
 /**
- * Run tasks until queue is empty.
+ * Run tasks from the queue.  If there are rsync contexts waiting for
+ * attention, we run just one task and return, so that the rsync
+ * manager gets a chance to reap finished children and start new ones
+ * before we go back to chewing on validation; otherwise, we run
+ * tasks until the queue is empty.
  */
 static void task_run_q(rcynic_ctx_t *rc)
 {
   task_t *t;
-  assert(rc && rc->task_queue);
+  assert(rc && rc->task_queue && rc->rsync_queue);
   while ((t = sk_task_t_shift(rc->task_queue)) != NULL) {
     t->handler(rc, t->cookie);
     free(t);
+    if (sk_rsync_ctx_t_num(rc->rsync_queue) > 0)
+      return;
   }
 }
 
@@ -2312,6 +2650,200 @@ static void rsync_history_add(const rcynic_ctx_t *rc,
   }
 }
 
+
+
+/**
+ * Find rsync statistics from previous runs for a particular URI.
+ */
+static rsync_stats_t *rsync_stats_find(const rcynic_ctx_t *rc,
+				       const uri_t *uri)
+{
+  rsync_stats_t s;
+  char *p;
+  int i;
+
+  assert(rc && uri);
+
+  if (rc->rsync_stats == NULL)
+    return NULL;
+
+  s.uri = *uri;
+
+  while ((p = strrchr(s.uri.s, '/')) != NULL && p[1] == '\0')
+    *p = '\0';
+
+  if ((i = sk_rsync_stats_t_find(rc->rsync_stats, &s)) < 0)
+    return NULL;
+
+  return sk_rsync_stats_t_value(rc->rsync_stats, i);
+}
+
+/**
+ * Update rsync statistics for a URI with the result of a transfer.
+ */
+static void rsync_stats_update(const rcynic_ctx_t *rc,
+			       const rsync_ctx_t *ctx,
+			       const rsync_status_t status)
+{
+  time_t now = time(0);
+  unsigned long duration;
+  rsync_stats_t *s;
+  char *p;
+
+  assert(rc && ctx);
+
+  if (rc->rsync_stats == NULL)
+    return;
+
+  duration = ctx->started && now > ctx->started ? now - ctx->started : 0;
+
+  if ((s = rsync_stats_find(rc, &ctx->uri)) == NULL) {
+    if ((s = rsync_stats_t_new()) == NULL ||
+	!sk_rsync_stats_t_push(rc->rsync_stats, s)) {
+      rsync_stats_t_free(s);
+      logmsg(rc, log_sys_err, "Couldn't add %s to rsync_stats, blundering onwards", ctx->uri.s);
+      return;
+    }
+    s->uri = ctx->uri;
+    while ((p = strrchr(s->uri.s, '/')) != NULL && p[1] == '\0')
+      *p = '\0';
+  }
+
+  if (s->attempts == 0)
+    s->duration = duration;
+  else
+    s->duration = (s->duration * 3 + duration) / 4;
+
+  if (status == rsync_status_done)
+    s->objects = ctx->objects;
+  else
+    s->failures++;
+
+  if (++s->attempts >= RSYNC_STATS_DECAY) {
+    s->attempts /= 2;
+    s->failures /= 2;
+  }
+
+  s->updated = now;
+}
+
+/**
+ * Read rsync statistics saved by a previous run.  Missing file is not
+ * an error, it just means we have no history yet.  Format is one line
+ * per URI: last update time, smoothed duration, object count, number
+ * of attempts, number of failures, URI.
+ */
+static int read_rsync_stats(const rcynic_ctx_t *rc)
+{
+  char line[URI_MAX + 128];
+  time_t now = time(0);
+  rsync_stats_t *s = NULL;
+  unsigned long updated;
+  FILE *f;
+  int n, ok;
+
+  assert(rc && rc->rsync_stats);
+
+  if (rc->rsync_stats_file == NULL)
+    return 1;
+
+  if ((f = fopen(rc->rsync_stats_file, "r")) == NULL) {
+    if (errno != ENOENT)
+      logmsg(rc, log_sys_err, "Couldn't open rsync statistics file %s: %s",
+	     rc->rsync_stats_file, strerror(errno));
+    return errno == ENOENT;
+  }
+
+  while (fgets(line, sizeof(line), f) != NULL) {
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if (line[0] == '#' || line[0] == '\0')
+      continue;
+
+    if (s == NULL && (s = rsync_stats_t_new()) == NULL)
+      break;
+
+    n = 0;
+
+    if (sscanf(line, "%lu %lu %lu %u %u %n", &updated,
+	       &s->duration, &s->objects, &s->attempts, &s->failures, &n) < 5 ||
+	n == 0 || !is_rsync(line + n) || strlen(line + n) >= sizeof(s->uri.s)) {
+      logmsg(rc, log_data_err, "Ignoring malformed line in rsync statistics file %s", rc->rsync_stats_file);
+      continue;
+    }
+
+    s->updated = (time_t) updated;
+
+    if (s->updated + RSYNC_STATS_MAX_AGE < now)
+      continue;
+
+    strcpy(s->uri.s, line + n);
+
+    if (!sk_rsync_stats_t_push(rc->rsync_stats, s))
+      break;
+
+    s = NULL;
+  }
+
+  rsync_stats_t_free(s);
+  ok = !ferror(f) && feof(f);
+  (void) fclose(f);
+
+  if (!ok)
+    logmsg(rc, log_sys_err, "Trouble reading rsync statistics file %s", rc->rsync_stats_file);
+  else
+    logmsg(rc, log_verbose, "Read statistics for %d rsync URIs from %s",
+	   sk_rsync_stats_t_num(rc->rsync_stats), rc->rsync_stats_file);
+
+  return ok;
+}
+
+/**
+ * Write rsync statistics for the next run.
+ */
+static int write_rsync_stats(const rcynic_ctx_t *rc)
+{
+  rsync_stats_t *s;
+  path_t temp;
+  FILE *f;
+  int i, ok;
+
+  assert(rc);
+
+  if (rc->rsync_stats_file == NULL || rc->rsync_stats == NULL)
+    return 1;
+
+  if (snprintf(temp.s, sizeof(temp.s), "%s.%u.tmp", rc->rsync_stats_file, (unsigned) getpid()) >= sizeof(temp.s)) {
+    logmsg(rc, log_usage_err, "Filename \"%s\" is too long, not writing rsync statistics", rc->rsync_stats_file);
+    return 0;
+  }
+
+  ok = (f = fopen(temp.s, "w")) != NULL;
+
+  if (ok)
+    ok &= fprintf(f, "# rcynic rsync statistics, written automatically, do not edit\n") != EOF;
+
+  for (i = 0; ok && (s = sk_rsync_stats_t_value(rc->rsync_stats, i)) != NULL; i++)
+    ok &= fprintf(f, "%lu %lu %lu %u %u %s\n",
+		  (unsigned long) s->updated, s->duration, s->objects,
+		  s->attempts, s->failures, s->uri.s) != EOF;
+
+  if (f)
+    ok &= fclose(f) != EOF;
+
+  if (ok)
+    ok &= rename(temp.s, rc->rsync_stats_file) == 0;
+
+  if (!ok) {
+    logmsg(rc, log_sys_err, "Couldn't write rsync statistics to %s: %s",
+	   rc->rsync_stats_file, strerror(errno));
+    (void) unlink(temp.s);
+  }
+
+  return ok;
+}
+
 
 
 /**
@@ -2408,6 +2940,51 @@ static int rsync_count_runable(const rcynic_ctx_t *rc)
   return n;
 }
 
+/**
+ * Expected cost of an rsync fetch: smoothed duration, scaled up by
+ * (1 + failures / attempts), since a flaky publication point tends to
+ * burn its whole timeout and may well need a retry.  A failing URI
+ * with no measurable duration still counts as costing one second.
+ */
+static unsigned long rsync_stats_cost(const rsync_stats_t *s)
+{
+  unsigned long duration;
+
+  assert(s);
+
+  if (s->attempts == 0 || s->failures == 0)
+    return s->duration;
+
+  duration = s->duration > 0 ? s->duration : 1;
+  return duration + duration * s->failures / s->attempts;
+}
+
+/**
+ * Pick the next rsync context to start.  We prefer the context with
+ * the highest expected cost based on statistics from previous runs,
+ * so that the slowest and least reliable fetches start first and we
+ * don't end up waiting for one huge or flaky repository after
+ * everything else is done.
+ * Ties (including "no history") go to the oldest queue entry.
+ */
+static rsync_ctx_t *rsync_next_runable(const rcynic_ctx_t *rc)
+{
+  rsync_ctx_t *ctx, *best = NULL;
+  int i;
+
+  assert(rc && rc->rsync_queue);
+
+  for (i = 0; (ctx = sk_rsync_ctx_t_value(rc->rsync_queue, i)) != NULL; ++i)
+    if (ctx->state != rsync_state_running &&
+	rsync_runable(rc, ctx) &&
+	(best == NULL ||
+	 ctx->cost > best->cost ||
+	 (ctx->cost == best->cost && ctx->expected_objects > best->expected_objects)))
+      best = ctx;
+
+  return best;
+}
+
 /**
  * Call rsync context handler, if one is set.
  */
@@ -2596,6 +3173,13 @@ static void do_one_rsync_log_line(const rcynic_ctx_t *rc,
   if (ctx->buffer[strspn(ctx->buffer, " \t\n\r")] != '\0')
     logmsg(rc, log_telemetry, "rsync[%u]: %s", ctx->pid, ctx->buffer);
 
+  /*
+   * Count --itemize-changes lines, for rsync_stats.
+   */
+  if (ctx->buffer[0] != '\0' && strchr("<>ch.*", ctx->buffer[0]) != NULL &&
+      ctx->buffer[1] != '\0' && strchr("fdLDS",  ctx->buffer[1]) != NULL)
+    ctx->objects++;
+
   /*
    * Check for magic error strings
    */
@@ -2607,7 +3191,9 @@ static void do_one_rsync_log_line(const rcynic_ctx_t *rc,
 }
 
 /**
- * Construct select() arguments.
+ * Construct select() arguments.  We never block when there are tasks
+ * waiting to run, since the whole point is to keep validating while
+ * rsync does its thing.
  */
 static int rsync_construct_select(const rcynic_ctx_t *rc,
 				  const time_t now,
@@ -2645,7 +3231,9 @@ static int rsync_construct_select(const rcynic_ctx_t *rc,
     }
   }
 
-  if (!when)
+  if (sk_task_t_num(rc->task_queue) > 0)
+    tv->tv_sec = 0;
+  else if (!when)
     tv->tv_sec = rc->max_select_time;
   else if (when < now)
     tv->tv_sec = 0;
@@ -2695,7 +3283,8 @@ static mib_counter_t rsync_status_to_mib_counter(rsync_status_t status)
  *
  * So this is the only place where the program blocks waiting for
  * children, but we only do it when we know there's nothing else
- * useful that we could be doing while we wait.
+ * useful that we could be doing while we wait: if the task queue is
+ * not empty, we just poll for output and return.
  */
 static void rsync_mgr(rcynic_ctx_t *rc)
 {
@@ -2795,6 +3384,7 @@ static void rsync_mgr(rcynic_ctx_t *rc)
 			  rsync_status_to_mib_counter(rsync_status),
 			  object_generation_null);
     rsync_history_add(rc, ctx, rsync_status);
+    rsync_stats_update(rc, ctx, rsync_status);
     rsync_call_handler(rc, ctx, rsync_status);
     (void) sk_rsync_ctx_t_delete_ptr(rc->rsync_queue, ctx);
     free(ctx);
@@ -2807,19 +3397,13 @@ static void rsync_mgr(rcynic_ctx_t *rc)
   assert(rsync_count_running(rc) <= rc->max_parallel_fetches);
 
   /*
-   * Look for rsync contexts that have become runable.  Odd loop
-   * structure is because rsync_run() might decide to remove the
-   * specified rsync task from the queue instead of running it.
+   * Start rsync contexts that have become runable, most expensive
+   * first.  rsync_run() either starts the context or removes it from
+   * the queue, so this loop always makes progress.
    */
-  for (i = 0; (ctx = sk_rsync_ctx_t_value(rc->rsync_queue, i)) != NULL; i++) {
-    n = sk_rsync_ctx_t_num(rc->rsync_queue);
-    if (ctx->state != rsync_state_running &&
-	rsync_runable(rc, ctx) &&
-	rsync_count_running(rc) < rc->max_parallel_fetches)
-      rsync_run(rc, ctx);
-    if (n > sk_rsync_ctx_t_num(rc->rsync_queue))
-      i--;
-  }
+  while (rsync_count_running(rc) < rc->max_parallel_fetches &&
+	 (ctx = rsync_next_runable(rc)) != NULL)
+    rsync_run(rc, ctx);
 
   assert(rsync_count_running(rc) <= rc->max_parallel_fetches);
 
@@ -2916,6 +3500,7 @@ static void rsync_init(rcynic_ctx_t *rc,
 		       void *cookie,
 		       void (*handler)(rcynic_ctx_t *, const rsync_ctx_t *, const rsync_status_t, const uri_t *, void *))
 {
+  const rsync_stats_t *stats;
   rsync_ctx_t *ctx = NULL;
 
   assert(rc && uri && strlen(uri->s) > SIZEOF_RSYNC);
@@ -2947,6 +3532,13 @@ static void rsync_init(rcynic_ctx_t *rc,
   ctx->cookie = cookie;
   ctx->fd = -1;
 
+  if ((stats = rsync_stats_find(rc, uri)) != NULL) {
+    ctx->cost = rsync_stats_cost(stats);
+    ctx->expected_objects = stats->objects;
+    logmsg(rc, log_debug, "Previous rsync of %s took %lu seconds, %lu objects, %u failures in %u attempts",
+	   uri->s, stats->duration, stats->objects, stats->failures, stats->attempts);
+  }
+
   if (!sk_rsync_ctx_t_push(rc->rsync_queue, ctx)) {
     logmsg(rc, log_sys_err, "Couldn't push rsync state object onto queue, punting %s", ctx->uri.s);
     rsync_call_handler(rc, ctx, rsync_status_failed);
@@ -4378,7 +4970,7 @@ static Manifest *check_manifest_1(rcynic_ctx_t *rc,
 
   assert(rc && wsk && uri && path && prefix);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL) {
+  if ((bio = scratch_bio(rc)) == NULL) {
     logmsg(rc, log_sys_err, "Couldn't allocate BIO for manifest %s", uri->s);
     goto done;
   }
@@ -4452,7 +5044,6 @@ static Manifest *check_manifest_1(rcynic_ctx_t *rc,
   manifest = NULL;
 
  done:
-  BIO_free(bio);
   Manifest_free(manifest);
   CMS_ContentInfo_free(cms);
   sk_FileAndHash_free(sorted_fileList);
@@ -4678,20 +5269,23 @@ static int check_roa_1(rcynic_ctx_t *rc,
 		       const size_t hashlen,
 		       const object_generation_t generation)
 {
-  STACK_OF(IPAddressFamily) *roa_resources = NULL, *ee_resources = NULL;
-  unsigned char addrbuf[ADDR_RAW_BUF_LEN];
+  walk_ctx_t *w = walk_ctx_stack_head(wsk);
+  addr_range_t *roa_ranges = NULL, *ee_ranges = NULL, *r;
   CMS_ContentInfo *cms = NULL;
   BIO *bio = NULL;
   ROA *roa = NULL;
   X509 *x = NULL;
-  int i, j, result = 0;
-  unsigned afi, *safi = NULL, safi_, prefixlen, max_prefixlen;
+  int i, j, n_roa = 0, n_ee = 0, ee_inherit = 0, result = 0;
+  unsigned afi, family, prefixlen, max_prefixlen, bits;
   ROAIPAddressFamily *rf;
   ROAIPAddress *ra;
+  arena_mark_t mark;
 
   assert(rc && wsk && uri && path && prefix);
 
-  if ((bio = BIO_new(BIO_s_mem())) == NULL) {
+  mark = arena_mark(&w->arena);
+
+  if ((bio = scratch_bio(rc)) == NULL) {
     logmsg(rc, log_sys_err, "Couldn't allocate BIO for ROA %s", uri->s);
     goto error;
   }
@@ -4716,29 +5310,34 @@ static int check_roa_1(rcynic_ctx_t *rc,
     goto error;
   }
 
-  ee_resources = X509_get_ext_d2i(x, NID_sbgp_ipAddrBlock, NULL, NULL);
-
   /*
-   * Extract prefixes from ROA and convert them into a resource set.
+   * Extract prefixes from ROA into a flat array of ranges.  We don't
+   * bother building an RFC 3779 resource set, removing nested
+   * prefixes, and canonizing: addr_ranges_subset() doesn't need any
+   * of that, and doing it via OpenSSL's stacks is quadratic.
    */
 
-  if (!(roa_resources = sk_IPAddressFamily_new_null()))
+  for (i = 0; i < sk_ROAIPAddressFamily_num(roa->ipAddrBlocks); i++)
+    if ((rf = sk_ROAIPAddressFamily_value(roa->ipAddrBlocks, i)) != NULL)
+      n_roa += sk_ROAIPAddress_num(rf->addresses);
+
+  if ((roa_ranges = arena_alloc(&w->arena, n_roa * sizeof(*roa_ranges))) == NULL) {
+    logmsg(rc, log_sys_err, "Couldn't allocate prefix array for ROA %s", uri->s);
     goto error;
+  }
 
-  for (i = 0; i < sk_ROAIPAddressFamily_num(roa->ipAddrBlocks); i++) {
+  for (r = roa_ranges, i = 0; i < sk_ROAIPAddressFamily_num(roa->ipAddrBlocks); i++) {
     rf = sk_ROAIPAddressFamily_value(roa->ipAddrBlocks, i);
-    if (!rf || !rf->addressFamily || rf->addressFamily->length < 2 || rf->addressFamily->length > 3) {
+    if (!rf || (family = addr_range_family(rf->addressFamily)) == 0) {
       log_validation_status(rc, uri, malformed_roa_addressfamily, generation);
       goto error;
     }
-    afi = (rf->addressFamily->data[0] << 8) | (rf->addressFamily->data[1]);
-    if (rf->addressFamily->length == 3)
-      *(safi = &safi_) = rf->addressFamily->data[2];
-    for (j = 0; j < sk_ROAIPAddress_num(rf->addresses); j++) {
+    afi = family >> 16;
+    for (j = 0; j < sk_ROAIPAddress_num(rf->addresses); j++, r++) {
       ra = sk_ROAIPAddress_value(rf->addresses, j);
+      memset(r, 0, sizeof(*r));
       if (!ra ||
-	  !extract_roa_prefix(ra, afi, addrbuf, &prefixlen, &max_prefixlen) ||
-	  !v3_addr_add_prefix(roa_resources, afi, safi, addrbuf, prefixlen)) {
+	  !extract_roa_prefix(ra, afi, r->min, &prefixlen, &max_prefixlen)) {
 	log_validation_status(rc, uri, roa_resources_malformed, generation);
 	goto error;
       }
@@ -4746,60 +5345,30 @@ static int check_roa_1(rcynic_ctx_t *rc,
 	log_validation_status(rc, uri, roa_max_prefixlen_too_short, generation);
 	goto error;
       }
+      r->family = family;
+      memcpy(r->max, r->min, sizeof(r->max));
+      bits = (afi == IANA_AFI_IPV4 ? 32 : 128);
+      for (; prefixlen < bits && (prefixlen & 7) != 0; prefixlen++)
+	r->max[prefixlen >> 3] |= 0x80 >> (prefixlen & 7);
+      if (prefixlen < bits)
+	memset(r->max + (prefixlen >> 3), 0xFF, (bits - prefixlen) >> 3);
     }
   }
 
-  /*
-   * ROAs can include nested prefixes, so direct translation to
-   * resource sets could include overlapping ranges, which is illegal.
-   * So we have to remove nested stuff before whacking into canonical
-   * form.  Fortunately, this is relatively easy, since we know these
-   * are just prefixes, not ranges: in a list of prefixes sorted by
-   * the RFC 3779 rules, the first element of a set of nested prefixes
-   * will always be the least specific.
-   */
-
-  for (i = 0; i < sk_IPAddressFamily_num(roa_resources); i++) {
-    IPAddressFamily *f = sk_IPAddressFamily_value(roa_resources, i);
-
-    if ((afi = v3_addr_get_afi(f)) == 0) {
-      log_validation_status(rc, uri, roa_contains_bad_afi_value, generation);
-      goto error;
-    }
-
-    if (f->ipAddressChoice->type == IPAddressChoice_addressesOrRanges) {
-      IPAddressOrRanges *aors = f->ipAddressChoice->u.addressesOrRanges;
-
-      sk_IPAddressOrRange_sort(aors);
-
-      for (j = 0; j < sk_IPAddressOrRange_num(aors) - 1; j++) {
-	IPAddressOrRange *a = sk_IPAddressOrRange_value(aors, j);
-	IPAddressOrRange *b = sk_IPAddressOrRange_value(aors, j + 1);
-	unsigned char a_min[ADDR_RAW_BUF_LEN], a_max[ADDR_RAW_BUF_LEN];
-	unsigned char b_min[ADDR_RAW_BUF_LEN], b_max[ADDR_RAW_BUF_LEN];
-	int length;
-
-	if ((length = v3_addr_get_range(a, afi, a_min, a_max, ADDR_RAW_BUF_LEN)) == 0 ||
-	    (length = v3_addr_get_range(b, afi, b_min, b_max, ADDR_RAW_BUF_LEN)) == 0) {
-	  log_validation_status(rc, uri, roa_resources_malformed, generation);
-	  goto error;
-	}
+  assert(r - roa_ranges == n_roa);
 
-	if (memcmp(a_max, b_max, length) >= 0) {
-	  (void) sk_IPAddressOrRange_delete(aors, j + 1);
-	  IPAddressOrRange_free(b);
-	  --j;
-	}
-      }
-    }
-  }
+  qsort(roa_ranges, n_roa, sizeof(*roa_ranges), addr_range_cmp);
 
-  if (!v3_addr_canonize(roa_resources)) {
-    log_validation_status(rc, uri, roa_resources_malformed, generation);
-    goto error;
-  }
+  /*
+   * EE certificate resources were already decoded and cached by
+   * OpenSSL when check_x509() ran.  As with v3_addr_subset(), a
+   * missing or inherited EE resource set covers nothing.
+   */
 
-  if (!v3_addr_subset(roa_resources, ee_resources)) {
+  if (x->rfc3779_addr == NULL ||
+      (ee_ranges = addr_ranges_from_rfc3779(&w->arena, x->rfc3779_addr, &n_ee, &ee_inherit)) == NULL ||
+      ee_inherit ||
+      !addr_ranges_subset(roa_ranges, n_roa, ee_ranges, n_ee)) {
     log_validation_status(rc, uri, roa_resource_not_in_ee, generation);
     goto error;
   }
@@ -4807,11 +5376,9 @@ static int check_roa_1(rcynic_ctx_t *rc,
   result = 1;
 
  error:
-  BIO_free(bio);
+  arena_release(&w->arena, mark);
   ROA_free(roa);
   CMS_ContentInfo_free(cms);
-  sk_IPAddressFamily_pop_free(roa_resources, IPAddressFamily_free);
-  sk_IPAddressFamily_pop_free(ee_resources, IPAddressFamily_free);
 
   return result;
 }
@@ -4976,7 +5543,7 @@ static void rsync_sia_callback(rcynic_ctx_t *rc,
 
   if (status != rsync_status_pending) {
     w->state++;
-    task_add(rc, walk_cert, wsk);
+    task_add(rc, walk_cert, wsk, sk_walk_ctx_t_num(wsk));
     return;
   }
 
@@ -4990,7 +5557,7 @@ static void rsync_sia_callback(rcynic_ctx_t *rc,
   }
 
   walk_ctx_stack_pop(wsk);
-  task_add(rc, walk_cert, wsk);
+  task_add(rc, walk_cert, wsk, sk_walk_ctx_t_num(wsk));
 }
 
 /**
@@ -5005,6 +5572,13 @@ static void rsync_sia_callback(rcynic_ctx_t *rc,
  * case because we've already checked them by the time we get here, so
  * we just ignore them.  Other objects are either certificates or
  * CMS-signed objects of one kind or another.
+ *
+ * To keep rsync fed while we chew on large publication points, we
+ * yield back to the event loop after checking rc->task_quantum
+ * objects whenever there are rsync contexts waiting for attention.
+ * Tasks are prioritized by depth of the walk context stack, so that
+ * we finish deep subtrees (and queue whatever fetches they need)
+ * before going back to wider ones.
  */
 static void walk_cert(rcynic_ctx_t *rc, void *cookie)
 {
@@ -5014,11 +5588,17 @@ static void walk_cert(rcynic_ctx_t *rc, void *cookie)
   size_t hashlen;
   walk_ctx_t *w;
   uri_t uri;
+  int checked = 0;
 
   assert(rc && wsk);
 
   while ((w = walk_ctx_stack_head(wsk)) != NULL) {
 
+    if (rc->task_quantum > 0 && checked >= rc->task_quantum &&
+	sk_rsync_ctx_t_num(rc->rsync_queue) > 0 &&
+	task_add(rc, walk_cert, wsk, sk_walk_ctx_t_num(wsk)))
+      return;
+
     switch (w->state) {
     case walk_state_current:
       generation = object_generation_current;
@@ -5088,6 +5668,8 @@ static void walk_cert(rcynic_ctx_t *rc, void *cookie)
       else if (w->stale_manifest)
 	log_validation_status(rc, &uri, tainted_by_stale_manifest, generation);
 
+      checked++;
+
       if (endswith(uri.s, ".roa")) {
 	check_roa(rc, wsk, &uri, hash, hashlen);
 	walk_ctx_loop_next(rc, wsk);
@@ -5171,7 +5753,7 @@ static int check_ta(rcynic_ctx_t *rc, X509 *x, const uri_t *uri,
   }
 
   log_validation_status(rc, uri, object_accepted, generation);
-  task_add(rc, walk_cert, wsk);
+  task_add(rc, walk_cert, wsk, sk_walk_ctx_t_num(wsk));
   return 1;
 }
 
@@ -5671,6 +6253,7 @@ int main(int argc, char *argv[])
   rc.rsync_timeout = 300;
   rc.max_select_time = 30;
   rc.rsync_early = 1;
+  rc.task_quantum = 50;
 
 #define QQ(x,y)   rc.priority[x] = y;
   LOG_LEVELS;
@@ -5807,6 +6390,9 @@ int main(int argc, char *argv[])
     else if (!name_cmp(val->name, "rsync-program"))
       rc.rsync_program = strdup(val->value);
 
+    else if (!name_cmp(val->name, "rsync-stats-file"))
+      rc.rsync_stats_file = strdup(val->value);
+
     else if (!name_cmp(val->name, "lockfile"))
       lockfile = strdup(val->value);
 
@@ -5904,6 +6490,10 @@ int main(int argc, char *argv[])
 	     !configure_boolean(&rc, &rc.rsync_early, val->value))
       goto done;
 
+    else if (!name_cmp(val->name, "task-quantum") &&
+	     !configure_integer(&rc, &rc.task_quantum, val->value))
+      goto done;
+
     /*
      * Ugly, but the easiest way to handle all these strings.
      */
@@ -5925,6 +6515,13 @@ int main(int argc, char *argv[])
     goto done;
   }
 
+  if (rc.rsync_stats_file &&
+      ((rc.rsync_stats = sk_rsync_stats_t_new(rsync_stats_cmp)) == NULL ||
+       !read_rsync_stats(&rc))) {
+    logmsg(&rc, log_sys_err, "Couldn't load rsync statistics");
+    goto done;
+  }
+
   if ((rc.validation_status = sk_validation_status_t_new_null()) == NULL) {
     logmsg(&rc, log_sys_err, "Couldn't allocate validation_status stack");
     goto done;
@@ -6021,6 +6618,9 @@ int main(int argc, char *argv[])
 
   logmsg(&rc, log_telemetry, "Event loop done, beginning final output and cleanup");
 
+  if (!write_rsync_stats(&rc))
+    logmsg(&rc, log_sys_err, "Couldn't save rsync statistics, continuing anyway");
+
   if (!finalize_directories(&rc))
     goto done;
 
@@ -6044,14 +6644,18 @@ int main(int argc, char *argv[])
    */
   sk_validation_status_t_pop_free(rc.validation_status, validation_status_t_free);
   sk_rsync_history_t_pop_free(rc.rsync_history, rsync_history_t_free);
+  sk_rsync_stats_t_pop_free(rc.rsync_stats, rsync_stats_t_free);
   validation_status_t_free(rc.validation_status_in_waiting);
   X509_STORE_free(rc.x509_store);
+  BIO_free(rc.scratch_bio);
   NCONF_free(cfg_handle);
   CONF_modules_free();
   EVP_cleanup();
   ERR_free_strings();
   if (rc.rsync_program)
     free(rc.rsync_program);
+  if (rc.rsync_stats_file)
+    free(rc.rsync_stats_file);
   if (lockfile && lockfd >= 0 && !keep_lockfile)
     unlink(lockfile);
   if (lockfile)
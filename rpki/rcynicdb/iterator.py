@@ -39,13 +39,30 @@ def authenticated_objects(directory_tree = None, uri_suffix = None, class_map =
                          roa = rpki.POW.ROA)
 
     if directory_tree:
-        for head, dirs, files in os.walk(directory_tree):
-            for fn in files:
-                if uri_suffix is None or fn.endswith(uri_suffix):
-                    fn = os.path.join(head, fn)
-                    uri = "rsync://" + fn[len(directory_tree):].lstrip("/")
-                    yield uri, _uri_to_class(uri, class_map).derReadFile(fn)
-        return
+        for uri, fn in authenticated_files(directory_tree, uri_suffix):
+            yield uri, _uri_to_class(uri, class_map).derReadFile(fn)
+    else:
+        for uri, der in authenticated_der(uri_suffix):
+            yield uri, _uri_to_class(uri, class_map).derRead(der)
+
+def authenticated_files(directory_tree, uri_suffix = None):
+    """
+    Yield (uri, filename) pairs for objects in an old-style directory
+    tree, without reading them, for callers which want to hand the
+    whole lot to one of the batch functions in rpki.POW.
+    """
+
+    for head, dirs, files in os.walk(directory_tree):
+        for fn in files:
+            if uri_suffix is None or fn.endswith(uri_suffix):
+                fn = os.path.join(head, fn)
+                yield "rsync://" + fn[len(directory_tree):].lstrip("/"), fn
+
+def authenticated_der(uri_suffix = None):
+    """
+    Yield (uri, der) pairs for objects in the new-style database,
+    without parsing them.
+    """
 
     global initialized_django
     if not initialized_django:
@@ -61,4 +78,4 @@ def authenticated_objects(directory_tree = None, uri_suffix = None, class_map =
     
     q = auth.rpkiobject_set
     for obj in q.filter(uri__endswith = uri_suffix) if uri_suffix else q.all():
-        yield obj.uri, _uri_to_class(obj.uri, class_map).derRead(obj.der)
+        yield obj.uri, obj.der
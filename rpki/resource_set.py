@@ -30,7 +30,6 @@ We also provide some basic set operations (union, intersection, etc).
 """
 
 import re
-import math
 import rpki.exceptions
 import rpki.POW
 
@@ -221,23 +220,8 @@ class resource_range_ip(resource_range):
         prefixes.
         """
 
-        try:
-            self.prefixlen()
-            result.append(self)
-        except rpki.exceptions.MustBePrefix:
-            range_min = self.min
-            range_max = self.max
-            while range_max >= range_min:
-                bits = int(math.log(long(range_max - range_min + 1), 2))
-                while True:
-                    mask = ~(~0 << bits)
-                    assert range_min + mask <= range_max
-                    if range_min & mask == 0:
-                        break
-                    assert bits > 0
-                    bits -= 1
-                result.append(self.make_prefix(range_min, range_min.bits - bits))
-                range_min = range_min + mask + 1
+        result.extend(self.make_prefix(prefix, prefixlen)
+                      for prefix, prefixlen in rpki.POW.ResourceSet((self,), self.version).prefixes())
 
     @classmethod
     def from_strings(cls, a, b = None):
@@ -318,6 +302,11 @@ class resource_set(list):
     # Give pylint a little help here
     range_type = resource_range
 
+    ## @var POW_version
+    # Version argument for rpki.POW.ResourceSet: 0 for ASNs, else IP version.
+
+    POW_version = None
+
     def __init__(self, ini = None, allow_overlap = False):
         """
         Initialize a resource_set.
@@ -385,6 +374,40 @@ class resource_set(list):
         else:
             return ",".join(str(x) for x in self)
 
+    def to_POW(self):
+        """
+        Convert to an rpki.POW.ResourceSet, which does the heavy lifting
+        for set operations.
+        """
+
+        assert not self.inherit
+        self.canonize()
+        return rpki.POW.ResourceSet(self, self.POW_version)
+
+    def _operand_to_POW(self):
+        """
+        Convert the right-hand operand of a set operation to an
+        rpki.POW.ResourceSet.  Unlike to_POW(), an inherit set is
+        allowed here, and contributes no resources.
+        """
+
+        if self.inherit:
+            return rpki.POW.ResourceSet((), self.POW_version)
+        else:
+            return self.to_POW()
+
+    @classmethod
+    def from_POW(cls, rset):
+        """
+        Convert from an rpki.POW.ResourceSet.  The result is already in
+        canonical form, so we skip canonize().
+        """
+
+        self = cls()
+        list.extend(self, (cls.range_type(range_min, range_max) for range_min, range_max in rset.ranges()))
+        self.canonical = True
+        return self
+
     def _comm(self, other):
         """
         Like comm(1), sort of.
@@ -424,30 +447,8 @@ class resource_set(list):
         Set union for resource sets.
         """
 
-        assert not self.inherit
         assert type(self) is type(other), "Type mismatch: %r %r" % (type(self), type(other))
-        set1 = type(self)(self)             # clone and whack into canonical form
-        set2 = type(other)(other)           # ditto
-        result = []
-        while set1 or set2:
-            if set1 and (not set2 or set1[0].max < set2[0].min):
-                result.append(set1.pop(0))
-            elif set2 and (not set1 or set2[0].max < set1[0].min):
-                result.append(set2.pop(0))
-            else:
-                this = set1.pop(0)
-                that = set2.pop(0)
-                assert type(this) is type(that)
-                range_min = min(this.min, that.min)
-                range_max = max(this.max, that.max)
-                result.append(type(this)(range_min, range_max))
-                while set1 and set1[0].max <= range_max:
-                    assert set1[0].min >= range_min
-                    del set1[0]
-                while set2 and set2[0].max <= range_max:
-                    assert set2[0].min >= range_min
-                    del set2[0]
-        return type(self)(result)
+        return self.from_POW(self.to_POW().union(other._operand_to_POW()))
 
     __or__ = union
 
@@ -456,7 +457,8 @@ class resource_set(list):
         Set intersection for resource sets.
         """
 
-        return self._comm(other)[2]
+        assert type(self) is type(other), "Type mismatch: %r %r" % (type(self), type(other))
+        return self.from_POW(self.to_POW().intersection(other._operand_to_POW()))
 
     __and__ = intersection
 
@@ -465,7 +467,8 @@ class resource_set(list):
         Set difference for resource sets.
         """
 
-        return self._comm(other)[0]
+        assert type(self) is type(other), "Type mismatch: %r %r" % (type(self), type(other))
+        return self.from_POW(self.to_POW().difference(other._operand_to_POW()))
 
     __sub__ = difference
 
@@ -474,8 +477,8 @@ class resource_set(list):
         Set symmetric difference (XOR) for resource sets.
         """
 
-        com = self._comm(other)
-        return com[0] | com[1]
+        assert type(self) is type(other), "Type mismatch: %r %r" % (type(self), type(other))
+        return self.from_POW(self.to_POW().symmetric_difference(other._operand_to_POW()))
 
     __xor__ = symmetric_difference
 
@@ -511,10 +514,9 @@ class resource_set(list):
         Test whether self is a subset (possibly improper) of other.
         """
 
-        for i in self:
-            if not other.contains(i):
-                return False
-        return True
+        if len(self) == 0:
+            return True             # Includes inherit, as before
+        return self.to_POW().issubset(other.to_POW())
 
     __le__ = issubset
 
@@ -585,6 +587,8 @@ class resource_set_as(resource_set):
 
     range_type = resource_range_as
 
+    POW_version = 0
+
 class resource_set_ip(resource_set):
     """
     (Generic) IP address resource set.
@@ -599,12 +603,9 @@ class resource_set_ip(resource_set):
         """
 
         # pylint: disable=E1101
-        prefix_ranges = []
-        for r in self:
-            r.chop_into_prefixes(prefix_ranges)
         return self.roa_prefix_set_type([
-            self.roa_prefix_set_type.prefix_type(r.min, r.prefixlen())
-            for r in prefix_ranges])
+            self.roa_prefix_set_type.prefix_type(prefix, prefixlen)
+            for prefix, prefixlen in self.to_POW().prefixes()])
 
 class resource_set_ipv4(resource_set_ip):
     """
@@ -616,6 +617,8 @@ class resource_set_ipv4(resource_set_ip):
 
     range_type = resource_range_ipv4
 
+    POW_version = 4
+
 class resource_set_ipv6(resource_set_ip):
     """
     IPv6 address resource set.
@@ -626,6 +629,8 @@ class resource_set_ipv6(resource_set_ip):
 
     range_type = resource_range_ipv6
 
+    POW_version = 6
+
 class resource_bag(object):
     """
     Container to simplify passing around the usual triple of ASN, IPv4,
@@ -731,6 +736,38 @@ class resource_bag(object):
                    resource_set_ipv4(v4) if v4  else None,
                    resource_set_ipv6(v6) if v6  else None)
 
+    @classmethod
+    def from_POW_rfc3779_packed(cls, resources):
+        """
+        Build a resource_bag from data returned by
+        rpki.POW.X509.getRFC3779Packed().  This skips creating Python
+        objects for each range on the way in, and hands the packed
+        ranges straight to rpki.POW.ResourceSet for canonicalization.
+
+        rpki.POW.ResourceSet quietly merges overlapping ranges, so sort
+        the ranges and check for overlaps first, as canonize() would.
+        Packed values are fixed-width big-endian, so comparing the bytes
+        compares the values.
+        """
+
+        def convert(set_type, packed):
+            if packed == "inherit":
+                return set_type(inherit_token)
+            if not packed:
+                return None
+            width = 16 if set_type.POW_version == 6 else 4
+            if len(packed) % (2 * width) != 0:
+                raise ValueError("Packed %s length is not a multiple of the range length" % set_type.__name__)
+            ranges = sorted(packed[i : i + 2 * width] for i in xrange(0, len(packed), 2 * width))
+            for i in xrange(1, len(ranges)):
+                if ranges[i - 1][width:] >= ranges[i][:width]:
+                    raise rpki.exceptions.ResourceOverlap("Resource overlap in %s" % set_type.__name__)
+            return set_type.from_POW(rpki.POW.ResourceSet.fromPacked("".join(ranges), set_type.POW_version))
+
+        return cls(convert(resource_set_as,   resources[0]),
+                   convert(resource_set_ipv4, resources[1]),
+                   convert(resource_set_ipv6, resources[2]))
+
     def empty(self):
         """
         True iff all resource sets in this bag are empty.
@@ -1173,6 +1210,30 @@ if __name__ == "__main__":
               r1.to_resource_set(),
               r2.to_resource_set())
 
+    def test4(t, s):
+        print "x:  ", s
+        print "y:  ", inherit_token
+        r1 = t(s)
+        r2 = t(inherit_token)
+        assert (r1 | r2) == r1
+        assert (r1 - r2) == r1
+        assert (r1 ^ r2) == r1
+        assert not (r1 & r2)
+        print "x|y:", r1 | r2
+        print "x&y:", r1 & r2
+
+    def test5(*ranges):
+        import struct
+        packed = "".join(struct.pack("!LL", lo, hi) for lo, hi in ranges)
+        print "x:  ", ranges
+        try:
+            r = resource_bag.from_POW_rfc3779_packed((packed, None, None)).asn
+        except rpki.exceptions.ResourceOverlap:
+            r = None
+        print "r:  ", r
+        assert (r is None) == any(a != b and a[0] <= b[1] and b[0] <= a[1] for a in ranges for b in ranges)
+        assert r is None or r == resource_set_as(",".join("%d-%d" % lh for lh in ranges))
+
     print
     print "Testing set operations on resource sets"
     print
@@ -1207,3 +1268,21 @@ if __name__ == "__main__":
     test3(resource_set_ipv6, "2002:0a00:002c::1/128", "2002:0a00:002c::2/128")
     print
     test3(resource_set_ipv6, "2002:0a00:002c::1/128", "2002:0a00:002c::/120")
+    print
+    print "Testing set operations with an inherited operand"
+    print
+    test4(resource_set_as, "1,2,3,4,5,6,11,12,13,14,15")
+    print
+    test4(resource_set_ipv4, "10.0.0.44/32,10.6.0.2/32")
+    print
+    test4(resource_set_ipv6, "2002:0a00:002c::/120")
+    print
+    print "Testing packed RFC 3779 ranges"
+    print
+    test5((1, 5), (10, 20))
+    print
+    test5((10, 20), (1, 5))
+    print
+    test5((10, 20), (21, 30), (1, 9))
+    print
+    test5((10, 20), (1, 10))
@@ -0,0 +1,346 @@
+# $Id$
+#
+# Copyright (C) 2015-2016  Parsons Government Services ("PARSONS")
+# Portions copyright (C) 2014  Dragon Research Labs ("DRL")
+# Portions copyright (C) 2009-2013  Internet Systems Consortium ("ISC")
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notices and this permission notice appear in all copies.
+#
+# THE SOFTWARE IS PROVIDED "AS IS" AND PARSONS, DRL, AND ISC DISCLAIM
+# ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL
+# PARSONS, DRL, OR ISC BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+# CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+# OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+# NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+# WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+"""
+Load generator for the RPKI-RTR server: a fleet of simulated routers.
+"""
+
+import os
+import sys
+import math
+import time
+import socket
+import signal
+import logging
+import asyncore
+import resource
+import rpki.rtr.pdus
+import rpki.rtr.client
+import rpki.rtr.server
+
+from rpki.rtr.pdus import ResetQueryPDU, SerialQueryPDU
+
+
+def rss(pid = "self"):
+    """
+    Resident set size of a process in bytes, or None if we can't tell.
+    """
+
+    try:
+        with open("/proc/%s/status" % pid, "r") as f:
+            for line in f:
+                if line.startswith("VmRSS:"):
+                    return int(line.split()[1]) * 1024
+    except (IOError, ValueError):
+        pass
+    return None
+
+
+def percentile(values, q):
+    """
+    Nearest-rank percentile of a sorted list.
+    """
+
+    return values[max(0, int(math.ceil(q * len(values))) - 1)] if values else None
+
+
+class BenchChannel(rpki.rtr.client.ClientChannel):
+    """
+    One simulated router.  This uses the test client's PDU classes and
+    protocol engine, but only counts the data it receives rather than
+    keeping it, and times each query from when it was sent until End Of
+    Data arrives.
+    """
+
+    def __init__(self, sock, args, fleet):
+        self.fleet = fleet
+        self.sent = None
+        super(BenchChannel, self).__init__(sock = sock, proc = None, killsig = None, args = args,
+                                           host = "bench", port = len(fleet.sessions))
+
+    def push_pdu(self, pdu):
+        """
+        Note when each query goes out.
+        """
+
+        if isinstance(pdu, (ResetQueryPDU, SerialQueryPDU)):
+            self.sent = time.time()
+        super(BenchChannel, self).push_pdu(pdu)
+
+    def deliver_pdu(self, pdu):
+        """
+        Count received PDUs.  Answer every Serial Notify with a Serial
+        Query, even if the serial hasn't changed, so that forced notify
+        waves exercise the whole notify-query-response path.
+        """
+
+        self.fleet.pdus += 1
+        if isinstance(pdu, rpki.rtr.pdus.SerialNotifyPDU):
+            self.fleet.notified(self)
+            self.query()
+        else:
+            pdu.consume(self)
+
+    def query(self):
+        """
+        Send a Serial Query, or a Reset Query if we have no data yet.
+        """
+
+        if self.serial is None:
+            self.push_pdu(ResetQueryPDU(version = self.version))
+        else:
+            self.push_pdu(SerialQueryPDU(version = self.version, serial = self.serial, nonce = self.nonce))
+
+    def consume_prefix(self, prefix):
+        pass
+
+    def consume_routerkey(self, routerkey):
+        pass
+
+    def cache_reset(self):
+        self.serial = None
+
+    def end_of_data(self, version, serial, nonce, refresh, retry, expire):
+        """
+        Record new session state and report the response time.
+        """
+
+        self.serial = serial
+        self.nonce  = nonce
+        self.fleet.answered(self, time.time() - self.sent)
+
+    def handle_close(self):
+        """
+        Losing a session is worth noting, but not fatal.
+        """
+
+        logging.warning("[Server closed session %s]", self.port)
+        self.fleet.lost(self)
+        self.close()
+
+
+class Fleet(object):
+    """
+    A set of simulated routers, and the bookkeeping for one wave of
+    queries across all of them.
+    """
+
+    def __init__(self, args):
+        self.args = args
+        self.sessions = []
+        self.pending = set()
+        self.latencies = []
+        self.notify_latencies = []
+        self.pdus = 0
+        self.kicked = None
+
+    def notified(self, session):
+        if self.kicked is not None:
+            self.notify_latencies.append(time.time() - self.kicked)
+
+    def answered(self, session, latency):
+        if session in self.pending:
+            self.pending.discard(session)
+            self.latencies.append(latency)
+
+    def lost(self, session):
+        self.pending.discard(session)
+        if session in self.sessions:
+            self.sessions.remove(session)
+
+    def wave(self, name, start):
+        """
+        Run one wave: call start() to set it going, then run the event
+        loop until every session has received End Of Data (or we give
+        up), and print statistics.
+        """
+
+        self.pending = set(self.sessions)
+        self.latencies = []
+        self.notify_latencies = []
+        self.pdus = 0
+        t0 = time.time()
+        start()
+        while self.pending and time.time() < t0 + self.args.timeout:
+            asyncore.loop(timeout = 1, use_poll = True, count = 1)
+        elapsed = time.time() - t0
+        self.kicked = None
+
+        self.report(name, self.latencies, elapsed)
+        if self.notify_latencies:
+            self.report(name + " delivery", self.notify_latencies, None)
+        if self.pending:
+            print "%-16s %d session(s) didn't answer within %s seconds" % (name, len(self.pending), self.args.timeout)
+
+    def report(self, name, latencies, elapsed):
+        latencies = sorted(latencies)
+        if not latencies:
+            print "%-16s no responses" % name
+            return
+        text = "%-16s n %6d  p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms" % (
+            name, len(latencies),
+            percentile(latencies, 0.50) * 1000,
+            percentile(latencies, 0.99) * 1000,
+            latencies[-1] * 1000)
+        if elapsed:
+            text += "  %10.0f PDUs/s" % (self.pdus / elapsed)
+        print text
+        sys.stdout.flush()
+
+    def reset_storm(self):
+        for session in self.sessions:
+            session.push_pdu(ResetQueryPDU(version = session.version))
+
+    def serial_wave(self):
+        for session in self.sessions:
+            session.query()
+
+
+def run_server(args, socks, ready):
+    """
+    Child process: serve the fleet's sessions from one ServerListener,
+    as listener_main() would, but over socketpairs instead of TCP.
+    SIGUSR1 forces a Serial Notify to every session.
+    """
+
+    kicked = []
+    signal.signal(signal.SIGUSR1, lambda signum, frame: kicked.append(signum))
+    os.chdir(args.rpki_rtr_dir)
+    logger = logging.LoggerAdapter(logging.root, dict(connection = "/bench/server"))
+    server = rpki.rtr.server.ServerListener(sock = None, logger = logger, refresh = None, retry = None, expire = None)
+    rpki.rtr.server.start_notify_channel(server)
+    os.write(ready, "%d\n" % (rss() or 0))
+    os.close(ready)
+    for i, sock in enumerate(socks):
+        server.sessions.add(rpki.rtr.server.ServerChannel(
+            logger = logging.LoggerAdapter(logging.root, dict(connection = "/bench/%d" % i)),
+            refresh = None, retry = None, expire = None, sock = sock, listener = server))
+    while True:
+        asyncore.loop(timeout = 1, use_poll = True, count = 1)
+        if kicked:
+            del kicked[:]
+            for session in list(server.sessions):
+                session.notify(force = True)
+
+
+def bench_main(args):
+    """
+    Load test an RPKI-RTR server with a fleet of simulated routers.
+
+    With --rpki-rtr-dir, fork a local server for that database and talk
+    to it over socketpairs; otherwise connect over TCP to a running
+    server at --host and --port.  Once all sessions are up, run reset
+    storms (every session sends a Reset Query at once), serial query
+    waves, and, with a local server, forced Serial Notify waves.  For
+    each wave, report median and 99th percentile response latency and
+    the aggregate rate at which PDUs arrived, then report memory used
+    per session.
+
+    All simulated routers run in this one process and decode every PDU
+    in Python, so for large tables the load generator may saturate
+    before the server does; run several copies against a TCP server to
+    push harder.
+    """
+
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    if soft < hard:
+        resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+
+    args.sql_database = None
+    fleet = Fleet(args)
+    server_pid = None
+    server_rss = None
+
+    if args.rpki_rtr_dir:
+        pairs = [socket.socketpair() for i in xrange(args.sessions)]
+        ready_r, ready_w = os.pipe()
+        server_pid = os.fork()
+        if server_pid == 0:
+            try:
+                os.close(ready_r)
+                for pair in pairs:
+                    pair[1].close()
+                run_server(args, [pair[0] for pair in pairs], ready_w)
+            except:
+                logging.exception("[Local server failed]")
+            finally:
+                os._exit(1)
+        os.close(ready_w)
+        for pair in pairs:
+            pair[0].close()
+        with os.fdopen(ready_r, "r") as f:
+            server_rss = int(f.read() or 0)
+        socks = [pair[1] for pair in pairs]
+    else:
+        socks = [socket.create_connection((args.host, args.port)) for i in xrange(args.sessions)]
+
+    try:
+        client_rss = rss()
+        t0 = time.time()
+        for sock in socks:
+            fleet.sessions.append(BenchChannel(sock = sock, args = args, fleet = fleet))
+        print "%d session(s) up in %.2f s" % (len(fleet.sessions), time.time() - t0)
+
+        for i in xrange(args.resets):
+            fleet.wave("reset", fleet.reset_storm)
+        for i in xrange(args.serials):
+            fleet.wave("serial", fleet.serial_wave)
+        if server_pid is not None:
+            for i in xrange(args.notifies):
+                def kick():
+                    fleet.kicked = time.time()
+                    os.kill(server_pid, signal.SIGUSR1)
+                fleet.wave("notify", kick)
+
+        n = max(len(fleet.sessions), 1)
+        if client_rss and rss():
+            print "client memory    %10.1f KiB/session" % ((rss() - client_rss) / 1024.0 / n)
+        if server_rss and server_pid is not None and rss(server_pid):
+            print "server memory    %10.1f KiB/session" % ((rss(server_pid) - server_rss) / 1024.0 / n)
+
+    finally:
+        if server_pid is not None:
+            os.kill(server_pid, signal.SIGTERM)
+            os.waitpid(server_pid, 0)
+
+
+def argparse_setup(subparsers):
+    """
+    Set up argparse stuff for commands in this module.
+    """
+
+    def positive(v):
+        v = int(v)
+        if v <= 0:
+            raise ValueError
+        return v
+
+    subparser = subparsers.add_parser("bench", description = bench_main.__doc__,
+                                      help = "Load test an RPKI-RTR server")
+    subparser.set_defaults(func = bench_main, default_log_destination = "stderr")
+    subparser.add_argument("--sessions", type = positive, default = 1000, help = "number of simulated routers")
+    subparser.add_argument("--resets",   type = int, default = 3, help = "number of reset storms")
+    subparser.add_argument("--serials",  type = int, default = 3, help = "number of serial query waves")
+    subparser.add_argument("--notifies", type = int, default = 3, help = "number of Serial Notify waves (local server only)")
+    subparser.add_argument("--timeout",  type = positive, default = 300, help = "seconds to wait for each wave")
+    subparser.add_argument("--force-version", type = int, choices = rpki.rtr.pdus.PDU.version_map, help = "force specific protocol version")
+    group = subparser.add_mutually_exclusive_group(required = True)
+    group.add_argument("--rpki-rtr-dir", help = "run a local server for this RPKI-RTR database")
+    group.add_argument("--host", help = "server host")
+    subparser.add_argument("--port", type = int, default = 323, help = "server TCP port")
@@ -43,6 +43,26 @@ class IgnoreThisRecord(Exception):
     pass
 
 
+def origin_asn(as_path):
+    """
+    Extract the origin AS from a bgpdump AS path.  Returns None if the
+    origin can't be determined (empty path, AS_SET, or confederation).
+    """
+
+    if not as_path or "{" in as_path or "(" in as_path:
+        return None
+    a  = as_path.split()[-1]
+    if "." in a:
+        a = [int(s) for s in a.split(".")]
+        if len(a) != 2 or a[0] < 0 or a[0] > 65535 or a[1] < 0 or a[1] > 65535:
+            logging.warn("Bad dotted ASNum %r, ignoring record", as_path)
+            raise IgnoreThisRecord
+        a = (a[0] << 16) | a[1]
+    else:
+        a = int(a)
+    return a
+
+
 class PrefixPDU(rpki.rtr.generator.PrefixPDU):
 
     @staticmethod
@@ -66,18 +86,9 @@ class PrefixPDU(rpki.rtr.generator.PrefixPDU):
                 self.announce = 0
             else:
                 self.announce = 1
-                if not fields[6] or "{" in fields[6] or "(" in fields[6]:
+                self.asn = origin_asn(fields[6])
+                if self.asn is None:
                     raise IgnoreThisRecord
-                a  = fields[6].split()[-1]
-                if "." in a:
-                    a = [int(s) for s in a.split(".")]
-                    if len(a) != 2 or a[0] < 0 or a[0] > 65535 or a[1] < 0 or a[1] > 65535:
-                        logging.warn("Bad dotted ASNum %r, ignoring record", fields[6])
-                        raise IgnoreThisRecord
-                    a = (a[0] << 16) | a[1]
-                else:
-                    a = int(a)
-                self.asn = a
 
             self.check()
             return self
@@ -108,23 +119,22 @@ class AXFRSet(rpki.rtr.generator.AXFRSet):
         assert os.path.basename(filename).startswith("ribs.")
         self = cls(version = min(rpki.rtr.pdus.PDU.version_map))
         self.serial = None
+        pdus = []
         for line in cls.read_bgpdump(filename):
             try:
                 pfx = PrefixPDU.from_bgpdump(line, rib_dump = True)
             except IgnoreThisRecord:
                 continue
-            self.append(pfx)
+            pdus.append(pfx.to_pdu())
             self.serial = pfx.timestamp
         if self.serial is None:
             sys.exit("Failed to parse anything useful from %s" % filename)
-        self.sort()
-        for i in xrange(len(self) - 2, -1, -1):
-            if self[i] == self[i + 1]:
-                del self[i + 1]
+        self.pdus = rpki.POW.rtrSortPDUs("".join(pdus))
         return self
 
     def parse_bgpdump_update(self, filename):
         assert os.path.basename(filename).startswith("updates.")
+        pdus = list(self)
         for line in self.read_bgpdump(filename):
             try:
                 pfx = PrefixPDU.from_bgpdump(line, rib_dump = False)
@@ -132,14 +142,15 @@ class AXFRSet(rpki.rtr.generator.AXFRSet):
                 continue
             announce = pfx.announce
             pfx.announce = 1
-            i = bisect.bisect_left(self, pfx)
+            i = bisect.bisect_left(pdus, pfx)
             if announce:
-                if i >= len(self) or pfx != self[i]:
-                    self.insert(i, pfx)
+                if i >= len(pdus) or pfx != pdus[i]:
+                    pdus.insert(i, pfx)
             else:
-                while i < len(self) and pfx.prefix == self[i].prefix and pfx.prefixlen == self[i].prefixlen:
-                    del self[i]
+                while i < len(pdus) and pfx.prefix == pdus[i].prefix and pfx.prefixlen == pdus[i].prefixlen:
+                    del pdus[i]
             self.serial = pfx.timestamp
+        self.pdus = "".join(p.to_pdu() for p in pdus)
 
 
 def bgpdump_convert_main(args):
@@ -218,6 +229,7 @@ def bgpdump_select_main(args):
     if nonce is None:
         nonce = rpki.rtr.generator.AXFRSet.new_nonce(force_zero_nonce = False)
 
+    rpki.rtr.server.write_snapshot(AXFRSet.load(args.ax_file).pdus, serial, nonce, version)
     rpki.rtr.server.write_current(serial, nonce, version)
     rpki.rtr.generator.kick_all(serial)
 
@@ -274,7 +286,7 @@ def bgpdump_server_main(args):
                      * DEBUGGING AND TEST USE ONLY! *
 
     This is a clone of server_main() which replaces the external serial
-    number updates triggered via the kickme channel by cronjob_main with
+    number updates triggered via the notifier by cronjob_main with
     an internal clocking mechanism to replay historical test data.
 
     DO NOT USE THIS IN PRODUCTION.
@@ -297,6 +309,7 @@ def bgpdump_server_main(args):
     #
     clock = BGPDumpReplayClock()
     rpki.rtr.server.read_current = clock.read_current
+    rpki.rtr.server.disable_snapshots = True
 
     try:
         server = rpki.rtr.server.ServerChannel(logger = logger, refresh = args.refresh, retry = args.retry, expire = args.expire)
@@ -313,6 +326,48 @@ def bgpdump_server_main(args):
         sys.exit(0)
 
 
+def bgpdump_validate_main(args):
+    """
+    Perform RFC 6811 route origin validation of the routes in a set of
+    BGP dump files against an AXFR dump, and report how many routes are
+    valid, invalid, or not found.  Routes whose origin AS can't be
+    determined are checked too, and can only be invalid or not found.
+    """
+
+    table = rpki.POW.OriginValidator(AXFRSet.load(args.ax_file).pdus)
+    logging.debug("Loaded %d VRPs from %s", len(table), args.ax_file)
+
+    counts = { rpki.POW.ORIGIN_VALID : 0, rpki.POW.ORIGIN_INVALID : 0, rpki.POW.ORIGIN_NOT_FOUND : 0 }
+    routes = []
+
+    def validate():
+        for route, state in zip(routes, table.validate(routes)):
+            counts[state] += 1
+            if state == rpki.POW.ORIGIN_INVALID:
+                logging.debug("Invalid: %s/%d AS %s", route[0], route[1], route[2])
+        del routes[:]
+
+    for filename in args.files:
+        for line in AXFRSet.read_bgpdump(filename):
+            fields = line.split("|")
+            if len(fields) < 7 or fields[2] not in ("A", "B"):
+                continue
+            try:
+                p, l = fields[5].split("/")
+                routes.append((rpki.POW.IPAddress(p), int(l), origin_asn(fields[6])))
+            except IgnoreThisRecord:
+                continue
+            except Exception, e:
+                logging.warn("Ignoring line %r: %s", line, e)
+                continue
+            if len(routes) >= 10000:
+                validate()
+    validate()
+
+    logging.info("%d valid, %d invalid, %d not found",
+                 counts[rpki.POW.ORIGIN_VALID], counts[rpki.POW.ORIGIN_INVALID], counts[rpki.POW.ORIGIN_NOT_FOUND])
+
+
 def argparse_setup(subparsers):
     """
     Set up argparse stuff for commands in this module.
@@ -332,3 +387,9 @@ def argparse_setup(subparsers):
                                       help = "Replay fake ROAs generated from historical data")
     subparser.set_defaults(func = bgpdump_server_main, default_log_destination = "syslog")
     subparser.add_argument("rpki_rtr_dir", nargs = "?", help = "directory containing RPKI-RTR database")
+
+    subparser = subparsers.add_parser("bgpdump-validate", description = bgpdump_validate_main.__doc__,
+                                      help = "Validate routes in BGP dumps against an AXFR dump")
+    subparser.set_defaults(func = bgpdump_validate_main, default_log_destination = "stderr")
+    subparser.add_argument("ax_file", help = "name of the .ax file containing VRPs")
+    subparser.add_argument("files", nargs = "+", help = "BGP dump files")
@@ -28,6 +28,7 @@ import signal
 import logging
 import asyncore
 import subprocess
+import rpki.POW
 import rpki.rtr.pdus
 import rpki.rtr.channels
 
@@ -191,6 +192,8 @@ class ClientChannel(rpki.rtr.channels.PDUChannel):
         if args.force_version is not None:
             self.version = args.force_version
         self.start_new_pdu()
+        self.prefix_table = rpki.POW.PrefixTable()
+        self.pending_prefixes = []
         if args.sql_database:
             self.setup_sql()
 
@@ -356,6 +359,8 @@ class ClientChannel(rpki.rtr.channels.PDUChannel):
         """
 
         self.serial = None
+        self.prefix_table.clear()
+        self.pending_prefixes = []
         if self.sql:
             cur = self.sql.cursor()
             cur.execute("DELETE FROM prefix WHERE cache_id = ?", (self.cache_id,))
@@ -375,6 +380,9 @@ class ClientChannel(rpki.rtr.channels.PDUChannel):
         self.retry   = retry
         self.expire  = expire
         self.updated = Timestamp.now()
+        self.prefix_table.load("".join(self.pending_prefixes))
+        self.pending_prefixes = []
+        logging.debug("Prefix table now holds %d VRPs", len(self.prefix_table))
         if self.sql:
             self.sql.execute("UPDATE cache SET"
                              " version = ?, serial = ?, nonce  = ?,"
@@ -386,9 +394,11 @@ class ClientChannel(rpki.rtr.channels.PDUChannel):
 
     def consume_prefix(self, prefix):
         """
-        Handle one prefix PDU.
+        Handle one prefix PDU.  Prefixes are queued as wire-format PDUs
+        and bulk-loaded into the prefix table at End Of Data.
         """
 
+        self.pending_prefixes.append(prefix.to_pdu())
         if self.sql:
             values = (self.cache_id, prefix.asn, str(prefix.prefix), prefix.prefixlen, prefix.max_prefixlen)
             if prefix.announce:
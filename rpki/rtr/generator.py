@@ -24,7 +24,6 @@ Database generator for RPKI-RTR server (RFC 6810 et sequalia).
 import os
 import sys
 import glob
-import socket
 import base64
 import random
 import logging
@@ -37,7 +36,7 @@ import rpki.rtr.server
 
 from rpki.rtr.channels import Timestamp
 
-from rpki.rcynicdb.iterator import authenticated_objects
+from rpki.rcynicdb.iterator import authenticated_objects, authenticated_files, authenticated_der
 
 class PrefixPDU(rpki.rtr.pdus.PrefixPDU):
     """
@@ -178,38 +177,61 @@ class X509(rpki.POW.X509):              # pylint: disable=W0232
                     yield asn
 
 
-class PDUSet(list):
+class PDUSet(object):
     """
     Object representing a set of PDUs, that is, one versioned and
     (theoretically) consistant set of prefixes and router keys extracted
     from rcynic's output.
+
+    The PDUs are held in packed form, as the concatenation of their
+    wire format encodings, which is also how we store them on disk.
+    Iterating over a PDUSet decodes the PDUs into objects, which is
+    fine for display and testing but not something the production
+    code paths should need to do.
     """
 
-    def __init__(self, version):
+    def __init__(self, version, pdus = ""):
         assert version in rpki.rtr.pdus.PDU.version_map
-        super(PDUSet, self).__init__()
         self.version = version
+        self.pdus = pdus
 
-    @classmethod
-    def _load_file(cls, filename, version):
-        """
-        Low-level method to read PDUSet from a file.
-        """
+    def __len__(self):
+        return rpki.POW.rtrCountPDUs(self.pdus)
 
-        self = cls(version = version)
-        f = open(filename, "rb")
+    def __eq__(self, other):
+        return isinstance(other, PDUSet) and self.version == other.version and self.pdus == other.pdus
+
+    def __ne__(self, other):
+        return not self == other
+
+    def __iter__(self):
         r = rpki.rtr.channels.ReadBuffer()
+        i = 0
         while True:
             p = rpki.rtr.pdus.PDU.read_pdu(r)
             while p is None:
-                b = f.read(r.needed())
+                b = self.pdus[i : i + r.needed()]
+                i += len(b)
                 if b == "":
                     assert r.available() == 0
-                    return self
+                    return
                 r.put(b)
                 p = r.retry()
             assert p.version == self.version
-            self.append(p)
+            yield p
+
+    @classmethod
+    def _load_file(cls, filename, version):
+        """
+        Low-level method to read PDUSet from a file.
+        """
+
+        with open(filename, "rb") as f:
+            self = cls(version = version, pdus = f.read())
+        rpki.POW.rtrCountPDUs(self.pdus, True)
+        if self.pdus and ord(self.pdus[0]) != version:
+            raise rpki.rtr.pdus.CorruptData("%s contains PDUs for the wrong protocol version" % filename)
+        return self
 
     @staticmethod
     def seq_ge(a, b):
@@ -229,7 +251,7 @@ class AXFRSet(PDUSet):
     serial = None
 
     @classmethod
-    def parse_rcynic(cls, rcynic_dir, version, scan_roas = None, scan_routercerts = None):
+    def parse_rcynic(cls, rcynic_dir, version, scan_roas = None, scan_routercerts = None, threads = 0):
         """
         Parse ROAS and router certificates fetched (and validated!) by
         rcynic to create a new AXFRSet.
@@ -241,19 +263,27 @@ class AXFRSet(PDUSet):
         At some point the ability to parse these data from external
         programs may move to a separate constructor function, so that we
         can make this one a bit simpler and faster.
+
+        ROAs are decoded, encoded, and sorted by rpki.POW.rtrScanROAs(),
+        using the specified number of extra threads.
         """
 
         self = cls(version = version)
         self.serial = rpki.rtr.channels.Timestamp.now()
 
+        pdus = []
+
         include_routercerts = RouterKeyPDU.pdu_type in rpki.rtr.pdus.PDU.version_map[version]
 
         if scan_roas is None:
-            for uri, roa in authenticated_objects(rcynic_dir, uri_suffix = ".roa", class_map = self.class_map):
-                roa.extractWithoutVerifying()
-                asn = roa.getASID()
-                self.extend(PrefixPDU.from_roa(version = version, asn = asn, prefix_tuple = prefix_tuple)
-                            for prefix_tuple in roa.prefixes)
+            if rcynic_dir:
+                uris, objects = zip(*authenticated_files(rcynic_dir, uri_suffix = ".roa")) or ((), ())
+            else:
+                uris, objects = zip(*authenticated_der(uri_suffix = ".roa")) or ((), ())
+            roas, failed = rpki.POW.rtrScanROAs(objects, version, files = bool(rcynic_dir), threads = threads)
+            for i in failed:
+                logging.warning("Couldn't extract payload from ROA %s, skipping", uris[i])
+            pdus.append(roas)
 
         if scan_routercerts is None and include_routercerts:
             for uri, cer in authenticated_objects(rcynic_dir, uri_suffix = ".cer", class_map = self.class_map):
@@ -261,7 +291,7 @@ class AXFRSet(PDUSet):
                 if eku is not None and rpki.oids.id_kp_bgpsec_router in eku:
                     ski = cer.getSKI()
                     key = cer.getPublicKey().derWritePublic()
-                    self.extend(RouterKeyPDU.from_certificate(version = version, asn = asn, ski = ski, key = key)
+                    pdus.extend(RouterKeyPDU.from_certificate(version = version, asn = asn, ski = ski, key = key).to_pdu()
                                 for asn in cer.asns)
 
         if scan_roas is not None:
@@ -270,7 +300,7 @@ class AXFRSet(PDUSet):
                 for line in p.stdout:
                     line = line.split()
                     asn = line[1]
-                    self.extend(PrefixPDU.from_text(version = version, asn = asn, addr = addr)
+                    pdus.extend(PrefixPDU.from_text(version = version, asn = asn, addr = addr).to_pdu()
                                 for addr in line[2:])
             except OSError, e:
                 sys.exit("Could not run %s: %s" % (scan_roas, e))
@@ -282,15 +312,12 @@ class AXFRSet(PDUSet):
                     line = line.split()
                     gski = line[0]
                     key  = line[-1]
-                    self.extend(RouterKeyPDU.from_text(version = version, asn = asn, gski = gski, key = key)
+                    pdus.extend(RouterKeyPDU.from_text(version = version, asn = asn, gski = gski, key = key).to_pdu()
                                 for asn in line[1:-1])
             except OSError, e:
                 sys.exit("Could not run %s: %s" % (scan_routercerts, e))
 
-        self.sort()
-        for i in xrange(len(self) - 2, -1, -1):
-            if self[i] == self[i + 1]:
-                del self[i + 1]
+        self.pdus = rpki.POW.rtrSortPDUs("".join(pdus))
         return self
 
     @classmethod
@@ -333,8 +360,7 @@ class AXFRSet(PDUSet):
         """
 
         f = open(self.filename(), "wb")
-        for p in self:
-            f.write(p.to_pdu())
+        f.write(self.pdus)
         f.close()
 
     def destroy_old_data(self):
@@ -365,8 +391,9 @@ class AXFRSet(PDUSet):
     def mark_current(self, force_zero_nonce = False):
         """
         Save current serial number and nonce, creating new nonce if
-        necessary.  Creating a new nonce triggers cleanup of old state, as
-        the new nonce invalidates all old serial numbers.
+        necessary, and publish this AXFRSet as the current snapshot.
+        Creating a new nonce triggers cleanup of old state, as the new
+        nonce invalidates all old serial numbers.
         """
 
         assert self.version in rpki.rtr.pdus.PDU.version_map
@@ -375,6 +402,7 @@ class AXFRSet(PDUSet):
             logging.debug("Creating new nonce and deleting stale data")
             nonce = self.new_nonce(force_zero_nonce)
             self.destroy_old_data()
+        rpki.rtr.server.write_snapshot(self.pdus, self.serial, nonce, self.version)
         rpki.rtr.server.write_current(self.serial, nonce, self.version)
 
     def save_ixfr(self, other):
@@ -382,29 +410,12 @@ class AXFRSet(PDUSet):
         Comparing this AXFRSet with an older one and write the resulting
         IXFRSet to file with magic filename.  Since we store PDUSets
         in sorted order, computing the difference is a trivial linear
-        comparison.
+        comparison, which rpki.POW.rtrDiffPDUs() does on the packed
+        form without decoding anything.
         """
 
         f = open("%d.ix.%d.v%d" % (self.serial, other.serial, self.version), "wb")
-        old = other
-        new = self
-        len_old = len(old)
-        len_new = len(new)
-        i_old = i_new = 0
-        while i_old < len_old and i_new < len_new:
-            if old[i_old] < new[i_new]:
-                f.write(old[i_old].to_pdu(announce = 0))
-                i_old += 1
-            elif old[i_old] > new[i_new]:
-                f.write(new[i_new].to_pdu(announce = 1))
-                i_new += 1
-            else:
-                i_old += 1
-                i_new += 1
-        for i in xrange(i_old, len_old):
-            f.write(old[i].to_pdu(announce = 0))
-        for i in xrange(i_new, len_new):
-            f.write(new[i].to_pdu(announce = 1))
+        f.write(rpki.POW.rtrDiffPDUs(other.pdus, self.pdus))
         f.close()
 
     def show(self):
@@ -465,30 +476,31 @@ class IXFRSet(PDUSet):
 
 def kick_all(serial):
     """
-    Kick any existing server processes to wake them up.
+    Kick any existing server processes to wake them up.  Servers all
+    watch the notifier directory, so atomically replacing the notifier
+    file wakes every one of them, however many there are.
     """
 
     try:
-        os.stat(rpki.rtr.server.kickme_dir)
+        os.stat(rpki.rtr.server.notify_dir)
     except OSError:
-        logging.debug('# Creating directory "%s"', rpki.rtr.server.kickme_dir)
-        os.makedirs(rpki.rtr.server.kickme_dir)
+        logging.debug('# Creating directory "%s"', rpki.rtr.server.notify_dir)
+        os.makedirs(rpki.rtr.server.notify_dir)
 
-    msg = "Good morning, serial %d is ready" % serial
-    sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
-    for name in glob.iglob("%s.*" % rpki.rtr.server.kickme_base):
+    fn = rpki.rtr.server.notify_name
+    tn = "%s.%d.tmp" % (fn, os.getpid())
+    try:
+        with open(tn, "w") as f:
+            f.write("Good morning, serial %d is ready" % serial)
+        os.chmod(tn, 0644)
+        os.rename(tn, fn)
+        logging.debug("# Kicked servers via %s", fn)
+    except Exception, e:
+        logging.warning("# Failed to kick servers via %s: %s", fn, e)
         try:
-            logging.debug("# Kicking %s", name)
-            sock.sendto(msg, name)
-        except socket.error:
-            try:
-                logging.exception("# Failed to kick %s, probably dead socket, attempting cleanup", name)
-                os.unlink(name)
-            except Exception, e:
-                logging.exception("# Couldn't unlink suspected dead socket %s: %s", name, e)
-        except Exception, e:
-            logging.warning("# Failed to kick %s and don't understand why: %s", name, e)
-    sock.close()
+            os.unlink(tn)
+        except OSError:
+            pass
 
 
 def cronjob_main(args):
@@ -496,10 +508,12 @@ def cronjob_main(args):
     Run this right after running rcynic to wade through the ROAs and
     router certificates that rcynic collects and translate that data
     into the form used in the rpki-router protocol.  Output is an
-    updated database containing both full dumps (AXFR) and incremental
-    dumps against a specific prior version (IXFR).  After updating the
-    database, kicks any active servers, so that they can notify their
-    clients that a new version is available.
+    updated database containing both full dumps (AXFR) and a chain of
+    incremental dumps (IXFR), each against the version immediately
+    preceding it, from which servers compose responses for older
+    versions on demand.  After updating the database, kicks any active
+    servers, so that they can notify their clients that a new version
+    is available.
     """
 
     if args.rpki_rtr_dir:
@@ -515,8 +529,6 @@ def cronjob_main(args):
 
         logging.debug("# Generating updates for protocol version %d", version)
 
-        old_ixfrs = glob.glob("*.ix.*.v%d" % version)
-
         current = rpki.rtr.server.read_current(version)[0]
         cutoff = Timestamp.now(-(24 * 60 * 60))
         for f in glob.iglob("*.ax.v%d" % version):
@@ -524,29 +536,27 @@ def cronjob_main(args):
             if  t < cutoff and t != current:
                 logging.debug("# Deleting old file %s, timestamp %s", f, t)
                 os.unlink(f)
+        for f in glob.iglob("*.ix.*.v%d" % version):
+            t = Timestamp(int(f.split(".")[2]))
+            if t < cutoff:
+                logging.debug("# Deleting old file %s, timestamp %s", f, t)
+                os.unlink(f)
 
-        pdus = rpki.rtr.generator.AXFRSet.parse_rcynic(args.rcynic_dir, version, args.scan_roas, args.scan_routercerts)
-        if pdus == rpki.rtr.generator.AXFRSet.load_current(version):
+        pdus = rpki.rtr.generator.AXFRSet.parse_rcynic(args.rcynic_dir, version, args.scan_roas, args.scan_routercerts,
+                                                       threads = args.threads)
+        prev = rpki.rtr.generator.AXFRSet.load_current(version)
+        if pdus == prev:
             logging.debug("# No change, new serial not needed")
             continue
         pdus.save_axfr()
-        for axfr in glob.iglob("*.ax.v%d" % version):
-            if axfr != pdus.filename():
-                pdus.save_ixfr(rpki.rtr.generator.AXFRSet.load(axfr))
+        if prev is not None:
+            pdus.save_ixfr(prev)
         pdus.mark_current(args.force_zero_nonce)
 
         logging.debug("# New serial is %d (%s)", pdus.serial, pdus.serial)
 
         rpki.rtr.generator.kick_all(pdus.serial)
 
-        old_ixfrs.sort()
-        for ixfr in old_ixfrs:
-            try:
-                logging.debug("# Deleting old file %s", ixfr)
-                os.unlink(ixfr)
-            except OSError:
-                pass
-
 
 def show_main(args):
     """
@@ -580,6 +590,7 @@ def argparse_setup(subparsers):
     subparser.add_argument("--scan-roas", help = "specify an external scan_roas program")
     subparser.add_argument("--scan-routercerts", help = "specify an external scan_routercerts program")
     subparser.add_argument("--force_zero_nonce", action = "store_true", help = "force nonce value of zero")
+    subparser.add_argument("--threads", type = int, default = 0, help = "number of extra threads to use for scanning ROAs")
     subparser.add_argument("rcynic_dir", nargs = "?", help = "directory containing validated rcynic output tree")
     subparser.add_argument("rpki_rtr_dir", nargs = "?", help = "directory containing RPKI-RTR database")
 
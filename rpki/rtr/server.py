@@ -23,11 +23,14 @@ Server implementation for the RPKI-RTR protocol (RFC 6810 et sequalia).
 
 import os
 import sys
+import glob
 import errno
+import struct
 import socket
 import signal
 import logging
 import asyncore
+import asynchat
 import rpki.POW
 import rpki.oids
 import rpki.rtr.pdus
@@ -39,9 +42,13 @@ from rpki.rtr.pdus import (clone_pdu_root, CacheResponsePDU, EndOfDataPDU, Cache
 # Disable incremental updates.  Debugging only, should be False in production.
 disable_incrementals = False
 
+# Ignore AXFR snapshots and use current.vN and .ax files instead.  Only
+# for test harnesses which fake the serial number, should be False in production.
+disable_snapshots = False
+
 # These should be configurable in some sane fashion.
-kickme_dir  = "sockets"
-kickme_base = os.path.join(kickme_dir, "kickme")
+notify_dir  = "sockets"
+notify_name = os.path.join(notify_dir, "notify")
 
 
 class PDU(rpki.rtr.pdus.PDU):
@@ -68,6 +75,36 @@ class PDU(rpki.rtr.pdus.PDU):
                                      retry   = server.retry,
                                      expire  = server.expire))
 
+    def send_snapshot(self, server, snapshot):
+        """
+        Send the PDUs from an AXFR snapshot as a cache response.
+        """
+
+        server.push_pdu(CacheResponsePDU(version = server.version,
+                                         nonce   = server.current_nonce))
+        server.push_with_producer(snapshot.producer(server.ac_out_buffer_size))
+        server.push_pdu(EndOfDataPDU(version = server.version,
+                                     serial  = server.current_serial,
+                                     nonce   = server.current_nonce,
+                                     refresh = server.refresh,
+                                     retry   = server.retry,
+                                     expire  = server.expire))
+
+    def send_packed(self, server, pdus):
+        """
+        Send a string of packed PDUs as a cache response.
+        """
+
+        server.push_pdu(CacheResponsePDU(version = server.version,
+                                         nonce   = server.current_nonce))
+        server.push(pdus)
+        server.push_pdu(EndOfDataPDU(version = server.version,
+                                     serial  = server.current_serial,
+                                     nonce   = server.current_nonce,
+                                     refresh = server.refresh,
+                                     retry   = server.retry,
+                                     expire  = server.expire))
+
     def send_nodata(self, server):
         """
         Send a nodata error.
@@ -113,10 +150,12 @@ class SerialQueryPDU(PDU, rpki.rtr.pdus.SerialQueryPDU):
         elif disable_incrementals:
             server.push_pdu(CacheResetPDU(version = server.version))
         else:
-            try:
-                self.send_file(server, "%d.ix.%d.v%d" % (server.current_serial, self.serial, server.version))
-            except IOError:
+            pdus = server.get_history().ixfr(self.serial, server.current_serial)
+            if pdus is None:
+                server.logger.info("[No delta chain from serial %d, resetting client]", self.serial)
                 server.push_pdu(CacheResetPDU(version = server.version))
+            else:
+                self.send_packed(server, pdus)
 
 
 @clone_pdu
@@ -133,6 +172,8 @@ class ResetQueryPDU(PDU, rpki.rtr.pdus.ResetQueryPDU):
         server.logger.debug(self)
         if server.get_serial() is None:
             self.send_nodata(server)
+        elif server.snapshot is not None:
+            self.send_snapshot(server, server.snapshot)
         else:
             try:
                 fn = "%d.ax.v%d" % (server.current_serial, server.version)
@@ -159,7 +200,7 @@ class ErrorReportPDU(rpki.rtr.pdus.ErrorReportPDU):
         server.logger.error(self)
         if self.errno in self.fatal:
             server.logger.error("[Shutting down due to reported fatal protocol error]")
-            sys.exit(1)
+            server.shutdown(1)
 
 
 def read_current(version):
@@ -181,6 +222,19 @@ def read_current(version):
         return None, None
 
 
+def file_signature(filename):
+    """
+    Identify one version of a file which the cronjob replaces by
+    renaming a new file over it, or None if the file doesn't exist.
+    """
+
+    try:
+        st = os.stat(filename)
+    except OSError:
+        return None
+    return st.st_dev, st.st_ino, st.st_size, st.st_mtime
+
+
 def write_current(serial, nonce, version):
     """
     Write serial number and nonce.
@@ -193,6 +247,190 @@ def write_current(serial, nonce, version):
     os.rename(tmpfn, curfn)
 
 
+class Snapshot(object):
+    """
+    AXFR snapshot, published by the cronjob as an immutable file which
+    it replaces atomically for each new serial.  The header carries the
+    serial number and nonce, so a snapshot is always self-consistent,
+    and one open file (and the page cache behind it) serves every
+    session: resets go out with sendfile() straight from the file,
+    without the PDUs ever passing through Python.
+
+    The file consists of the header followed by the sorted packed PDUs.
+    """
+
+    header_struct = struct.Struct("!8sBxHLLLL")
+    magic = "RTRSNAP2"
+
+    def __init__(self, filename):
+        self.path = filename
+        self.file = open(filename, "rb")
+        try:
+            st = os.fstat(self.file.fileno())
+            self.signature = st.st_dev, st.st_ino, st.st_size, st.st_mtime
+            (magic, self.version, self.nonce, self.serial, self.pdu_count,
+             self.pdu_offset, self.pdu_length) = self.header_struct.unpack(
+                 self.file.read(self.header_struct.size))
+            if magic != self.magic or self.pdu_offset + self.pdu_length > st.st_size:
+                raise ValueError("%s is not a valid AXFR snapshot" % filename)
+        except:
+            self.close()
+            raise
+
+    @staticmethod
+    def filename(version):
+        return "snapshot.v%d" % version
+
+    def is_current(self):
+        """
+        Check whether this is still the published snapshot, that is,
+        whether the cronjob hasn't replaced the file since we opened it.
+        """
+
+        return file_signature(self.path) == self.signature
+
+    def close(self):
+        self.file.close()
+
+    def producer(self, buffersize):
+        """
+        Return a producer which sends this snapshot's PDUs.  The
+        producer gets its own descriptor, so it doesn't care whether
+        this snapshot has been replaced by the time it finishes.
+        """
+
+        return SendfileProducer(os.fdopen(os.dup(self.file.fileno()), "rb"), buffersize,
+                                offset = self.pdu_offset, size = self.pdu_length)
+
+
+def read_snapshot(version):
+    """
+    Open current AXFR snapshot.  Return None if there isn't one.
+    """
+
+    if version is None or disable_snapshots:
+        return None
+    try:
+        snapshot = Snapshot(Snapshot.filename(version))
+    except (IOError, OSError, ValueError, struct.error):
+        return None
+    if snapshot.version != version:
+        snapshot.close()
+        return None
+    return snapshot
+
+
+def write_snapshot(pdus, serial, nonce, version):
+    """
+    Write AXFR snapshot from packed PDUs.  The new file replaces the
+    old one atomically, so servers see either the old snapshot or the
+    new one, never a partial file.
+    """
+
+    header = Snapshot.header_struct.pack(Snapshot.magic, version, nonce, serial,
+                                         rpki.POW.rtrCountPDUs(pdus),
+                                         Snapshot.header_struct.size, len(pdus))
+    snapfn = Snapshot.filename(version)
+    tmpfn = snapfn + ".%d.tmp" % os.getpid()
+    with open(tmpfn, "wb") as f:
+        f.write(header)
+        f.write(pdus)
+        f.flush()
+        os.fsync(f.fileno())
+    os.rename(tmpfn, snapfn)
+
+
+class DeltaHistory(object):
+    """
+    In-memory chain of the per-serial deltas written by the cronjob,
+    from which we compose an IXFR from any retained serial number to
+    the current one on demand.
+
+    Each delta file NEW.ix.OLD.vN holds the sorted changes from serial
+    OLD to serial NEW.  Delta files never change once written, so we
+    read each one at most once, and remember composed results until
+    the set of deltas changes.
+    """
+
+    def __init__(self, version):
+        self.version = version
+        self.deltas = {}                # filename -> packed PDUs
+        self.composed = {}              # (from, to) -> packed PDUs
+        self.links = None               # from serial -> [(to serial, filename)]
+
+    @staticmethod
+    def seq_ge(a, b):
+        return ((a - b) % (1 << 32)) < (1 << 31)
+
+    def refresh(self):
+        """
+        Rescan delta files.  Called when the cronjob kicks us.
+        """
+
+        self.links = None
+        self.composed.clear()
+
+    def scan(self):
+        """
+        Build the map of available deltas, dropping any we've cached
+        whose files have since been deleted.
+        """
+
+        self.links = {}
+        seen = set()
+        for fn in glob.iglob("*.ix.*.v%d" % self.version):
+            fn1, fn2, fn3, fn4 = fn.split(".")
+            if fn1.isdigit() and fn3.isdigit():
+                self.links.setdefault(int(fn3), []).append((int(fn1), fn))
+                seen.add(fn)
+        for fn in set(self.deltas) - seen:
+            del self.deltas[fn]
+
+    def delta(self, filename):
+        """
+        Return the content of one delta file.
+        """
+
+        if filename not in self.deltas:
+            with open(filename, "rb") as f:
+                self.deltas[filename] = f.read()
+        return self.deltas[filename]
+
+    def ixfr(self, from_serial, to_serial):
+        """
+        Return packed IXFR from from_serial to to_serial, or None if
+        the retained deltas don't reach.  At each step we take the
+        longest jump which doesn't overshoot, so direct deltas written
+        by older versions of the cronjob are used when present.
+        """
+
+        key = (from_serial, to_serial)
+        if key in self.composed:
+            return self.composed[key]
+        if self.links is None:
+            self.scan()
+        pdus = None
+        serial = from_serial
+        try:
+            for i in xrange(len(self.links)):
+                if serial == to_serial:
+                    break
+                steps = [(n, fn) for n, fn in self.links.get(serial, ()) if self.seq_ge(to_serial, n)]
+                if not steps:
+                    return None
+                n, fn = max(steps, key = lambda step: (step[0] - serial) % (1 << 32))
+                d = self.delta(fn)
+                pdus = d if pdus is None else rpki.POW.rtrComposePDUs(pdus, d)
+                serial = n
+            if serial != to_serial:
+                return None
+        except IOError:
+            self.links = None
+            return None
+        self.composed[key] = pdus
+        return pdus
+
+
 class FileProducer(object):
     """
     File-based producer object for asynchat.
@@ -206,7 +444,73 @@ class FileProducer(object):
         return self.handle.read(self.buffersize)
 
 
-class ServerWriteChannel(rpki.rtr.channels.PDUChannel):
+class SendfileProducer(FileProducer):
+    """
+    File-based producer which channels using SendfileMixin can send
+    with sendfile(), straight from the page cache to the socket.  Still
+    works as an ordinary producer if the kernel won't cooperate.
+    """
+
+    def __init__(self, handle, buffersize, offset = 0, size = None):
+        super(SendfileProducer, self).__init__(handle, buffersize)
+        if size is None:
+            size = os.fstat(handle.fileno()).st_size - offset
+        self.offset = offset
+        self.end = offset + size
+        self.use_sendfile = True
+
+    def more(self):
+        self.handle.seek(self.offset)
+        data = self.handle.read(min(self.buffersize, self.end - self.offset))
+        self.offset += len(data)
+        return data
+
+    def sendfile(self, fd):
+        """
+        Send as much as the output will take, return True when done.
+        """
+
+        n = rpki.POW.sendfile(fd, self.handle.fileno(), self.offset, self.end - self.offset)
+        self.offset += n
+        return n == 0 or self.offset >= self.end
+
+
+class SendfileMixin(object):
+    """
+    Mixin for asynchat channels which handles SendfileProducers in the
+    output queue by calling sendfile() rather than reading the file
+    into Python.  Everything else goes through asynchat as usual.
+    """
+
+    # Errors which mean the peer has gone away, as in asyncore's send().
+    disconnected = frozenset((errno.ECONNRESET, errno.ENOTCONN, errno.ESHUTDOWN,
+                              errno.ECONNABORTED, errno.EPIPE, errno.EBADF))
+
+    def initiate_send(self):
+        while self.producer_fifo and self.connected:
+            first = self.producer_fifo[0]
+            if not isinstance(first, SendfileProducer) or not first.use_sendfile:
+                break
+            try:
+                done = first.sendfile(self.socket.fileno())
+            except OSError, e:
+                if e.errno in (errno.EAGAIN, errno.EWOULDBLOCK):
+                    return
+                if e.errno in self.disconnected:
+                    self.handle_close()
+                    return
+                if e.errno not in (errno.EINVAL, errno.ENOSYS):
+                    raise
+                first.use_sendfile = False
+                break
+            if not done:
+                return
+            first.handle.close()
+            del self.producer_fifo[0]
+        asynchat.async_chat.initiate_send(self)
+
+
+class ServerWriteChannel(SendfileMixin, rpki.rtr.channels.PDUChannel):
     """
     Kludge to deal with ssh's habit of sometimes (compile time option)
     invoking us with two unidirectional pipes instead of one
@@ -236,27 +540,39 @@ class ServerWriteChannel(rpki.rtr.channels.PDUChannel):
         """
 
         try:
-            self.push_with_producer(FileProducer(f, self.ac_out_buffer_size))
+            self.push_with_producer(SendfileProducer(f, self.ac_out_buffer_size))
         except OSError, e:
             if e.errno != errno.EAGAIN:
                 raise
 
 
-class ServerChannel(rpki.rtr.channels.PDUChannel):
+class ServerChannel(SendfileMixin, rpki.rtr.channels.PDUChannel):
     """
     Server protocol engine, handles upcalls from PDUChannel to
     implement protocol logic.
+
+    Runs either standalone on stdin and stdout (one process per
+    session, as under inetd or ssh), or as one of many sessions on
+    sockets accepted by a ServerListener in a single process.
     """
 
-    def __init__(self, logger, refresh, retry, expire):
+    def __init__(self, logger, refresh, retry, expire, sock = None, listener = None):
         """
-        Set up stdin and stdout as connection and start listening for
-        first PDU.
+        Set up connection and start listening for first PDU.  With no
+        socket, use stdin and stdout.
         """
 
-        super(ServerChannel, self).__init__(root_pdu_class = PDU)
-        self.init_file_dispatcher(sys.stdin.fileno())
-        self.writer = ServerWriteChannel()
+        super(ServerChannel, self).__init__(root_pdu_class = PDU, sock = sock)
+        if sock is None:
+            self.init_file_dispatcher(sys.stdin.fileno())
+            self.writer = ServerWriteChannel()
+        else:
+            self.writer = None
+        self.listener = listener
+        self.history = None
+        self.snapshot = None
+        self.current_serial = None
+        self.current_nonce = None
         self.logger = logger
         self.refresh = refresh
         self.retry = retry
@@ -266,38 +582,84 @@ class ServerChannel(rpki.rtr.channels.PDUChannel):
 
     def writable(self):
         """
-        This channel is never writable.
+        Standalone, this channel is never writable, output goes to
+        the writer channel.
         """
 
-        return False
+        return self.writer is None and asynchat.async_chat.writable(self)
 
     def push(self, data):
         """
-        Redirect to writer channel.
+        Redirect to writer channel, if we have one.
         """
 
-        return self.writer.push(data)
+        if self.writer is None:
+            return asynchat.async_chat.push(self, data)
+        else:
+            return self.writer.push(data)
 
     def push_with_producer(self, producer):
         """
-        Redirect to writer channel.
+        Redirect to writer channel, if we have one.
         """
 
-        return self.writer.push_with_producer(producer)
+        if self.writer is None:
+            return asynchat.async_chat.push_with_producer(self, producer)
+        else:
+            return self.writer.push_with_producer(producer)
 
     def push_pdu(self, pdu):
         """
-        Redirect to writer channel.
+        Redirect to writer channel, if we have one.
         """
 
-        return self.writer.push_pdu(pdu)
+        if self.writer is None:
+            return super(ServerChannel, self).push_pdu(pdu)
+        else:
+            return self.writer.push_pdu(pdu)
 
     def push_file(self, f):
         """
-        Redirect to writer channel.
+        Redirect to writer channel, if we have one.
         """
 
-        return self.writer.push_file(f)
+        if self.writer is None:
+            return self.push_with_producer(SendfileProducer(f, self.ac_out_buffer_size))
+        else:
+            return self.writer.push_file(f)
+
+    def shutdown(self, status = 0):
+        """
+        Shut down this session.  Standalone, that means exiting.
+        """
+
+        if self.listener is None:
+            sys.exit(status)
+        self.close()
+        self.listener.remove_session(self)
+
+    def handle_close(self):
+        """
+        Connection closed.
+        """
+
+        if self.listener is None:
+            super(ServerChannel, self).handle_close()
+        else:
+            self.logger.debug("[Connection closed]")
+            self.shutdown()
+
+    def handle_error(self):
+        """
+        Handle errors caught by asyncore main loop.  In a listener,
+        one broken session shouldn't take down all the others.
+        """
+
+        if self.listener is None:
+            super(ServerChannel, self).handle_error()
+        else:
+            self.logger.exception("[Unhandled exception, closing session]")
+            self.shutdown()
 
     def deliver_pdu(self, pdu):
         """
@@ -312,11 +674,56 @@ class ServerChannel(rpki.rtr.channels.PDUChannel):
         find the serial number file.  The latter condition should never
         happen, but maybe we got started in server mode while the cronjob
         mode instance is still building its database.
+
+        When there's an AXFR snapshot, the serial number and nonce come
+        from its header.  We keep the snapshot until we're kicked or
+        until the cronjob replaces it, which we check for with a stat()
+        each time, so that we stay current even with no notifier.
         """
 
-        self.current_serial, self.current_nonce = read_current(self.version)
+        if self.listener is not None:
+            self.snapshot = self.listener.get_snapshot(self.version)
+        elif self.snapshot is None or not self.snapshot.is_current():
+            if self.snapshot is not None:
+                self.snapshot.close()
+            self.snapshot = read_snapshot(self.version)
+        if self.snapshot is not None:
+            current = self.snapshot.serial, self.snapshot.nonce
+        elif self.listener is None:
+            current = read_current(self.version)
+        else:
+            current = self.listener.read_current(self.version)
+        if self.listener is None and self.history is not None and current != (self.current_serial, self.current_nonce):
+            self.history.refresh()
+        self.current_serial, self.current_nonce = current
         return self.current_serial
 
+    def flush_cache(self):
+        """
+        Forget cached snapshot and delta chains.  Under a listener, the
+        listener owns those, and flushes them itself.
+        """
+
+        if self.listener is not None:
+            return
+        if self.snapshot is not None:
+            self.snapshot.close()
+            self.snapshot = None
+        if self.history is not None:
+            self.history.refresh()
+
+    def get_history(self):
+        """
+        Return the delta history for our protocol version, shared with
+        other sessions when running under a listener.
+        """
+
+        if self.listener is not None:
+            return self.listener.get_history(self.version)
+        if self.history is None:
+            self.history = DeltaHistory(self.version)
+        return self.history
+
     def check_serial(self):
         """
         Check for a new serial number.
@@ -336,6 +743,7 @@ class ServerChannel(rpki.rtr.channels.PDUChannel):
         whether we care about a particular change set or not.
         """
 
+        self.flush_cache()
         if force or self.check_serial():
             self.push_pdu(SerialNotifyPDU(version = self.version,
                                           serial  = self.current_serial,
@@ -344,58 +752,225 @@ class ServerChannel(rpki.rtr.channels.PDUChannel):
             self.logger.debug("Cronjob kicked me but I see no serial change, ignoring")
 
 
-class KickmeChannel(asyncore.dispatcher, object):
+class ServerListener(asyncore.dispatcher, object):
+    """
+    TCP listener running any number of ServerChannel sessions in one
+    process, sharing one cached copy of the current serial numbers and
+    one notifier watch, so that a kick turns into Serial Notify PDUs to
+    every session in a single pass.
+    """
+
+    def __init__(self, sock, logger, refresh, retry, expire):
+        asyncore.dispatcher.__init__(self, sock)            # Old-style class
+        self.accepting = True                               # Caller already called listen()
+        self.logger = logger
+        self.refresh = refresh
+        self.retry = retry
+        self.expire = expire
+        self.sessions = set()
+        self.current = {}
+        self.history = {}
+        self.snapshots = {}
+        self.signatures = {}
+
+    def writable(self):
+        """
+        Listening socket is never writable.
+        """
+
+        return False
+
+    def handle_accept(self):
+        """
+        Accept a new connection and start a session on it.
+        """
+
+        pair = self.accept()
+        if pair is None:
+            return
+        sock, ai = pair
+        host, port = ai[:2]
+        tag = "/tcp/%s.%s" % (host, port) if ":" in host else "/tcp/%s:%s" % (host, port)
+        logger = logging.LoggerAdapter(logging.root, dict(connection = tag))
+        logger.debug("[Received connection]")
+        self.sessions.add(ServerChannel(logger = logger, refresh = self.refresh, retry = self.retry,
+                                        expire = self.expire, sock = sock, listener = self))
+
+    def remove_session(self, session):
+        """
+        Forget about a session which has gone away.
+        """
+
+        self.sessions.discard(session)
+
+    def revalidate(self, version):
+        """
+        Flush cached state for one protocol version if the cronjob has
+        replaced the files behind it since we last looked.  This costs
+        a couple of stat() calls per query, and means that sessions see
+        new data when their refresh timers expire even if the notifier
+        isn't running.
+        """
+
+        if version is None:
+            return
+        signature = (file_signature(Snapshot.filename(version)),
+                     file_signature("current.v%d" % version))
+        if self.signatures.get(version) != signature:
+            self.flush_cache(version)
+            self.signatures[version] = signature
+
+    def read_current(self, version):
+        """
+        Cached version of read_current(), shared by all sessions.
+        """
+
+        self.revalidate(version)
+        if version not in self.current:
+            self.current[version] = read_current(version)
+        return self.current[version]
+
+    def get_snapshot(self, version):
+        """
+        AXFR snapshot for one protocol version, shared by all sessions.
+        """
+
+        self.revalidate(version)
+        if version not in self.snapshots:
+            self.snapshots[version] = read_snapshot(version)
+        return self.snapshots[version]
+
+    def flush_cache(self, version = None):
+        """
+        Forget cached serial numbers, snapshots, and delta chains, for
+        one protocol version or for all of them.
+        """
+
+        for v in self.current.keys() if version is None else (version,):
+            self.current.pop(v, None)
+        for v in self.snapshots.keys() if version is None else (version,):
+            snapshot = self.snapshots.pop(v, None)
+            if snapshot is not None:
+                snapshot.close()
+        for v in self.history.keys() if version is None else (version,):
+            if v in self.history:
+                self.history[v].refresh()
+        if version is None:
+            self.signatures.clear()
+
+    def get_history(self, version):
+        """
+        Delta history for one protocol version, shared by all sessions.
+        """
+
+        if version not in self.history:
+            self.history[version] = DeltaHistory(version)
+        return self.history[version]
+
+    def notify(self, data = None):
+        """
+        Cronjob instance kicked us: flush cached serial numbers,
+        snapshots, and delta chains, then let each session decide
+        whether it needs to notify its client.
+        """
+
+        self.flush_cache()
+        self.logger.debug("[Notifying %d session(s)]", len(self.sessions))
+        for session in list(self.sessions):
+            try:
+                session.notify(data)
+            except Exception:
+                session.logger.exception("[Couldn't notify session, closing it]")
+                session.shutdown()
+
+    def log(self, msg):
+        """
+        Intercept asyncore's logging.
+        """
+
+        self.logger.info(msg)
+
+    def log_info(self, msg, tag = "info"):
+        """
+        Intercept asyncore's logging.
+        """
+
+        self.logger.info("asyncore: %s: %s", tag, msg)
+
+    def handle_error(self):
+        """
+        Handle errors caught by asyncore main loop.
+        """
+
+        self.logger.exception("[Unhandled exception in listener]")
+
+
+class NotifyChannel(asyncore.file_dispatcher, object):
     """
-    asyncore dispatcher for the PF_UNIX socket that cronjob mode uses to
-    kick servers when it's time to send notify PDUs to clients.
+    asyncore dispatcher watching the notifier directory, where cronjob
+    mode replaces the notifier file when it's time to send notify PDUs
+    to clients.  Every server process subscribes once, and the kernel
+    wakes all of them when the file is replaced, so the cronjob's cost
+    doesn't depend on how many servers are running.
     """
 
+    # How many errors in a row we put up with, reopening the watch each
+    # time, before giving up on the notifier.
+    max_failures = 5
+
     def __init__(self, server):
-        asyncore.dispatcher.__init__(self)                  # Old-style class
         self.server = server
-        self.sockname = "%s.%d" % (kickme_base, os.getpid())
-        self.create_socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        self.failures = 0
+        if not os.path.isdir(notify_dir):
+            os.makedirs(notify_dir)
+        fd = rpki.POW.watchDirectory(notify_dir)
         try:
-            self.bind(self.sockname)
-            os.chmod(self.sockname, 0660)
-        except socket.error, e:
-            self.server.logger.exception("Couldn't bind() kickme socket: %r", e)
-            self.close()
-        except OSError, e:
-            self.server.logger.exception("Couldn't chmod() kickme socket: %r", e)
+            asyncore.file_dispatcher.__init__(self, fd)     # Old-style class
+        finally:
+            os.close(fd)
 
-    def writable(self):
+    def reopen(self):
         """
-        This socket is read-only, never writable.
+        Replace the watch descriptor with a fresh one, discarding any
+        events queued on the old one.
         """
 
-        return False
+        self.del_channel()
+        self.socket.close()
+        fd = rpki.POW.watchDirectory(notify_dir)
+        try:
+            self.set_file(fd)
+        finally:
+            os.close(fd)
 
-    def handle_connect(self):
+    def writable(self):
         """
-        Ignore connect events (not very useful on datagram socket).
+        This descriptor is read-only, never writable.
         """
 
-        pass
+        return False
 
     def handle_read(self):
         """
-        Handle receipt of a datagram.
+        Handle notifier events.
         """
 
-        data = self.recv(512)
+        if rpki.POW.watchEvents(self.socket.fileno()) == 0:
+            return
+        try:
+            with open(notify_name, "r") as f:
+                data = f.read(512)
+        except IOError:
+            data = None
         self.server.notify(data)
+        self.failures = 0
 
     def cleanup(self):
         """
-        Clean up this dispatcher's socket.
+        Clean up this dispatcher's descriptor.
         """
 
         self.close()
-        try:
-            os.unlink(self.sockname)
-        except:
-            pass
 
     def log(self, msg):
         """
@@ -413,12 +988,45 @@ class KickmeChannel(asyncore.dispatcher, object):
 
     def handle_error(self):
         """
-        Handle errors caught by asyncore main loop.
+        Handle errors caught by asyncore main loop.  Losing the notifier
+        isn't worth losing the server over.  Reopen the watch, since the
+        old one may have unread events that would only fail again, and
+        check for anything we missed.  If that keeps failing, give up
+        on the notifier and leave clients to pick up new data when
+        their refresh timers expire, which works because the server
+        checks its cached data against the files on every query.
         """
 
-        self.server.logger.exception("[Unhandled exception]")
-        self.server.logger.critical("[Exiting after unhandled exception]")
-        sys.exit(1)
+        self.failures += 1
+        self.server.logger.exception("[Unhandled exception in notifier (%d in a row)]", self.failures)
+        if self.failures <= self.max_failures:
+            try:
+                self.reopen()
+            except Exception:
+                self.server.logger.exception("[Couldn't reopen notifier watch]")
+            else:
+                try:
+                    self.server.notify()
+                except Exception:
+                    self.server.logger.exception("[Couldn't check for changes after reopening notifier watch]")
+                return
+        self.server.logger.warning("[Serial Notify disabled, clients will rely on refresh timers]")
+        self.close()
+        self.server.flush_cache()
+
+
+def start_notify_channel(server):
+    """
+    Subscribe a server to the notifier, or log why we couldn't.  Without
+    the notifier the server still works, but clients only find out about
+    new data when their refresh timers expire.
+    """
+
+    try:
+        return NotifyChannel(server = server)
+    except (OSError, NotImplementedError), e:
+        server.logger.warning("Couldn't watch notifier directory %s, Serial Notify disabled: %s", notify_dir, e)
+        return None
 
 
 def hostport_tag():
@@ -470,9 +1078,8 @@ def hostport_tag():
 
 def server_main(args):
     """
-    Implement the server side of the rpkk-router protocol.  Other than
-    one PF_UNIX socket inode, this doesn't write anything to disk, so it
-    can be run with minimal privileges.  Most of the work has already
+    Implement the server side of the rpkk-router protocol.  This doesn't
+    write anything to disk, so it can be run with minimal privileges.  Most of the work has already
     been done by the database generator, so all this server has to do is
     pass the results along to a client.
     """
@@ -488,18 +1095,18 @@ def server_main(args):
             logger.error("[Couldn't chdir(%r), exiting: %s]", args.rpki_rtr_dir, e)
             sys.exit(1)
 
-    kickme = None
+    notifier = None
     try:
         server = rpki.rtr.server.ServerChannel(logger = logger, refresh = args.refresh, retry = args.retry, expire = args.expire)
-        kickme = rpki.rtr.server.KickmeChannel(server = server)
+        notifier = rpki.rtr.server.start_notify_channel(server)
         asyncore.loop(timeout = None)
         signal.signal(signal.SIGINT, signal.SIG_IGN) # Theorized race condition
     except KeyboardInterrupt:
         sys.exit(0)
     finally:
         signal.signal(signal.SIGINT, signal.SIG_IGN) # Observed race condition
-        if kickme is not None:
-            kickme.cleanup()
+        if notifier is not None:
+            notifier.cleanup()
 
 
 def listener_main(args):
@@ -508,11 +1115,20 @@ def listener_main(args):
     implement this because it's all that the routers currently support.
     In theory, we will all be running TCP-AO in the future, at which
     point this listener will go away or become a TCP-AO listener.
+
+    All sessions run in this one process.
     """
 
     # Perhaps we should daemonize?  Deal with that later.
 
-    # server_main() handles args.rpki_rtr_dir.
+    logger = logging.LoggerAdapter(logging.root, dict(connection = "/tcp/listener"))
+
+    if args.rpki_rtr_dir:
+        try:
+            os.chdir(args.rpki_rtr_dir)
+        except OSError, e:
+            logger.error("[Couldn't chdir(%r), exiting: %s]", args.rpki_rtr_dir, e)
+            sys.exit(1)
 
     listener = None
     try:
@@ -528,33 +1144,22 @@ def listener_main(args):
     except AttributeError:
         pass
     listener.bind(("", args.port))
-    listener.listen(5)
-    logging.debug("[Listening on port %s]", args.port)
-    while True:
-        try:
-            s, ai = listener.accept()
-        except KeyboardInterrupt:
-            sys.exit(0)
-        logging.debug("[Received connection from %r]", ai)
-        pid = os.fork()
-        if pid == 0:
-            os.dup2(s.fileno(), 0)      # pylint: disable=E1101
-            os.dup2(s.fileno(), 1)      # pylint: disable=E1101
-            s.close()
-            #os.closerange(3, os.sysconf("SC_OPEN_MAX"))
-            server_main(args)
-            sys.exit()
-        else:
-            logging.debug("[Spawned server %d]", pid)
-            while True:
-                try:
-                    pid, status = os.waitpid(0, os.WNOHANG)
-                    if pid:
-                        logging.debug("[Server %s exited with status 0x%x]", pid, status)
-                        continue
-                except:
-                    pass
-                break
+    listener.listen(socket.SOMAXCONN)
+    logger.debug("[Listening on port %s]", args.port)
+
+    notifier = None
+    try:
+        server = ServerListener(sock = listener, logger = logger,
+                                refresh = args.refresh, retry = args.retry, expire = args.expire)
+        notifier = start_notify_channel(server)
+        asyncore.loop(timeout = None, use_poll = True)
+        signal.signal(signal.SIGINT, signal.SIG_IGN) # Theorized race condition
+    except KeyboardInterrupt:
+        sys.exit(0)
+    finally:
+        signal.signal(signal.SIGINT, signal.SIG_IGN) # Observed race condition
+        if notifier is not None:
+            notifier.cleanup()
 
 
 def argparse_setup(subparsers):
@@ -569,7 +569,7 @@ class DER_object(object):
         Get RFC 3779 resources as rpki.resource_set objects.
         """
 
-        resources = rpki.resource_set.resource_bag.from_POW_rfc3779(self.get_POW().getRFC3779())
+        resources = rpki.resource_set.resource_bag.from_POW_rfc3779_packed(self.get_POW().getRFC3779Packed())
         try:
             resources.valid_until = self.getNotAfter()          # pylint: disable=E1101
         except AttributeError: